@@ -22,6 +22,7 @@ extern "C"
 
 #include "rosidl_generator_c/service_type_support_struct.h"
 
+#include "rcl/dispatch.h"
 #include "rcl/macros.h"
 #include "rcl/node.h"
 #include "rcl/visibility_control.h"
@@ -43,6 +44,8 @@ typedef struct rcl_client_options_t
   /// Custom allocator for the client, used for incidental allocations.
   /** For default behavior (malloc/free), use: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
+  /// How urgently the client is handled once it is ready.
+  rcl_dispatch_attributes_t dispatch;
 } rcl_client_options_t;
 
 /// Return a rcl_client_t struct with members set to `NULL`.
@@ -159,6 +162,51 @@ rcl_client_init(
   const char * service_name,
   const rcl_client_options_t * options);
 
+/// Initialize several clients of a node at once.
+/**
+ * This is equivalent to calling rcl_client_init() for each client, in array
+ * order, with the type support, service name and options of the same index.
+ * The names are resolved in a single pass first though, which sets up the
+ * substitutions and the remap rules of the node only once, so bringing up a
+ * node with many clients costs less.
+ *
+ * Either every client is initialized or none is: when one of them fails, those
+ * initialized before it are finalized again and left zero initialized.
+ * Each client is finalized on its own with rcl_client_fini().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] clients array of count zero initialized client handles
+ * \param[in] node valid rcl node handle
+ * \param[in] type_supports array of count type supports
+ * \param[in] service_names array of count service names
+ * \param[in] options array of count client options
+ * \param[in] count the number of clients to initialize
+ * \return `RCL_RET_OK` if every client was initialized successfully, or
+ * \return `RCL_RET_NODE_INVALID` if the node is invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if a client is already initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_SERVICE_NAME_INVALID` if a given service name is invalid, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_clients_init_bulk(
+  rcl_client_t * clients,
+  const rcl_node_t * node,
+  const rosidl_service_type_support_t * const * type_supports,
+  const char * const * service_names,
+  const rcl_client_options_t * options,
+  size_t count);
+
 /// Finalize a rcl_client_t.
 /**
  * After calling this function, calls to rcl_send_request() and
@@ -191,6 +239,7 @@ rcl_client_fini(rcl_client_t * client, rcl_node_t * node);
  *
  * - qos = rmw_qos_profile_services_default
  * - allocator = rcl_get_default_allocator()
+ * - dispatch = zero initialized, a priority of `0` and no deadline
  */
 RCL_PUBLIC
 RCL_WARN_UNUSED
@@ -0,0 +1,167 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__CONTENT_FILTER_H_
+#define RCL__CONTENT_FILTER_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+
+#include "rcl/allocator.h"
+#include "rcl/macros.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+/// Maximum number of intermediate results an expression may need during evaluation.
+#define RCL_CONTENT_FILTER_MAX_DEPTH 64u
+
+struct rcl_content_filter_impl_t;
+
+/// Structure which encapsulates a compiled content filter expression.
+typedef struct rcl_content_filter_t
+{
+  /// Private implementation pointer.
+  struct rcl_content_filter_impl_t * impl;
+} rcl_content_filter_t;
+
+/// Return a zero initialized content filter.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_content_filter_t
+rcl_get_zero_initialized_content_filter(void);
+
+/// Compile a content filter expression.
+/**
+ * A content filter decides whether a serialized message is accepted by
+ * reading fields directly out of its CDR payload, so that rejected messages
+ * are never deserialized.
+ * The expression is compiled once into a small program, which is then
+ * evaluated for each message by rcl_content_filter_evaluate().
+ *
+ * Since the payload is not deserialized, fields are addressed by their type
+ * and their offset in bytes after the 4 byte encapsulation header of the
+ * payload, which is where CDR alignment starts.
+ * Fields before the first string or sequence of a message are at fixed
+ * offsets, e.g. a `string` following an `int32` and a `uint32` is at offset
+ * `8`.
+ *
+ * The grammar of an expression is:
+ *
+ * ```
+ * expression := and ( '||' and )*
+ * and        := unary ( '&&' unary )*
+ * unary      := '!' unary | '(' expression ')' | comparison
+ * comparison := type '@' offset operator literal
+ * type       := 'bool' | 'int8' | 'uint8' | 'int16' | 'uint16' | 'int32' | 'uint32'
+ *             | 'int64' | 'uint64' | 'float32' | 'float64' | 'string'
+ * operator   := '==' | '!=' | '<' | '<=' | '>' | '>='
+ * ```
+ *
+ * where offset is a decimal number and literal is `true` or `false` for
+ * `bool` fields, a decimal or `0x` prefixed hexadecimal integer in the range
+ * of the type for integer fields, a decimal number for floating point fields,
+ * and a double quoted string, in which `\"` and `\\` are escaped, for
+ * `string` fields.
+ * Strings are ordered byte by byte, and whitespace between tokens is ignored.
+ * For example `uint32@4 > 100 && string@8 == "base_link"`.
+ *
+ * The content filter handle must be a pointer to an allocated and zero
+ * initialized rcl_content_filter_t struct.
+ * The expression is not needed anymore once this function returns.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] filter the content filter handle to be initialized
+ * \param[in] expression the null terminated expression to compile
+ * \param[in] allocator the allocator to use for the compiled program
+ * \return `RCL_RET_OK` if the expression was compiled successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, including
+ *         an expression which does not follow the grammar, or
+ * \return `RCL_RET_ALREADY_INIT` if the content filter was already initialized, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_content_filter_init(
+  rcl_content_filter_t * filter,
+  const char * expression,
+  rcl_allocator_t allocator);
+
+/// Finalize a content filter.
+/**
+ * Calling this function on a zero initialized content filter does nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] filter the content filter handle to be finalized
+ * \return `RCL_RET_OK` if the content filter was finalized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_content_filter_fini(rcl_content_filter_t * filter);
+
+/// Evaluate a content filter against a serialized message.
+/**
+ * The byte order of the fields is taken from the encapsulation header of the
+ * payload.
+ * A comparison of a field which does not fit in the payload is false, so a
+ * truncated message is only accepted if the expression does not depend on
+ * the missing fields.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] filter the initialized content filter to evaluate
+ * \param[in] serialized_message the CDR serialized message to evaluate it against
+ * \param[out] accepted true if the message matches the expression
+ * \return `RCL_RET_OK` if the content filter was evaluated successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_content_filter_evaluate(
+  const rcl_content_filter_t * filter,
+  const rcl_serialized_message_t * serialized_message,
+  bool * accepted);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__CONTENT_FILTER_H_
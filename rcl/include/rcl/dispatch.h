@@ -0,0 +1,63 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__DISPATCH_H_
+#define RCL__DISPATCH_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/// Order in which the entities found ready by a wait are handled.
+/**
+ * \see rcl_wait_set_sort_ready_entities
+ */
+typedef enum rcl_dispatch_order_t
+{
+  /// Order of the storage arrays of the wait set, the order of rcl_wait().
+  RCL_DISPATCH_ORDER_WAIT_SET,
+  /// Highest priority first, then earliest deadline first.
+  RCL_DISPATCH_ORDER_PRIORITY,
+  /// Earliest deadline first, then highest priority first.
+  RCL_DISPATCH_ORDER_EARLIEST_DEADLINE
+} rcl_dispatch_order_t;
+
+/// How urgently an entity has to be handled once it is ready.
+/**
+ * Subscriptions, clients and services take these from their options, timers
+ * have them set with rcl_timer_set_dispatch_attributes().
+ * Zero initialized attributes are the defaults, a priority of `0` and no
+ * deadline.
+ */
+typedef struct rcl_dispatch_attributes_t
+{
+  /// Entities with a higher priority are handled first.
+  int32_t priority;
+  /// Time within which the entity should be handled, in nanoseconds, or `0` for none.
+  /**
+   * For a timer the deadline is relative to the time the timer was due,
+   * for other entities it is relative to the time the wait found them ready.
+   * Entities without a deadline are handled after all those which have one.
+   */
+  int64_t deadline;
+} rcl_dispatch_attributes_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__DISPATCH_H_
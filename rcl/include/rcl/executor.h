@@ -0,0 +1,394 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__EXECUTOR_H_
+#define RCL__EXECUTOR_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rmw/types.h"
+
+#include "rcl/allocator.h"
+#include "rcl/client.h"
+#include "rcl/context.h"
+#include "rcl/dispatch.h"
+#include "rcl/guard_condition.h"
+#include "rcl/macros.h"
+#include "rcl/service.h"
+#include "rcl/subscription.h"
+#include "rcl/timer.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+struct rcl_executor_impl_t;
+
+/// Structure which encapsulates an executor.
+typedef struct rcl_executor_t
+{
+  /// Private implementation pointer.
+  struct rcl_executor_impl_t * impl;
+} rcl_executor_t;
+
+/// Options available for an rcl executor.
+typedef struct rcl_executor_options_t
+{
+  /// Number of threads executing callbacks while spinning, including the spinning thread.
+  /** With one thread, rcl_executor_spin() does not start any thread. */
+  size_t thread_count;
+  /// Order in which the entities found ready by a wait are executed.
+  /**
+   * With more than one thread the order is kept within the queue of each
+   * thread, see rcl_wait_set_sort_ready_entities().
+   */
+  rcl_dispatch_order_t dispatch_order;
+  /// Custom allocator for the executor, used for registering entities, not while spinning.
+  rcl_allocator_t allocator;
+} rcl_executor_options_t;
+
+/// User callback for messages taken by the executor.
+/**
+ * The first argument is the message taken, stored in the message given when
+ * the subscription was added.
+ * The second argument is the information about the message.
+ * The third argument is the user data given when the subscription was added.
+ */
+typedef void (* rcl_executor_subscription_callback_t)(
+  void *, const rmw_message_info_t *, void *);
+
+/// User callback for requests taken by the executor.
+/**
+ * The first argument is the header of the request, which is used to send the
+ * response.
+ * The second argument is the request taken and the third is the response to
+ * fill, stored in the request and response given when the service was added.
+ * The response is sent once the callback returns.
+ * The fourth argument is the user data given when the service was added.
+ */
+typedef void (* rcl_executor_service_callback_t)(
+  const rmw_request_id_t *, void *, void *, void *);
+
+/// User callback for responses taken by the executor.
+/**
+ * The first argument is the header of the response, identifying the request.
+ * The second argument is the response taken, stored in the response given
+ * when the client was added.
+ * The third argument is the user data given when the client was added.
+ */
+typedef void (* rcl_executor_client_callback_t)(const rmw_request_id_t *, void *, void *);
+
+/// User callback for triggered guard conditions.
+/**
+ * The argument is the user data given when the guard condition was added.
+ */
+typedef void (* rcl_executor_guard_condition_callback_t)(void *);
+
+/// Return the default executor options in a rcl_executor_options_t.
+/**
+ * The defaults are:
+ *
+ * - thread_count = 1
+ * - dispatch_order = RCL_DISPATCH_ORDER_WAIT_SET
+ * - allocator = rcl_get_default_allocator()
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_executor_options_t
+rcl_executor_get_default_options(void);
+
+/// Return a zero initialized executor.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_executor_t
+rcl_get_zero_initialized_executor(void);
+
+/// Initialize an executor.
+/**
+ * An executor implements the loop of waiting for entities to be ready, taking
+ * their data and calling the user callbacks, over a wait set.
+ * Subscriptions, timers, services, clients and guard conditions are added to
+ * it along with their callbacks, and the storage for the data taken from
+ * them, and are then executed by rcl_executor_spin_some() or
+ * rcl_executor_spin().
+ *
+ * Memory is only allocated when entities are added, spinning does not
+ * allocate memory in rcl, although the middleware may when taking data.
+ *
+ * With more than one thread, rcl_executor_spin() runs callbacks concurrently.
+ * One thread at a time waits on the wait set, and spreads the ready entities
+ * over the queues of all threads.
+ * Each thread executes the work at the front of its own queue first, and
+ * steals work from the back of the queues of the other threads when its own
+ * queue is empty.
+ * An entity is never executed by two threads at the same time: it is left
+ * out of the wait set until its callback returned.
+ * The wait set is persistent, see rcl_wait_set_set_persistent(), so the
+ * entities are added to it once, and only the executed ones are removed and
+ * added again between waits.
+ *
+ * Expected usage:
+ *
+ * ```c
+ * #include <rcl/rcl.h>
+ * #include <rcl/executor.h>
+ *
+ * rcl_context_t * context;  // initialized previously by rcl_init()...
+ * rcl_subscription_t subscription;  // initialized previously...
+ * std_msgs__msg__String msg;  // initialized previously...
+ * rcl_executor_t executor = rcl_get_zero_initialized_executor();
+ * rcl_executor_options_t options = rcl_executor_get_default_options();
+ * options.thread_count = 4;
+ * rcl_ret_t ret = rcl_executor_init(&executor, context, &options);
+ * // ... error handling
+ * ret = rcl_executor_add_subscription(&executor, &subscription, &msg, my_callback, NULL);
+ * // ... error handling
+ * ret = rcl_executor_spin(&executor);  // until rcl_executor_cancel() or rcl_shutdown()
+ * // ... error handling, then cleanup
+ * ret = rcl_executor_fini(&executor);
+ * // ... error handling
+ * ```
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] executor the executor handle to be initialized
+ * \param[in] context the context of the entities to be executed
+ * \param[in] options the executor's options, thread_count must be positive
+ * \return `RCL_RET_OK` if the executor was initialized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if the executor was already initialized, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_init(
+  rcl_executor_t * executor,
+  rcl_context_t * context,
+  const rcl_executor_options_t * options);
+
+/// Finalize an executor.
+/**
+ * The executor must not be spinning.
+ * The entities added to it are not finalized.
+ * Calling this function on a zero initialized executor does nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] executor the executor handle to be finalized
+ * \return `RCL_RET_OK` if the executor was finalized successfully, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_fini(rcl_executor_t * executor);
+
+/// Add a subscription to an executor.
+/**
+ * When the subscription is ready, a message is taken into the given message
+ * with rcl_take() and the callback is called with it.
+ * The message must stay valid while the executor is initialized.
+ *
+ * Entities may only be added while the executor is not spinning.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] executor the executor to add the subscription to
+ * \param[in] subscription the subscription to be executed
+ * \param[in] ros_message the message to take messages into
+ * \param[in] callback the function to call with each message taken
+ * \param[in] user_data the data to pass to the callback, may be `NULL`
+ * \return `RCL_RET_OK` if added successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if the executor is spinning, or an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_add_subscription(
+  rcl_executor_t * executor,
+  const rcl_subscription_t * subscription,
+  void * ros_message,
+  rcl_executor_subscription_callback_t callback,
+  void * user_data);
+
+/// Add a timer to an executor.
+/**
+ * When the timer is ready, it is called with rcl_timer_call(), which calls the
+ * callback of the timer.
+ *
+ * \see rcl_executor_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_add_timer(rcl_executor_t * executor, rcl_timer_t * timer);
+
+/// Add a service to an executor.
+/**
+ * When the service is ready, a request is taken into the given request with
+ * rcl_take_request(), the callback is called with it to fill the given
+ * response, which is then sent with rcl_send_response().
+ * The request and response must stay valid while the executor is initialized.
+ *
+ * \see rcl_executor_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_add_service(
+  rcl_executor_t * executor,
+  const rcl_service_t * service,
+  void * ros_request,
+  void * ros_response,
+  rcl_executor_service_callback_t callback,
+  void * user_data);
+
+/// Add a client to an executor.
+/**
+ * When the client is ready, a response is taken into the given response with
+ * rcl_take_response() and the callback is called with it.
+ * The response must stay valid while the executor is initialized.
+ *
+ * \see rcl_executor_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_add_client(
+  rcl_executor_t * executor,
+  const rcl_client_t * client,
+  void * ros_response,
+  rcl_executor_client_callback_t callback,
+  void * user_data);
+
+/// Add a guard condition to an executor.
+/**
+ * When the guard condition is triggered the callback is called, if any.
+ *
+ * \see rcl_executor_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_add_guard_condition(
+  rcl_executor_t * executor,
+  const rcl_guard_condition_t * guard_condition,
+  rcl_executor_guard_condition_callback_t callback,
+  void * user_data);
+
+/// Wait once for entities to be ready and execute them, in the calling thread.
+/**
+ * This waits for at most the given timeout, see rcl_wait(), and then executes
+ * all the entities which were ready, before returning.
+ * The thread count of the executor is ignored.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] executor the executor to spin
+ * \param[in] timeout the duration to wait for entities to be ready, in nanoseconds
+ * \return `RCL_RET_OK` if the ready entities were executed, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMEOUT` if nothing was ready before the timeout, or
+ * \return `RCL_RET_ERROR` if the executor is spinning, or an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_spin_some(rcl_executor_t * executor, int64_t timeout);
+
+/// Execute entities as they become ready, until canceled or the context is shut down.
+/**
+ * The context being shut down is noticed the next time the wait returns.
+ * With a thread count greater than one the additional threads are started
+ * when spinning starts and joined before this function returns.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] executor the executor to spin
+ * \return `RCL_RET_OK` if spinning was canceled or the context was shut down, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ERROR` if the executor is already spinning, or an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_spin(rcl_executor_t * executor);
+
+/// Make rcl_executor_spin() return.
+/**
+ * Spinning stops once the entities found ready by the last wait have been
+ * executed.
+ * Calling this when the executor is not spinning does nothing.
+ * This function may be called from a callback of the executor.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] executor the executor to cancel
+ * \return `RCL_RET_OK` if the executor was canceled, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_executor_cancel(rcl_executor_t * executor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__EXECUTOR_H_
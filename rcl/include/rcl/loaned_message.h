@@ -0,0 +1,53 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__LOANED_MESSAGE_H_
+#define RCL__LOANED_MESSAGE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+/// Options of the messages a publisher or subscription loans out.
+/**
+ * Loaned messages are owned by the publisher or subscription, which keeps up
+ * to `capacity` of them and reuses them once they are returned, so that large
+ * messages are neither allocated nor copied by the application per message.
+ * rcl cannot create messages of an arbitrary type itself, so the messages are
+ * created with the given functions, for example wrapping the generated
+ * `__create()` and `__destroy()` functions of the message type.
+ *
+ * Zero initialized options, the default, disable loaning.
+ */
+typedef struct rcl_loan_options_t
+{
+  /// Allocate and initialize a message, or return `NULL` on failure.
+  /** Loaning is disabled if this is `NULL`. */
+  void * (* create_message)(void * state);
+  /// Finalize and deallocate a message made by create_message.
+  void (* destroy_message)(void * message, void * state);
+  /// State given to create_message and destroy_message.
+  void * state;
+  /// Maximum number of messages which are created, and so can be on loan at the same time.
+  size_t capacity;
+} rcl_loan_options_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__LOANED_MESSAGE_H_
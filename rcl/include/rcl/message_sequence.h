@@ -0,0 +1,180 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__MESSAGE_SEQUENCE_H_
+#define RCL__MESSAGE_SEQUENCE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rmw/types.h"
+
+#include "rcl/allocator.h"
+#include "rcl/macros.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+/// Sequence of messages taken at once, see rcl_take_sequence().
+/**
+ * The sequence only owns the array of message pointers.
+ * The messages themselves are allocated and initialized by the caller, who
+ * points each entry of `data` at one of them before taking.
+ */
+typedef struct rcl_message_sequence_t
+{
+  /// Pointers to the messages, `capacity` of them.
+  void ** data;
+  /// Number of messages which hold valid data, set when taking.
+  size_t size;
+  /// Number of messages which can be taken into the sequence.
+  size_t capacity;
+  /// Allocator used for the array of message pointers.
+  rcl_allocator_t allocator;
+} rcl_message_sequence_t;
+
+/// Sequence of message infos matching a rcl_message_sequence_t.
+typedef struct rcl_message_info_sequence_t
+{
+  /// The message infos, `capacity` of them.
+  rmw_message_info_t * data;
+  /// Number of message infos which hold valid data, set when taking.
+  size_t size;
+  /// Number of message infos the sequence can hold.
+  size_t capacity;
+  /// Allocator used for the array of message infos.
+  rcl_allocator_t allocator;
+} rcl_message_info_sequence_t;
+
+/// Return a rcl_message_sequence_t struct with members set to `NULL` or `0`.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_message_sequence_t
+rcl_get_zero_initialized_message_sequence(void);
+
+/// Allocate the array of message pointers of a message sequence.
+/**
+ * The message pointers are set to `NULL` and the size to `0`.
+ * The sequence must be zero initialized.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] sequence the zero initialized sequence to initialize
+ * \param[in] capacity the number of message pointers to allocate
+ * \param[in] allocator the allocator used for the array of message pointers
+ * \return `RCL_RET_OK` if the sequence was initialized successfully, or
+ * \return `RCL_RET_ALREADY_INIT` if the sequence is not zero initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_message_sequence_init(
+  rcl_message_sequence_t * sequence,
+  size_t capacity,
+  rcl_allocator_t allocator);
+
+/// Deallocate the array of message pointers of a message sequence.
+/**
+ * The messages themselves are not finalized.
+ * Calling this function on a zero initialized sequence does nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] sequence the sequence to finalize
+ * \return `RCL_RET_OK` if the sequence was finalized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_message_sequence_fini(rcl_message_sequence_t * sequence);
+
+/// Return a rcl_message_info_sequence_t struct with members set to `NULL` or `0`.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_message_info_sequence_t
+rcl_get_zero_initialized_message_info_sequence(void);
+
+/// Allocate the array of message infos of a message info sequence.
+/**
+ * The message infos are zero initialized and the size is set to `0`.
+ * The sequence must be zero initialized.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] sequence the zero initialized sequence to initialize
+ * \param[in] capacity the number of message infos to allocate
+ * \param[in] allocator the allocator used for the array of message infos
+ * \return `RCL_RET_OK` if the sequence was initialized successfully, or
+ * \return `RCL_RET_ALREADY_INIT` if the sequence is not zero initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_message_info_sequence_init(
+  rcl_message_info_sequence_t * sequence,
+  size_t capacity,
+  rcl_allocator_t allocator);
+
+/// Deallocate the array of message infos of a message info sequence.
+/**
+ * Calling this function on a zero initialized sequence does nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] sequence the sequence to finalize
+ * \return `RCL_RET_OK` if the sequence was finalized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_message_info_sequence_fini(rcl_message_info_sequence_t * sequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__MESSAGE_SEQUENCE_H_
@@ -0,0 +1,384 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__PARTITIONED_WAIT_SET_H_
+#define RCL__PARTITIONED_WAIT_SET_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/client.h"
+#include "rcl/context.h"
+#include "rcl/guard_condition.h"
+#include "rcl/macros.h"
+#include "rcl/service.h"
+#include "rcl/subscription.h"
+#include "rcl/timer.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+#include "rcl/wait.h"
+
+struct rcl_partitioned_wait_set_impl_t;
+
+/// Structure which encapsulates a set of entities sharded over several wait sets.
+typedef struct rcl_partitioned_wait_set_t
+{
+  /// Private implementation pointer.
+  struct rcl_partitioned_wait_set_impl_t * impl;
+} rcl_partitioned_wait_set_t;
+
+/// Return a zero initialized partitioned wait set.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_partitioned_wait_set_t
+rcl_get_zero_initialized_partitioned_wait_set(void);
+
+/// Initialize a partitioned wait set with the given number of shards.
+/**
+ * A partitioned wait set distributes the entities added to it over several
+ * shards, each of which is a persistent rcl_wait_set_t, see
+ * rcl_wait_set_set_persistent().
+ * Each shard can be waited on with rcl_partitioned_wait_set_wait() by its own
+ * thread, at the same time as the other shards, so that the entities are
+ * handled by several threads without them sharing a single wait set.
+ *
+ * Entities are assigned to the shard with the fewest entities when they are
+ * added, and may be spread again evenly with
+ * rcl_partitioned_wait_set_rebalance().
+ * Entities can be added, removed and rebalanced while other threads wait on
+ * the shards: each shard has a guard condition which wakes it up when its
+ * entities change, and it takes its new entities into account before it
+ * waits again.
+ *
+ * The partitioned wait set handle must be a pointer to an allocated and zero
+ * initialized rcl_partitioned_wait_set_t struct.
+ *
+ * Expected usage:
+ *
+ * ```c
+ * #include <rcl/rcl.h>
+ * #include <rcl/partitioned_wait_set.h>
+ *
+ * rcl_context_t * context;  // initialized previously by rcl_init()...
+ * rcl_partitioned_wait_set_t partitioned = rcl_get_zero_initialized_partitioned_wait_set();
+ * rcl_ret_t ret = rcl_partitioned_wait_set_init(
+ *   &partitioned, 4, context, rcl_get_default_allocator());
+ * // ... error handling
+ * ret = rcl_partitioned_wait_set_add_subscription(&partitioned, &subscription, NULL);
+ * // ... error handling, then in the thread of the shard at shard_index
+ * rcl_wait_set_t * wait_set;
+ * ret = rcl_partitioned_wait_set_wait(&partitioned, shard_index, RCL_MS_TO_NS(100), &wait_set);
+ * // ... error handling, then check the ready entities of wait_set
+ * // ... after all threads returned, cleanup
+ * ret = rcl_partitioned_wait_set_fini(&partitioned);
+ * // ... error handling
+ * ```
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] partitioned the partitioned wait set handle to be initialized
+ * \param[in] shard_count the number of shards, must be positive
+ * \param[in] context the context that the guard conditions of the shards are associated with
+ * \param[in] allocator the allocator to use for allocations
+ * \return `RCL_RET_OK` if the partitioned wait set was initialized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if the partitioned wait set was already initialized, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_init(
+  rcl_partitioned_wait_set_t * partitioned,
+  size_t shard_count,
+  rcl_context_t * context,
+  rcl_allocator_t allocator);
+
+/// Finalize a partitioned wait set.
+/**
+ * No thread may be waiting on a shard of the partitioned wait set.
+ * Calling this function on a zero initialized partitioned wait set does
+ * nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] partitioned the partitioned wait set handle to be finalized
+ * \return `RCL_RET_OK` if the partitioned wait set was finalized successfully, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_fini(rcl_partitioned_wait_set_t * partitioned);
+
+/// Retrieve the number of shards of a partitioned wait set.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] partitioned the partitioned wait set to be queried
+ * \param[out] shard_count the number of shards
+ * \return `RCL_RET_OK` if the count was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_get_shard_count(
+  const rcl_partitioned_wait_set_t * partitioned,
+  size_t * shard_count);
+
+/// Retrieve the number of entities assigned to a shard.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] partitioned the partitioned wait set to be queried
+ * \param[in] shard_index the index of the shard
+ * \param[out] entity_count the number of entities assigned to the shard
+ * \return `RCL_RET_OK` if the count was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_get_entity_count(
+  rcl_partitioned_wait_set_t * partitioned,
+  size_t shard_index,
+  size_t * entity_count);
+
+/// Add a subscription to the shard with the fewest entities.
+/**
+ * The shard is woken up if a thread is waiting on it, and waits on the
+ * subscription from then on.
+ * Adding an entity which is already in the partitioned wait set fails.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ * <i>[1] when the storage of the shard is full</i>
+ *
+ * \param[inout] partitioned the partitioned wait set to add the subscription to
+ * \param[in] subscription the subscription to be added
+ * \param[out] shard_index the index of the shard the subscription was added to, may be `NULL`
+ * \return `RCL_RET_OK` if added successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if the subscription was already added, or an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_add_subscription(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_subscription_t * subscription,
+  size_t * shard_index);
+
+/// Add a guard condition to the shard with the fewest entities.
+/**
+ * \see rcl_partitioned_wait_set_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_add_guard_condition(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_guard_condition_t * guard_condition,
+  size_t * shard_index);
+
+/// Add a timer to the shard with the fewest entities.
+/**
+ * \see rcl_partitioned_wait_set_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_add_timer(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_timer_t * timer,
+  size_t * shard_index);
+
+/// Add a client to the shard with the fewest entities.
+/**
+ * \see rcl_partitioned_wait_set_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_add_client(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_client_t * client,
+  size_t * shard_index);
+
+/// Add a service to the shard with the fewest entities.
+/**
+ * \see rcl_partitioned_wait_set_add_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_add_service(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_service_t * service,
+  size_t * shard_index);
+
+/// Remove an entity from the partitioned wait set.
+/**
+ * The entity is given by its handle, i.e. a pointer to a subscription, guard
+ * condition, timer, client or service which was added before.
+ * The shard which held it is woken up if a thread is waiting on it, but the
+ * entity may only be finalized once that thread returned from
+ * rcl_partitioned_wait_set_wait().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] partitioned the partitioned wait set to remove the entity from
+ * \param[in] entity the handle of the entity to be removed
+ * \return `RCL_RET_OK` if removed successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ERROR` if the entity is not in the partitioned wait set.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_remove(rcl_partitioned_wait_set_t * partitioned, const void * entity);
+
+/// Spread the entities evenly over the shards.
+/**
+ * Entities are moved from the shards with the most entities to the shards
+ * with the fewest, until the numbers of entities of any two shards differ by
+ * at most one, which may be needed after entities were removed.
+ * The shards which lost or gained entities are woken up.
+ *
+ * A moved entity is handed over to its new shard right away, while the thread
+ * waiting on its old shard may still be in rmw_wait() on it.
+ * Until that thread returns from rcl_partitioned_wait_set_wait(), both shards
+ * may report the entity as ready, e.g. a timer could be called twice for the
+ * same period, so either entities should only be rebalanced while no thread
+ * is waiting on the shards, or the threads handling the shards should
+ * tolerate this.
+ * As for rcl_partitioned_wait_set_remove(), the entity may only be finalized
+ * once both threads returned from rcl_partitioned_wait_set_wait().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] partitioned the partitioned wait set to be rebalanced
+ * \return `RCL_RET_OK` if rebalanced successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_rebalance(rcl_partitioned_wait_set_t * partitioned);
+
+/// Wait on the entities of one shard.
+/**
+ * This updates the wait set of the shard if its entities changed and calls
+ * rcl_wait() on it, see rcl_wait() for the meaning of the timeout and of the
+ * wait set on return.
+ * The entities are copied under the lock of the shard, and the wait set is
+ * updated from the copy without it, so adding or removing entities is not
+ * held up by the update.
+ * Wake ups caused by changes of the entities of the shard are not returned,
+ * the wait continues with the new entities until the timeout.
+ *
+ * On return the wait set of the shard is given, to check which entities are
+ * ready, until the next wait on the shard.
+ * Its first guard condition is the one used to wake up the shard, which is
+ * set to `NULL` in the guard_conditions array, but may still be listed by
+ * rcl_wait_set_get_ready_entities() at index 0.
+ *
+ * Only one thread may wait on a given shard at a time, but different shards
+ * may be waited on concurrently.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | Yes [2]
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ * <i>[1] when the wait set of the shard or the copy of its entities grows</i>
+ * <i>[2] for different shards</i>
+ *
+ * \param[inout] partitioned the partitioned wait set to wait on
+ * \param[in] shard_index the index of the shard to wait on
+ * \param[in] timeout the duration to wait, in nanoseconds, as for rcl_wait()
+ * \param[out] wait_set the wait set of the shard
+ * \return `RCL_RET_OK` something in the shard became ready, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_TIMEOUT` timeout expired before something was ready, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_partitioned_wait_set_wait(
+  rcl_partitioned_wait_set_t * partitioned,
+  size_t shard_index,
+  int64_t timeout,
+  rcl_wait_set_t ** wait_set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__PARTITIONED_WAIT_SET_H_
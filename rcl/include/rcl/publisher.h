@@ -22,8 +22,10 @@ extern "C"
 
 #include "rosidl_generator_c/message_type_support_struct.h"
 
+#include "rcl/loaned_message.h"
 #include "rcl/macros.h"
 #include "rcl/node.h"
+#include "rcl/traffic_statistics.h"
 #include "rcl/visibility_control.h"
 
 /// Internal rcl publisher implementation struct.
@@ -43,6 +45,13 @@ typedef struct rcl_publisher_options_t
   /// Custom allocator for the publisher, used for incidental allocations.
   /** For default behavior (malloc/free), use: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
+  /// Messages loaned by rcl_borrow_loaned_message(), loaning is disabled if zero initialized.
+  rcl_loan_options_t loan;
+  /// If true, loaned messages are handed to subscriptions of the same context without rmw.
+  /** This requires loaning, see rcl_publish_loaned_message(). */
+  bool intra_process;
+  /// If true, the messages published are counted, see rcl_publisher_get_traffic_statistics().
+  bool traffic_statistics;
 } rcl_publisher_options_t;
 
 /// Return a rcl_publisher_t struct with members set to `NULL`.
@@ -152,6 +161,51 @@ rcl_publisher_init(
   const char * topic_name,
   const rcl_publisher_options_t * options);
 
+/// Initialize several publishers of a node at once.
+/**
+ * This is equivalent to calling rcl_publisher_init() for each publisher, in array
+ * order, with the type support, topic name and options of the same index.
+ * The names are resolved in a single pass first though, which sets up the
+ * substitutions and the remap rules of the node only once, so bringing up a
+ * node with many publishers costs less.
+ *
+ * Either every publisher is initialized or none is: when one of them fails, those
+ * initialized before it are finalized again and left zero initialized.
+ * Each publisher is finalized on its own with rcl_publisher_fini().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] publishers array of count zero initialized publisher handles
+ * \param[in] node valid rcl node handle
+ * \param[in] type_supports array of count type supports
+ * \param[in] topic_names array of count topic names
+ * \param[in] options array of count publisher options
+ * \param[in] count the number of publishers to initialize
+ * \return `RCL_RET_OK` if every publisher was initialized successfully, or
+ * \return `RCL_RET_NODE_INVALID` if the node is invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if a publisher is already initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_TOPIC_NAME_INVALID` if a given topic name is invalid, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publishers_init_bulk(
+  rcl_publisher_t * publishers,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * const * type_supports,
+  const char * const * topic_names,
+  const rcl_publisher_options_t * options,
+  size_t count);
+
 /// Finalize a rcl_publisher_t.
 /**
  * After calling, the node will no longer be advertising that it is publishing
@@ -187,6 +241,9 @@ rcl_publisher_fini(rcl_publisher_t * publisher, rcl_node_t * node);
  *
  * - qos = rmw_qos_profile_default
  * - allocator = rcl_get_default_allocator()
+ * - loan = zero initialized, loaning is disabled
+ * - intra_process = false
+ * - traffic_statistics = false
  */
 RCL_PUBLIC
 RCL_WARN_UNUSED
@@ -233,6 +290,9 @@ rcl_publisher_get_default_options(void);
  * rcl_publish() simultaneously, even if the publishers differ.
  * The `ros_message` is unmodified by rcl_publish().
  *
+ * Intra process publishers only publish loaned messages, see
+ * rcl_publish_loaned_message().
+ *
  * <hr>
  * Attribute          | Adherence
  * ------------------ | -------------
@@ -247,6 +307,7 @@ rcl_publisher_get_default_options(void);
  * \return `RCL_RET_OK` if the message was published successfully, or
  * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
  * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher is an intra process publisher, or
  * \return `RCL_RET_ERROR` if an unspecified error occurs.
  */
 RCL_PUBLIC
@@ -254,6 +315,165 @@ RCL_WARN_UNUSED
 rcl_ret_t
 rcl_publish(const rcl_publisher_t * publisher, const void * ros_message);
 
+/// Publish a batch of ROS messages on a topic using a publisher.
+/**
+ * The messages are published in array order, as if rcl_publish() was called
+ * for each of them, but the publisher and the arguments are only checked once,
+ * so publishing a burst of messages costs less than the same number of calls
+ * to rcl_publish().
+ *
+ * Every message must be of the type of the publisher, see rcl_publish().
+ * All messages are checked before the first one is published, so invalid
+ * arguments never result in a partially published batch.
+ * When the middleware fails to publish a message, the messages after it are
+ * not published and published is set to the number of messages published
+ * before it.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes [1]
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ * <i>[1] for unique pairs of publishers and messages, see rcl_publish()</i>
+ *
+ * \param[in] publisher handle to the publisher which will do the publishing
+ * \param[in] ros_messages array of count type-erased pointers to ROS messages
+ * \param[in] count the number of messages to publish
+ * \param[out] published the number of messages published
+ * \return `RCL_RET_OK` if all messages were published successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher is an intra process publisher, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publish_batch(
+  const rcl_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published);
+
+/// Check if the publisher loans messages.
+/**
+ * A publisher loans messages if it was initialized with `loan` options which
+ * have a create_message function, see rcl_loan_options_t.
+ * The middleware in use does not loan messages itself, so the messages are
+ * owned by the publisher.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] publisher the publisher to check
+ * \return `true` if the publisher loans messages, otherwise `false`
+ */
+RCL_PUBLIC
+bool
+rcl_publisher_can_loan_messages(const rcl_publisher_t * publisher);
+
+/// Borrow a message owned by the publisher, to fill and publish it.
+/**
+ * The message is one of the messages of the publisher, created with the
+ * `loan` options of the publisher when it is first needed and reused after
+ * that, so the message does not need to be allocated by the caller and is not
+ * copied by the caller when publishing.
+ * The message keeps the content it had when it was last used.
+ *
+ * The loan ends with rcl_publish_loaned_message() or
+ * rcl_return_loaned_message_from_publisher(), and the message must not be
+ * used after that.
+ * Messages still on loan when the publisher is finalized are destroyed.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ * <i>[1] only when a message is loaned for the first time</i>
+ *
+ * \param[in] publisher the publisher which owns the message
+ * \param[out] ros_message set to point to the loaned message
+ * \return `RCL_RET_OK` if a message was loaned, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher does not loan messages, or
+ * \return `RCL_RET_BAD_ALLOC` if all messages are on loan, or creating one failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_borrow_loaned_message(const rcl_publisher_t * publisher, void ** ros_message);
+
+/// Return a loaned message to the publisher without publishing it.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] publisher the publisher which loaned the message
+ * \param[in] loaned_message the message to return
+ * \return `RCL_RET_OK` if the message was returned, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or the
+ *         message is not on loan from the publisher, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_return_loaned_message_from_publisher(
+  const rcl_publisher_t * publisher,
+  void * loaned_message);
+
+/// Publish a loaned message and return it to the publisher.
+/**
+ * The message is published like with rcl_publish(), and the loan ends,
+ * whether or not publishing succeeded.
+ *
+ * If the publisher was initialized with the `intra_process` option, the
+ * message is not copied for intra process subscriptions of the same context,
+ * with the same topic and type support.
+ * Instead a reference to the message is queued for each of them, and the
+ * message is only loaned out again once they all returned it.
+ * The message is only given to the middleware when it has other
+ * subscriptions, for example in another process.
+ * Messages still queued when the publisher is finalized are dropped, while
+ * messages taken by subscriptions stay valid until they return them.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] publisher the publisher which loaned the message
+ * \param[in] ros_message the loaned message to publish
+ * \return `RCL_RET_OK` if the message was published successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or the
+ *         message is not on loan from the publisher, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publish_loaned_message(const rcl_publisher_t * publisher, void * ros_message);
+
 /// Publish a serialized message on a topic using a publisher.
 /**
  * It is the job of the caller to ensure that the type of the serialized message
@@ -282,6 +502,7 @@ rcl_publish(const rcl_publisher_t * publisher, const void * ros_message);
  * \return `RCL_RET_OK` if the message was published successfully, or
  * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
  * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher is an intra process publisher, or
  * \return `RCL_RET_ERROR` if an unspecified error occurs.
  */
 RCL_PUBLIC
@@ -290,6 +511,40 @@ rcl_ret_t
 rcl_publish_serialized_message(
   const rcl_publisher_t * publisher, const rcl_serialized_message_t * serialized_message);
 
+/// Publish a batch of serialized messages on a topic using a publisher.
+/**
+ * This function behaves like rcl_publish_batch(), except that it publishes
+ * already serialized messages, like rcl_publish_serialized_message().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes [1]
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ * <i>[1] for unique pairs of publishers and messages, see rcl_publish()</i>
+ *
+ * \param[in] publisher handle to the publisher which will do the publishing
+ * \param[in] serialized_messages array of count pointers to serialized messages
+ * \param[in] count the number of messages to publish
+ * \param[out] published the number of messages published
+ * \return `RCL_RET_OK` if all messages were published successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher is an intra process publisher, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publish_serialized_message_batch(
+  const rcl_publisher_t * publisher,
+  const rcl_serialized_message_t * const * serialized_messages,
+  size_t count,
+  size_t * published);
+
 /// Get the topic name for the publisher.
 /**
  * This function returns the publisher's internal topic name string.
@@ -465,6 +720,34 @@ rcl_publisher_get_subscription_count(
   const rcl_publisher_t * publisher,
   size_t * subscription_count);
 
+/// Get the traffic statistics of a publisher.
+/**
+ * The statistics count the messages published successfully, with any of the
+ * publish functions, since the publisher was initialized.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[in] publisher pointer to the rcl publisher
+ * \param[out] statistics a snapshot of the counters of the publisher
+ * \return `RCL_RET_OK` if the statistics were retrieved, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher was initialized without the
+ *         `traffic_statistics` option.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publisher_get_traffic_statistics(
+  const rcl_publisher_t * publisher,
+  rcl_traffic_statistics_t * statistics);
+
 #ifdef __cplusplus
 }
 #endif
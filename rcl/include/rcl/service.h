@@ -22,6 +22,7 @@ extern "C"
 
 #include "rosidl_generator_c/service_type_support_struct.h"
 
+#include "rcl/dispatch.h"
 #include "rcl/macros.h"
 #include "rcl/node.h"
 #include "rcl/visibility_control.h"
@@ -43,6 +44,8 @@ typedef struct rcl_service_options_t
   /// Custom allocator for the service, used for incidental allocations.
   /** For default behavior (malloc/free), see: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
+  /// How urgently the service is handled once it is ready.
+  rcl_dispatch_attributes_t dispatch;
 } rcl_service_options_t;
 
 /// Return a rcl_service_t struct with members set to `NULL`.
@@ -154,6 +157,51 @@ rcl_service_init(
   const char * service_name,
   const rcl_service_options_t * options);
 
+/// Initialize several services of a node at once.
+/**
+ * This is equivalent to calling rcl_service_init() for each service, in array
+ * order, with the type support, service name and options of the same index.
+ * The names are resolved in a single pass first though, which sets up the
+ * substitutions and the remap rules of the node only once, so bringing up a
+ * node with many services costs less.
+ *
+ * Either every service is initialized or none is: when one of them fails, those
+ * initialized before it are finalized again and left zero initialized.
+ * Each service is finalized on its own with rcl_service_fini().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] services array of count zero initialized service handles
+ * \param[in] node valid rcl node handle
+ * \param[in] type_supports array of count type supports
+ * \param[in] service_names array of count service names
+ * \param[in] options array of count service options
+ * \param[in] count the number of services to initialize
+ * \return `RCL_RET_OK` if every service was initialized successfully, or
+ * \return `RCL_RET_NODE_INVALID` if the node is invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if a service is already initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_SERVICE_NAME_INVALID` if a given service name is invalid, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_services_init_bulk(
+  rcl_service_t * services,
+  const rcl_node_t * node,
+  const rosidl_service_type_support_t * const * type_supports,
+  const char * const * service_names,
+  const rcl_service_options_t * options,
+  size_t count);
+
 /// Finalize a rcl_service_t.
 /**
  * After calling, the node will no longer listen for requests for this service.
@@ -191,6 +239,7 @@ rcl_service_fini(rcl_service_t * service, rcl_node_t * node);
  *
  * - qos = rmw_qos_profile_services_default
  * - allocator = rcl_get_default_allocator()
+ * - dispatch = zero initialized, a priority of `0` and no deadline
  */
 RCL_PUBLIC
 RCL_WARN_UNUSED
@@ -22,8 +22,13 @@ extern "C"
 
 #include "rosidl_generator_c/message_type_support_struct.h"
 
+#include "rcl/dispatch.h"
+#include "rcl/guard_condition.h"
+#include "rcl/loaned_message.h"
 #include "rcl/macros.h"
+#include "rcl/message_sequence.h"
 #include "rcl/node.h"
+#include "rcl/traffic_statistics.h"
 #include "rcl/visibility_control.h"
 
 /// Internal rcl implementation struct.
@@ -35,6 +40,26 @@ typedef struct rcl_subscription_t
   struct rcl_subscription_impl_t * impl;
 } rcl_subscription_t;
 
+/// Options of the pool of serialized messages of a subscription.
+/**
+ * The pool has `class_count` size classes, the first one with buffers of
+ * `min_capacity` bytes and each next one with buffers twice as large.
+ * `buffers_per_class` buffers of each class are allocated when the
+ * subscription is initialized, and are handed out by
+ * rcl_take_serialized_message_from_pool() until they are returned.
+ *
+ * Zero initialized options, the default, disable the pool.
+ */
+typedef struct rcl_serialized_message_pool_options_t
+{
+  /// Number of buffers of each size class, the pool is disabled if `0`.
+  size_t buffers_per_class;
+  /// Capacity in bytes of the buffers of the smallest size class.
+  size_t min_capacity;
+  /// Number of size classes.
+  size_t class_count;
+} rcl_serialized_message_pool_options_t;
+
 /// Options available for a rcl subscription.
 typedef struct rcl_subscription_options_t
 {
@@ -45,6 +70,35 @@ typedef struct rcl_subscription_options_t
   /// Custom allocator for the subscription, used for incidental allocations.
   /** For default behavior (malloc/free), see: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
+  /// How urgently the subscription is handled once it is ready.
+  rcl_dispatch_attributes_t dispatch;
+  /// Messages loaned by rcl_take_loaned_message(), loaning is disabled if zero initialized.
+  rcl_loan_options_t loan;
+  /// If true, loaned messages of intra process publishers of the same context are queued in rcl.
+  /** This requires loaning, see rcl_take_loaned_message(). */
+  bool intra_process;
+  /// Buffers handed out by rcl_take_serialized_message_from_pool(), disabled if zero initialized.
+  rcl_serialized_message_pool_options_t serialized_message_pool;
+  /// If true, only the most recent message is kept and older ones are dropped without being taken.
+  /**
+   * This overrides the history of `qos` with a depth of `1`, so that a newer
+   * message replaces an older one in the middleware before it is deserialized.
+   * The options returned by rcl_subscription_get_options() hold the
+   * overridden `qos`.
+   */
+  bool keep_latest;
+  /// Expression a message must match to be taken, or `NULL` to take every message.
+  /**
+   * See rcl_content_filter_init() for the syntax of the expression, which is
+   * compiled once by rcl_subscription_init() and copied, so it only needs to
+   * be valid during that call.
+   * The expression is evaluated against the serialized payload of each
+   * message, and rejected messages are dropped without being deserialized.
+   * It cannot be combined with `intra_process`.
+   */
+  const char * content_filter;
+  /// If true, the messages taken are counted, see rcl_subscription_get_traffic_statistics().
+  bool traffic_statistics;
 } rcl_subscription_options_t;
 
 /// Return a rcl_subscription_t struct with members set to `NULL`.
@@ -155,6 +209,51 @@ rcl_subscription_init(
   const char * topic_name,
   const rcl_subscription_options_t * options);
 
+/// Initialize several subscriptions of a node at once.
+/**
+ * This is equivalent to calling rcl_subscription_init() for each subscription, in array
+ * order, with the type support, topic name and options of the same index.
+ * The names are resolved in a single pass first though, which sets up the
+ * substitutions and the remap rules of the node only once, so bringing up a
+ * node with many subscriptions costs less.
+ *
+ * Either every subscription is initialized or none is: when one of them fails, those
+ * initialized before it are finalized again and left zero initialized.
+ * Each subscription is finalized on its own with rcl_subscription_fini().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] subscriptions array of count zero initialized subscription handles
+ * \param[in] node valid rcl node handle
+ * \param[in] type_supports array of count type supports
+ * \param[in] topic_names array of count topic names
+ * \param[in] options array of count subscription options
+ * \param[in] count the number of subscriptions to initialize
+ * \return `RCL_RET_OK` if every subscription was initialized successfully, or
+ * \return `RCL_RET_NODE_INVALID` if the node is invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if a subscription is already initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_TOPIC_NAME_INVALID` if a given topic name is invalid, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscriptions_init_bulk(
+  rcl_subscription_t * subscriptions,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * const * type_supports,
+  const char * const * topic_names,
+  const rcl_subscription_options_t * options,
+  size_t count);
+
 /// Finalize a rcl_subscription_t.
 /**
  * After calling, the node will no longer be subscribed on this topic
@@ -193,6 +292,13 @@ rcl_subscription_fini(rcl_subscription_t * subscription, rcl_node_t * node);
  * - ignore_local_publications = false
  * - qos = rmw_qos_profile_default
  * - allocator = rcl_get_default_allocator()
+ * - dispatch = zero initialized, a priority of `0` and no deadline
+ * - loan = zero initialized, loaning is disabled
+ * - intra_process = false
+ * - serialized_message_pool = zero initialized, the pool is disabled
+ * - keep_latest = false
+ * - content_filter = NULL
+ * - traffic_statistics = false
  */
 RCL_PUBLIC
 RCL_WARN_UNUSED
@@ -229,6 +335,16 @@ rcl_subscription_get_default_options(void);
  * structure.
  * Passing `NULL` for message_info will result in the argument being ignored.
  *
+ * If the subscription was initialized with the `keep_latest` option, the
+ * message taken is the most recent one, and the older ones were dropped
+ * without being deserialized.
+ *
+ * If the subscription was initialized with the `content_filter` option, the
+ * messages are taken serialized, and the first one matching the filter is
+ * deserialized into ros_message, the others being dropped.
+ * The subscription keeps one buffer for the serialized messages, a take
+ * running concurrently with another one allocates a buffer of its own.
+ *
  * <hr>
  * Attribute          | Adherence
  * ------------------ | -------------
@@ -244,6 +360,7 @@ rcl_subscription_get_default_options(void);
  * \return `RCL_RET_OK` if the message was published, or
  * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
  * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the subscription is an intra process subscription, or
  * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
  * \return `RCL_RET_SUBSCRIPTION_TAKE_FAILED` if take failed but no error
  *         occurred in the middleware, or
@@ -257,6 +374,183 @@ rcl_take(
   void * ros_message,
   rmw_message_info_t * message_info);
 
+/// Take up to count ROS messages from a topic using a rcl subscription.
+/**
+ * This function takes the messages which are already available, one after the
+ * other, into the preallocated messages of message_sequence, and stops at the
+ * first message which is not available or after count messages.
+ * The subscription and arguments are only checked once, so draining a queue
+ * costs less than the same number of calls to rcl_take().
+ *
+ * The first count entries of `message_sequence->data` must point to
+ * allocated messages of the type of the subscription, see rcl_take().
+ * Both sequences must have a capacity of at least count.
+ * On return, the size of both sequences and taken are set to the number of
+ * messages taken, the message info at each index belonging to the message at
+ * the same index.
+ * Passing `NULL` for message_info_sequence will result in the message infos
+ * being discarded.
+ *
+ * When the middleware fails after some messages were taken, the error is
+ * returned and the messages taken so far are still counted in taken.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ * <i>[1] only if required when filling the messages, avoided for fixed sizes</i>
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[in] count the maximum number of messages to take
+ * \param[inout] message_sequence the preallocated messages to take into
+ * \param[inout] message_info_sequence the message infos of the messages taken, or `NULL`
+ * \param[out] taken the number of messages taken
+ * \return `RCL_RET_OK` if at least one message was taken, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the subscription is an intra process subscription, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_SUBSCRIPTION_TAKE_FAILED` if no message was available but
+ *         no error occurred in the middleware, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_sequence(
+  const rcl_subscription_t * subscription,
+  size_t count,
+  rcl_message_sequence_t * message_sequence,
+  rcl_message_info_sequence_t * message_info_sequence,
+  size_t * taken);
+
+/// Check if the subscription loans messages.
+/**
+ * A subscription loans messages if it was initialized with `loan` options
+ * which have a create_message function, see rcl_loan_options_t.
+ * The middleware in use does not loan messages itself, so the messages are
+ * owned by the subscription.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] subscription the subscription to check
+ * \return `true` if the subscription loans messages, otherwise `false`
+ */
+RCL_PUBLIC
+bool
+rcl_subscription_can_loan_messages(const rcl_subscription_t * subscription);
+
+/// Take a ROS message into a message loaned from the subscription.
+/**
+ * This function behaves like rcl_take(), except that the message is taken into
+ * one of the messages of the subscription, created with its `loan` options
+ * when first needed and reused after that, and loaned to the caller.
+ * The caller neither allocates nor copies the message.
+ *
+ * The loan ends with rcl_return_loaned_message_from_subscription(), and the
+ * message must not be used after that.
+ * No message is loaned if none was taken.
+ * Messages still on loan when the subscription is finalized are destroyed.
+ *
+ * If the subscription was initialized with the `intra_process` option, the
+ * messages queued by intra process publishers are taken first, without any
+ * copy: the loaned message is the one the publisher published, which must not
+ * be modified.
+ * Their `message_info` has `from_intra_process` set.
+ * They stay valid when their publisher is finalized, until they are returned,
+ * which happens when the subscription is finalized at the latest.
+ * Messages of these publishers received from the middleware are dropped, as
+ * they were already queued.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ * <i>[1] when a message is first loaned or filled, or to track an intra process message</i>
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[out] loaned_message set to point to the loaned message which was taken
+ * \param[out] message_info rmw struct which contains meta-data for the message, or `NULL`
+ * \return `RCL_RET_OK` if a message was taken, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the subscription does not loan messages, or
+ * \return `RCL_RET_BAD_ALLOC` if all messages are on loan, or allocating memory failed, or
+ * \return `RCL_RET_SUBSCRIPTION_TAKE_FAILED` if take failed but no error
+ *         occurred in the middleware, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_loaned_message(
+  const rcl_subscription_t * subscription,
+  void ** loaned_message,
+  rmw_message_info_t * message_info);
+
+/// Return a message loaned by rcl_take_loaned_message() to the subscription.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] subscription the subscription which loaned the message
+ * \param[in] loaned_message the message to return
+ * \return `RCL_RET_OK` if the message was returned, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or the
+ *         message is not on loan from the subscription, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_return_loaned_message_from_subscription(
+  const rcl_subscription_t * subscription,
+  void * loaned_message);
+
+/// Return the guard condition triggered when an intra process message is queued.
+/**
+ * Messages of intra process publishers do not go through the middleware, so
+ * waiting on the subscription alone does not wake up for them.
+ * This guard condition should be added to the wait set next to the
+ * subscription, and messages be taken with rcl_take_loaned_message() when
+ * either is ready.
+ *
+ * The guard condition is owned by the subscription and is valid until it is
+ * finalized.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] subscription pointer to the rcl subscription
+ * \return guard condition if successful, otherwise `NULL`
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+const rcl_guard_condition_t *
+rcl_subscription_get_intra_process_guard_condition(const rcl_subscription_t * subscription);
+
 /// Take a serialized raw message from a topic using a rcl subscription.
 /**
  * In contrast to `rcl_take`, this function stores the taken message in
@@ -270,7 +564,8 @@ rcl_take(
  * Passing a different type to rcl_take produces undefined behavior and cannot
  * be checked by this function and therefore no deliberate error will occur.
  *
- * Apart from the differences above, this function behaves like `rcl_take`.
+ * Apart from the differences above, this function behaves like `rcl_take`,
+ * including dropping the messages rejected by the `content_filter` option.
  *
  * <hr>
  * Attribute          | Adherence
@@ -287,6 +582,7 @@ rcl_take(
  * \return `RCL_RET_OK` if the message was published, or
  * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
  * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the subscription is an intra process subscription, or
  * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
  * \return `RCL_RET_SUBSCRIPTION_TAKE_FAILED` if take failed but no error
  *         occurred in the middleware, or
@@ -300,6 +596,78 @@ rcl_take_serialized_message(
   rcl_serialized_message_t * serialized_message,
   rmw_message_info_t * message_info);
 
+/// Take a serialized raw message into a buffer of the subscription's pool.
+/**
+ * This function behaves like rcl_take_serialized_message(), except that the
+ * message is taken into one of the buffers of the subscription, which were
+ * allocated with its `serialized_message_pool` options, and handed to the
+ * caller.
+ *
+ * The buffer is picked from the size class fitting the largest recent
+ * messages, so once the sizes of the messages are known no memory is
+ * allocated, even if they vary.
+ * A buffer the middleware had to grow for a larger message is kept in the
+ * pool with its new capacity, in a larger size class.
+ *
+ * The buffer must be given back with
+ * rcl_return_serialized_message_to_pool(), and must not be used after that.
+ * No buffer is handed out if no message was taken.
+ * Buffers still handed out when the subscription is finalized are deallocated.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ * <i>[1] only if the buffer is smaller than the message</i>
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[out] serialized_message set to point to the buffer holding the taken message
+ * \param[out] message_info rmw struct which contains meta-data for the message, or `NULL`
+ * \return `RCL_RET_OK` if a message was taken, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the pool is disabled, or the subscription is an
+ *         intra process subscription, or
+ * \return `RCL_RET_BAD_ALLOC` if every buffer is handed out, or allocating memory failed, or
+ * \return `RCL_RET_SUBSCRIPTION_TAKE_FAILED` if take failed but no error
+ *         occurred in the middleware, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_serialized_message_from_pool(
+  const rcl_subscription_t * subscription,
+  rcl_serialized_message_t ** serialized_message,
+  rmw_message_info_t * message_info);
+
+/// Give a buffer handed out by rcl_take_serialized_message_from_pool() back to the pool.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] subscription the subscription which handed out the buffer
+ * \param[in] serialized_message the buffer to give back
+ * \return `RCL_RET_OK` if the buffer was given back, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or the
+ *         buffer is not handed out by the subscription, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_return_serialized_message_to_pool(
+  const rcl_subscription_t * subscription,
+  rcl_serialized_message_t * serialized_message);
+
 /// Get the topic name for the subscription.
 /**
  * This function returns the subscription's internal topic name string.
@@ -337,6 +705,8 @@ rcl_subscription_get_topic_name(const rcl_subscription_t * subscription);
  * The returned struct is only valid as long as the subscription is valid.
  * The values in the struct may change if the subscription's options change,
  * and therefore copying the struct is recommended if this is a concern.
+ * With `keep_latest`, its `qos` is the one the subscription was created
+ * with, i.e. a history of keep last with a depth of `1`.
  *
  * <hr>
  * Attribute          | Adherence
@@ -434,6 +804,65 @@ rcl_subscription_get_publisher_count(
   const rcl_subscription_t * subscription,
   size_t * publisher_count);
 
+/// Get the traffic statistics of a subscription.
+/**
+ * The statistics count the messages taken, with any of the take functions,
+ * and the takes for which no message was available, since the subscription
+ * was initialized.
+ *
+ * The middleware does not tell when a message was sent, so the latency
+ * histogram only has samples for the messages of intra process publishers,
+ * which rcl stamps when they are published, and for the latencies added with
+ * rcl_subscription_add_latency_sample(), e.g. from the header of messages.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[in] subscription pointer to the rcl subscription
+ * \param[out] statistics a snapshot of the counters of the subscription
+ * \return `RCL_RET_OK` if the statistics were retrieved, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the subscription was initialized without the
+ *         `traffic_statistics` option.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscription_get_traffic_statistics(
+  const rcl_subscription_t * subscription,
+  rcl_traffic_statistics_t * statistics);
+
+/// Add a latency sample to the traffic statistics of a subscription.
+/**
+ * This is meant for callers which know when a taken message was sent, e.g.
+ * from a time stamp in the message, as the middleware does not tell.
+ * Nothing is recorded if the subscription was initialized without the
+ * `traffic_statistics` option.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[in] subscription pointer to the rcl subscription
+ * \param[in] latency the duration between sending and taking a message, in nanoseconds
+ * \return `RCL_RET_OK` if the sample was added, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscription_add_latency_sample(const rcl_subscription_t * subscription, int64_t latency);
+
 #ifdef __cplusplus
 }
 #endif
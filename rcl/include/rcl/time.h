@@ -125,6 +125,21 @@ typedef struct rcl_clock_t
   // void (*set_now) (rcl_time_point_value_t);
   void * data;
   rcl_allocator_t allocator;
+
+  // The assumption that this is big enough for an atomic_uint_least64_t is
+  // ensured with a static_assert in the time.c file.
+#if !defined(RCL_CLOCK_ATOMIC_SCHEDULE_EPOCH_STORAGE_SIZE)
+#define RCL_CLOCK_ATOMIC_SCHEDULE_EPOCH_STORAGE_SIZE sizeof(uint_least64_t)
+#endif
+  /// Private storage for the schedule epoch atomic of the timers using the clock.
+  /**
+   * It changes whenever the next call time of a timer using the clock may
+   * have moved back, so that wait sets can tell whether their schedule of
+   * the timers is still valid without looking at every timer.
+   * Like the instance id of rcl_context_t, it is stored as bytes because C11
+   * atomics cannot be used in a header which may be included into C++.
+   */
+  uint8_t schedule_epoch_storage[RCL_CLOCK_ATOMIC_SCHEDULE_EPOCH_STORAGE_SIZE];
 } rcl_clock_t;
 
 /// A single point in time, measured in nanoseconds, the reference point is based on the source.
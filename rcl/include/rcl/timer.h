@@ -24,6 +24,7 @@ extern "C"
 
 #include "rcl/allocator.h"
 #include "rcl/context.h"
+#include "rcl/dispatch.h"
 #include "rcl/guard_condition.h"
 #include "rcl/macros.h"
 #include "rcl/time.h"
@@ -55,6 +56,33 @@ typedef struct rcl_timer_t
  */
 typedef void (* rcl_timer_callback_t)(rcl_timer_t *, int64_t);
 
+/// Number of buckets of the lateness histogram of a timer.
+#define RCL_TIMER_LATENESS_HISTOGRAM_SIZE 16
+
+/// Statistics about the calls of a timer, see rcl_timer_get_statistics().
+/**
+ * The lateness of a call is the time at which rcl_timer_call() was called
+ * minus the time the call was scheduled for, in nanoseconds.
+ * Calls made before the scheduled time count as not late.
+ */
+typedef struct rcl_timer_statistics_t
+{
+  /// Number of successful calls to rcl_timer_call().
+  uint64_t call_count;
+  /// Number of periods which were skipped because a call was later than a period.
+  uint64_t missed_period_count;
+  /// Smallest lateness of a call, `0` if there was no call.
+  int64_t min_lateness;
+  /// Largest lateness of a call, `0` if there was no call.
+  int64_t max_lateness;
+  /// Mean lateness of the calls, `0` if there was no call.
+  int64_t mean_lateness;
+  /// Width of the buckets of the histogram, `0` if the histogram is disabled.
+  int64_t histogram_bucket_width;
+  /// Number of calls per bucket of lateness, the last bucket also counts all later calls.
+  uint64_t histogram[RCL_TIMER_LATENESS_HISTOGRAM_SIZE];
+} rcl_timer_statistics_t;
+
 /// Return a zero initialized timer.
 RCL_PUBLIC
 RCL_WARN_UNUSED
@@ -324,6 +352,32 @@ RCL_WARN_UNUSED
 rcl_ret_t
 rcl_timer_get_time_until_next_call(const rcl_timer_t * timer, int64_t * time_until_next_call);
 
+/// Retrieve the time at which the timer is next due, in the time of its clock.
+/**
+ * Unlike rcl_timer_get_time_until_next_call(), this function does not read
+ * the clock, so it can be used to compare many timers sharing one clock
+ * against a single reading of that clock.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_int_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer that is being queried
+ * \param[out] next_call_time the output variable for the result, in nanoseconds
+ * \return `RCL_RET_OK` if the next call time was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_get_next_call_time(const rcl_timer_t * timer, int64_t * next_call_time);
+
 /// Retrieve the time since the previous call to rcl_timer_call() occurred.
 /**
  * This function calculates the time since the last call and copies it into
@@ -414,6 +468,139 @@ RCL_WARN_UNUSED
 rcl_ret_t
 rcl_timer_exchange_period(const rcl_timer_t * timer, int64_t new_period, int64_t * old_period);
 
+/// Retrieve the slack of the timer.
+/**
+ * This function retrieves the slack and copies it into the given variable.
+ *
+ * The slack is the duration after the next call time within which the timer
+ * may be called without being late, see rcl_timer_exchange_slack().
+ *
+ * The slack argument must be a pointer to an already allocated int64_t.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_int_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer which is being queried
+ * \param[out] slack the int64_t in which the slack is stored
+ * \return `RCL_RET_OK` if the slack was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_get_slack(const rcl_timer_t * timer, int64_t * slack);
+
+/// Exchange the slack of the timer and return the previous slack.
+/**
+ * This function exchanges the slack in the timer and copies the old one into
+ * the given variable.
+ *
+ * The slack is a non-negative duration in nanoseconds, `0` by default.
+ * A timer with slack tolerates being called up to that long after its next
+ * call time.
+ * rcl_wait() uses it to coalesce wake ups: instead of waking up at the next
+ * call time of the earliest timer, it wakes up at the earliest end of the
+ * slack window of a timer, so that every timer whose next call time falls
+ * before that point is ready on the same wake up.
+ * The slack does not change when the timer is considered ready, nor the next
+ * call time of the timer.
+ *
+ * Exchanging (changing) the slack will not affect already waiting wait sets.
+ *
+ * The old_slack argument must be a pointer to an already allocated int64_t.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_int_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer which is being modified
+ * \param[in] new_slack the int64_t to exchange into the timer
+ * \param[out] old_slack the int64_t in which the previous slack is stored
+ * \return `RCL_RET_OK` if the slack was exchanged successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_exchange_slack(const rcl_timer_t * timer, int64_t new_slack, int64_t * old_slack);
+
+/// Retrieve the dispatch attributes of the timer.
+/**
+ * This function copies the priority and deadline of the timer into the given
+ * attributes, see rcl_timer_set_dispatch_attributes().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_int_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer which is being queried
+ * \param[out] attributes the attributes in which the priority and deadline are stored
+ * \return `RCL_RET_OK` if the attributes were retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_get_dispatch_attributes(
+  const rcl_timer_t * timer,
+  rcl_dispatch_attributes_t * attributes);
+
+/// Set the dispatch attributes of the timer.
+/**
+ * The priority and deadline decide where the timer goes when the ready
+ * entities of a wait set are sorted with rcl_wait_set_sort_ready_entities().
+ * The deadline of a timer is relative to its next call time, so a timer which
+ * is already late sorts before one which has just become due.
+ * Both are `0` by default, the deadline must be non-negative.
+ *
+ * The priority and deadline are stored separately, so a concurrent call to
+ * rcl_timer_get_dispatch_attributes() may see one updated but not the other.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_int_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer which is being modified
+ * \param[in] attributes the priority and deadline to store in the timer
+ * \return `RCL_RET_OK` if the attributes were set successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_set_dispatch_attributes(
+  const rcl_timer_t * timer,
+  const rcl_dispatch_attributes_t * attributes);
+
 /// Return the current timer callback.
 /**
  * This function can fail, and therefore return `NULL`, if:
@@ -569,8 +756,127 @@ rcl_timer_reset(rcl_timer_t * timer);
 const rcl_allocator_t *
 rcl_timer_get_allocator(const rcl_timer_t * timer);
 
+/// Retrieve the call statistics of the timer.
+/**
+ * Each call to rcl_timer_call() updates the statistics of the timer with
+ * atomic operations, so they can be retrieved from any thread.
+ * They are accumulated since the timer was initialized, or since the last
+ * call to rcl_timer_reset_statistics().
+ * The fields are read one by one, so a call made concurrently may be
+ * reflected in some of them only.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_uint_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer which is being queried
+ * \param[out] statistics the struct in which the statistics are stored
+ * \return `RCL_RET_OK` if the statistics were retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_get_statistics(const rcl_timer_t * timer, rcl_timer_statistics_t * statistics);
+
+/// Reset the call statistics of the timer.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_uint_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer whose statistics are reset
+ * \return `RCL_RET_OK` if the statistics were reset successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_reset_statistics(const rcl_timer_t * timer);
+
+/// Enable or disable the lateness histogram of the timer.
+/**
+ * The histogram has `RCL_TIMER_LATENESS_HISTOGRAM_SIZE` buckets of the given
+ * width, in nanoseconds, bucket `i` counting the calls with a lateness in
+ * `[i * width, (i + 1) * width)`, and the last bucket all later calls too.
+ * It is disabled by default, and a width of `0` disables it again.
+ * The counts of the histogram are cleared.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_uint_least64_t`</i>
+ *
+ * \param[in] timer the handle to the timer which is being modified
+ * \param[in] bucket_width the width of the buckets in nanoseconds, `0` to disable
+ * \return `RCL_RET_OK` if the histogram was configured successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_set_lateness_histogram(const rcl_timer_t * timer, int64_t bucket_width);
+
+/// Wake wait sets with a kernel timer when the timer expires.
+/**
+ * On Linux, a steady or system time timer can be backed by a `timerfd`,
+ * which is rearmed whenever the timer is called, reset or canceled.
+ * For a steady time timer it is armed relative to the time last read from
+ * its clock, as the steady clock need not be the one of the `timerfd`, and
+ * for a system time timer with the absolute next call time, so that changes
+ * of the system clock are followed.
+ * When it expires, a shared background thread triggers a guard condition of
+ * the timer, see rcl_timer_get_guard_condition(), so wait sets containing the
+ * timer are woken up by the kernel at the expiry even if they were blocked
+ * with a longer timeout, e.g. because the timer was reset by another thread.
+ * The thread is started with the first such timer and stopped when the last
+ * one is finalized.
+ *
+ * This must be called before the timer is added to any wait set.
+ * ROS time timers already have a guard condition, which is triggered when
+ * ROS time jumps past their next call time, so they are rejected.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] timer the handle to the timer which is being modified
+ * \return `RCL_RET_OK` if the timer is now backed by a timerfd, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if the timer is already backed by a timerfd, or
+ * \return `RCL_RET_ERROR` if timerfds are not supported or an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_enable_timerfd(rcl_timer_t * timer);
+
 /// Retrieve a guard condition used by the timer to wake the waitset when using ROSTime.
 /**
+ * Timers backed by a timerfd, see rcl_timer_enable_timerfd(), also have one.
+ *
  * <hr>
  * Attribute          | Adherence
  * ------------------ | -------------
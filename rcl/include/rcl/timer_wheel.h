@@ -0,0 +1,321 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TIMER_WHEEL_H_
+#define RCL__TIMER_WHEEL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#include "rcl/allocator.h"
+#include "rcl/context.h"
+#include "rcl/macros.h"
+#include "rcl/time.h"
+#include "rcl/timer.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+struct rcl_timer_wheel_impl_t;
+
+/// Structure which encapsulates a hierarchical timing wheel.
+typedef struct rcl_timer_wheel_t
+{
+  /// Private implementation pointer.
+  struct rcl_timer_wheel_impl_t * impl;
+} rcl_timer_wheel_t;
+
+/// Handle of an entry armed on a timer wheel.
+/**
+ * Handles of entries which expired or were canceled are never reused for
+ * another entry, so using them is detected as an error.
+ */
+typedef uint64_t rcl_timer_wheel_entry_t;
+
+/// User callback signature for timer wheel entries.
+/**
+ * The first argument is the timer wheel which the entry was armed on, which
+ * may be used to arm or cancel entries, including the expiring one.
+ * The second argument is the handle of the expiring entry.
+ * The third argument is the user data given when the entry was armed.
+ */
+typedef void (* rcl_timer_wheel_callback_t)(
+  rcl_timer_wheel_t *, rcl_timer_wheel_entry_t, void *);
+
+/// Return a zero initialized timer wheel.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_timer_wheel_t
+rcl_get_zero_initialized_timer_wheel(void);
+
+/// Initialize a timer wheel.
+/**
+ * A timer wheel manages a large number of timer entries which share a clock.
+ * Time is divided into ticks of the given resolution and entries are hashed
+ * into buckets by the tick at which they expire, on four levels of 64 buckets
+ * each, covering 64^4 ticks before entries are kept in the last level.
+ * Arming and canceling an entry takes constant time, and only buckets which
+ * hold entries are visited when time advances, entries on the outer levels
+ * being moved inward as their expiration gets closer.
+ *
+ * Entries never expire before their deadline, but may expire up to one tick
+ * late, so the resolution trades precision for the number of buckets which
+ * are visited.
+ *
+ * The wheel owns a single rcl_timer_t, see rcl_timer_wheel_get_timer(), which
+ * is kept ready at the earliest time an entry may expire.
+ * This timer is what is added to a wait set, so a wait set sees the whole
+ * wheel as a single timer, and calling it with rcl_timer_call() expires the
+ * entries of the wheel, like rcl_timer_wheel_call() does.
+ *
+ * The timer wheel handle must be a pointer to an allocated and zero
+ * initialized rcl_timer_wheel_t struct, whose address must not change while
+ * it is initialized.
+ * The life time of the clock must exceed the life time of the timer wheel.
+ *
+ * Expected usage:
+ *
+ * ```c
+ * #include <rcl/rcl.h>
+ * #include <rcl/timer_wheel.h>
+ *
+ * void my_heartbeat_callback(
+ *   rcl_timer_wheel_t * wheel, rcl_timer_wheel_entry_t entry, void * user_data)
+ * {
+ *   // Do the work of the entry...
+ * }
+ *
+ * rcl_context_t * context;  // initialized previously by rcl_init()...
+ * rcl_clock_t clock;  // initialized previously by rcl_clock_init()...
+ * rcl_timer_wheel_t wheel = rcl_get_zero_initialized_timer_wheel();
+ * rcl_ret_t ret = rcl_timer_wheel_init(
+ *   &wheel, &clock, context, RCL_MS_TO_NS(1), 1024, rcl_get_default_allocator());
+ * // ... error handling
+ * rcl_timer_wheel_entry_t entry;
+ * ret = rcl_timer_wheel_arm(
+ *   &wheel, RCL_MS_TO_NS(100), RCL_MS_TO_NS(100), my_heartbeat_callback, NULL, &entry);
+ * // ... error handling
+ * ret = rcl_wait_set_add_timer(&wait_set, rcl_timer_wheel_get_timer(&wheel), NULL);
+ * // ... error handling, wait, and call the timer when it is ready, then cleanup
+ * ret = rcl_timer_wheel_fini(&wheel);
+ * // ... error handling
+ * ```
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wheel the timer wheel handle to be initialized
+ * \param[in] clock the clock providing the current time
+ * \param[in] context the context that the timer of the wheel is to be associated with
+ * \param[in] resolution the duration of a tick, in nanoseconds, must be positive
+ * \param[in] capacity the number of entries to allocate storage for up front
+ * \param[in] allocator the allocator to use for allocations
+ * \return `RCL_RET_OK` if the timer wheel was initialized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if the timer wheel was already initialized, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_wheel_init(
+  rcl_timer_wheel_t * wheel,
+  rcl_clock_t * clock,
+  rcl_context_t * context,
+  int64_t resolution,
+  size_t capacity,
+  rcl_allocator_t allocator);
+
+/// Finalize a timer wheel.
+/**
+ * All entries are dropped without their callbacks being called.
+ * Calling this function on a zero initialized timer wheel does nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wheel the timer wheel handle to be finalized
+ * \return `RCL_RET_OK` if the timer wheel was finalized successfully, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_wheel_fini(rcl_timer_wheel_t * wheel);
+
+/// Arm a new entry on a timer wheel.
+/**
+ * The entry expires once the delay has elapsed on the clock of the wheel.
+ * If the period is positive the entry is periodic and expires again every
+ * period after its previous deadline, skipping the deadlines which have
+ * already passed, until it is canceled.
+ * If the period is `0` the entry expires once and its handle becomes invalid
+ * just before its callback is called.
+ *
+ * This function may be called from within the callback of an entry.
+ * Memory is only allocated when the storage for entries is full, in which
+ * case it is doubled.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ * <i>[1] if more entries are armed than there is storage for</i>
+ *
+ * \param[inout] wheel the timer wheel to arm the entry on
+ * \param[in] delay the duration until the entry expires first, in nanoseconds
+ * \param[in] period the duration between expirations, in nanoseconds, `0` for a one shot entry
+ * \param[in] callback the function to call when the entry expires
+ * \param[in] user_data the data to pass to the callback
+ * \param[out] entry the handle of the armed entry, may be `NULL`
+ * \return `RCL_RET_OK` if the entry was armed successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_wheel_arm(
+  rcl_timer_wheel_t * wheel,
+  int64_t delay,
+  int64_t period,
+  rcl_timer_wheel_callback_t callback,
+  void * user_data,
+  rcl_timer_wheel_entry_t * entry);
+
+/// Cancel an entry of a timer wheel.
+/**
+ * The callback of the entry will not be called anymore and its handle
+ * becomes invalid.
+ * This function may be called from within the callback of an entry,
+ * including the callback of the entry being canceled.
+ *
+ * The timer of the wheel is not moved later, so it may become ready without
+ * any entry expiring.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wheel the timer wheel which the entry was armed on
+ * \param[in] entry the handle of the entry to cancel
+ * \return `RCL_RET_OK` if the entry was canceled successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or if the
+ *   entry already expired or was canceled.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_wheel_cancel(rcl_timer_wheel_t * wheel, rcl_timer_wheel_entry_t entry);
+
+/// Expire the entries of a timer wheel whose deadline has passed.
+/**
+ * The wheel is advanced to the current time of its clock, calling the
+ * callbacks of the expired entries in deadline order, at tick granularity,
+ * and rearming the periodic ones.
+ * Then the timer of the wheel is scheduled at the earliest time an entry may
+ * expire.
+ *
+ * This function must not be called from within the callback of an entry.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ * <i>[1] if the callbacks arm entries</i>
+ *
+ * \param[inout] wheel the timer wheel to advance
+ * \return `RCL_RET_OK` if the wheel was advanced successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_wheel_call(rcl_timer_wheel_t * wheel);
+
+/// Return the number of armed entries of a timer wheel.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] wheel the timer wheel to query
+ * \param[out] count the number of entries which are armed
+ * \return `RCL_RET_OK` if the count was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_timer_wheel_get_entry_count(const rcl_timer_wheel_t * wheel, size_t * count);
+
+/// Return the timer which represents a timer wheel in a wait set.
+/**
+ * The timer is owned by the wheel and must not be finalized, reset or have
+ * its callback exchanged by the caller.
+ * Calling it with rcl_timer_call() is equivalent to rcl_timer_wheel_call().
+ * While no entry is armed, the timer is not ready before the end of time.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] wheel the timer wheel
+ * \return the timer of the wheel, or
+ * \return `NULL` if the timer wheel is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_timer_t *
+rcl_timer_wheel_get_timer(rcl_timer_wheel_t * wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TIMER_WHEEL_H_
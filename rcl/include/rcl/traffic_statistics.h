@@ -0,0 +1,62 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TRAFFIC_STATISTICS_H_
+#define RCL__TRAFFIC_STATISTICS_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#include "rcl/types.h"
+
+/// Number of buckets of the latency histogram of rcl_traffic_statistics_t.
+#define RCL_TRAFFIC_STATISTICS_LATENCY_BUCKETS 32u
+
+/// Traffic counters of a publisher or a subscription.
+/**
+ * The counters are kept if the publisher or subscription was initialized with
+ * the `traffic_statistics` option, and start at `0`.
+ * They are never reset, so rates are obtained from the difference between two
+ * snapshots.
+ */
+typedef struct rcl_traffic_statistics_t
+{
+  /// Number of messages published, or taken.
+  uint64_t message_count;
+  /// Number of bytes of the serialized messages published, or taken.
+  /**
+   * Messages published or taken as ROS messages are not serialized by rcl, so
+   * their size is unknown and they do not count.
+   */
+  uint64_t byte_count;
+  /// Number of takes for which no message was available, always `0` for publishers.
+  uint64_t failed_take_count;
+  /// Number of latency samples by bucket, always `0` for publishers.
+  /**
+   * Bucket `0` counts the latencies below 1 microsecond, and bucket `i` those
+   * from `2^(i - 1)` up to `2^i` microseconds, the last bucket counting all
+   * longer latencies too.
+   */
+  uint64_t latency_histogram[RCL_TRAFFIC_STATISTICS_LATENCY_BUCKETS];
+} rcl_traffic_statistics_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TRAFFIC_STATISTICS_H_
@@ -0,0 +1,245 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TRAFFIC_STATISTICS_PUBLISHER_H_
+#define RCL__TRAFFIC_STATISTICS_PUBLISHER_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rcl/macros.h"
+#include "rcl/node.h"
+#include "rcl/publisher.h"
+#include "rcl/subscription.h"
+#include "rcl/time.h"
+#include "rcl/timer.h"
+#include "rcl/traffic_statistics.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+#include "rosidl_generator_c/message_type_support_struct.h"
+
+struct rcl_traffic_statistics_publisher_impl_t;
+
+/// Structure which encapsulates a publisher of traffic statistics.
+typedef struct rcl_traffic_statistics_publisher_t
+{
+  /// Private implementation pointer.
+  struct rcl_traffic_statistics_publisher_impl_t * impl;
+} rcl_traffic_statistics_publisher_t;
+
+/// User callback signature filling a statistics message.
+/**
+ * The first argument is the fully qualified topic name of the publisher or
+ * subscription.
+ * The second argument is true for a subscription and false for a publisher.
+ * The third argument is a snapshot of its counters.
+ * The fourth argument is the message to fill, which is then published.
+ * The fifth argument is the user data given at initialization.
+ * The callback returns `RCL_RET_OK` to publish the message, anything else
+ * skips it and is reported as an error.
+ */
+typedef rcl_ret_t (* rcl_traffic_statistics_fill_t)(
+  const char *, bool, const rcl_traffic_statistics_t *, void *, void *);
+
+/// Return a zero initialized traffic statistics publisher.
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_traffic_statistics_publisher_t
+rcl_get_zero_initialized_traffic_statistics_publisher(void);
+
+/// Initialize a publisher of the traffic statistics of publishers and subscriptions.
+/**
+ * rcl does not know any message type, so the statistics are published with
+ * the given type support, each message being filled from the counters of one
+ * publisher or subscription by the fill callback.
+ *
+ * The statistics publisher owns a timer of the given period, see
+ * rcl_traffic_statistics_publisher_get_timer(), which is what is added to a
+ * wait set.
+ * Calling that timer with rcl_timer_call() publishes the statistics, like
+ * rcl_traffic_statistics_publisher_publish() does.
+ *
+ * The message is reused for every publication, and must outlive the
+ * statistics publisher, as must the clock.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] statistics_publisher the zero initialized handle to be initialized
+ * \param[in] node valid rcl node handle
+ * \param[in] type_support type support of the statistics message
+ * \param[in] topic_name the name of the statistics topic
+ * \param[in] options publisher options, including the allocator to use
+ * \param[in] ros_message the allocated message to fill and publish
+ * \param[in] fill the function filling the message from the counters
+ * \param[in] user_data the data to pass to the fill function
+ * \param[in] clock the clock of the timer
+ * \param[in] period the duration between publications, in nanoseconds, must be positive
+ * \return `RCL_RET_OK` if the statistics publisher was initialized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if the statistics publisher was already initialized, or
+ * \return `RCL_RET_NODE_INVALID` if the node is invalid, or
+ * \return `RCL_RET_TOPIC_NAME_INVALID` if the given topic name is invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_traffic_statistics_publisher_init(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * type_support,
+  const char * topic_name,
+  const rcl_publisher_options_t * options,
+  void * ros_message,
+  rcl_traffic_statistics_fill_t fill,
+  void * user_data,
+  rcl_clock_t * clock,
+  int64_t period);
+
+/// Finalize a traffic statistics publisher.
+/**
+ * Calling this function on a zero initialized statistics publisher does nothing.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] statistics_publisher the handle to be finalized
+ * \param[in] node the node which was used to initialize it
+ * \return `RCL_RET_OK` if the statistics publisher was finalized successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_NODE_INVALID` if the node is invalid, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_traffic_statistics_publisher_fini(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  rcl_node_t * node);
+
+/// Add a publisher whose statistics are published.
+/**
+ * The publisher must have the `traffic_statistics` option set, and must
+ * outlive the statistics publisher.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ * <i>[1] if more entities are added than there is storage for</i>
+ *
+ * \param[inout] statistics_publisher the initialized statistics publisher
+ * \param[in] publisher the publisher to add
+ * \return `RCL_RET_OK` if the publisher was added, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_PUBLISHER_INVALID` if the publisher is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the publisher does not keep statistics, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_traffic_statistics_publisher_add_publisher(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const rcl_publisher_t * publisher);
+
+/// Add a subscription whose statistics are published.
+/**
+ * The subscription must have the `traffic_statistics` option set, and must
+ * outlive the statistics publisher.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ * <i>[1] if more entities are added than there is storage for</i>
+ *
+ * \param[inout] statistics_publisher the initialized statistics publisher
+ * \param[in] subscription the subscription to add
+ * \return `RCL_RET_OK` if the subscription was added, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_SUBSCRIPTION_INVALID` if the subscription is invalid, or
+ * \return `RCL_RET_UNSUPPORTED` if the subscription does not keep statistics, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_traffic_statistics_publisher_add_subscription(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const rcl_subscription_t * subscription);
+
+/// Publish one statistics message for each added publisher and subscription.
+/**
+ * Every message is attempted, and an error is returned if any of them failed.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ * <i>[1] rmw implementation defined</i>
+ *
+ * \param[in] statistics_publisher the initialized statistics publisher
+ * \return `RCL_RET_OK` if every message was published, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ERROR` if filling or publishing a message failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_traffic_statistics_publisher_publish(
+  const rcl_traffic_statistics_publisher_t * statistics_publisher);
+
+/// Return the timer which publishes the statistics when called.
+/**
+ * \param[in] statistics_publisher the initialized statistics publisher
+ * \return the timer, or `NULL` if the statistics publisher is not initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_timer_t *
+rcl_traffic_statistics_publisher_get_timer(
+  rcl_traffic_statistics_publisher_t * statistics_publisher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TRAFFIC_STATISTICS_PUBLISHER_H_
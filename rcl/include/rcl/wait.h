@@ -22,8 +22,10 @@ extern "C"
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "rcl/client.h"
+#include "rcl/dispatch.h"
 #include "rcl/guard_condition.h"
 #include "rcl/macros.h"
 #include "rcl/service.h"
@@ -56,6 +58,68 @@ typedef struct rcl_wait_set_t
   struct rcl_wait_set_impl_t * impl;
 } rcl_wait_set_t;
 
+/// Kinds of entities which can be waited on in a wait set.
+typedef enum rcl_wait_set_entity_type_t
+{
+  RCL_WAIT_SET_SUBSCRIPTION,
+  RCL_WAIT_SET_GUARD_CONDITION,
+  RCL_WAIT_SET_TIMER,
+  RCL_WAIT_SET_CLIENT,
+  RCL_WAIT_SET_SERVICE
+} rcl_wait_set_entity_type_t;
+
+/// Number of kinds of entities in rcl_wait_set_entity_type_t.
+#define RCL_WAIT_SET_ENTITY_TYPE_COUNT 5
+
+/// An entity which was found ready by rcl_wait().
+typedef struct rcl_wait_set_ready_entity_t
+{
+  /// Which of the storage arrays of the wait set the entity is in.
+  rcl_wait_set_entity_type_t type;
+  /// Index of the entity in that storage array.
+  size_t index;
+} rcl_wait_set_ready_entity_t;
+
+/// How the waits of a wait set with a spin budget were resolved.
+/**
+ * \see rcl_wait_set_set_spin_budget
+ */
+typedef struct rcl_wait_set_spin_statistics_t
+{
+  /// Number of waits which spun before blocking.
+  uint64_t spin_count;
+  /// Number of waits which found something ready while spinning.
+  uint64_t spin_wake_count;
+  /// Number of waits which found something ready after blocking.
+  uint64_t block_wake_count;
+  /// Number of waits which timed out, while spinning or after blocking.
+  uint64_t timeout_count;
+} rcl_wait_set_spin_statistics_t;
+
+/// Number of buckets of the ready count histograms of a wait set.
+#define RCL_WAIT_SET_READY_HISTOGRAM_SIZE 8
+
+/// Statistics about the wake ups of a wait set, see rcl_wait_set_get_statistics().
+/**
+ * Only waits which did not fail are counted.
+ */
+typedef struct rcl_wait_set_statistics_t
+{
+  /// Number of calls to rcl_wait() or rcl_wait_until() which did not fail.
+  uint64_t wait_count;
+  /// Number of waits which timed out.
+  uint64_t timeout_count;
+  /// Number of waits which did not time out, but found nothing ready.
+  uint64_t empty_wake_count;
+  /// Total time spent waiting for entities to be ready, including spinning, in nanoseconds.
+  int64_t blocked_time;
+  /// Total time spent in rcl before and after waiting, in nanoseconds.
+  int64_t bookkeeping_time;
+  /// Number of waits per count of ready entities, for each rcl_wait_set_entity_type_t.
+  /** The last bucket also counts all waits with more ready entities. */
+  uint64_t ready_histogram[RCL_WAIT_SET_ENTITY_TYPE_COUNT][RCL_WAIT_SET_READY_HISTOGRAM_SIZE];
+} rcl_wait_set_statistics_t;
+
 /// Return a rcl_wait_set_t struct with members set to `NULL`.
 RCL_PUBLIC
 RCL_WARN_UNUSED
@@ -218,6 +282,7 @@ rcl_wait_set_add_subscription(
  * adding new entities to the set.
  * Sets all of the entries in the underlying rmw array to `NULL`, and sets the
  * count in the rmw array to `0`.
+ * The members of a persistent wait set are removed as well.
  *
  * Calling this on an uninitialized (zero initialized) wait set will fail.
  *
@@ -251,10 +316,13 @@ rcl_wait_set_clear(rcl_wait_set_t * wait_set);
  *
  * After calling this function all values in the set will be set to `NULL`,
  * effectively the same as calling rcl_wait_set_clear().
- * Similarly, the underlying rmw representation is reallocated and reset:
+ * Similarly, the underlying rmw representation is reset:
  * all entries are set to `NULL` and the count is set to zero.
  *
- * If the requested size matches the current size, no allocation will be done.
+ * All the storage of the wait set, including that of the rmw representation,
+ * is carved out of a single block of memory.
+ * The block only grows, at least doubling, when the requested sizes do not
+ * fit, so shrinking or resizing back to a previous size does not allocate.
  *
  * This can be called on an uninitialized (zero initialized) wait set.
  *
@@ -340,6 +408,342 @@ rcl_wait_set_add_service(
   const rcl_service_t * service,
   size_t * index);
 
+/// Make the entities in the wait set stay registered across calls to rcl_wait().
+/**
+ * By default rcl_wait() prunes the wait set in place, setting every entity
+ * which is not ready to `NULL`, so the wait set has to be cleared and filled
+ * again before the next call to rcl_wait().
+ *
+ * A persistent wait set instead keeps a separate copy of its membership.
+ * Entities which are added stay members until they are removed with one of
+ * the rcl_wait_set_remove_*() functions or until the wait set is cleared or
+ * resized.
+ * Each call to rcl_wait() restores the storage arrays (e.g.
+ * `wait_set.subscriptions`) from the membership before waiting, and then
+ * prunes them as usual, so after rcl_wait() returns the storage arrays hold
+ * the ready entities, exactly as for a wait set which is not persistent.
+ * The handles are validated once, when they are added, and not again on each
+ * call to rcl_wait().
+ *
+ * The index of an entity, as returned by the add functions, does not change
+ * while it is a member.
+ * A slot freed by a remove call is reused by a later add once the end of the
+ * storage has been reached.
+ *
+ * Entities which are already in the wait set when it is made persistent
+ * become members, so this should be called either before adding entities or
+ * after adding them, but not after rcl_wait() has pruned the storage.
+ * Making a persistent wait set not persistent clears it, see
+ * rcl_wait_set_clear().
+ *
+ * Expected usage:
+ *
+ * ```c
+ * rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+ * rcl_ret_t ret = rcl_wait_set_init(&wait_set, 2, 0, 0, 0, 0, rcl_get_default_allocator());
+ * // ... error handling
+ * ret = rcl_wait_set_set_persistent(&wait_set, true);
+ * // ... error handling
+ * ret = rcl_wait_set_add_subscription(&wait_set, &sub1, NULL);
+ * // ... error handling
+ * ret = rcl_wait_set_add_subscription(&wait_set, &sub2, NULL);
+ * // ... error handling
+ * do {
+ *   ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1000));
+ *   // ... check wait_set.subscriptions for ready subscriptions, no clearing needed
+ * } while(check_some_condition());
+ * ```
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wait_set the wait set to be changed
+ * \param[in] persistent true to keep the members across calls to rcl_wait()
+ * \return `RCL_RET_OK` if the mode was changed successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_set_persistent(rcl_wait_set_t * wait_set, bool persistent);
+
+/// Check whether the wait set keeps its members across calls to rcl_wait().
+/**
+ * \see rcl_wait_set_set_persistent
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] wait_set the wait set to be queried
+ * \param[out] persistent set to true if the wait set is persistent
+ * \return `RCL_RET_OK` if the mode was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_is_persistent(const rcl_wait_set_t * wait_set, bool * persistent);
+
+/// Busy poll the wait set for a while in rcl_wait() before blocking.
+/**
+ * Waking up from a blocking wait in the middleware can take tens of
+ * microseconds.
+ * With a spin budget, rcl_wait() first checks the wait set without blocking,
+ * repeatedly, until something is ready, the timeout expires or the budget is
+ * spent, and only then blocks for the rest of the timeout.
+ * Spinning keeps a core busy, so the budget should be short and is best used
+ * in latency critical loops on dedicated cores.
+ *
+ * Waits which are not given anything to check by the middleware, e.g. only
+ * steady time timers, and waits with a zero timeout do not spin.
+ * How waits were resolved is counted, see rcl_wait_set_get_spin_statistics(),
+ * so the budget can be tuned.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wait_set the wait set to be changed
+ * \param[in] spin_budget the longest time to spin in each wait, in nanoseconds,
+ *   `0` to disable spinning
+ * \return `RCL_RET_OK` if the budget was set successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_set_spin_budget(rcl_wait_set_t * wait_set, int64_t spin_budget);
+
+/// Retrieve the spin budget of the wait set.
+/**
+ * \see rcl_wait_set_set_spin_budget
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] wait_set the wait set to be queried
+ * \param[out] spin_budget the spin budget, in nanoseconds
+ * \return `RCL_RET_OK` if the budget was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_get_spin_budget(const rcl_wait_set_t * wait_set, int64_t * spin_budget);
+
+/// Retrieve how the waits which spun were resolved.
+/**
+ * Only waits with a spin budget are counted.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] wait_set the wait set to be queried
+ * \param[out] statistics the counters of the wait set
+ * \return `RCL_RET_OK` if the statistics were retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_get_spin_statistics(
+  const rcl_wait_set_t * wait_set,
+  rcl_wait_set_spin_statistics_t * statistics);
+
+/// Reset the spin statistics of the wait set to zero.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wait_set the wait set to be changed
+ * \return `RCL_RET_OK` if the statistics were reset successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_reset_spin_statistics(rcl_wait_set_t * wait_set);
+
+/// Count the wake ups of the wait set.
+/**
+ * When enabled, every call to rcl_wait() or rcl_wait_until() updates the
+ * counters returned by rcl_wait_set_get_statistics(), which show whether the
+ * user of the wait set is starved, oversubscribed or woken up spuriously.
+ * This costs two reads of the steady clock and a few atomic increments per
+ * wait.
+ * Statistics are disabled by default, disabling them keeps the counters.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wait_set the wait set to be changed
+ * \param[in] enabled true to count the wake ups
+ * \return `RCL_RET_OK` if the statistics were enabled or disabled successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_enable_statistics(rcl_wait_set_t * wait_set, bool enabled);
+
+/// Retrieve the wake up statistics of the wait set.
+/**
+ * This may be called while another thread waits on the wait set, in which
+ * case the counters may be from different waits.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_uint_least64_t`</i>
+ *
+ * \param[in] wait_set the wait set to be queried
+ * \param[out] statistics the counters of the wait set
+ * \return `RCL_RET_OK` if the statistics were retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_get_statistics(
+  const rcl_wait_set_t * wait_set,
+  rcl_wait_set_statistics_t * statistics);
+
+/// Reset the wake up statistics of the wait set to zero.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes [1]
+ * <i>[1] if `atomic_is_lock_free()` returns true for `atomic_uint_least64_t`</i>
+ *
+ * \param[inout] wait_set the wait set to be changed
+ * \return `RCL_RET_OK` if the statistics were reset successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_reset_statistics(rcl_wait_set_t * wait_set);
+
+/// Remove the subscription at the given index from a persistent wait set.
+/**
+ * The index is the one returned when the subscription was added.
+ * Only the slot of that subscription is touched, the other members keep their
+ * indices.
+ * Removing from a wait set which is not persistent fails, use
+ * rcl_wait_set_clear() instead.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wait_set the persistent wait set
+ * \param[in] index the index of the subscription in the storage container
+ * \return `RCL_RET_OK` if removed successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized, or
+ * \return `RCL_RET_ERROR` if the wait set is not persistent.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_remove_subscription(rcl_wait_set_t * wait_set, size_t index);
+
+/// Remove the guard condition at the given index from a persistent wait set.
+/**
+ * This function behaves exactly the same as for subscriptions.
+ * \see rcl_wait_set_remove_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_remove_guard_condition(rcl_wait_set_t * wait_set, size_t index);
+
+/// Remove the timer at the given index from a persistent wait set.
+/**
+ * This function behaves exactly the same as for subscriptions.
+ * \see rcl_wait_set_remove_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_remove_timer(rcl_wait_set_t * wait_set, size_t index);
+
+/// Remove the client at the given index from a persistent wait set.
+/**
+ * This function behaves exactly the same as for subscriptions.
+ * \see rcl_wait_set_remove_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_remove_client(rcl_wait_set_t * wait_set, size_t index);
+
+/// Remove the service at the given index from a persistent wait set.
+/**
+ * This function behaves exactly the same as for subscriptions.
+ * \see rcl_wait_set_remove_subscription
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_remove_service(rcl_wait_set_t * wait_set, size_t index);
+
 /// Block until the wait set is ready or until the timeout has been exceeded.
 /**
  * This function will collect the items in the rcl_wait_set_t and pass them
@@ -351,6 +755,7 @@ rcl_wait_set_add_service(
  * on the type of the item.
  * For subscriptions this means there are messages that can be taken.
  * For guard conditions this means the guard condition was triggered.
+ * The ready items are also listed by rcl_wait_set_get_ready_entities().
  *
  * Expected usage:
  *
@@ -395,7 +800,8 @@ rcl_wait_set_add_service(
  * ```
  *
  * The wait set struct must be allocated, initialized, and should have been
- * cleared and then filled with items, e.g. subscriptions and guard conditions.
+ * cleared and then filled with items, e.g. subscriptions and guard conditions,
+ * unless it is persistent, see rcl_wait_set_set_persistent().
  * Passing a wait set with no wait-able items in it will fail.
  * `NULL` items in the sets are ignored, e.g. it is valid to have as input:
  *  - `subscriptions[0]` = valid pointer
@@ -415,6 +821,26 @@ rcl_wait_set_add_service(
  * comes first.
  * Passing a timeout struct with uninitialized memory is undefined behavior.
  *
+ * Timers are kept in one deadline ordered queue per clock, which is rebuilt
+ * only when timers are added, removed or reset, so the timeout is computed
+ * from the earliest timer of each clock and only due timers are inspected
+ * after waking up.
+ * Only a reset or a time jump of a timer in the wait set causes a rebuild,
+ * timers of other wait sets do not.
+ * A wait set which is not persistent is cleared and filled again between
+ * waits, so its queues are rebuilt on every wait, see
+ * rcl_wait_set_set_persistent().
+ * Timers with slack, see rcl_timer_exchange_slack(), delay the wake up to the
+ * earliest end of a slack window, so that timers whose windows overlap are
+ * ready on the same wake up.
+ * Each clock is read once before and once after waiting.
+ * If the wait set only contains timers which do not need a guard condition,
+ * e.g. steady or system time timers, and the timeout is finite, the thread
+ * sleeps until the timeout on platforms which support it instead of calling
+ * rmw_wait(), since nothing else could wake the wait up.
+ * A wait set with a spin budget polls before blocking, see
+ * rcl_wait_set_set_spin_budget().
+ *
  * This function is thread-safe for unique wait sets with unique contents.
  * This function cannot operate on the same wait set in multiple threads, and
  * the wait sets may not share content.
@@ -435,6 +861,169 @@ RCL_WARN_UNUSED
 rcl_ret_t
 rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout);
 
+/// Block until the wait set is ready or until an absolute deadline has passed.
+/**
+ * This function behaves like rcl_wait(), except that instead of a relative
+ * timeout it waits until the given time point on the given clock.
+ * Executors which wait for a fixed cadence should use it, because the
+ * deadline is converted to a timeout just before calling into the middleware,
+ * after the timers of the wait set were processed, so the time spent until
+ * then does not cause the cadence to drift.
+ *
+ * If the clock is a ROS time clock with ROS time active, the time of the
+ * clock does not advance with the system clock, so the deadline can not be
+ * turned into a timeout.
+ * Instead, like timers on ROS time, a guard condition of the wait set is
+ * triggered by a jump callback of the clock once the time of the clock is at
+ * or after the deadline.
+ * This guard condition is created on first use in the given context, which
+ * must be valid in this case and may be `NULL` otherwise.
+ * The jump callback is only added to the clock while waiting.
+ * When only this guard condition is ready, the wait returns
+ * `RCL_RET_TIMEOUT`, even if it was triggered by a jump at the end of a
+ * previous wait, so `RCL_RET_OK` always means something in the wait set is
+ * ready.
+ *
+ * A deadline which already passed makes this function non-blocking.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe [1]
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ * <i>[1] only when the deadline is on a clock with ROS time active</i>
+ *
+ * \param[inout] wait_set the set of things to be waited on and to be pruned if not ready
+ * \param[in] clock the clock on which the deadline is given
+ * \param[in] deadline the time point until which to wait at most
+ * \param[in] context the context in which to create the deadline guard condition, if needed
+ * \return `RCL_RET_OK` something in the wait set became ready, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or if the
+ *   deadline is not of the type of the clock, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized, or
+ * \return `RCL_RET_WAIT_SET_EMPTY` if the wait set contains no items, or
+ * \return `RCL_RET_TIMEOUT` if the deadline passed before something was ready, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_until(
+  rcl_wait_set_t * wait_set,
+  rcl_clock_t * clock,
+  const rcl_time_point_t * deadline,
+  rcl_context_t * context);
+
+/// Get the entities found ready by the last call to rcl_wait().
+/**
+ * Each call to rcl_wait() fills a compact list with one (type, index) pair
+ * for every entity which it left non-`NULL` in the storage arrays, so that
+ * the ready entities can be handled without scanning every storage array.
+ * Entries are grouped by type: timers first, then subscriptions, guard
+ * conditions, clients and services.
+ * Timers are listed in no particular order, the other types in ascending
+ * index order.
+ *
+ * The list is owned by the wait set and stays valid until the next call to
+ * rcl_wait(), rcl_wait_set_clear(), rcl_wait_set_resize() or
+ * rcl_wait_set_fini().
+ * It is empty before the first call to rcl_wait() and after a timeout.
+ *
+ * Expected usage:
+ *
+ * ```c
+ * ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1000));
+ * // ... error handling
+ * const rcl_wait_set_ready_entity_t * ready_entities;
+ * size_t count;
+ * ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+ * // ... error handling
+ * for (size_t i = 0; i < count; ++i) {
+ *   if (RCL_WAIT_SET_SUBSCRIPTION == ready_entities[i].type) {
+ *     const rcl_subscription_t * sub = wait_set.subscriptions[ready_entities[i].index];
+ *     // The subscription is ready...
+ *   }
+ * }
+ * ```
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] wait_set the wait set which was waited on
+ * \param[out] ready_entities set to point to the first ready entity
+ * \param[out] count set to the number of ready entities
+ * \return `RCL_RET_OK` if the list was retrieved successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_get_ready_entities(
+  const rcl_wait_set_t * wait_set,
+  const rcl_wait_set_ready_entity_t ** ready_entities,
+  size_t * count);
+
+/// Sort the entities found ready by the last call to rcl_wait().
+/**
+ * This function reorders the list returned by rcl_wait_set_get_ready_entities()
+ * in place, so that handling the entities in list order handles the most
+ * urgent ones first.
+ * The storage arrays of the wait set are not changed.
+ *
+ * The priority and deadline of an entity come from its rcl_dispatch_attributes_t:
+ * the `dispatch` member of the options of subscriptions, clients and services,
+ * and rcl_timer_set_dispatch_attributes() for timers.
+ * Guard conditions always have a priority of `0` and no deadline.
+ *
+ * With `RCL_DISPATCH_ORDER_EARLIEST_DEADLINE` entities are sorted by the
+ * time left until their deadline, measured when this function is called.
+ * For timers that is the time until the next call time plus the deadline,
+ * for other entities it is the deadline itself.
+ * With `RCL_DISPATCH_ORDER_PRIORITY` entities are sorted by descending
+ * priority first, and by time left until their deadline among equal
+ * priorities.
+ * Entities which compare equal keep their relative order.
+ * `RCL_DISPATCH_ORDER_WAIT_SET` restores the order filled by rcl_wait().
+ *
+ * Expected usage:
+ *
+ * ```c
+ * ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1000));
+ * // ... error handling
+ * ret = rcl_wait_set_sort_ready_entities(&wait_set, RCL_DISPATCH_ORDER_EARLIEST_DEADLINE);
+ * // ... error handling
+ * ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+ * // ... handle ready_entities[0] first
+ * ```
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes
+ *
+ * \param[inout] wait_set the wait set which was waited on
+ * \param[in] order the order to sort the ready entities in
+ * \return `RCL_RET_OK` if the list was sorted successfully, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_WAIT_SET_INVALID` if the wait set is zero initialized, or
+ * \return `RCL_RET_ERROR` an unspecified error occur.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_wait_set_sort_ready_entities(rcl_wait_set_t * wait_set, rcl_dispatch_order_t order);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,15 +23,13 @@ extern "C"
 #include <string.h>
 
 #include "rcl/error_handling.h"
-#include "rcl/expand_topic_name.h"
-#include "rcl/remap.h"
 #include "rcutils/logging_macros.h"
 #include "rcutils/stdatomic_helper.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
-#include "rmw/validate_full_topic_name.h"
 
 #include "./common.h"
+#include "./resolved_name_cache_impl.h"
 
 typedef struct rcl_client_impl_t
 {
@@ -73,89 +71,15 @@ rcl_client_init(
     RCL_SET_ERROR_MSG("client already initialized, or memory was unintialized");
     return RCL_RET_ALREADY_INIT;
   }
-  // Expand the given service name.
-  rcutils_allocator_t rcutils_allocator = *allocator;  // implicit conversion to rcutils version
-  rcutils_string_map_t substitutions_map = rcutils_get_zero_initialized_string_map();
-  rcutils_ret_t rcutils_ret = rcutils_string_map_init(&substitutions_map, 0, rcutils_allocator);
-  if (rcutils_ret != RCUTILS_RET_OK) {
-    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
-    if (rcutils_ret == RCUTILS_RET_BAD_ALLOC) {
-      return RCL_RET_BAD_ALLOC;
-    }
-    return RCL_RET_ERROR;
-  }
-  rcl_ret_t ret = rcl_get_default_topic_name_substitutions(&substitutions_map);
-  if (ret != RCL_RET_OK) {
-    rcutils_ret = rcutils_string_map_fini(&substitutions_map);
-    if (rcutils_ret != RCUTILS_RET_OK) {
-      RCUTILS_LOG_ERROR_NAMED(
-        ROS_PACKAGE_NAME,
-        "failed to fini string_map (%d) during error handling: %s\n",
-        rcutils_ret,
-        rcutils_get_error_string().str);
-    }
-    if (ret == RCL_RET_BAD_ALLOC) {
-      return ret;
-    }
-    return RCL_RET_ERROR;
-  }
-  char * expanded_service_name = NULL;
-  char * remapped_service_name = NULL;
-  ret = rcl_expand_topic_name(
-    service_name,
-    rcl_node_get_name(node),
-    rcl_node_get_namespace(node),
-    &substitutions_map,
-    *allocator,
-    &expanded_service_name);
-  rcutils_ret = rcutils_string_map_fini(&substitutions_map);
-  if (rcutils_ret != RCUTILS_RET_OK) {
-    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
-    allocator->deallocate(expanded_service_name, allocator->state);
-    return RCL_RET_ERROR;
-  }
-  if (ret != RCL_RET_OK) {
-    if (ret == RCL_RET_TOPIC_NAME_INVALID || ret == RCL_RET_UNKNOWN_SUBSTITUTION) {
-      ret = RCL_RET_SERVICE_NAME_INVALID;
-    } else {
-      ret = RCL_RET_ERROR;
-    }
-    goto cleanup;
-  }
-  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Expanded service name '%s'", expanded_service_name);
-
-  const rcl_node_options_t * node_options = rcl_node_get_options(node);
-  if (NULL == node_options) {
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  rcl_arguments_t * global_args = NULL;
-  if (node_options->use_global_arguments) {
-    global_args = &(node->context->global_arguments);
-  }
-  ret = rcl_remap_service_name(
-    &(node_options->arguments), global_args, expanded_service_name,
-    rcl_node_get_name(node), rcl_node_get_namespace(node), *allocator, &remapped_service_name);
-  if (RCL_RET_OK != ret) {
-    goto fail;
-  } else if (NULL == remapped_service_name) {
-    remapped_service_name = expanded_service_name;
-    expanded_service_name = NULL;
-  }
-
-  // Validate the expanded service name.
-  int validation_result;
-  rmw_ret_t rmw_ret = rmw_validate_full_topic_name(remapped_service_name, &validation_result, NULL);
-  if (rmw_ret != RMW_RET_OK) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  if (validation_result != RMW_TOPIC_VALID) {
-    RCL_SET_ERROR_MSG(rmw_full_topic_name_validation_result_string(validation_result));
-    ret = RCL_RET_SERVICE_NAME_INVALID;
-    goto cleanup;
+  // Resolve the given service name, which is only done once per name for the whole node.
+  const char * resolved_service_name = NULL;
+  rcl_ret_t ret = rcl_node_resolve_name(node, service_name, true, &resolved_service_name);
+  if (RCL_RET_TOPIC_NAME_INVALID == ret) {
+    return RCL_RET_SERVICE_NAME_INVALID;  // error already set
+  } else if (RCL_RET_OK != ret) {
+    return ret;  // error already set
   }
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Resolved service name '%s'", resolved_service_name);
   // Allocate space for the implementation struct.
   client->impl = (rcl_client_impl_t *)allocator->allocate(
     sizeof(rcl_client_impl_t), allocator->state);
@@ -167,7 +91,7 @@ rcl_client_init(
   client->impl->rmw_handle = rmw_create_client(
     rcl_node_get_rmw_handle(node),
     type_support,
-    remapped_service_name,
+    resolved_service_name,
     &options->qos);
   if (!client->impl->rmw_handle) {
     RCL_SET_ERROR_MSG(rmw_get_error_string().str);
@@ -185,11 +109,53 @@ fail:
   ret = fail_ret;
   // Fall through to cleanup
 cleanup:
-  if (NULL != expanded_service_name) {
-    allocator->deallocate(expanded_service_name, allocator->state);
+  return ret;
+}
+
+rcl_ret_t
+rcl_clients_init_bulk(
+  rcl_client_t * clients,
+  const rcl_node_t * node,
+  const rosidl_service_type_support_t * const * type_supports,
+  const char * const * service_names,
+  const rcl_client_options_t * options,
+  size_t count)
+{
+  if (!rcl_node_is_valid(node)) {
+    return RCL_RET_NODE_INVALID;  // error already set
+  }
+  if (0u == count) {
+    return RCL_RET_OK;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(clients, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(type_supports, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(service_names, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  // Every client then finds its name in the cache of the node.
+  rcl_ret_t ret = rcl_node_resolve_names(node, service_names, count, true);
+  if (RCL_RET_TOPIC_NAME_INVALID == ret) {
+    return RCL_RET_SERVICE_NAME_INVALID;  // error already set
+  } else if (RCL_RET_OK != ret) {
+    return ret;  // error already set
   }
-  if (NULL != remapped_service_name) {
-    allocator->deallocate(remapped_service_name, allocator->state);
+  size_t i;
+  for (i = 0u; i < count; ++i) {
+    ret = rcl_client_init(&clients[i], node, type_supports[i], service_names[i], &options[i]);
+    if (RCL_RET_OK != ret) {
+      break;
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    // Finalize the clients initialized before the one which failed.
+    while (i-- > 0u) {
+      if (rcl_client_fini(&clients[i], (rcl_node_t *)node) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          ROS_PACKAGE_NAME, "failed to fini client during error handling: %s",
+          rcl_get_error_string().str);
+      }
+      // Left zero initialized, so that the clients can be initialized again.
+      clients[i] = rcl_get_zero_initialized_client();
+    }
   }
   return ret;
 }
@@ -0,0 +1,666 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/content_filter.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rcl/error_handling.h"
+
+// Size of the encapsulation header which precedes the CDR payload.
+#define RCL_CONTENT_FILTER_HEADER_SIZE 4u
+
+typedef enum rcl_content_filter_opcode_t
+{
+  // Push the result of comparing a field with a literal.
+  RCL_CONTENT_FILTER_OPCODE_COMPARE,
+  // Pop two results and push their conjunction.
+  RCL_CONTENT_FILTER_OPCODE_AND,
+  // Pop two results and push their disjunction.
+  RCL_CONTENT_FILTER_OPCODE_OR,
+  // Negate the result on top.
+  RCL_CONTENT_FILTER_OPCODE_NOT
+} rcl_content_filter_opcode_t;
+
+typedef enum rcl_content_filter_kind_t
+{
+  RCL_CONTENT_FILTER_KIND_BOOL,
+  RCL_CONTENT_FILTER_KIND_SIGNED,
+  RCL_CONTENT_FILTER_KIND_UNSIGNED,
+  RCL_CONTENT_FILTER_KIND_FLOAT,
+  RCL_CONTENT_FILTER_KIND_STRING
+} rcl_content_filter_kind_t;
+
+typedef enum rcl_content_filter_comparison_t
+{
+  RCL_CONTENT_FILTER_EQUAL,
+  RCL_CONTENT_FILTER_NOT_EQUAL,
+  RCL_CONTENT_FILTER_LESS,
+  RCL_CONTENT_FILTER_LESS_EQUAL,
+  RCL_CONTENT_FILTER_GREATER,
+  RCL_CONTENT_FILTER_GREATER_EQUAL
+} rcl_content_filter_comparison_t;
+
+typedef struct rcl_content_filter_type_t
+{
+  const char * name;
+  rcl_content_filter_kind_t kind;
+  // Number of bytes at the offset of the field, the length prefix for strings.
+  size_t size;
+} rcl_content_filter_type_t;
+
+static const rcl_content_filter_type_t __content_filter_types[] = {
+  {"bool", RCL_CONTENT_FILTER_KIND_BOOL, 1u},
+  {"int8", RCL_CONTENT_FILTER_KIND_SIGNED, 1u},
+  {"uint8", RCL_CONTENT_FILTER_KIND_UNSIGNED, 1u},
+  {"int16", RCL_CONTENT_FILTER_KIND_SIGNED, 2u},
+  {"uint16", RCL_CONTENT_FILTER_KIND_UNSIGNED, 2u},
+  {"int32", RCL_CONTENT_FILTER_KIND_SIGNED, 4u},
+  {"uint32", RCL_CONTENT_FILTER_KIND_UNSIGNED, 4u},
+  {"int64", RCL_CONTENT_FILTER_KIND_SIGNED, 8u},
+  {"uint64", RCL_CONTENT_FILTER_KIND_UNSIGNED, 8u},
+  {"float32", RCL_CONTENT_FILTER_KIND_FLOAT, 4u},
+  {"float64", RCL_CONTENT_FILTER_KIND_FLOAT, 8u},
+  {"string", RCL_CONTENT_FILTER_KIND_STRING, 4u},
+};
+
+typedef struct rcl_content_filter_instruction_t
+{
+  rcl_content_filter_opcode_t opcode;
+  // The remaining members are only used by comparisons.
+  rcl_content_filter_kind_t kind;
+  size_t size;
+  size_t offset;
+  rcl_content_filter_comparison_t comparison;
+  union
+  {
+    uint64_t unsigned_value;
+    int64_t signed_value;
+    double float_value;
+    struct
+    {
+      // Range of the unescaped literal in the strings of the program.
+      size_t start;
+      size_t length;
+    } string_value;
+  } literal;
+} rcl_content_filter_instruction_t;
+
+typedef struct rcl_content_filter_impl_t
+{
+  // Program in postfix order, evaluated on a stack of results.
+  rcl_content_filter_instruction_t * instructions;
+  size_t instruction_count;
+  // Unescaped string literals of the comparisons.
+  char * strings;
+  size_t strings_length;
+  rcl_allocator_t allocator;
+} rcl_content_filter_impl_t;
+
+typedef struct rcl_content_filter_parser_t
+{
+  const char * expression;
+  size_t position;
+  rcl_content_filter_impl_t * impl;
+  // Number of results on the stack after the instructions emitted so far.
+  size_t depth;
+  // Number of parentheses the parser is in.
+  size_t nesting;
+} rcl_content_filter_parser_t;
+
+rcl_content_filter_t
+rcl_get_zero_initialized_content_filter()
+{
+  static rcl_content_filter_t null_content_filter = {0};
+  return null_content_filter;
+}
+
+static void
+__content_filter_deallocate(rcl_content_filter_impl_t * impl)
+{
+  rcl_allocator_t allocator = impl->allocator;
+  if (NULL != impl->instructions) {
+    allocator.deallocate(impl->instructions, allocator.state);
+  }
+  if (NULL != impl->strings) {
+    allocator.deallocate(impl->strings, allocator.state);
+  }
+  allocator.deallocate(impl, allocator.state);
+}
+
+static rcl_ret_t
+__content_filter_error(const rcl_content_filter_parser_t * parser, const char * expected)
+{
+  RCL_SET_ERROR_MSG_WITH_FORMAT_STRING(
+    "content filter expression is invalid at character %zu, expected %s",
+    parser->position, expected);
+  return RCL_RET_INVALID_ARGUMENT;
+}
+
+static char
+__content_filter_peek(rcl_content_filter_parser_t * parser)
+{
+  char c = parser->expression[parser->position];
+  while (' ' == c || '\t' == c || '\n' == c || '\r' == c) {
+    c = parser->expression[++parser->position];
+  }
+  return c;
+}
+
+static bool
+__content_filter_is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// Consume the token if it is the next one.
+static bool
+__content_filter_accept(rcl_content_filter_parser_t * parser, const char * token)
+{
+  (void)__content_filter_peek(parser);
+  const size_t length = strlen(token);
+  if (0 != strncmp(parser->expression + parser->position, token, length)) {
+    return false;
+  }
+  parser->position += length;
+  return true;
+}
+
+// Length of the lowercase identifier which is the next token, 0 if there is none.
+static size_t
+__content_filter_identifier_length(rcl_content_filter_parser_t * parser)
+{
+  (void)__content_filter_peek(parser);
+  const char * start = parser->expression + parser->position;
+  size_t length = 0u;
+  while ((start[length] >= 'a' && start[length] <= 'z') ||
+    __content_filter_is_digit(start[length]))
+  {
+    ++length;
+  }
+  return length;
+}
+
+static rcl_ret_t
+__content_filter_emit(
+  rcl_content_filter_parser_t * parser,
+  const rcl_content_filter_instruction_t * instruction)
+{
+  if (RCL_CONTENT_FILTER_OPCODE_COMPARE == instruction->opcode) {
+    if (++parser->depth > RCL_CONTENT_FILTER_MAX_DEPTH) {
+      RCL_SET_ERROR_MSG("content filter expression nests too deeply");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+  } else if (RCL_CONTENT_FILTER_OPCODE_NOT != instruction->opcode) {
+    --parser->depth;
+  }
+  // Every instruction consumes at least one character, so the program has room for it.
+  parser->impl->instructions[parser->impl->instruction_count++] = *instruction;
+  return RCL_RET_OK;
+}
+
+static rcl_ret_t
+__content_filter_emit_operation(
+  rcl_content_filter_parser_t * parser,
+  rcl_content_filter_opcode_t opcode)
+{
+  rcl_content_filter_instruction_t instruction;
+  memset(&instruction, 0, sizeof(instruction));
+  instruction.opcode = opcode;
+  return __content_filter_emit(parser, &instruction);
+}
+
+static rcl_ret_t
+__content_filter_parse_integer(
+  rcl_content_filter_parser_t * parser,
+  rcl_content_filter_instruction_t * instruction)
+{
+  const char * start = parser->expression + parser->position;
+  const bool is_signed = RCL_CONTENT_FILTER_KIND_SIGNED == instruction->kind;
+  const char * digits = (is_signed && '-' == *start) ? start + 1 : start;
+  if (!__content_filter_is_digit(*digits)) {
+    return __content_filter_error(parser, "an integer literal");
+  }
+  const int base = ('0' == digits[0] && ('x' == digits[1] || 'X' == digits[1])) ? 16 : 10;
+  const unsigned bits = (unsigned)(instruction->size * 8u);
+  char * end = NULL;
+  bool in_range = true;
+  errno = 0;
+  if (is_signed) {
+    const long long value = strtoll(start, &end, base);  // NOLINT(runtime/int)
+    instruction->literal.signed_value = value;
+    in_range = ERANGE != errno && (bits >= 64u ||
+      (value >= -((int64_t)1 << (bits - 1u)) && value < ((int64_t)1 << (bits - 1u))));
+  } else {
+    const unsigned long long value = strtoull(start, &end, base);  // NOLINT(runtime/int)
+    instruction->literal.unsigned_value = value;
+    in_range = ERANGE != errno && (bits >= 64u || value < ((uint64_t)1 << bits));
+  }
+  if (!in_range) {
+    return __content_filter_error(parser, "a literal in the range of the field type");
+  }
+  parser->position += (size_t)(end - start);
+  return RCL_RET_OK;
+}
+
+static rcl_ret_t
+__content_filter_parse_float(
+  rcl_content_filter_parser_t * parser,
+  rcl_content_filter_instruction_t * instruction)
+{
+  const char * start = parser->expression + parser->position;
+  const char * digits = '-' == *start ? start + 1 : start;
+  if (!__content_filter_is_digit(*digits) && '.' != *digits) {
+    return __content_filter_error(parser, "a number literal");
+  }
+  char * end = NULL;
+  errno = 0;
+  instruction->literal.float_value = strtod(start, &end);
+  if (end == start || (ERANGE == errno && isinf(instruction->literal.float_value))) {
+    return __content_filter_error(parser, "a number literal in range");
+  }
+  parser->position += (size_t)(end - start);
+  return RCL_RET_OK;
+}
+
+static rcl_ret_t
+__content_filter_parse_string(
+  rcl_content_filter_parser_t * parser,
+  rcl_content_filter_instruction_t * instruction)
+{
+  if (!__content_filter_accept(parser, "\"")) {
+    return __content_filter_error(parser, "a string literal");
+  }
+  rcl_content_filter_impl_t * impl = parser->impl;
+  instruction->literal.string_value.start = impl->strings_length;
+  // The unescaped literals are never longer than the expression, so the strings have room.
+  char c = parser->expression[parser->position];
+  while ('"' != c) {
+    if ('\0' == c) {
+      return __content_filter_error(parser, "a closing '\"'");
+    }
+    if ('\\' == c) {
+      c = parser->expression[++parser->position];
+      if ('"' != c && '\\' != c) {
+        return __content_filter_error(parser, "an escaped '\"' or '\\'");
+      }
+    }
+    impl->strings[impl->strings_length++] = c;
+    c = parser->expression[++parser->position];
+  }
+  ++parser->position;
+  instruction->literal.string_value.length =
+    impl->strings_length - instruction->literal.string_value.start;
+  return RCL_RET_OK;
+}
+
+static rcl_ret_t
+__content_filter_parse_comparison(rcl_content_filter_parser_t * parser)
+{
+  rcl_content_filter_instruction_t instruction;
+  memset(&instruction, 0, sizeof(instruction));
+  instruction.opcode = RCL_CONTENT_FILTER_OPCODE_COMPARE;
+  // type
+  const size_t length = __content_filter_identifier_length(parser);
+  const char * name = parser->expression + parser->position;
+  const rcl_content_filter_type_t * type = NULL;
+  size_t i;
+  for (i = 0; i < sizeof(__content_filter_types) / sizeof(__content_filter_types[0]); ++i) {
+    if (strlen(__content_filter_types[i].name) == length &&
+      0 == strncmp(__content_filter_types[i].name, name, length))
+    {
+      type = &__content_filter_types[i];
+    }
+  }
+  if (NULL == type) {
+    return __content_filter_error(parser, "a field type");
+  }
+  parser->position += length;
+  instruction.kind = type->kind;
+  instruction.size = type->size;
+  // offset
+  if (!__content_filter_accept(parser, "@")) {
+    return __content_filter_error(parser, "'@'");
+  }
+  char c = __content_filter_peek(parser);
+  if (!__content_filter_is_digit(c)) {
+    return __content_filter_error(parser, "an offset");
+  }
+  while (__content_filter_is_digit(c)) {
+    const size_t digit = (size_t)(c - '0');
+    if (instruction.offset > (SIZE_MAX - digit) / 10u) {
+      return __content_filter_error(parser, "an offset in range");
+    }
+    instruction.offset = instruction.offset * 10u + digit;
+    c = parser->expression[++parser->position];
+  }
+  // operator, the two character ones first
+  if (__content_filter_accept(parser, "==")) {
+    instruction.comparison = RCL_CONTENT_FILTER_EQUAL;
+  } else if (__content_filter_accept(parser, "!=")) {
+    instruction.comparison = RCL_CONTENT_FILTER_NOT_EQUAL;
+  } else if (__content_filter_accept(parser, "<=")) {
+    instruction.comparison = RCL_CONTENT_FILTER_LESS_EQUAL;
+  } else if (__content_filter_accept(parser, ">=")) {
+    instruction.comparison = RCL_CONTENT_FILTER_GREATER_EQUAL;
+  } else if (__content_filter_accept(parser, "<")) {
+    instruction.comparison = RCL_CONTENT_FILTER_LESS;
+  } else if (__content_filter_accept(parser, ">")) {
+    instruction.comparison = RCL_CONTENT_FILTER_GREATER;
+  } else {
+    return __content_filter_error(parser, "a comparison operator");
+  }
+  // literal
+  (void)__content_filter_peek(parser);
+  rcl_ret_t ret = RCL_RET_OK;
+  switch (instruction.kind) {
+    case RCL_CONTENT_FILTER_KIND_BOOL:
+      if (__content_filter_accept(parser, "true")) {
+        instruction.literal.unsigned_value = 1u;
+      } else if (!__content_filter_accept(parser, "false")) {
+        ret = __content_filter_error(parser, "true or false");
+      }
+      break;
+    case RCL_CONTENT_FILTER_KIND_SIGNED:
+    case RCL_CONTENT_FILTER_KIND_UNSIGNED:
+      ret = __content_filter_parse_integer(parser, &instruction);
+      break;
+    case RCL_CONTENT_FILTER_KIND_FLOAT:
+      ret = __content_filter_parse_float(parser, &instruction);
+      break;
+    case RCL_CONTENT_FILTER_KIND_STRING:
+      ret = __content_filter_parse_string(parser, &instruction);
+      break;
+  }
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  return __content_filter_emit(parser, &instruction);
+}
+
+static rcl_ret_t
+__content_filter_parse_or(rcl_content_filter_parser_t * parser);
+
+static rcl_ret_t
+__content_filter_parse_unary(rcl_content_filter_parser_t * parser)
+{
+  // Negations are folded, so that only parentheses recurse.
+  size_t negations = 0u;
+  while (__content_filter_accept(parser, "!")) {
+    ++negations;
+  }
+  rcl_ret_t ret = RCL_RET_OK;
+  if (__content_filter_accept(parser, "(")) {
+    if (++parser->nesting > RCL_CONTENT_FILTER_MAX_DEPTH) {
+      RCL_SET_ERROR_MSG("content filter expression nests too deeply");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+    ret = __content_filter_parse_or(parser);
+    if (RCL_RET_OK == ret && !__content_filter_accept(parser, ")")) {
+      ret = __content_filter_error(parser, "')'");
+    }
+    --parser->nesting;
+  } else {
+    ret = __content_filter_parse_comparison(parser);
+  }
+  if (RCL_RET_OK == ret && 1u == negations % 2u) {
+    ret = __content_filter_emit_operation(parser, RCL_CONTENT_FILTER_OPCODE_NOT);
+  }
+  return ret;
+}
+
+static rcl_ret_t
+__content_filter_parse_and(rcl_content_filter_parser_t * parser)
+{
+  rcl_ret_t ret = __content_filter_parse_unary(parser);
+  while (RCL_RET_OK == ret && __content_filter_accept(parser, "&&")) {
+    ret = __content_filter_parse_unary(parser);
+    if (RCL_RET_OK == ret) {
+      ret = __content_filter_emit_operation(parser, RCL_CONTENT_FILTER_OPCODE_AND);
+    }
+  }
+  return ret;
+}
+
+static rcl_ret_t
+__content_filter_parse_or(rcl_content_filter_parser_t * parser)
+{
+  rcl_ret_t ret = __content_filter_parse_and(parser);
+  while (RCL_RET_OK == ret && __content_filter_accept(parser, "||")) {
+    ret = __content_filter_parse_and(parser);
+    if (RCL_RET_OK == ret) {
+      ret = __content_filter_emit_operation(parser, RCL_CONTENT_FILTER_OPCODE_OR);
+    }
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_content_filter_init(
+  rcl_content_filter_t * filter,
+  const char * expression,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(filter, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(expression, RCL_RET_INVALID_ARGUMENT);
+  if (NULL != filter->impl) {
+    RCL_SET_ERROR_MSG("content filter already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  rcl_content_filter_impl_t * impl = (rcl_content_filter_impl_t *)allocator.zero_allocate(
+    1u, sizeof(rcl_content_filter_impl_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->allocator = allocator;
+  // Every instruction and every character of a string literal takes at least one
+  // character of the expression, which bounds the size of the program.
+  const size_t length = strlen(expression) + 1u;
+  impl->instructions = (rcl_content_filter_instruction_t *)allocator.zero_allocate(
+    length, sizeof(rcl_content_filter_instruction_t), allocator.state);
+  impl->strings = (char *)allocator.allocate(length, allocator.state);
+  if (NULL == impl->instructions || NULL == impl->strings) {
+    __content_filter_deallocate(impl);
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  rcl_content_filter_parser_t parser = {expression, 0u, impl, 0u, 0u};
+  rcl_ret_t ret = __content_filter_parse_or(&parser);
+  if (RCL_RET_OK == ret && '\0' != __content_filter_peek(&parser)) {
+    ret = __content_filter_error(&parser, "an operator or the end of the expression");
+  }
+  if (RCL_RET_OK != ret) {
+    __content_filter_deallocate(impl);
+    return ret;  // error already set
+  }
+  filter->impl = impl;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_content_filter_fini(rcl_content_filter_t * filter)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(filter, RCL_RET_INVALID_ARGUMENT);
+  if (NULL != filter->impl) {
+    __content_filter_deallocate(filter->impl);
+    filter->impl = NULL;
+  }
+  return RCL_RET_OK;
+}
+
+// Read an unsigned integer of the given size in the byte order of the payload.
+static uint64_t
+__content_filter_read(const uint8_t * data, size_t size, bool little_endian)
+{
+  uint64_t value = 0u;
+  size_t i;
+  for (i = 0; i < size; ++i) {
+    value = (value << 8u) | (little_endian ? data[size - 1u - i] : data[i]);
+  }
+  return value;
+}
+
+// Compare the field of a comparison with its literal, false if the field does not fit.
+static bool
+__content_filter_compare(
+  const rcl_content_filter_impl_t * impl,
+  const rcl_content_filter_instruction_t * instruction,
+  const uint8_t * data,
+  size_t length,
+  bool little_endian)
+{
+  if (instruction->offset > length || instruction->size > length - instruction->offset) {
+    return false;
+  }
+  const uint8_t * field = data + instruction->offset;
+  const uint64_t raw = __content_filter_read(field, instruction->size, little_endian);
+  // Sign of the field minus the literal.
+  int order = 0;
+  switch (instruction->kind) {
+    case RCL_CONTENT_FILTER_KIND_BOOL:
+    case RCL_CONTENT_FILTER_KIND_UNSIGNED:
+      {
+        const uint64_t value =
+          RCL_CONTENT_FILTER_KIND_BOOL == instruction->kind ? (0u != raw) : raw;
+        const uint64_t literal = instruction->literal.unsigned_value;
+        order = (value > literal) - (value < literal);
+      }
+      break;
+    case RCL_CONTENT_FILTER_KIND_SIGNED:
+      {
+        const unsigned bits = (unsigned)(instruction->size * 8u);
+        uint64_t extended = raw;
+        if (bits < 64u && 0u != (raw >> (bits - 1u))) {
+          extended |= ~(uint64_t)0 << bits;
+        }
+        const int64_t value = (int64_t)extended;
+        const int64_t literal = instruction->literal.signed_value;
+        order = (value > literal) - (value < literal);
+      }
+      break;
+    case RCL_CONTENT_FILTER_KIND_FLOAT:
+      {
+        double value;
+        if (sizeof(float) == instruction->size) {
+          const uint32_t bytes = (uint32_t)raw;
+          float single;
+          memcpy(&single, &bytes, sizeof(single));
+          value = single;
+        } else {
+          memcpy(&value, &raw, sizeof(value));
+        }
+        const double literal = instruction->literal.float_value;
+        if (isnan(value) || isnan(literal)) {
+          return RCL_CONTENT_FILTER_NOT_EQUAL == instruction->comparison;
+        }
+        order = (value > literal) - (value < literal);
+      }
+      break;
+    case RCL_CONTENT_FILTER_KIND_STRING:
+      {
+        // The length prefix counts the terminating null character.
+        const size_t available = length - instruction->offset - instruction->size;
+        if (0u == raw || raw > available) {
+          return false;
+        }
+        const size_t value_length = (size_t)raw - 1u;
+        const size_t literal_length = instruction->literal.string_value.length;
+        const int difference = memcmp(
+          field + instruction->size, impl->strings + instruction->literal.string_value.start,
+          value_length < literal_length ? value_length : literal_length);
+        order = 0 != difference ? (difference > 0) - (difference < 0) :
+          (value_length > literal_length) - (value_length < literal_length);
+      }
+      break;
+  }
+  switch (instruction->comparison) {
+    case RCL_CONTENT_FILTER_EQUAL:
+      return 0 == order;
+    case RCL_CONTENT_FILTER_NOT_EQUAL:
+      return 0 != order;
+    case RCL_CONTENT_FILTER_LESS:
+      return order < 0;
+    case RCL_CONTENT_FILTER_LESS_EQUAL:
+      return order <= 0;
+    case RCL_CONTENT_FILTER_GREATER:
+      return order > 0;
+    case RCL_CONTENT_FILTER_GREATER_EQUAL:
+      return order >= 0;
+  }
+  return false;
+}
+
+rcl_ret_t
+rcl_content_filter_evaluate(
+  const rcl_content_filter_t * filter,
+  const rcl_serialized_message_t * serialized_message,
+  bool * accepted)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(filter, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    filter->impl, "content filter is not initialized", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(accepted, RCL_RET_INVALID_ARGUMENT);
+  const rcl_content_filter_impl_t * impl = filter->impl;
+  // A payload without a complete header has no fields.
+  const uint8_t * data = NULL;
+  size_t length = 0u;
+  bool little_endian = false;
+  if (NULL != serialized_message->buffer &&
+    serialized_message->buffer_length >= RCL_CONTENT_FILTER_HEADER_SIZE)
+  {
+    const uint8_t * buffer = (const uint8_t *)serialized_message->buffer;
+    data = buffer + RCL_CONTENT_FILTER_HEADER_SIZE;
+    length = serialized_message->buffer_length - RCL_CONTENT_FILTER_HEADER_SIZE;
+    // The second byte of the header is odd for the little endian representations.
+    little_endian = 0u != (buffer[1] & 1u);
+  }
+  bool stack[RCL_CONTENT_FILTER_MAX_DEPTH];
+  size_t depth = 0u;
+  size_t i;
+  for (i = 0; i < impl->instruction_count; ++i) {
+    const rcl_content_filter_instruction_t * instruction = &impl->instructions[i];
+    switch (instruction->opcode) {
+      case RCL_CONTENT_FILTER_OPCODE_COMPARE:
+        stack[depth++] = __content_filter_compare(impl, instruction, data, length, little_endian);
+        break;
+      case RCL_CONTENT_FILTER_OPCODE_AND:
+        --depth;
+        stack[depth - 1u] = stack[depth - 1u] && stack[depth];
+        break;
+      case RCL_CONTENT_FILTER_OPCODE_OR:
+        --depth;
+        stack[depth - 1u] = stack[depth - 1u] || stack[depth];
+        break;
+      case RCL_CONTENT_FILTER_OPCODE_NOT:
+        stack[depth - 1u] = !stack[depth - 1u];
+        break;
+    }
+  }
+  *accepted = stack[0];
+  return RCL_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
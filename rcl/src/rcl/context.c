@@ -126,6 +126,9 @@ __cleanup_context(rcl_context_t * context)
       }
     }
 
+    // every intra process publisher and subscription is already finalized
+    rcl_intra_process_registry_fini(&(context->impl->intra_process));
+
     // clean up copy of argv if valid
     if (NULL != context->impl->argv) {
       int64_t i;
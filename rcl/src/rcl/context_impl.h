@@ -19,6 +19,7 @@
 #include "rcl/error_handling.h"
 
 #include "./init_options_impl.h"
+#include "./intra_process_impl.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -38,6 +39,8 @@ typedef struct rcl_context_impl_t
   char ** argv;
   /// rmw context.
   rmw_context_t rmw_context;
+  /// Publishers and subscriptions which exchange messages without the middleware.
+  rcl_intra_process_registry_t intra_process;
 } rcl_context_impl_t;
 
 RCL_LOCAL
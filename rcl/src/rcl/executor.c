@@ -0,0 +1,959 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if defined(__linux__) && !defined(_POSIX_C_SOURCE)
+// For pthreads, when compiling with strict ISO C.
+# define _POSIX_C_SOURCE 200112L
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/executor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/error_handling.h"
+#include "rcl/wait.h"
+#include "rcutils/logging_macros.h"
+#include "rcutils/stdatomic_helper.h"
+
+#if defined(_WIN32)
+# include <windows.h>
+typedef CRITICAL_SECTION rcl_executor_mutex_t;
+typedef CONDITION_VARIABLE rcl_executor_cond_t;
+typedef HANDLE rcl_executor_thread_t;
+#else
+# include <pthread.h>
+typedef pthread_mutex_t rcl_executor_mutex_t;
+typedef pthread_cond_t rcl_executor_cond_t;
+typedef pthread_t rcl_executor_thread_t;
+#endif
+
+typedef struct rcl_executor_entity_t
+{
+  rcl_wait_set_entity_type_t type;
+  union
+  {
+    const rcl_subscription_t * subscription;
+    const rcl_guard_condition_t * guard_condition;
+    rcl_timer_t * timer;
+    const rcl_client_t * client;
+    const rcl_service_t * service;
+  } handle;
+  union
+  {
+    rcl_executor_subscription_callback_t subscription;
+    rcl_executor_guard_condition_callback_t guard_condition;
+    rcl_executor_client_callback_t client;
+    rcl_executor_service_callback_t service;
+  } callback;
+  // Message, request or response to take into.
+  void * data;
+  // Response of a service.
+  void * response;
+  void * user_data;
+  // True from the wait which found the entity ready until its callback returned.
+  bool in_flight;
+  // Index of the entity in the wait set, while it is a member.
+  size_t wait_set_index;
+} rcl_executor_entity_t;
+
+// Queue of the indices of the entities to execute, one per thread.
+typedef struct rcl_executor_queue_t
+{
+  size_t * items;
+  size_t head;
+  size_t count;
+  rcl_executor_mutex_t mutex;
+} rcl_executor_queue_t;
+
+typedef struct rcl_executor_worker_t
+{
+  struct rcl_executor_impl_t * impl;
+  size_t index;
+  rcl_executor_thread_t thread;
+} rcl_executor_worker_t;
+
+typedef struct rcl_executor_impl_t
+{
+  rcl_context_t * context;
+  rcl_allocator_t allocator;
+  rcl_executor_entity_t * entities;
+  size_t entity_count;
+  size_t capacity;
+  size_t type_counts[RCL_WAIT_SET_ENTITY_TYPE_COUNT];
+  // First slot of each kind of entity in the slots.
+  size_t slot_offsets[RCL_WAIT_SET_ENTITY_TYPE_COUNT];
+  // Entity index of each entry of the wait set, the entries of each kind following each other.
+  size_t * slots;
+  // True if entities were added since the wait set was last resized.
+  bool wait_set_dirty;
+  // Persistent, the entities are removed while in flight and added again once executed.
+  rcl_wait_set_t wait_set;
+  // The first guard condition of the wait set, interrupts the wait.
+  rcl_guard_condition_t interrupt_guard_condition;
+  // One queue and worker per thread, the queues can hold every entity.
+  rcl_executor_queue_t * queues;
+  rcl_executor_worker_t * workers;
+  size_t thread_count;
+  rcl_dispatch_order_t dispatch_order;
+  // Protects the fields below and the in_flight flags of the entities.
+  rcl_executor_mutex_t mutex;
+  // Signaled when work is queued, or when no thread waits on the wait set.
+  rcl_executor_cond_t cond;
+  // Number of entities in the queues.
+  size_t pending;
+  // Indices of the entities executed since the last wait, to add to the wait set again.
+  size_t * returned;
+  size_t returned_count;
+  // True while a thread waits on the wait set.
+  bool waiting;
+  bool stop;
+  // First error which made spinning stop.
+  rcl_ret_t result;
+  atomic_bool spinning;
+  atomic_bool canceled;
+} rcl_executor_impl_t;
+
+#if defined(_WIN32)
+# define EXECUTOR_MUTEX_INIT(mutex) (InitializeCriticalSection(mutex), true)
+# define EXECUTOR_MUTEX_FINI(mutex) DeleteCriticalSection(mutex)
+# define EXECUTOR_MUTEX_LOCK(mutex) EnterCriticalSection(mutex)
+# define EXECUTOR_MUTEX_UNLOCK(mutex) LeaveCriticalSection(mutex)
+# define EXECUTOR_COND_INIT(cond) (InitializeConditionVariable(cond), true)
+# define EXECUTOR_COND_FINI(cond)
+# define EXECUTOR_COND_WAIT(cond, mutex) SleepConditionVariableCS(cond, mutex, INFINITE)
+# define EXECUTOR_COND_BROADCAST(cond) WakeAllConditionVariable(cond)
+#else
+# define EXECUTOR_MUTEX_INIT(mutex) (0 == pthread_mutex_init(mutex, NULL))
+# define EXECUTOR_MUTEX_FINI(mutex) pthread_mutex_destroy(mutex)
+# define EXECUTOR_MUTEX_LOCK(mutex) pthread_mutex_lock(mutex)
+# define EXECUTOR_MUTEX_UNLOCK(mutex) pthread_mutex_unlock(mutex)
+# define EXECUTOR_COND_INIT(cond) (0 == pthread_cond_init(cond, NULL))
+# define EXECUTOR_COND_FINI(cond) pthread_cond_destroy(cond)
+# define EXECUTOR_COND_WAIT(cond, mutex) pthread_cond_wait(cond, mutex)
+# define EXECUTOR_COND_BROADCAST(cond) pthread_cond_broadcast(cond)
+#endif
+
+rcl_executor_options_t
+rcl_executor_get_default_options()
+{
+  // !!! MAKE SURE THAT CHANGES TO THESE DEFAULTS ARE REFLECTED IN THE HEADER DOC STRING
+  static rcl_executor_options_t default_options;
+  default_options.thread_count = 1u;
+  default_options.dispatch_order = RCL_DISPATCH_ORDER_WAIT_SET;
+  default_options.allocator = rcl_get_default_allocator();
+  return default_options;
+}
+
+rcl_executor_t
+rcl_get_zero_initialized_executor()
+{
+  static rcl_executor_t null_executor = {0};
+  return null_executor;
+}
+
+// Finalize the synchronization primitives of the first count queues, and of the executor.
+static void
+__executor_fini_sync(rcl_executor_impl_t * impl, size_t count, bool cond)
+{
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    EXECUTOR_MUTEX_FINI(&impl->queues[i].mutex);
+  }
+  if (cond) {
+    EXECUTOR_COND_FINI(&impl->cond);
+  }
+  EXECUTOR_MUTEX_FINI(&impl->mutex);
+}
+
+static void
+__executor_deallocate(rcl_executor_impl_t * impl)
+{
+  rcl_allocator_t allocator = impl->allocator;
+  size_t i;
+  if (NULL != impl->queues) {
+    for (i = 0; i < impl->thread_count; ++i) {
+      allocator.deallocate(impl->queues[i].items, allocator.state);
+    }
+  }
+  allocator.deallocate(impl->queues, allocator.state);
+  allocator.deallocate(impl->workers, allocator.state);
+  allocator.deallocate(impl->slots, allocator.state);
+  allocator.deallocate(impl->returned, allocator.state);
+  allocator.deallocate(impl->entities, allocator.state);
+  allocator.deallocate(impl, allocator.state);
+}
+
+rcl_ret_t
+rcl_executor_init(
+  rcl_executor_t * executor,
+  rcl_context_t * context,
+  const rcl_executor_options_t * options)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(executor, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(context, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  rcl_allocator_t allocator = options->allocator;
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  if (0u == options->thread_count) {
+    RCL_SET_ERROR_MSG("executor needs at least one thread");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (executor->impl) {
+    RCL_SET_ERROR_MSG("executor already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  rcl_executor_impl_t * impl = (rcl_executor_impl_t *)allocator.zero_allocate(
+    1, sizeof(rcl_executor_impl_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->context = context;
+  impl->allocator = allocator;
+  impl->thread_count = options->thread_count;
+  impl->dispatch_order = options->dispatch_order;
+  impl->wait_set_dirty = true;
+  rcutils_atomic_store(&impl->spinning, false);
+  rcutils_atomic_store(&impl->canceled, false);
+  impl->queues = (rcl_executor_queue_t *)allocator.zero_allocate(
+    impl->thread_count, sizeof(rcl_executor_queue_t), allocator.state);
+  impl->workers = (rcl_executor_worker_t *)allocator.zero_allocate(
+    impl->thread_count, sizeof(rcl_executor_worker_t), allocator.state);
+  // The first slot is for the interrupt guard condition.
+  impl->slots = (size_t *)allocator.allocate(sizeof(size_t), allocator.state);
+  if (NULL == impl->queues || NULL == impl->workers || NULL == impl->slots) {
+    __executor_deallocate(impl);
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  if (!EXECUTOR_MUTEX_INIT(&impl->mutex)) {
+    __executor_deallocate(impl);
+    RCL_SET_ERROR_MSG("failed to initialize executor mutex");
+    return RCL_RET_ERROR;
+  }
+  if (!EXECUTOR_COND_INIT(&impl->cond)) {
+    __executor_fini_sync(impl, 0u, false);
+    __executor_deallocate(impl);
+    RCL_SET_ERROR_MSG("failed to initialize executor condition variable");
+    return RCL_RET_ERROR;
+  }
+  size_t i;
+  for (i = 0; i < impl->thread_count; ++i) {
+    impl->workers[i].impl = impl;
+    impl->workers[i].index = i;
+    if (!EXECUTOR_MUTEX_INIT(&impl->queues[i].mutex)) {
+      __executor_fini_sync(impl, i, true);
+      __executor_deallocate(impl);
+      RCL_SET_ERROR_MSG("failed to initialize executor mutex");
+      return RCL_RET_ERROR;
+    }
+  }
+  impl->interrupt_guard_condition = rcl_get_zero_initialized_guard_condition();
+  rcl_guard_condition_options_t guard_condition_options =
+    rcl_guard_condition_get_default_options();
+  guard_condition_options.allocator = allocator;
+  rcl_ret_t ret = rcl_guard_condition_init(
+    &impl->interrupt_guard_condition, context, guard_condition_options);
+  if (RCL_RET_OK == ret) {
+    impl->wait_set = rcl_get_zero_initialized_wait_set();
+    ret = rcl_wait_set_init(&impl->wait_set, 0, 1, 0, 0, 0, allocator);
+    if (RCL_RET_OK == ret) {
+      ret = rcl_wait_set_set_persistent(&impl->wait_set, true);
+      if (RCL_RET_OK != ret && RCL_RET_OK != rcl_wait_set_fini(&impl->wait_set)) {
+        RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to fini wait set after failed init");
+      }
+    }
+    if (RCL_RET_OK != ret) {
+      if (RCL_RET_OK != rcl_guard_condition_fini(&impl->interrupt_guard_condition)) {
+        RCUTILS_LOG_ERROR_NAMED(
+          ROS_PACKAGE_NAME, "Failed to fini guard condition after failed init");
+      }
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    __executor_fini_sync(impl, impl->thread_count, true);
+    __executor_deallocate(impl);
+    return ret;  // rcl error state should already be set.
+  }
+  executor->impl = impl;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_executor_fini(rcl_executor_t * executor)
+{
+  if (!executor || !executor->impl) {
+    return RCL_RET_OK;
+  }
+  rcl_executor_impl_t * impl = executor->impl;
+  if (rcutils_atomic_load_bool(&impl->spinning)) {
+    RCL_SET_ERROR_MSG("executor is spinning");
+    return RCL_RET_ERROR;
+  }
+  rcl_ret_t result = RCL_RET_OK;
+  if (RCL_RET_OK != rcl_wait_set_fini(&impl->wait_set)) {
+    result = RCL_RET_ERROR;
+  }
+  if (RCL_RET_OK != rcl_guard_condition_fini(&impl->interrupt_guard_condition)) {
+    result = RCL_RET_ERROR;
+  }
+  __executor_fini_sync(impl, impl->thread_count, true);
+  __executor_deallocate(impl);
+  executor->impl = NULL;
+  return result;
+}
+
+// Make room for one more entity, in the entities, the slots, the returned list and every queue.
+static rcl_ret_t
+__executor_reserve(rcl_executor_impl_t * impl)
+{
+  if (impl->entity_count < impl->capacity) {
+    return RCL_RET_OK;
+  }
+  rcl_allocator_t allocator = impl->allocator;
+  const size_t capacity = impl->capacity ? 2u * impl->capacity : 8u;
+  rcl_executor_entity_t * entities = (rcl_executor_entity_t *)allocator.reallocate(
+    impl->entities, capacity * sizeof(rcl_executor_entity_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(entities, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->entities = entities;
+  size_t * slots = (size_t *)allocator.reallocate(
+    impl->slots, (capacity + 1u) * sizeof(size_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(slots, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->slots = slots;
+  size_t * returned = (size_t *)allocator.reallocate(
+    impl->returned, capacity * sizeof(size_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(returned, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->returned = returned;
+  size_t i;
+  for (i = 0; i < impl->thread_count; ++i) {
+    // The queues are empty while not spinning.
+    size_t * items = (size_t *)allocator.reallocate(
+      impl->queues[i].items, capacity * sizeof(size_t), allocator.state);
+    RCL_CHECK_FOR_NULL_WITH_MSG(items, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+    impl->queues[i].items = items;
+  }
+  impl->capacity = capacity;
+  return RCL_RET_OK;
+}
+
+// Check the arguments and reserve storage for a new entity, which is returned.
+static rcl_executor_entity_t *
+__executor_add(rcl_executor_t * executor, rcl_wait_set_entity_type_t type, rcl_ret_t * ret)
+{
+  if (!executor || !executor->impl) {
+    RCL_SET_ERROR_MSG("executor is invalid");
+    *ret = RCL_RET_INVALID_ARGUMENT;
+    return NULL;
+  }
+  rcl_executor_impl_t * impl = executor->impl;
+  if (rcutils_atomic_load_bool(&impl->spinning)) {
+    RCL_SET_ERROR_MSG("cannot add entities while the executor is spinning");
+    *ret = RCL_RET_ERROR;
+    return NULL;
+  }
+  *ret = __executor_reserve(impl);
+  if (RCL_RET_OK != *ret) {
+    return NULL;
+  }
+  rcl_executor_entity_t * entity = &impl->entities[impl->entity_count++];
+  entity->type = type;
+  entity->data = NULL;
+  entity->response = NULL;
+  entity->user_data = NULL;
+  entity->in_flight = false;
+  ++impl->type_counts[type];
+  impl->wait_set_dirty = true;
+  return entity;
+}
+
+rcl_ret_t
+rcl_executor_add_subscription(
+  rcl_executor_t * executor,
+  const rcl_subscription_t * subscription,
+  void * ros_message,
+  rcl_executor_subscription_callback_t callback,
+  void * user_data)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(callback, RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t ret;
+  rcl_executor_entity_t * entity = __executor_add(executor, RCL_WAIT_SET_SUBSCRIPTION, &ret);
+  if (NULL == entity) {
+    return ret;  // rcl error state should already be set.
+  }
+  entity->handle.subscription = subscription;
+  entity->callback.subscription = callback;
+  entity->data = ros_message;
+  entity->user_data = user_data;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_executor_add_timer(rcl_executor_t * executor, rcl_timer_t * timer)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t ret;
+  rcl_executor_entity_t * entity = __executor_add(executor, RCL_WAIT_SET_TIMER, &ret);
+  if (NULL == entity) {
+    return ret;  // rcl error state should already be set.
+  }
+  entity->handle.timer = timer;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_executor_add_service(
+  rcl_executor_t * executor,
+  const rcl_service_t * service,
+  void * ros_request,
+  void * ros_response,
+  rcl_executor_service_callback_t callback,
+  void * user_data)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_request, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_response, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(callback, RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t ret;
+  rcl_executor_entity_t * entity = __executor_add(executor, RCL_WAIT_SET_SERVICE, &ret);
+  if (NULL == entity) {
+    return ret;  // rcl error state should already be set.
+  }
+  entity->handle.service = service;
+  entity->callback.service = callback;
+  entity->data = ros_request;
+  entity->response = ros_response;
+  entity->user_data = user_data;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_executor_add_client(
+  rcl_executor_t * executor,
+  const rcl_client_t * client,
+  void * ros_response,
+  rcl_executor_client_callback_t callback,
+  void * user_data)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_response, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(callback, RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t ret;
+  rcl_executor_entity_t * entity = __executor_add(executor, RCL_WAIT_SET_CLIENT, &ret);
+  if (NULL == entity) {
+    return ret;  // rcl error state should already be set.
+  }
+  entity->handle.client = client;
+  entity->callback.client = callback;
+  entity->data = ros_response;
+  entity->user_data = user_data;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_executor_add_guard_condition(
+  rcl_executor_t * executor,
+  const rcl_guard_condition_t * guard_condition,
+  rcl_executor_guard_condition_callback_t callback,
+  void * user_data)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(guard_condition, RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t ret;
+  rcl_executor_entity_t * entity = __executor_add(executor, RCL_WAIT_SET_GUARD_CONDITION, &ret);
+  if (NULL == entity) {
+    return ret;  // rcl error state should already be set.
+  }
+  entity->handle.guard_condition = guard_condition;
+  entity->callback.guard_condition = callback;
+  entity->user_data = user_data;
+  return RCL_RET_OK;
+}
+
+// Add an entity to the wait set, and remember which entity the wait set entry is.
+static rcl_ret_t
+__executor_wait_set_add(rcl_executor_impl_t * impl, size_t entity_index)
+{
+  rcl_wait_set_t * wait_set = &impl->wait_set;
+  rcl_executor_entity_t * entity = &impl->entities[entity_index];
+  rcl_ret_t ret = RCL_RET_OK;
+  switch (entity->type) {
+    case RCL_WAIT_SET_SUBSCRIPTION:
+      ret = rcl_wait_set_add_subscription(
+        wait_set, entity->handle.subscription, &entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_GUARD_CONDITION:
+      ret = rcl_wait_set_add_guard_condition(
+        wait_set, entity->handle.guard_condition, &entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_TIMER:
+      ret = rcl_wait_set_add_timer(wait_set, entity->handle.timer, &entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_CLIENT:
+      ret = rcl_wait_set_add_client(wait_set, entity->handle.client, &entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_SERVICE:
+      ret = rcl_wait_set_add_service(wait_set, entity->handle.service, &entity->wait_set_index);
+      break;
+  }
+  if (RCL_RET_OK == ret) {
+    impl->slots[impl->slot_offsets[entity->type] + entity->wait_set_index] = entity_index;
+  }
+  return ret;
+}
+
+// Remove an entity from the wait set, while it is being executed.
+static rcl_ret_t
+__executor_wait_set_remove(rcl_executor_impl_t * impl, const rcl_executor_entity_t * entity)
+{
+  rcl_wait_set_t * wait_set = &impl->wait_set;
+  rcl_ret_t ret = RCL_RET_OK;
+  switch (entity->type) {
+    case RCL_WAIT_SET_SUBSCRIPTION:
+      ret = rcl_wait_set_remove_subscription(wait_set, entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_GUARD_CONDITION:
+      ret = rcl_wait_set_remove_guard_condition(wait_set, entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_TIMER:
+      ret = rcl_wait_set_remove_timer(wait_set, entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_CLIENT:
+      ret = rcl_wait_set_remove_client(wait_set, entity->wait_set_index);
+      break;
+    case RCL_WAIT_SET_SERVICE:
+      ret = rcl_wait_set_remove_service(wait_set, entity->wait_set_index);
+      break;
+  }
+  return ret;
+}
+
+// Size the wait set for the entities and add all of them, before spinning.
+static rcl_ret_t
+__executor_prepare(rcl_executor_impl_t * impl)
+{
+  if (!impl->wait_set_dirty) {
+    return RCL_RET_OK;
+  }
+  // Resizing empties the wait set, it stays persistent.
+  rcl_ret_t ret = rcl_wait_set_resize(
+    &impl->wait_set,
+    impl->type_counts[RCL_WAIT_SET_SUBSCRIPTION],
+    impl->type_counts[RCL_WAIT_SET_GUARD_CONDITION] + 1u,
+    impl->type_counts[RCL_WAIT_SET_TIMER],
+    impl->type_counts[RCL_WAIT_SET_CLIENT],
+    impl->type_counts[RCL_WAIT_SET_SERVICE]);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  size_t offset = 0u;
+  size_t type;
+  for (type = 0; type < RCL_WAIT_SET_ENTITY_TYPE_COUNT; ++type) {
+    impl->slot_offsets[type] = offset;
+    offset += impl->type_counts[type];
+    if (RCL_WAIT_SET_GUARD_CONDITION == type) {
+      ++offset;
+    }
+  }
+  ret = rcl_wait_set_add_guard_condition(&impl->wait_set, &impl->interrupt_guard_condition, NULL);
+  size_t i;
+  // Nothing is in flight while not spinning.
+  for (i = 0; i < impl->entity_count && RCL_RET_OK == ret; ++i) {
+    ret = __executor_wait_set_add(impl, i);
+  }
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  impl->returned_count = 0u;
+  impl->wait_set_dirty = false;
+  return RCL_RET_OK;
+}
+
+// Mark an executed entity as no longer in flight, with the mutex held.
+static void
+__executor_return(rcl_executor_impl_t * impl, size_t entity_index)
+{
+  impl->entities[entity_index].in_flight = false;
+  impl->returned[impl->returned_count++] = entity_index;
+}
+
+// Add the entities executed since the last wait to the wait set again, with the mutex held.
+static rcl_ret_t
+__executor_fill_wait_set(rcl_executor_impl_t * impl)
+{
+  rcl_ret_t ret = RCL_RET_OK;
+  while (impl->returned_count > 0u && RCL_RET_OK == ret) {
+    ret = __executor_wait_set_add(impl, impl->returned[--impl->returned_count]);
+  }
+  if (RCL_RET_OK != ret) {
+    // Rebuild the wait set on the next spin.
+    impl->wait_set_dirty = true;
+  }
+  return ret;
+}
+
+// Wait on the entities which are not being executed, and queue the ready ones.
+// Called without the mutex held, by the only thread waiting.
+static rcl_ret_t
+__executor_wait(rcl_executor_impl_t * impl, size_t queue_index, int64_t timeout)
+{
+  EXECUTOR_MUTEX_LOCK(&impl->mutex);
+  rcl_ret_t ret = __executor_fill_wait_set(impl);
+  EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  ret = rcl_wait(&impl->wait_set, timeout);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set, unless it timed out.
+  }
+  if (RCL_DISPATCH_ORDER_WAIT_SET != impl->dispatch_order) {
+    ret = rcl_wait_set_sort_ready_entities(&impl->wait_set, impl->dispatch_order);
+    if (RCL_RET_OK != ret) {
+      return ret;  // rcl error state should already be set.
+    }
+  }
+  const rcl_wait_set_ready_entity_t * ready_entities;
+  size_t ready_count;
+  ret = rcl_wait_set_get_ready_entities(&impl->wait_set, &ready_entities, &ready_count);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  size_t queued = 0u;
+  size_t i;
+  EXECUTOR_MUTEX_LOCK(&impl->mutex);
+  for (i = 0; i < ready_count; ++i) {
+    const rcl_wait_set_ready_entity_t * ready = &ready_entities[i];
+    if (RCL_WAIT_SET_GUARD_CONDITION == ready->type && 0u == ready->index) {
+      continue;  // The interrupt guard condition.
+    }
+    const size_t entity_index = impl->slots[impl->slot_offsets[ready->type] + ready->index];
+    // Only this thread uses the wait set, the entity is added again once it was executed.
+    ret = __executor_wait_set_remove(impl, &impl->entities[entity_index]);
+    if (RCL_RET_OK != ret) {
+      // Rebuild the wait set on the next spin.
+      impl->wait_set_dirty = true;
+      break;
+    }
+    impl->entities[entity_index].in_flight = true;
+    // Spread the work over the queues, starting with the one of the waiting thread.
+    rcl_executor_queue_t * queue = &impl->queues[(queue_index + queued) % impl->thread_count];
+    EXECUTOR_MUTEX_LOCK(&queue->mutex);
+    queue->items[(queue->head + queue->count) % impl->capacity] = entity_index;
+    ++queue->count;
+    EXECUTOR_MUTEX_UNLOCK(&queue->mutex);
+    ++queued;
+  }
+  impl->pending += queued;
+  EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+  return ret;  // rcl error state should already be set, unless it is RCL_RET_OK.
+}
+
+// Take the oldest work of the own queue, or else the newest work of another queue.
+static bool
+__executor_take_work(rcl_executor_impl_t * impl, size_t queue_index, size_t * entity_index)
+{
+  size_t i;
+  for (i = 0; i < impl->thread_count; ++i) {
+    rcl_executor_queue_t * queue = &impl->queues[(queue_index + i) % impl->thread_count];
+    bool taken = false;
+    EXECUTOR_MUTEX_LOCK(&queue->mutex);
+    if (queue->count > 0u) {
+      if (0u == i) {
+        *entity_index = queue->items[queue->head];
+        queue->head = (queue->head + 1u) % impl->capacity;
+      } else {
+        *entity_index = queue->items[(queue->head + queue->count - 1u) % impl->capacity];
+      }
+      --queue->count;
+      taken = true;
+    }
+    EXECUTOR_MUTEX_UNLOCK(&queue->mutex);
+    if (taken) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Take the data of an entity and call its callback.
+static rcl_ret_t
+__executor_execute(rcl_executor_entity_t * entity)
+{
+  rcl_ret_t ret = RCL_RET_OK;
+  rmw_message_info_t message_info;
+  rmw_request_id_t request_header;
+  switch (entity->type) {
+    case RCL_WAIT_SET_SUBSCRIPTION:
+      ret = rcl_take(entity->handle.subscription, entity->data, &message_info);
+      if (RCL_RET_OK == ret) {
+        entity->callback.subscription(entity->data, &message_info, entity->user_data);
+      } else if (RCL_RET_SUBSCRIPTION_TAKE_FAILED == ret) {
+        ret = RCL_RET_OK;
+      }
+      break;
+    case RCL_WAIT_SET_GUARD_CONDITION:
+      if (NULL != entity->callback.guard_condition) {
+        entity->callback.guard_condition(entity->user_data);
+      }
+      break;
+    case RCL_WAIT_SET_TIMER:
+      ret = rcl_timer_call(entity->handle.timer);
+      if (RCL_RET_TIMER_CANCELED == ret) {
+        ret = RCL_RET_OK;
+      }
+      break;
+    case RCL_WAIT_SET_CLIENT:
+      ret = rcl_take_response(entity->handle.client, &request_header, entity->data);
+      if (RCL_RET_OK == ret) {
+        entity->callback.client(&request_header, entity->data, entity->user_data);
+      } else if (RCL_RET_CLIENT_TAKE_FAILED == ret) {
+        ret = RCL_RET_OK;
+      }
+      break;
+    case RCL_WAIT_SET_SERVICE:
+      ret = rcl_take_request(entity->handle.service, &request_header, entity->data);
+      if (RCL_RET_OK == ret) {
+        entity->callback.service(
+          &request_header, entity->data, entity->response, entity->user_data);
+        ret = rcl_send_response(entity->handle.service, &request_header, entity->response);
+      } else if (RCL_RET_SERVICE_TAKE_FAILED == ret) {
+        ret = RCL_RET_OK;
+      }
+      break;
+  }
+  return ret;
+}
+
+// Record the first error which made spinning stop, with the mutex held.
+static void
+__executor_fail(rcl_executor_impl_t * impl, rcl_ret_t ret)
+{
+  // The error state is thread local, so it is logged from the thread which failed.
+  RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "executor failed: %s", rcl_get_error_string().str);
+  rcl_reset_error();
+  if (RCL_RET_OK == impl->result) {
+    impl->result = ret;
+  }
+  impl->stop = true;
+}
+
+static void
+__executor_interrupt(rcl_executor_impl_t * impl)
+{
+  if (RCL_RET_OK != rcl_trigger_guard_condition(&impl->interrupt_guard_condition)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      ROS_PACKAGE_NAME, "Failed to interrupt executor wait: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+// Loop of each thread while spinning.
+static void
+__executor_run(rcl_executor_impl_t * impl, size_t queue_index)
+{
+  EXECUTOR_MUTEX_LOCK(&impl->mutex);
+  for (;;) {
+    if (impl->pending > 0u) {
+      // Finish the queued work, even when stopping, so that nothing taken is lost.
+      EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+      size_t entity_index;
+      const bool taken = __executor_take_work(impl, queue_index, &entity_index);
+      rcl_ret_t ret = RCL_RET_OK;
+      if (taken) {
+        EXECUTOR_MUTEX_LOCK(&impl->mutex);
+        --impl->pending;
+        EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+        ret = __executor_execute(&impl->entities[entity_index]);
+      }
+      EXECUTOR_MUTEX_LOCK(&impl->mutex);
+      if (taken) {
+        __executor_return(impl, entity_index);
+        if (RCL_RET_OK != ret) {
+          __executor_fail(impl, ret);
+          EXECUTOR_COND_BROADCAST(&impl->cond);
+        }
+        if (impl->waiting) {
+          // Let the waiting thread wait on the entity again, or see the failure.
+          __executor_interrupt(impl);
+        }
+      }
+      continue;
+    }
+    if (!impl->stop && rcutils_atomic_load_bool(&impl->canceled)) {
+      impl->stop = true;
+    }
+    if (impl->stop && !impl->waiting) {
+      break;
+    }
+    if (!impl->stop && !impl->waiting) {
+      impl->waiting = true;
+      EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+      rcl_ret_t ret = __executor_wait(impl, queue_index, -1);
+      EXECUTOR_MUTEX_LOCK(&impl->mutex);
+      impl->waiting = false;
+      if (RCL_RET_OK != ret && RCL_RET_TIMEOUT != ret) {
+        __executor_fail(impl, ret);
+      } else if (!rcl_context_is_valid(impl->context)) {
+        impl->stop = true;
+      }
+      EXECUTOR_COND_BROADCAST(&impl->cond);
+      continue;
+    }
+    EXECUTOR_COND_WAIT(&impl->cond, &impl->mutex);
+  }
+  EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI
+__executor_thread(LPVOID arg)
+{
+  rcl_executor_worker_t * worker = (rcl_executor_worker_t *)arg;
+  __executor_run(worker->impl, worker->index);
+  return 0;
+}
+#else
+static void *
+__executor_thread(void * arg)
+{
+  rcl_executor_worker_t * worker = (rcl_executor_worker_t *)arg;
+  __executor_run(worker->impl, worker->index);
+  return NULL;
+}
+#endif
+
+static bool
+__executor_thread_start(rcl_executor_worker_t * worker)
+{
+#if defined(_WIN32)
+  worker->thread = CreateThread(NULL, 0, __executor_thread, worker, 0, NULL);
+  return NULL != worker->thread;
+#else
+  return 0 == pthread_create(&worker->thread, NULL, __executor_thread, worker);
+#endif
+}
+
+static void
+__executor_thread_join(rcl_executor_worker_t * worker)
+{
+#if defined(_WIN32)
+  WaitForSingleObject(worker->thread, INFINITE);
+  CloseHandle(worker->thread);
+#else
+  pthread_join(worker->thread, NULL);
+#endif
+}
+
+// Mark the executor as spinning, and get it ready for it.
+static rcl_ret_t
+__executor_start(rcl_executor_t * executor)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(executor, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    executor->impl, "executor is invalid", return RCL_RET_INVALID_ARGUMENT);
+  rcl_executor_impl_t * impl = executor->impl;
+  if (rcutils_atomic_exchange_bool(&impl->spinning, true)) {
+    RCL_SET_ERROR_MSG("executor is already spinning");
+    return RCL_RET_ERROR;
+  }
+  rcl_ret_t ret = __executor_prepare(impl);
+  if (RCL_RET_OK != ret) {
+    rcutils_atomic_store(&impl->spinning, false);
+    return ret;  // rcl error state should already be set.
+  }
+  impl->stop = false;
+  impl->result = RCL_RET_OK;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_executor_spin_some(rcl_executor_t * executor, int64_t timeout)
+{
+  rcl_ret_t ret = __executor_start(executor);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_executor_impl_t * impl = executor->impl;
+  ret = __executor_wait(impl, 0u, timeout);
+  size_t entity_index;
+  while (__executor_take_work(impl, 0u, &entity_index)) {
+    rcl_ret_t execute_ret = __executor_execute(&impl->entities[entity_index]);
+    if (RCL_RET_OK != execute_ret && RCL_RET_OK == ret) {
+      ret = execute_ret;
+    }
+    EXECUTOR_MUTEX_LOCK(&impl->mutex);
+    --impl->pending;
+    __executor_return(impl, entity_index);
+    EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+  }
+  rcutils_atomic_store(&impl->canceled, false);
+  rcutils_atomic_store(&impl->spinning, false);
+  return ret;
+}
+
+rcl_ret_t
+rcl_executor_spin(rcl_executor_t * executor)
+{
+  rcl_ret_t ret = __executor_start(executor);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_executor_impl_t * impl = executor->impl;
+  size_t started;
+  for (started = 1u; started < impl->thread_count; ++started) {
+    if (!__executor_thread_start(&impl->workers[started])) {
+      EXECUTOR_MUTEX_LOCK(&impl->mutex);
+      impl->stop = true;
+      impl->result = RCL_RET_ERROR;
+      EXECUTOR_COND_BROADCAST(&impl->cond);
+      EXECUTOR_MUTEX_UNLOCK(&impl->mutex);
+      break;
+    }
+  }
+  __executor_run(impl, 0u);
+  size_t i;
+  for (i = 1u; i < started; ++i) {
+    __executor_thread_join(&impl->workers[i]);
+  }
+  ret = impl->result;
+  rcutils_atomic_store(&impl->canceled, false);
+  rcutils_atomic_store(&impl->spinning, false);
+  if (RCL_RET_OK != ret) {
+    RCL_SET_ERROR_MSG("executor stopped spinning on an error, see the log for details");
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_executor_cancel(rcl_executor_t * executor)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(executor, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    executor->impl, "executor is invalid", return RCL_RET_INVALID_ARGUMENT);
+  rcl_executor_impl_t * impl = executor->impl;
+  if (!rcutils_atomic_load_bool(&impl->spinning)) {
+    return RCL_RET_OK;
+  }
+  rcutils_atomic_store(&impl->canceled, true);
+  return rcl_trigger_guard_condition(&impl->interrupt_guard_condition);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -75,6 +75,7 @@ rcl_init(
   context->impl = allocator.zero_allocate(1, sizeof(rcl_context_impl_t), allocator.state);
   RCL_CHECK_FOR_NULL_WITH_MSG(
     context->impl, "failed to allocate memory for context impl", return RCL_RET_BAD_ALLOC);
+  rcl_intra_process_registry_init(&(context->impl->intra_process), allocator);
 
   // Copy the options into the context for future reference.
   rcl_ret_t ret = rcl_init_options_copy(options, &(context->impl->init_options));
@@ -0,0 +1,488 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "./intra_process_impl.h"
+
+#include <string.h>
+
+#include "rcl/error_handling.h"
+#include "rcutils/logging_macros.h"
+#include "rmw/rmw.h"
+
+// Return true if the messages of the publisher are queued for the subscription.
+static bool
+__intra_process_match(
+  const rcl_intra_process_publisher_t * publisher,
+  const rcl_intra_process_subscription_t * subscription)
+{
+  return publisher->type_support == subscription->type_support &&
+         0 == strcmp(publisher->topic_name, subscription->topic_name);
+}
+
+// Capacity to grow an array to once it is full.
+static size_t
+__intra_process_next_capacity(size_t capacity)
+{
+  return 0u == capacity ? 4u : 2u * capacity;
+}
+
+// Grow an array protected by the lock, which must not be held, to the given capacity.
+// Memory is only allocated and deallocated without holding the lock.
+static bool
+__intra_process_grow(
+  rcl_intra_process_registry_t * registry,
+  void ** array,
+  size_t element_size,
+  const size_t * count,
+  size_t * capacity,
+  size_t new_capacity,
+  rcl_allocator_t * allocator)
+{
+  void * new_array = allocator->allocate(new_capacity * element_size, allocator->state);
+  if (NULL == new_array) {
+    return false;
+  }
+  void * unused_array = new_array;
+  rcl_spin_lock_acquire(&registry->lock);
+  // Another thread may have grown the array meanwhile.
+  if (new_capacity > *capacity) {
+    if (*count > 0u) {
+      memcpy(new_array, *array, *count * element_size);
+    }
+    unused_array = *array;
+    *array = new_array;
+    *capacity = new_capacity;
+  }
+  rcl_spin_lock_release(&registry->lock);
+  if (NULL != unused_array) {
+    allocator->deallocate(unused_array, allocator->state);
+  }
+  return true;
+}
+
+// Append an entry to an array of pointers of the registry, the lock must not be held.
+static bool
+__intra_process_add(
+  rcl_intra_process_registry_t * registry,
+  void *** array,
+  size_t * count,
+  size_t * capacity,
+  void * entry)
+{
+  size_t new_capacity = 0u;
+  bool added = false;
+  while (!added) {
+    if (0u != new_capacity && !__intra_process_grow(
+        registry, (void **)array, sizeof(void *), count, capacity, new_capacity,
+        &registry->allocator))
+    {
+      return false;
+    }
+    rcl_spin_lock_acquire(&registry->lock);
+    if (*count < *capacity) {
+      (*array)[(*count)++] = entry;
+      added = true;
+    } else {
+      new_capacity = __intra_process_next_capacity(*capacity);
+    }
+    rcl_spin_lock_release(&registry->lock);
+  }
+  return true;
+}
+
+// Remove an entry from an array of pointers, keeping the order, the lock must be held.
+static void
+__intra_process_remove(void ** array, size_t * count, const void * entry)
+{
+  size_t i;
+  for (i = 0; i < *count; ++i) {
+    if (array[i] == entry) {
+      memmove(&array[i], &array[i + 1], (*count - i - 1u) * sizeof(void *));
+      --*count;
+      return;
+    }
+  }
+}
+
+void
+rcl_intra_process_registry_init(
+  rcl_intra_process_registry_t * registry,
+  rcl_allocator_t allocator)
+{
+  registry->publishers = NULL;
+  registry->publisher_count = 0u;
+  registry->publisher_capacity = 0u;
+  registry->subscriptions = NULL;
+  registry->subscription_count = 0u;
+  registry->subscription_capacity = 0u;
+  rcl_spin_lock_init(&registry->lock);
+  registry->allocator = allocator;
+}
+
+void
+rcl_intra_process_registry_fini(rcl_intra_process_registry_t * registry)
+{
+  if (NULL != registry->publishers) {
+    registry->allocator.deallocate(registry->publishers, registry->allocator.state);
+    registry->publishers = NULL;
+  }
+  if (NULL != registry->subscriptions) {
+    registry->allocator.deallocate(registry->subscriptions, registry->allocator.state);
+    registry->subscriptions = NULL;
+  }
+  registry->publisher_count = 0u;
+  registry->publisher_capacity = 0u;
+  registry->subscription_count = 0u;
+  registry->subscription_capacity = 0u;
+}
+
+rcl_intra_process_publisher_t
+rcl_get_zero_initialized_intra_process_publisher()
+{
+  static rcl_intra_process_publisher_t null_publisher = {0};
+  return null_publisher;
+}
+
+rcl_ret_t
+rcl_intra_process_publisher_init(
+  rcl_intra_process_publisher_t * publisher,
+  rcl_intra_process_registry_t * registry,
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support,
+  const rmw_gid_t * gid,
+  rcl_loan_pool_t * pool)
+{
+  publisher->topic_name = topic_name;
+  publisher->type_support = type_support;
+  publisher->gid = *gid;
+  publisher->pool = pool;
+  if (!__intra_process_add(
+      registry, (void ***)&registry->publishers, &registry->publisher_count,
+      &registry->publisher_capacity, publisher))
+  {
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  publisher->registry = registry;
+  return RCL_RET_OK;
+}
+
+void
+rcl_intra_process_publisher_fini(rcl_intra_process_publisher_t * publisher)
+{
+  rcl_intra_process_registry_t * registry = publisher->registry;
+  if (NULL == registry) {
+    return;
+  }
+  rcl_spin_lock_acquire(&registry->lock);
+  __intra_process_remove(
+    (void **)registry->publishers, &registry->publisher_count, publisher);
+  // Drop the messages of the publisher which are still queued, compacting each queue in place.
+  size_t i;
+  for (i = 0; i < registry->subscription_count; ++i) {
+    rcl_intra_process_subscription_t * subscription = registry->subscriptions[i];
+    size_t kept = 0u;
+    size_t j;
+    for (j = 0; j < subscription->size; ++j) {
+      rcl_intra_process_message_t * queued =
+        &subscription->messages[(subscription->head + j) % subscription->capacity];
+      if (queued->pool == publisher->pool) {
+        // The publisher did not finalize its pool yet, so this does not destroy it.
+        (void)rcl_loan_pool_release(queued->pool, queued->message);
+        continue;
+      }
+      subscription->messages[(subscription->head + kept) % subscription->capacity] = *queued;
+      ++kept;
+    }
+    subscription->size = kept;
+  }
+  rcl_spin_lock_release(&registry->lock);
+  publisher->registry = NULL;
+}
+
+rcl_ret_t
+rcl_intra_process_publish(
+  rcl_intra_process_publisher_t * publisher,
+  void * message,
+  size_t * delivered)
+{
+  rcl_intra_process_registry_t * registry = publisher->registry;
+  rcl_ret_t ret = RCL_RET_OK;
+  *delivered = 0u;
+  rcutils_time_point_value_t publish_time = 0;
+  (void)rcutils_steady_time_now(&publish_time);
+  // Subscriptions to trigger once the lock is released, linked through next_trigger.
+  rcl_intra_process_subscription_t * triggers = NULL;
+  rcl_spin_lock_acquire(&registry->lock);
+  size_t i;
+  for (i = 0; i < registry->subscription_count; ++i) {
+    rcl_intra_process_subscription_t * subscription = registry->subscriptions[i];
+    if (!__intra_process_match(publisher, subscription)) {
+      continue;
+    }
+    if (rcl_loan_pool_retain(publisher->pool, message) != RCL_RET_OK) {
+      ret = RCL_RET_ERROR;  // error already set
+      break;
+    }
+    if (subscription->size == subscription->capacity) {
+      // Keep the latest messages, like the middleware with a keep last history.
+      // Its publisher is still registered, so this does not destroy its pool.
+      rcl_intra_process_message_t * oldest = &subscription->messages[subscription->head];
+      (void)rcl_loan_pool_release(oldest->pool, oldest->message);
+      subscription->head = (subscription->head + 1u) % subscription->capacity;
+      --subscription->size;
+    }
+    rcl_intra_process_message_t * queued = &subscription->messages[
+      (subscription->head + subscription->size) % subscription->capacity];
+    queued->message = message;
+    queued->pool = publisher->pool;
+    queued->message_info.publisher_gid = publisher->gid;
+    queued->message_info.from_intra_process = true;
+    queued->publish_time = publish_time;
+    ++subscription->size;
+    ++*delivered;
+    // A publisher which is about to trigger the guard condition triggers it again instead.
+    if (subscription->trigger_pending) {
+      subscription->trigger_again = true;
+    } else {
+      subscription->trigger_pending = true;
+      subscription->next_trigger = triggers;
+      triggers = subscription;
+    }
+  }
+  rcl_spin_lock_release(&registry->lock);
+  while (NULL != triggers) {
+    rcl_intra_process_subscription_t * subscription = triggers;
+    if (rcl_trigger_guard_condition(&subscription->guard_condition) != RCL_RET_OK) {
+      ret = RCL_RET_ERROR;  // error already set
+    }
+    rcl_spin_lock_acquire(&registry->lock);
+    if (subscription->trigger_again) {
+      subscription->trigger_again = false;
+    } else {
+      triggers = subscription->next_trigger;
+      // The subscription may be finalized as soon as this is cleared.
+      subscription->trigger_pending = false;
+    }
+    rcl_spin_lock_release(&registry->lock);
+  }
+  return ret;
+}
+
+rcl_intra_process_subscription_t
+rcl_get_zero_initialized_intra_process_subscription()
+{
+  static rcl_intra_process_subscription_t null_subscription = {0};
+  return null_subscription;
+}
+
+rcl_ret_t
+rcl_intra_process_subscription_init(
+  rcl_intra_process_subscription_t * subscription,
+  rcl_intra_process_registry_t * registry,
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support,
+  size_t depth,
+  rcl_context_t * context,
+  rcl_allocator_t allocator)
+{
+  subscription->topic_name = topic_name;
+  subscription->type_support = type_support;
+  subscription->capacity = 0u == depth ? 1u : depth;
+  subscription->head = 0u;
+  subscription->size = 0u;
+  subscription->taken = NULL;
+  subscription->taken_count = 0u;
+  subscription->taken_capacity = 0u;
+  subscription->trigger_pending = false;
+  subscription->trigger_again = false;
+  subscription->next_trigger = NULL;
+  subscription->allocator = allocator;
+  subscription->messages = allocator.allocate(
+    subscription->capacity * sizeof(rcl_intra_process_message_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->messages, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  rcl_guard_condition_options_t guard_condition_options =
+    rcl_guard_condition_get_default_options();
+  guard_condition_options.allocator = allocator;
+  rcl_ret_t ret = rcl_guard_condition_init(
+    &subscription->guard_condition, context, guard_condition_options);
+  if (RCL_RET_OK != ret) {
+    allocator.deallocate(subscription->messages, allocator.state);
+    subscription->messages = NULL;
+    return ret;  // error already set
+  }
+  if (!__intra_process_add(
+      registry, (void ***)&registry->subscriptions, &registry->subscription_count,
+      &registry->subscription_capacity, subscription))
+  {
+    if (RCL_RET_OK != rcl_guard_condition_fini(&subscription->guard_condition)) {
+      RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to fini guard condition after failed init");
+    }
+    allocator.deallocate(subscription->messages, allocator.state);
+    subscription->messages = NULL;
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  subscription->registry = registry;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_intra_process_subscription_fini(rcl_intra_process_subscription_t * subscription)
+{
+  rcl_intra_process_registry_t * registry = subscription->registry;
+  if (NULL == registry) {
+    return RCL_RET_OK;
+  }
+  rcl_spin_lock_acquire(&registry->lock);
+  __intra_process_remove(
+    (void **)registry->subscriptions, &registry->subscription_count, subscription);
+  rcl_spin_lock_release(&registry->lock);
+  // Wait for a publisher which is about to trigger the guard condition.
+  bool trigger_pending = true;
+  while (trigger_pending) {
+    rcl_spin_lock_acquire(&registry->lock);
+    trigger_pending = subscription->trigger_pending;
+    rcl_spin_lock_release(&registry->lock);
+    if (trigger_pending) {
+      rcl_spin_lock_yield();
+    }
+  }
+  // Publishers do not see the subscription anymore, so the messages are released without the
+  // lock, which may destroy the pools of finalized publishers.
+  for (; subscription->size > 0u; --subscription->size) {
+    rcl_intra_process_message_t * queued = &subscription->messages[subscription->head];
+    (void)rcl_loan_pool_release(queued->pool, queued->message);
+    subscription->head = (subscription->head + 1u) % subscription->capacity;
+  }
+  size_t i;
+  for (i = 0; i < subscription->taken_count; ++i) {
+    (void)rcl_loan_pool_release(subscription->taken[i].pool, subscription->taken[i].message);
+  }
+  subscription->registry = NULL;
+  rcl_ret_t ret = rcl_guard_condition_fini(&subscription->guard_condition);
+  subscription->allocator.deallocate(subscription->messages, subscription->allocator.state);
+  subscription->messages = NULL;
+  if (NULL != subscription->taken) {
+    subscription->allocator.deallocate(subscription->taken, subscription->allocator.state);
+    subscription->taken = NULL;
+  }
+  subscription->taken_count = 0u;
+  subscription->taken_capacity = 0u;
+  return ret;
+}
+
+rcl_ret_t
+rcl_intra_process_take(
+  rcl_intra_process_subscription_t * subscription,
+  void ** message,
+  rmw_message_info_t * message_info,
+  rcutils_time_point_value_t * publish_time)
+{
+  rcl_intra_process_registry_t * registry = subscription->registry;
+  size_t new_capacity = 0u;
+  bool taken = false;
+  bool done = false;
+  while (!done) {
+    // The taken message is remembered, so the list of taken messages needs room for it first.
+    if (0u != new_capacity && !__intra_process_grow(
+        registry, (void **)&subscription->taken, sizeof(rcl_intra_process_loan_t),
+        &subscription->taken_count, &subscription->taken_capacity, new_capacity,
+        &subscription->allocator))
+    {
+      RCL_SET_ERROR_MSG("allocating memory failed");
+      return RCL_RET_BAD_ALLOC;
+    }
+    rcl_spin_lock_acquire(&registry->lock);
+    if (0u == subscription->size) {
+      done = true;
+    } else if (subscription->taken_count == subscription->taken_capacity) {
+      new_capacity = __intra_process_next_capacity(subscription->taken_capacity);
+    } else {
+      rcl_intra_process_message_t * queued = &subscription->messages[subscription->head];
+      *message = queued->message;
+      if (NULL != message_info) {
+        *message_info = queued->message_info;
+      }
+      if (NULL != publish_time) {
+        *publish_time = queued->publish_time;
+      }
+      rcl_intra_process_loan_t * loan = &subscription->taken[subscription->taken_count++];
+      loan->message = queued->message;
+      loan->pool = queued->pool;
+      subscription->head = (subscription->head + 1u) % subscription->capacity;
+      --subscription->size;
+      taken = true;
+      done = true;
+    }
+    rcl_spin_lock_release(&registry->lock);
+  }
+  return taken ? RCL_RET_OK : RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+}
+
+rcl_ret_t
+rcl_intra_process_return(
+  rcl_intra_process_subscription_t * subscription,
+  const void * message)
+{
+  rcl_intra_process_registry_t * registry = subscription->registry;
+  rcl_loan_pool_t * pool = NULL;
+  rcl_spin_lock_acquire(&registry->lock);
+  size_t i;
+  for (i = subscription->taken_count; i > 0u && NULL == pool; --i) {
+    if (subscription->taken[i - 1u].message == message) {
+      pool = subscription->taken[i - 1u].pool;
+      subscription->taken[i - 1u] = subscription->taken[--subscription->taken_count];
+    }
+  }
+  rcl_spin_lock_release(&registry->lock);
+  if (NULL == pool) {
+    RCL_SET_ERROR_MSG("message is not on loan");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  // Released without the lock, as this may destroy the pool of a finalized publisher.
+  return rcl_loan_pool_release(pool, message);
+}
+
+bool
+rcl_intra_process_is_local_publisher(
+  rcl_intra_process_subscription_t * subscription,
+  const rmw_gid_t * gid)
+{
+  rcl_intra_process_registry_t * registry = subscription->registry;
+  bool local = false;
+  rcl_spin_lock_acquire(&registry->lock);
+  size_t i;
+  for (i = 0; i < registry->publisher_count && !local; ++i) {
+    rcl_intra_process_publisher_t * publisher = registry->publishers[i];
+    bool equal = false;
+    if (__intra_process_match(publisher, subscription) &&
+      rmw_compare_gids_equal(&publisher->gid, gid, &equal) == RMW_RET_OK)
+    {
+      local = equal;
+    }
+  }
+  rcl_spin_lock_release(&registry->lock);
+  return local;
+}
+
+#ifdef __cplusplus
+}
+#endif
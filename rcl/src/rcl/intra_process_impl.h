@@ -0,0 +1,287 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__INTRA_PROCESS_IMPL_H_
+#define RCL__INTRA_PROCESS_IMPL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/context.h"
+#include "rcl/guard_condition.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+#include "rcutils/time.h"
+#include "rmw/types.h"
+#include "rosidl_generator_c/message_type_support_struct.h"
+
+#include "./loan_pool_impl.h"
+#include "./spin_lock_impl.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+struct rcl_intra_process_registry_t;
+
+/// \internal
+/// A message queued for an intra process subscription.
+typedef struct rcl_intra_process_message_t
+{
+  void * message;
+  /// Loan pool of the publisher, in which the queue holds a reference to the message.
+  rcl_loan_pool_t * pool;
+  rmw_message_info_t message_info;
+  /// Steady time at which the message was published.
+  rcutils_time_point_value_t publish_time;
+} rcl_intra_process_message_t;
+
+/// \internal
+/// A message taken by an intra process subscription, which holds a reference to it.
+typedef struct rcl_intra_process_loan_t
+{
+  void * message;
+  /// Loan pool of the publisher, which stays alive until the reference is released.
+  rcl_loan_pool_t * pool;
+} rcl_intra_process_loan_t;
+
+/// \internal
+/// Intra process side of a publisher.
+typedef struct rcl_intra_process_publisher_t
+{
+  /// Registry the publisher is registered with, `NULL` if it is not.
+  struct rcl_intra_process_registry_t * registry;
+  const char * topic_name;
+  const rosidl_message_type_support_t * type_support;
+  rmw_gid_t gid;
+  /// Loan pool of the publisher, which the published messages come from.
+  rcl_loan_pool_t * pool;
+} rcl_intra_process_publisher_t;
+
+/// \internal
+/// Intra process side of a subscription, a ring buffer of the queued messages.
+typedef struct rcl_intra_process_subscription_t
+{
+  /// Registry the subscription is registered with, `NULL` if it is not.
+  struct rcl_intra_process_registry_t * registry;
+  const char * topic_name;
+  const rosidl_message_type_support_t * type_support;
+  rcl_intra_process_message_t * messages;
+  size_t capacity;
+  /// Index of the oldest message.
+  size_t head;
+  size_t size;
+  /// Messages taken and not returned yet, in no particular order.
+  rcl_intra_process_loan_t * taken;
+  size_t taken_count;
+  size_t taken_capacity;
+  /// Triggered whenever a message is queued.
+  rcl_guard_condition_t guard_condition;
+  /// True while a publisher is about to trigger the guard condition, without the lock held.
+  bool trigger_pending;
+  /// True if messages were queued since that publisher picked the subscription to trigger.
+  bool trigger_again;
+  /// Next subscription the same publisher is about to trigger.
+  struct rcl_intra_process_subscription_t * next_trigger;
+  rcl_allocator_t allocator;
+} rcl_intra_process_subscription_t;
+
+/// \internal
+/// The intra process publishers and subscriptions of a context.
+/**
+ * The registry and the queues of its subscriptions are protected by a single
+ * spin lock, which is only held to look entries up and move pointers.
+ * Arrays are grown and guard conditions are triggered without holding it.
+ */
+typedef struct rcl_intra_process_registry_t
+{
+  rcl_intra_process_publisher_t ** publishers;
+  size_t publisher_count;
+  size_t publisher_capacity;
+  rcl_intra_process_subscription_t ** subscriptions;
+  size_t subscription_count;
+  size_t subscription_capacity;
+  rcl_spin_lock_t lock;
+  rcl_allocator_t allocator;
+} rcl_intra_process_registry_t;
+
+/// \internal
+/// Initialize an empty registry, which cannot fail.
+RCL_LOCAL
+void
+rcl_intra_process_registry_init(
+  rcl_intra_process_registry_t * registry,
+  rcl_allocator_t allocator);
+
+/// \internal
+/// Deallocate a registry, every publisher and subscription must be finalized already.
+RCL_LOCAL
+void
+rcl_intra_process_registry_fini(rcl_intra_process_registry_t * registry);
+
+/// \internal
+/// Return a rcl_intra_process_publisher_t struct which is not registered.
+RCL_LOCAL
+rcl_intra_process_publisher_t
+rcl_get_zero_initialized_intra_process_publisher(void);
+
+/// \internal
+/// Register a publisher, whose messages are loaned from the given pool.
+/**
+ * \param[inout] publisher a zero initialized intra process publisher
+ * \param[in] registry the registry of the context of the publisher
+ * \param[in] topic_name fully qualified topic name, which must outlive the publisher
+ * \param[in] type_support type support of the published messages
+ * \param[in] gid the gid of the rmw publisher
+ * \param[in] pool the loan pool of the publisher, with loaning enabled
+ * \return `RCL_RET_OK` if the publisher was registered, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_intra_process_publisher_init(
+  rcl_intra_process_publisher_t * publisher,
+  rcl_intra_process_registry_t * registry,
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support,
+  const rmw_gid_t * gid,
+  rcl_loan_pool_t * pool);
+
+/// \internal
+/// Unregister a publisher, dropping its messages still queued for subscriptions.
+/**
+ * Messages already taken by subscriptions keep their references, which keep
+ * the publisher's pool alive once it is finalized, until they are returned.
+ * The messages queued for registered subscriptions are thus always from the
+ * pools of registered publishers, so that dropping them never destroys a pool
+ * with the registry lock held.
+ */
+RCL_LOCAL
+void
+rcl_intra_process_publisher_fini(rcl_intra_process_publisher_t * publisher);
+
+/// \internal
+/// Queue a loaned message for every matching subscription and trigger their guard conditions.
+/**
+ * Each queue takes its own reference to the message, a full queue drops its
+ * oldest message first.
+ * The guard conditions are triggered once the message is queued for every
+ * subscription, and a subscription waits for that when it is finalized.
+ *
+ * \param[in] publisher a registered publisher
+ * \param[in] message a message on loan from the publisher's pool
+ * \param[out] delivered the number of subscriptions the message was queued for
+ * \return `RCL_RET_OK` if the message was queued, or
+ * \return `RCL_RET_ERROR` if triggering a guard condition failed.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_intra_process_publish(
+  rcl_intra_process_publisher_t * publisher,
+  void * message,
+  size_t * delivered);
+
+/// \internal
+/// Return a rcl_intra_process_subscription_t struct which is not registered.
+RCL_LOCAL
+rcl_intra_process_subscription_t
+rcl_get_zero_initialized_intra_process_subscription(void);
+
+/// \internal
+/// Allocate the queue and guard condition of a subscription, and register it.
+/**
+ * \param[inout] subscription a zero initialized intra process subscription
+ * \param[in] registry the registry of the context of the subscription
+ * \param[in] topic_name fully qualified topic name, which must outlive the subscription
+ * \param[in] type_support type support of the received messages
+ * \param[in] depth number of messages queued before the oldest is dropped, at least 1
+ * \param[in] context the context of the guard condition
+ * \param[in] allocator allocator for the queue and the list of taken messages
+ * \return `RCL_RET_OK` if the subscription was registered, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_intra_process_subscription_init(
+  rcl_intra_process_subscription_t * subscription,
+  rcl_intra_process_registry_t * registry,
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support,
+  size_t depth,
+  rcl_context_t * context,
+  rcl_allocator_t allocator);
+
+/// \internal
+/// Unregister a subscription, releasing its queued and taken messages and its guard condition.
+/**
+ * Taken messages must not be used anymore, as their publishers may reuse or
+ * destroy them.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_intra_process_subscription_fini(rcl_intra_process_subscription_t * subscription);
+
+/// \internal
+/// Take the oldest queued message, whose reference the subscription keeps until it is returned.
+/**
+ * \param[inout] subscription a registered subscription
+ * \param[out] message the message taken
+ * \param[out] message_info the message info of the message, may be `NULL`
+ * \param[out] publish_time the steady time at which it was published, may be `NULL`
+ * \return `RCL_RET_OK` if a message was taken, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_SUBSCRIPTION_TAKE_FAILED` if the queue is empty.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_intra_process_take(
+  rcl_intra_process_subscription_t * subscription,
+  void ** message,
+  rmw_message_info_t * message_info,
+  rcutils_time_point_value_t * publish_time);
+
+/// \internal
+/// Release a message taken with rcl_intra_process_take().
+/**
+ * This works after the publisher of the message was finalized, and may then
+ * destroy its pool.
+ *
+ * \return `RCL_RET_OK` if the message was released, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the subscription did not take the message.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_intra_process_return(
+  rcl_intra_process_subscription_t * subscription,
+  const void * message);
+
+/// \internal
+/// Return true if a matching publisher with this gid queues its messages for the subscription.
+/**
+ * Messages of such publishers also received from the middleware are duplicates.
+ */
+RCL_LOCAL
+bool
+rcl_intra_process_is_local_publisher(
+  rcl_intra_process_subscription_t * subscription,
+  const rmw_gid_t * gid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__INTRA_PROCESS_IMPL_H_
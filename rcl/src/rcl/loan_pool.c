@@ -0,0 +1,244 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "./loan_pool_impl.h"
+
+#include "rcl/error_handling.h"
+
+rcl_ret_t
+rcl_loan_pool_init(
+  rcl_loan_pool_t ** pool,
+  const rcl_loan_options_t * options,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(pool, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  *pool = NULL;
+  if (NULL == options->create_message) {
+    return RCL_RET_OK;
+  }
+  if (NULL == options->destroy_message || 0u == options->capacity) {
+    RCL_SET_ERROR_MSG("loan options need destroy_message and a non-zero capacity");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_loan_pool_t * new_pool = allocator.allocate(sizeof(rcl_loan_pool_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(new_pool, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  new_pool->entries = allocator.zero_allocate(
+    options->capacity, sizeof(rcl_loan_pool_entry_t), allocator.state);
+  if (NULL == new_pool->entries) {
+    allocator.deallocate(new_pool, allocator.state);
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  new_pool->options = *options;
+  new_pool->ref_count = 0u;
+  new_pool->finalized = false;
+  rcl_spin_lock_init(&new_pool->lock);
+  new_pool->allocator = allocator;
+  *pool = new_pool;
+  return RCL_RET_OK;
+}
+
+// Destroy every message of the pool and deallocate it, once nothing refers to it anymore.
+static void
+__loan_pool_destroy(rcl_loan_pool_t * pool)
+{
+  rcl_allocator_t allocator = pool->allocator;
+  size_t i;
+  for (i = 0; i < pool->options.capacity; ++i) {
+    if (NULL != pool->entries[i].message) {
+      pool->options.destroy_message(pool->entries[i].message, pool->options.state);
+    }
+  }
+  allocator.deallocate(pool->entries, allocator.state);
+  allocator.deallocate(pool, allocator.state);
+}
+
+void
+rcl_loan_pool_fini(rcl_loan_pool_t * pool)
+{
+  if (NULL == pool) {
+    return;
+  }
+  size_t i;
+  rcl_spin_lock_acquire(&pool->lock);
+  for (i = 0; i < pool->options.capacity; ++i) {
+    pool->entries[i].on_loan = false;
+  }
+  pool->finalized = true;
+  const bool referenced = pool->ref_count > 0u;
+  rcl_spin_lock_release(&pool->lock);
+  if (!referenced) {
+    __loan_pool_destroy(pool);
+  }
+}
+
+bool
+rcl_loan_pool_is_enabled(const rcl_loan_pool_t * pool)
+{
+  return NULL != pool;
+}
+
+rcl_ret_t
+rcl_loan_pool_borrow(rcl_loan_pool_t * pool, void ** message)
+{
+  if (!rcl_loan_pool_is_enabled(pool)) {
+    RCL_SET_ERROR_MSG("loaning messages is not enabled");
+    return RCL_RET_UNSUPPORTED;
+  }
+  // Prefer a message which was already created, so messages are only created when needed.
+  rcl_loan_pool_entry_t * entry = NULL;
+  size_t i;
+  rcl_spin_lock_acquire(&pool->lock);
+  for (i = 0; i < pool->options.capacity; ++i) {
+    rcl_loan_pool_entry_t * candidate = &pool->entries[i];
+    if (!candidate->on_loan && 0u == candidate->ref_count &&
+      (NULL == entry || NULL != candidate->message))
+    {
+      entry = candidate;
+      if (NULL != entry->message) {
+        break;
+      }
+    }
+  }
+  if (NULL != entry) {
+    entry->on_loan = true;
+  }
+  rcl_spin_lock_release(&pool->lock);
+  if (NULL == entry) {
+    RCL_SET_ERROR_MSG("every message of the pool is in use");
+    return RCL_RET_BAD_ALLOC;
+  }
+  if (NULL == entry->message) {
+    // The entry is reserved, so the message is created without holding the lock.
+    void * created = pool->options.create_message(pool->options.state);
+    rcl_spin_lock_acquire(&pool->lock);
+    if (NULL == created) {
+      entry->on_loan = false;
+    } else {
+      entry->message = created;
+    }
+    rcl_spin_lock_release(&pool->lock);
+    if (NULL == created) {
+      RCL_SET_ERROR_MSG("creating a message to loan failed");
+      return RCL_RET_BAD_ALLOC;
+    }
+    *message = created;
+    return RCL_RET_OK;
+  }
+  *message = entry->message;
+  return RCL_RET_OK;
+}
+
+// Find the entry of a message, the lock must be held.
+static rcl_loan_pool_entry_t *
+__loan_pool_find(rcl_loan_pool_t * pool, const void * message)
+{
+  size_t i;
+  for (i = 0; i < pool->options.capacity; ++i) {
+    if (pool->entries[i].message == message) {
+      return &pool->entries[i];
+    }
+  }
+  return NULL;
+}
+
+rcl_ret_t
+rcl_loan_pool_return(rcl_loan_pool_t * pool, const void * message)
+{
+  bool returned = false;
+  if (rcl_loan_pool_is_enabled(pool) && NULL != message) {
+    rcl_spin_lock_acquire(&pool->lock);
+    rcl_loan_pool_entry_t * entry = __loan_pool_find(pool, message);
+    if (NULL != entry && entry->on_loan) {
+      entry->on_loan = false;
+      returned = true;
+    }
+    rcl_spin_lock_release(&pool->lock);
+  }
+  if (!returned) {
+    RCL_SET_ERROR_MSG("message is not on loan");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  return RCL_RET_OK;
+}
+
+bool
+rcl_loan_pool_is_on_loan(rcl_loan_pool_t * pool, const void * message)
+{
+  if (!rcl_loan_pool_is_enabled(pool) || NULL == message) {
+    return false;
+  }
+  rcl_spin_lock_acquire(&pool->lock);
+  rcl_loan_pool_entry_t * entry = __loan_pool_find(pool, message);
+  bool on_loan = NULL != entry && entry->on_loan;
+  rcl_spin_lock_release(&pool->lock);
+  return on_loan;
+}
+
+rcl_ret_t
+rcl_loan_pool_retain(rcl_loan_pool_t * pool, const void * message)
+{
+  bool retained = false;
+  if (rcl_loan_pool_is_enabled(pool) && NULL != message) {
+    rcl_spin_lock_acquire(&pool->lock);
+    rcl_loan_pool_entry_t * entry = __loan_pool_find(pool, message);
+    if (NULL != entry && (entry->on_loan || entry->ref_count > 0u)) {
+      ++entry->ref_count;
+      ++pool->ref_count;
+      retained = true;
+    }
+    rcl_spin_lock_release(&pool->lock);
+  }
+  if (!retained) {
+    RCL_SET_ERROR_MSG("message is not on loan");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_loan_pool_release(rcl_loan_pool_t * pool, const void * message)
+{
+  bool released = false;
+  bool destroy = false;
+  if (rcl_loan_pool_is_enabled(pool) && NULL != message) {
+    rcl_spin_lock_acquire(&pool->lock);
+    rcl_loan_pool_entry_t * entry = __loan_pool_find(pool, message);
+    if (NULL != entry && entry->ref_count > 0u) {
+      --entry->ref_count;
+      --pool->ref_count;
+      released = true;
+      destroy = pool->finalized && 0u == pool->ref_count;
+    }
+    rcl_spin_lock_release(&pool->lock);
+  }
+  if (!released) {
+    RCL_SET_ERROR_MSG("message is not referenced");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (destroy) {
+    __loan_pool_destroy(pool);
+  }
+  return RCL_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
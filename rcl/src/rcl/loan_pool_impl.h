@@ -0,0 +1,157 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__LOAN_POOL_IMPL_H_
+#define RCL__LOAN_POOL_IMPL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/loaned_message.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+#include "./spin_lock_impl.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// A message of a loan pool and the references to it.
+typedef struct rcl_loan_pool_entry_t
+{
+  /// The message, `NULL` until it is first loaned.
+  void * message;
+  /// True while the message is on loan to the owner of the pool.
+  bool on_loan;
+  /// Number of references held by others, it is free when `0` and not on loan.
+  size_t ref_count;
+} rcl_loan_pool_entry_t;
+
+/// \internal
+/// Messages loaned out by a publisher or a subscription, the owner of the pool.
+/**
+ * Messages are created on first use and reused once they are neither on loan
+ * to the owner nor referenced by others anymore.
+ * Others, like intra process subscriptions, hold references to the messages
+ * with rcl_loan_pool_retain(), and these keep the whole pool alive when the
+ * owner finalizes it, until the last of them is released.
+ * All functions but init and fini may be called concurrently.
+ */
+typedef struct rcl_loan_pool_t
+{
+  rcl_loan_options_t options;
+  /// `options.capacity` entries.
+  rcl_loan_pool_entry_t * entries;
+  /// Number of references held by others, over all entries.
+  size_t ref_count;
+  /// True once the owner finalized the pool, which is destroyed with the last reference.
+  bool finalized;
+  /// Spin lock protecting the entries, only held to look an entry up.
+  rcl_spin_lock_t lock;
+  rcl_allocator_t allocator;
+} rcl_loan_pool_t;
+
+/// \internal
+/// Allocate a loan pool, or leave loaning disabled.
+/**
+ * \param[out] pool set to the allocated pool, or `NULL` if loaning is disabled
+ * \param[in] options the loan options, loaning stays disabled without create_message
+ * \param[in] allocator allocator for the pool
+ * \return `RCL_RET_OK` if the pool was initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the options are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_loan_pool_init(
+  rcl_loan_pool_t ** pool,
+  const rcl_loan_options_t * options,
+  rcl_allocator_t allocator);
+
+/// \internal
+/// End the loans of the owner, and destroy the pool once no references are held by others.
+/**
+ * Messages on loan to the owner are destroyed with the pool, messages
+ * referenced by others stay valid until their last reference is released.
+ * Calling it with `NULL` does nothing.
+ */
+RCL_LOCAL
+void
+rcl_loan_pool_fini(rcl_loan_pool_t * pool);
+
+/// \internal
+/// Return true if the pool loans messages, that is if it is not `NULL`.
+RCL_LOCAL
+bool
+rcl_loan_pool_is_enabled(const rcl_loan_pool_t * pool);
+
+/// \internal
+/// Loan a free message of the pool to its owner.
+/**
+ * \return `RCL_RET_OK` if a message was loaned, or
+ * \return `RCL_RET_UNSUPPORTED` if loaning is disabled, or
+ * \return `RCL_RET_BAD_ALLOC` if every message is in use or creating one failed.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_loan_pool_borrow(rcl_loan_pool_t * pool, void ** message);
+
+/// \internal
+/// End the loan of a message to the owner.
+/**
+ * \return `RCL_RET_OK` if the loan ended, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the message is not on loan from the pool.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_loan_pool_return(rcl_loan_pool_t * pool, const void * message);
+
+/// \internal
+/// Return true if the message is on loan to the owner of the pool.
+RCL_LOCAL
+bool
+rcl_loan_pool_is_on_loan(rcl_loan_pool_t * pool, const void * message);
+
+/// \internal
+/// Add a reference to a message which is on loan or referenced already.
+/**
+ * \return `RCL_RET_OK` if the reference was added, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the message is not in use.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_loan_pool_retain(rcl_loan_pool_t * pool, const void * message);
+
+/// \internal
+/// Release a reference added with rcl_loan_pool_retain().
+/**
+ * The message is free again once it is neither on loan nor referenced, and
+ * the pool is destroyed with the last reference if its owner finalized it.
+ *
+ * \return `RCL_RET_OK` if the reference was released, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the message is not referenced.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_loan_pool_release(rcl_loan_pool_t * pool, const void * message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__LOAN_POOL_IMPL_H_
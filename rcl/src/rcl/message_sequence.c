@@ -0,0 +1,109 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/message_sequence.h"
+
+#include "rcl/error_handling.h"
+
+rcl_message_sequence_t
+rcl_get_zero_initialized_message_sequence()
+{
+  static rcl_message_sequence_t null_sequence = {0};
+  return null_sequence;
+}
+
+rcl_ret_t
+rcl_message_sequence_init(
+  rcl_message_sequence_t * sequence,
+  size_t capacity,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(sequence, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  if (NULL != sequence->data) {
+    RCL_SET_ERROR_MSG("message sequence already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  if (capacity > 0u) {
+    sequence->data = allocator.zero_allocate(capacity, sizeof(void *), allocator.state);
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      sequence->data, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  }
+  sequence->size = 0u;
+  sequence->capacity = capacity;
+  sequence->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_message_sequence_fini(rcl_message_sequence_t * sequence)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(sequence, RCL_RET_INVALID_ARGUMENT);
+  if (NULL != sequence->data) {
+    sequence->allocator.deallocate(sequence->data, sequence->allocator.state);
+  }
+  *sequence = rcl_get_zero_initialized_message_sequence();
+  return RCL_RET_OK;
+}
+
+rcl_message_info_sequence_t
+rcl_get_zero_initialized_message_info_sequence()
+{
+  static rcl_message_info_sequence_t null_sequence = {0};
+  return null_sequence;
+}
+
+rcl_ret_t
+rcl_message_info_sequence_init(
+  rcl_message_info_sequence_t * sequence,
+  size_t capacity,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(sequence, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  if (NULL != sequence->data) {
+    RCL_SET_ERROR_MSG("message info sequence already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  if (capacity > 0u) {
+    sequence->data = allocator.zero_allocate(
+      capacity, sizeof(rmw_message_info_t), allocator.state);
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      sequence->data, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  }
+  sequence->size = 0u;
+  sequence->capacity = capacity;
+  sequence->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_message_info_sequence_fini(rcl_message_info_sequence_t * sequence)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(sequence, RCL_RET_INVALID_ARGUMENT);
+  if (NULL != sequence->data) {
+    sequence->allocator.deallocate(sequence->data, sequence->allocator.state);
+  }
+  *sequence = rcl_get_zero_initialized_message_info_sequence();
+  return RCL_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
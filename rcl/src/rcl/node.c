@@ -45,6 +45,7 @@ extern "C"
 
 #include "./common.h"
 #include "./context_impl.h"
+#include "./resolved_name_cache_impl.h"
 
 #define ROS_SECURITY_NODE_DIRECTORY_VAR_NAME "ROS_SECURITY_NODE_DIRECTORY"
 #define ROS_SECURITY_ROOT_DIRECTORY_VAR_NAME "ROS_SECURITY_ROOT_DIRECTORY"
@@ -58,6 +59,8 @@ typedef struct rcl_node_impl_t
   rmw_node_t * rmw_node_handle;
   rcl_guard_condition_t * graph_guard_condition;
   const char * logger_name;
+  // Resolved names of the publishers, subscriptions, services and clients.
+  rcl_resolved_name_cache_t resolved_name_cache;
 } rcl_node_impl_t;
 
 
@@ -284,12 +287,14 @@ rcl_node_init(
   node->impl->graph_guard_condition = NULL;
   node->impl->logger_name = NULL;
   node->impl->options = rcl_node_get_default_options();
+  node->impl->resolved_name_cache = rcl_get_zero_initialized_resolved_name_cache();
   node->context = context;
   // Initialize node impl.
   ret = rcl_node_options_copy(options, &(node->impl->options));
   if (RCL_RET_OK != ret) {
     goto fail;
   }
+  rcl_resolved_name_cache_init(&node->impl->resolved_name_cache, *allocator);
 
   // Remap the node name and namespace if remap rules are given
   rcl_arguments_t * global_args = NULL;
@@ -448,6 +453,7 @@ fail:
       }
       allocator->deallocate(node->impl->graph_guard_condition, allocator->state);
     }
+    rcl_resolved_name_cache_fini(&node->impl->resolved_name_cache);
     if (NULL != node->impl->options.arguments.impl) {
       ret = rcl_arguments_fini(&(node->impl->options.arguments));
       if (ret != RCL_RET_OK) {
@@ -498,6 +504,7 @@ rcl_node_fini(rcl_node_t * node)
   allocator.deallocate(node->impl->graph_guard_condition, allocator.state);
   // assuming that allocate and deallocate are ok since they are checked in init
   allocator.deallocate((char *)node->impl->logger_name, allocator.state);
+  rcl_resolved_name_cache_fini(&node->impl->resolved_name_cache);
   if (NULL != node->impl->options.arguments.impl) {
     rcl_ret_t ret = rcl_arguments_fini(&(node->impl->options.arguments));
     if (ret != RCL_RET_OK) {
@@ -644,6 +651,12 @@ rcl_node_get_logger_name(const rcl_node_t * node)
   return node->impl->logger_name;
 }
 
+rcl_resolved_name_cache_t *
+rcl_node_get_resolved_name_cache(const rcl_node_t * node)
+{
+  return &node->impl->resolved_name_cache;
+}
+
 #ifdef __cplusplus
 }
 #endif
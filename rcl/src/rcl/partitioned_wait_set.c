@@ -0,0 +1,667 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/partitioned_wait_set.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "rcl/error_handling.h"
+#include "rcutils/logging_macros.h"
+#include "rcutils/time.h"
+
+#include "./spin_lock_impl.h"
+
+typedef struct rcl_partitioned_wait_set_entity_t
+{
+  rcl_wait_set_entity_type_t type;
+  const void * handle;
+} rcl_partitioned_wait_set_entity_t;
+
+typedef struct rcl_partitioned_wait_set_shard_t
+{
+  // Persistent wait set, only used by the thread waiting on the shard.
+  rcl_wait_set_t wait_set;
+  // Wakes up the thread waiting on the shard when its entities change.
+  rcl_guard_condition_t guard_condition;
+  // Entities of the shard, written with both locks held, read with either.
+  rcl_partitioned_wait_set_entity_t * entities;
+  size_t entity_count;
+  size_t capacity;
+  // Copy of the entities the wait set is updated to, only used by the thread waiting on the shard.
+  rcl_partitioned_wait_set_entity_t * snapshot;
+  size_t snapshot_count;
+  size_t snapshot_capacity;
+  // True if the entities changed since they were last copied.
+  bool dirty;
+  rcl_spin_lock_t lock;
+} rcl_partitioned_wait_set_shard_t;
+
+typedef struct rcl_partitioned_wait_set_impl_t
+{
+  rcl_partitioned_wait_set_shard_t * shards;
+  size_t shard_count;
+  // Serializes the changes of the entities, taken before the lock of any shard.
+  rcl_spin_lock_t lock;
+  rcl_allocator_t allocator;
+} rcl_partitioned_wait_set_impl_t;
+
+rcl_partitioned_wait_set_t
+rcl_get_zero_initialized_partitioned_wait_set()
+{
+  static rcl_partitioned_wait_set_t null_partitioned_wait_set = {0};
+  return null_partitioned_wait_set;
+}
+
+// Finalize the first count shards.
+static rcl_ret_t
+__partitioned_shards_fini(rcl_partitioned_wait_set_impl_t * impl, size_t count)
+{
+  rcl_ret_t result = RCL_RET_OK;
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    rcl_partitioned_wait_set_shard_t * shard = &impl->shards[i];
+    if (RCL_RET_OK != rcl_wait_set_fini(&shard->wait_set)) {
+      result = RCL_RET_ERROR;
+    }
+    if (RCL_RET_OK != rcl_guard_condition_fini(&shard->guard_condition)) {
+      result = RCL_RET_ERROR;
+    }
+    impl->allocator.deallocate(shard->entities, impl->allocator.state);
+    impl->allocator.deallocate(shard->snapshot, impl->allocator.state);
+  }
+  return result;
+}
+
+static rcl_ret_t
+__partitioned_shard_init(
+  rcl_partitioned_wait_set_shard_t * shard,
+  rcl_context_t * context,
+  rcl_allocator_t allocator)
+{
+  shard->wait_set = rcl_get_zero_initialized_wait_set();
+  shard->guard_condition = rcl_get_zero_initialized_guard_condition();
+  rcl_spin_lock_init(&shard->lock);
+  rcl_guard_condition_options_t options = rcl_guard_condition_get_default_options();
+  options.allocator = allocator;
+  rcl_ret_t ret = rcl_guard_condition_init(&shard->guard_condition, context, options);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  ret = rcl_wait_set_init(&shard->wait_set, 0, 1, 0, 0, 0, allocator);
+  if (RCL_RET_OK == ret) {
+    ret = rcl_wait_set_set_persistent(&shard->wait_set, true);
+  }
+  if (RCL_RET_OK == ret) {
+    ret = rcl_wait_set_add_guard_condition(&shard->wait_set, &shard->guard_condition, NULL);
+  }
+  if (RCL_RET_OK != ret) {
+    if (RCL_RET_OK != rcl_wait_set_fini(&shard->wait_set)) {
+      RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to fini wait set after failed init");
+    }
+    if (RCL_RET_OK != rcl_guard_condition_fini(&shard->guard_condition)) {
+      RCUTILS_LOG_ERROR_NAMED(
+        ROS_PACKAGE_NAME, "Failed to fini guard condition after failed init");
+    }
+    return ret;
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_init(
+  rcl_partitioned_wait_set_t * partitioned,
+  size_t shard_count,
+  rcl_context_t * context,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(partitioned, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(context, RCL_RET_INVALID_ARGUMENT);
+  if (0u == shard_count) {
+    RCL_SET_ERROR_MSG("partitioned wait set needs at least one shard");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (partitioned->impl) {
+    RCL_SET_ERROR_MSG("partitioned wait set already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  rcl_partitioned_wait_set_impl_t * impl =
+    (rcl_partitioned_wait_set_impl_t *)allocator.zero_allocate(
+    1, sizeof(rcl_partitioned_wait_set_impl_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->shards = (rcl_partitioned_wait_set_shard_t *)allocator.zero_allocate(
+    shard_count, sizeof(rcl_partitioned_wait_set_shard_t), allocator.state);
+  if (NULL == impl->shards) {
+    allocator.deallocate(impl, allocator.state);
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  impl->allocator = allocator;
+  rcl_spin_lock_init(&impl->lock);
+  for (impl->shard_count = 0; impl->shard_count < shard_count; ++impl->shard_count) {
+    rcl_ret_t ret = __partitioned_shard_init(
+      &impl->shards[impl->shard_count], context, allocator);
+    if (RCL_RET_OK != ret) {
+      if (RCL_RET_OK != __partitioned_shards_fini(impl, impl->shard_count)) {
+        RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to fini shards after failed init");
+      }
+      allocator.deallocate(impl->shards, allocator.state);
+      allocator.deallocate(impl, allocator.state);
+      return ret;  // rcl error state should already be set.
+    }
+  }
+  partitioned->impl = impl;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_fini(rcl_partitioned_wait_set_t * partitioned)
+{
+  if (!partitioned || !partitioned->impl) {
+    return RCL_RET_OK;
+  }
+  rcl_partitioned_wait_set_impl_t * impl = partitioned->impl;
+  rcl_allocator_t allocator = impl->allocator;
+  rcl_ret_t result = __partitioned_shards_fini(impl, impl->shard_count);
+  if (RCL_RET_OK != result) {
+    RCL_SET_ERROR_MSG("failed to fini a shard of the partitioned wait set");
+  }
+  allocator.deallocate(impl->shards, allocator.state);
+  allocator.deallocate(impl, allocator.state);
+  partitioned->impl = NULL;
+  return result;
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_get_shard_count(
+  const rcl_partitioned_wait_set_t * partitioned,
+  size_t * shard_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(partitioned, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    partitioned->impl, "partitioned wait set is invalid", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(shard_count, RCL_RET_INVALID_ARGUMENT);
+  *shard_count = partitioned->impl->shard_count;
+  return RCL_RET_OK;
+}
+
+// Check the arguments common to the functions taking a shard index.
+#define CHECK_SHARD_INDEX(partitioned, shard_index) \
+  RCL_CHECK_ARGUMENT_FOR_NULL(partitioned, RCL_RET_INVALID_ARGUMENT); \
+  RCL_CHECK_FOR_NULL_WITH_MSG( \
+    partitioned->impl, "partitioned wait set is invalid", return RCL_RET_INVALID_ARGUMENT); \
+  if (shard_index >= partitioned->impl->shard_count) { \
+    RCL_SET_ERROR_MSG("shard index out of range"); \
+    return RCL_RET_INVALID_ARGUMENT; \
+  }
+
+rcl_ret_t
+rcl_partitioned_wait_set_get_entity_count(
+  rcl_partitioned_wait_set_t * partitioned,
+  size_t shard_index,
+  size_t * entity_count)
+{
+  CHECK_SHARD_INDEX(partitioned, shard_index);
+  RCL_CHECK_ARGUMENT_FOR_NULL(entity_count, RCL_RET_INVALID_ARGUMENT);
+  rcl_partitioned_wait_set_shard_t * shard = &partitioned->impl->shards[shard_index];
+  rcl_spin_lock_acquire(&shard->lock);
+  *entity_count = shard->entity_count;
+  rcl_spin_lock_release(&shard->lock);
+  return RCL_RET_OK;
+}
+
+// Grow the storage of a shard to at least the given capacity, allocating without any lock held.
+static rcl_ret_t
+__partitioned_shard_grow(
+  rcl_partitioned_wait_set_impl_t * impl,
+  rcl_partitioned_wait_set_shard_t * shard,
+  size_t capacity)
+{
+  rcl_allocator_t allocator = impl->allocator;
+  rcl_partitioned_wait_set_entity_t * entities =
+    (rcl_partitioned_wait_set_entity_t *)allocator.allocate(
+    capacity * sizeof(rcl_partitioned_wait_set_entity_t), allocator.state);
+  if (NULL == entities) {
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  rcl_spin_lock_acquire(&impl->lock);
+  rcl_spin_lock_acquire(&shard->lock);
+  // Another thread may have grown the storage meanwhile, then the new one is freed instead.
+  if (shard->capacity < capacity) {
+    memcpy(entities, shard->entities, shard->entity_count * sizeof(*entities));
+    rcl_partitioned_wait_set_entity_t * old_entities = shard->entities;
+    shard->entities = entities;
+    shard->capacity = capacity;
+    entities = old_entities;
+  }
+  rcl_spin_lock_release(&shard->lock);
+  rcl_spin_lock_release(&impl->lock);
+  allocator.deallocate(entities, allocator.state);
+  return RCL_RET_OK;
+}
+
+// Return the capacity to grow the storage of a shard to, to hold at least count entities.
+static size_t
+__partitioned_next_capacity(const rcl_partitioned_wait_set_shard_t * shard, size_t count)
+{
+  size_t capacity = shard->capacity ? 2u * shard->capacity : 8u;
+  return capacity < count ? count : capacity;
+}
+
+// Append an entity to a shard with room for it, with the lock of the partitioned wait set held.
+static void
+__partitioned_shard_push(
+  rcl_partitioned_wait_set_shard_t * shard,
+  rcl_partitioned_wait_set_entity_t entity)
+{
+  rcl_spin_lock_acquire(&shard->lock);
+  shard->entities[shard->entity_count++] = entity;
+  shard->dirty = true;
+  rcl_spin_lock_release(&shard->lock);
+}
+
+// Remove the entity at the given index of a shard, with the lock of the partitioned wait set held.
+static void
+__partitioned_shard_erase(rcl_partitioned_wait_set_shard_t * shard, size_t index)
+{
+  rcl_spin_lock_acquire(&shard->lock);
+  --shard->entity_count;
+  memmove(
+    &shard->entities[index], &shard->entities[index + 1],
+    (shard->entity_count - index) * sizeof(rcl_partitioned_wait_set_entity_t));
+  shard->dirty = true;
+  rcl_spin_lock_release(&shard->lock);
+}
+
+// Find the shard and index of an entity, with the lock of the partitioned wait set held.
+static bool
+__partitioned_find(
+  const rcl_partitioned_wait_set_impl_t * impl,
+  const void * handle,
+  size_t * shard_index,
+  size_t * index)
+{
+  size_t i;
+  size_t j;
+  for (i = 0; i < impl->shard_count; ++i) {
+    const rcl_partitioned_wait_set_shard_t * shard = &impl->shards[i];
+    for (j = 0; j < shard->entity_count; ++j) {
+      if (shard->entities[j].handle == handle) {
+        *shard_index = i;
+        *index = j;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void
+__partitioned_wake(rcl_partitioned_wait_set_shard_t * shard)
+{
+  if (RCL_RET_OK != rcl_trigger_guard_condition(&shard->guard_condition)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      ROS_PACKAGE_NAME, "Failed to wake up shard: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+static rcl_ret_t
+__partitioned_add(
+  rcl_partitioned_wait_set_t * partitioned,
+  rcl_wait_set_entity_type_t type,
+  const void * handle,
+  size_t * shard_index)
+{
+  rcl_partitioned_wait_set_impl_t * impl = partitioned->impl;
+  size_t found_shard;
+  size_t found_index;
+  size_t target;
+  for (;;) {
+    rcl_spin_lock_acquire(&impl->lock);
+    if (__partitioned_find(impl, handle, &found_shard, &found_index)) {
+      rcl_spin_lock_release(&impl->lock);
+      RCL_SET_ERROR_MSG("entity is already in the partitioned wait set");
+      return RCL_RET_ERROR;
+    }
+    target = 0u;
+    size_t i;
+    for (i = 1; i < impl->shard_count; ++i) {
+      if (impl->shards[i].entity_count < impl->shards[target].entity_count) {
+        target = i;
+      }
+    }
+    rcl_partitioned_wait_set_shard_t * shard = &impl->shards[target];
+    if (shard->entity_count < shard->capacity) {
+      break;
+    }
+    size_t capacity = __partitioned_next_capacity(shard, shard->entity_count + 1u);
+    rcl_spin_lock_release(&impl->lock);
+    rcl_ret_t ret = __partitioned_shard_grow(impl, shard, capacity);
+    if (RCL_RET_OK != ret) {
+      return ret;  // rcl error state should already be set.
+    }
+  }
+  rcl_partitioned_wait_set_entity_t entity = {type, handle};
+  __partitioned_shard_push(&impl->shards[target], entity);
+  rcl_spin_lock_release(&impl->lock);
+  __partitioned_wake(&impl->shards[target]);
+  if (NULL != shard_index) {
+    *shard_index = target;
+  }
+  return RCL_RET_OK;
+}
+
+#define PARTITIONED_ADD(Type, TYPE) \
+  RCL_CHECK_ARGUMENT_FOR_NULL(partitioned, RCL_RET_INVALID_ARGUMENT); \
+  RCL_CHECK_FOR_NULL_WITH_MSG( \
+    partitioned->impl, "partitioned wait set is invalid", return RCL_RET_INVALID_ARGUMENT); \
+  RCL_CHECK_ARGUMENT_FOR_NULL(Type, RCL_RET_INVALID_ARGUMENT); \
+  return __partitioned_add(partitioned, RCL_WAIT_SET_ ## TYPE, Type, shard_index);
+
+rcl_ret_t
+rcl_partitioned_wait_set_add_subscription(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_subscription_t * subscription,
+  size_t * shard_index)
+{
+  PARTITIONED_ADD(subscription, SUBSCRIPTION)
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_add_guard_condition(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_guard_condition_t * guard_condition,
+  size_t * shard_index)
+{
+  PARTITIONED_ADD(guard_condition, GUARD_CONDITION)
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_add_timer(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_timer_t * timer,
+  size_t * shard_index)
+{
+  PARTITIONED_ADD(timer, TIMER)
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_add_client(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_client_t * client,
+  size_t * shard_index)
+{
+  PARTITIONED_ADD(client, CLIENT)
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_add_service(
+  rcl_partitioned_wait_set_t * partitioned,
+  const rcl_service_t * service,
+  size_t * shard_index)
+{
+  PARTITIONED_ADD(service, SERVICE)
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_remove(rcl_partitioned_wait_set_t * partitioned, const void * entity)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(partitioned, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    partitioned->impl, "partitioned wait set is invalid", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(entity, RCL_RET_INVALID_ARGUMENT);
+  rcl_partitioned_wait_set_impl_t * impl = partitioned->impl;
+  size_t shard_index;
+  size_t index;
+  rcl_spin_lock_acquire(&impl->lock);
+  if (!__partitioned_find(impl, entity, &shard_index, &index)) {
+    rcl_spin_lock_release(&impl->lock);
+    RCL_SET_ERROR_MSG("entity is not in the partitioned wait set");
+    return RCL_RET_ERROR;
+  }
+  __partitioned_shard_erase(&impl->shards[shard_index], index);
+  rcl_spin_lock_release(&impl->lock);
+  __partitioned_wake(&impl->shards[shard_index]);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_rebalance(rcl_partitioned_wait_set_t * partitioned)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(partitioned, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    partitioned->impl, "partitioned wait set is invalid", return RCL_RET_INVALID_ARGUMENT);
+  rcl_partitioned_wait_set_impl_t * impl = partitioned->impl;
+  rcl_allocator_t allocator = impl->allocator;
+  bool * moved = (bool *)allocator.zero_allocate(impl->shard_count, sizeof(bool), allocator.state);
+  if (NULL == moved) {
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  size_t i;
+  // Grow the shards first so that moving the entities does not allocate with the lock held.
+  // Once rebalanced, no shard holds more entities than its share rounded up.
+  for (;;) {
+    rcl_spin_lock_acquire(&impl->lock);
+    size_t total = 0u;
+    for (i = 0; i < impl->shard_count; ++i) {
+      total += impl->shards[i].entity_count;
+    }
+    size_t share = (total + impl->shard_count - 1u) / impl->shard_count;
+    for (i = 0; i < impl->shard_count; ++i) {
+      if (impl->shards[i].capacity < share) {
+        break;
+      }
+    }
+    if (i == impl->shard_count) {
+      break;
+    }
+    rcl_partitioned_wait_set_shard_t * shard = &impl->shards[i];
+    size_t capacity = __partitioned_next_capacity(shard, share);
+    rcl_spin_lock_release(&impl->lock);
+    rcl_ret_t ret = __partitioned_shard_grow(impl, shard, capacity);
+    if (RCL_RET_OK != ret) {
+      allocator.deallocate(moved, allocator.state);
+      return ret;  // rcl error state should already be set.
+    }
+  }
+  for (;;) {
+    size_t most = 0u;
+    size_t fewest = 0u;
+    for (i = 1; i < impl->shard_count; ++i) {
+      if (impl->shards[i].entity_count > impl->shards[most].entity_count) {
+        most = i;
+      }
+      if (impl->shards[i].entity_count < impl->shards[fewest].entity_count) {
+        fewest = i;
+      }
+    }
+    rcl_partitioned_wait_set_shard_t * from = &impl->shards[most];
+    rcl_partitioned_wait_set_shard_t * to = &impl->shards[fewest];
+    if (from->entity_count <= to->entity_count + 1u) {
+      break;
+    }
+    // Move the most recently added entity.
+    __partitioned_shard_push(to, from->entities[from->entity_count - 1u]);
+    __partitioned_shard_erase(from, from->entity_count - 1u);
+    moved[most] = true;
+    moved[fewest] = true;
+  }
+  rcl_spin_lock_release(&impl->lock);
+  // Waking up calls into the middleware, so it is done after releasing the lock.
+  for (i = 0; i < impl->shard_count; ++i) {
+    if (moved[i]) {
+      __partitioned_wake(&impl->shards[i]);
+    }
+  }
+  allocator.deallocate(moved, allocator.state);
+  return RCL_RET_OK;
+}
+
+// Copy the entities of a shard if they changed since the last copy, holding its lock only to copy.
+static rcl_ret_t
+__partitioned_shard_snapshot(
+  rcl_partitioned_wait_set_impl_t * impl,
+  rcl_partitioned_wait_set_shard_t * shard,
+  bool * changed)
+{
+  *changed = false;
+  for (;;) {
+    rcl_spin_lock_acquire(&shard->lock);
+    const size_t count = shard->entity_count;
+    if (shard->dirty && count <= shard->snapshot_capacity) {
+      if (count > 0u) {
+        memcpy(shard->snapshot, shard->entities, count * sizeof(rcl_partitioned_wait_set_entity_t));
+      }
+      shard->snapshot_count = count;
+      shard->dirty = false;
+      *changed = true;
+    }
+    const bool grow = shard->dirty;
+    rcl_spin_lock_release(&shard->lock);
+    if (!grow) {
+      return RCL_RET_OK;
+    }
+    // Grow the copy without the lock, the entities are counted again once it is taken back.
+    rcl_partitioned_wait_set_entity_t * snapshot =
+      (rcl_partitioned_wait_set_entity_t *)impl->allocator.reallocate(
+      shard->snapshot, count * sizeof(rcl_partitioned_wait_set_entity_t),
+      impl->allocator.state);
+    RCL_CHECK_FOR_NULL_WITH_MSG(snapshot, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+    shard->snapshot = snapshot;
+    shard->snapshot_capacity = count;
+  }
+}
+
+// Update the wait set of a shard to the copy of its entities, without its lock held.
+static rcl_ret_t
+__partitioned_shard_update(rcl_partitioned_wait_set_shard_t * shard)
+{
+  size_t counts[RCL_WAIT_SET_ENTITY_TYPE_COUNT] = {0u};
+  size_t i;
+  for (i = 0; i < shard->snapshot_count; ++i) {
+    ++counts[shard->snapshot[i].type];
+  }
+  rcl_ret_t ret = rcl_wait_set_resize(
+    &shard->wait_set,
+    counts[RCL_WAIT_SET_SUBSCRIPTION],
+    counts[RCL_WAIT_SET_GUARD_CONDITION] + 1u,
+    counts[RCL_WAIT_SET_TIMER],
+    counts[RCL_WAIT_SET_CLIENT],
+    counts[RCL_WAIT_SET_SERVICE]);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  ret = rcl_wait_set_add_guard_condition(&shard->wait_set, &shard->guard_condition, NULL);
+  for (i = 0; i < shard->snapshot_count && RCL_RET_OK == ret; ++i) {
+    const void * handle = shard->snapshot[i].handle;
+    switch (shard->snapshot[i].type) {
+      case RCL_WAIT_SET_SUBSCRIPTION:
+        ret = rcl_wait_set_add_subscription(
+          &shard->wait_set, (const rcl_subscription_t *)handle, NULL);
+        break;
+      case RCL_WAIT_SET_GUARD_CONDITION:
+        ret = rcl_wait_set_add_guard_condition(
+          &shard->wait_set, (const rcl_guard_condition_t *)handle, NULL);
+        break;
+      case RCL_WAIT_SET_TIMER:
+        ret = rcl_wait_set_add_timer(&shard->wait_set, (const rcl_timer_t *)handle, NULL);
+        break;
+      case RCL_WAIT_SET_CLIENT:
+        ret = rcl_wait_set_add_client(&shard->wait_set, (const rcl_client_t *)handle, NULL);
+        break;
+      case RCL_WAIT_SET_SERVICE:
+        ret = rcl_wait_set_add_service(&shard->wait_set, (const rcl_service_t *)handle, NULL);
+        break;
+    }
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_partitioned_wait_set_wait(
+  rcl_partitioned_wait_set_t * partitioned,
+  size_t shard_index,
+  int64_t timeout,
+  rcl_wait_set_t ** wait_set)
+{
+  CHECK_SHARD_INDEX(partitioned, shard_index);
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  rcl_partitioned_wait_set_shard_t * shard = &partitioned->impl->shards[shard_index];
+  rcutils_time_point_value_t end = 0;
+  if (timeout > 0) {
+    if (RCUTILS_RET_OK != rcutils_steady_time_now(&end)) {
+      RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+      return RCL_RET_ERROR;
+    }
+    end = timeout > INT64_MAX - end ? INT64_MAX : end + timeout;
+  }
+  *wait_set = &shard->wait_set;
+  for (;;) {
+    bool changed;
+    rcl_ret_t ret = __partitioned_shard_snapshot(partitioned->impl, shard, &changed);
+    if (RCL_RET_OK == ret && changed) {
+      ret = __partitioned_shard_update(shard);
+      if (RCL_RET_OK != ret) {
+        // Update the wait set again on the next wait.
+        rcl_spin_lock_acquire(&shard->lock);
+        shard->dirty = true;
+        rcl_spin_lock_release(&shard->lock);
+      }
+    }
+    if (RCL_RET_OK != ret) {
+      return ret;  // rcl error state should already be set.
+    }
+    ret = rcl_wait(&shard->wait_set, timeout);
+    if (RCL_RET_OK != ret) {
+      return ret;  // rcl error state should already be set, unless it timed out.
+    }
+    const rcl_wait_set_ready_entity_t * ready_entities;
+    size_t ready_count;
+    ret = rcl_wait_set_get_ready_entities(&shard->wait_set, &ready_entities, &ready_count);
+    if (RCL_RET_OK != ret) {
+      return ret;  // rcl error state should already be set.
+    }
+    const bool woken = NULL != shard->wait_set.guard_conditions[0];
+    shard->wait_set.guard_conditions[0] = NULL;
+    if (!woken || ready_count > 1u) {
+      return RCL_RET_OK;
+    }
+    // Only woken up because the entities changed, wait again for the remaining time.
+    if (timeout > 0) {
+      rcutils_time_point_value_t now;
+      if (RCUTILS_RET_OK != rcutils_steady_time_now(&now)) {
+        RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+        return RCL_RET_ERROR;
+      }
+      if (now >= end) {
+        return RCL_RET_TIMEOUT;
+      }
+      timeout = end - now;
+    }
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -23,20 +23,28 @@ extern "C"
 #include <string.h>
 
 #include "./common.h"
+#include "./context_impl.h"
+#include "./intra_process_impl.h"
+#include "./loan_pool_impl.h"
+#include "./resolved_name_cache_impl.h"
+#include "./traffic_statistics_impl.h"
 #include "rcl/allocator.h"
 #include "rcl/error_handling.h"
-#include "rcl/expand_topic_name.h"
-#include "rcl/remap.h"
 #include "rcutils/logging_macros.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
-#include "rmw/validate_full_topic_name.h"
 
 typedef struct rcl_publisher_impl_t
 {
   rcl_publisher_options_t options;
   rcl_context_t * context;
   rmw_publisher_t * rmw_handle;
+  // Messages loaned out by rcl_borrow_loaned_message(), `NULL` if loaning is disabled.
+  rcl_loan_pool_t * loan_pool;
+  // Registration with the context, if the intra_process option is set.
+  rcl_intra_process_publisher_t intra_process;
+  // Counters of the messages published, if the traffic_statistics option is set.
+  rcl_traffic_statistics_counters_t traffic_statistics;
 } rcl_publisher_impl_t;
 
 rcl_publisher_t
@@ -46,6 +54,25 @@ rcl_get_zero_initialized_publisher()
   return null_publisher;
 }
 
+// Register a publisher whose rmw handle and loan pool are initialized with its context.
+static rcl_ret_t
+__publisher_init_intra_process(
+  rcl_publisher_t * publisher,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * type_support)
+{
+  rmw_gid_t gid;
+  rmw_ret_t rmw_ret = rmw_get_gid_for_publisher(publisher->impl->rmw_handle, &gid);
+  if (rmw_ret != RMW_RET_OK) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+    return rcl_convert_rmw_ret_to_rcl_ret(rmw_ret);
+  }
+  return rcl_intra_process_publisher_init(
+    &publisher->impl->intra_process, &node->context->impl->intra_process,
+    publisher->impl->rmw_handle->topic_name, type_support, &gid,
+    publisher->impl->loan_pool);
+}
+
 rcl_ret_t
 rcl_publisher_init(
   rcl_publisher_t * publisher,
@@ -60,6 +87,10 @@ rcl_publisher_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   rcl_allocator_t * allocator = (rcl_allocator_t *)&options->allocator;
   RCL_CHECK_ALLOCATOR_WITH_MSG(allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  if (options->intra_process && NULL == options->loan.create_message) {
+    RCL_SET_ERROR_MSG("intra process publishers need loan options");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
 
   RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
   if (publisher->impl) {
@@ -73,89 +104,13 @@ rcl_publisher_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(topic_name, RCL_RET_INVALID_ARGUMENT);
   RCUTILS_LOG_DEBUG_NAMED(
     ROS_PACKAGE_NAME, "Initializing publisher for topic name '%s'", topic_name);
-  // Expand the given topic name.
-  rcutils_allocator_t rcutils_allocator = *allocator;  // implicit conversion to rcutils version
-  rcutils_string_map_t substitutions_map = rcutils_get_zero_initialized_string_map();
-  rcutils_ret_t rcutils_ret = rcutils_string_map_init(&substitutions_map, 0, rcutils_allocator);
-  if (rcutils_ret != RCUTILS_RET_OK) {
-    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
-    if (rcutils_ret == RCUTILS_RET_BAD_ALLOC) {
-      return RCL_RET_BAD_ALLOC;
-    }
-    return RCL_RET_ERROR;
-  }
-  rcl_ret_t ret = rcl_get_default_topic_name_substitutions(&substitutions_map);
-  if (ret != RCL_RET_OK) {
-    rcutils_ret = rcutils_string_map_fini(&substitutions_map);
-    if (rcutils_ret != RCUTILS_RET_OK) {
-      RCUTILS_LOG_ERROR_NAMED(
-        ROS_PACKAGE_NAME,
-        "failed to fini string_map (%d) during error handling: %s",
-        rcutils_ret,
-        rcutils_get_error_string().str);
-    }
-    if (ret == RCL_RET_BAD_ALLOC) {
-      return ret;
-    }
-    return RCL_RET_ERROR;
-  }
-  char * expanded_topic_name = NULL;
-  char * remapped_topic_name = NULL;
-  ret = rcl_expand_topic_name(
-    topic_name,
-    rcl_node_get_name(node),
-    rcl_node_get_namespace(node),
-    &substitutions_map,
-    *allocator,
-    &expanded_topic_name);
-  rcutils_ret = rcutils_string_map_fini(&substitutions_map);
-  if (rcutils_ret != RCUTILS_RET_OK) {
-    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  if (ret != RCL_RET_OK) {
-    if (ret == RCL_RET_TOPIC_NAME_INVALID || ret == RCL_RET_UNKNOWN_SUBSTITUTION) {
-      ret = RCL_RET_TOPIC_NAME_INVALID;
-    } else {
-      ret = RCL_RET_ERROR;
-    }
-    goto cleanup;
-  }
-  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Expanded topic name '%s'", expanded_topic_name);
-
-  const rcl_node_options_t * node_options = rcl_node_get_options(node);
-  if (NULL == node_options) {
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  rcl_arguments_t * global_args = NULL;
-  if (node_options->use_global_arguments) {
-    global_args = &(node->context->global_arguments);
-  }
-  ret = rcl_remap_topic_name(
-    &(node_options->arguments), global_args, expanded_topic_name,
-    rcl_node_get_name(node), rcl_node_get_namespace(node), *allocator, &remapped_topic_name);
+  // Resolve the given topic name, which is only done once per name for the whole node.
+  const char * resolved_topic_name = NULL;
+  rcl_ret_t ret = rcl_node_resolve_name(node, topic_name, false, &resolved_topic_name);
   if (RCL_RET_OK != ret) {
-    goto fail;
-  } else if (NULL == remapped_topic_name) {
-    remapped_topic_name = expanded_topic_name;
-    expanded_topic_name = NULL;
-  }
-
-  // Validate the expanded topic name.
-  int validation_result;
-  rmw_ret_t rmw_ret = rmw_validate_full_topic_name(remapped_topic_name, &validation_result, NULL);
-  if (rmw_ret != RMW_RET_OK) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  if (validation_result != RMW_TOPIC_VALID) {
-    RCL_SET_ERROR_MSG(rmw_full_topic_name_validation_result_string(validation_result));
-    ret = RCL_RET_TOPIC_NAME_INVALID;
-    goto cleanup;
+    return ret;  // error already set
   }
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Resolved topic name '%s'", resolved_topic_name);
   // Allocate space for the implementation struct.
   publisher->impl = (rcl_publisher_impl_t *)allocator->allocate(
     sizeof(rcl_publisher_impl_t), allocator->state);
@@ -167,12 +122,33 @@ rcl_publisher_init(
   publisher->impl->rmw_handle = rmw_create_publisher(
     rcl_node_get_rmw_handle(node),
     type_support,
-    remapped_topic_name,
+    resolved_topic_name,
     &(options->qos));
   RCL_CHECK_FOR_NULL_WITH_MSG(publisher->impl->rmw_handle,
     rmw_get_error_string().str, goto fail);
+  // loaned messages
+  publisher->impl->intra_process = rcl_get_zero_initialized_intra_process_publisher();
+  ret = rcl_loan_pool_init(&publisher->impl->loan_pool, &options->loan, *allocator);
+  // intra process registration
+  if (RCL_RET_OK == ret && options->intra_process) {
+    ret = __publisher_init_intra_process(publisher, node, type_support);
+    if (RCL_RET_OK != ret) {
+      rcl_loan_pool_fini(publisher->impl->loan_pool);
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    fail_ret = ret;
+    if (rmw_destroy_publisher(
+        rcl_node_get_rmw_handle(node), publisher->impl->rmw_handle) != RMW_RET_OK)
+    {
+      RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "%s", rmw_get_error_string().str);
+    }
+    goto fail;
+  }
   // options
   publisher->impl->options = *options;
+  rcl_traffic_statistics_counters_init(
+    &publisher->impl->traffic_statistics, options->traffic_statistics);
   RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Publisher initialized");
   // context
   publisher->impl->context = node->context;
@@ -184,11 +160,51 @@ fail:
   ret = fail_ret;
   // Fall through to cleanup
 cleanup:
-  if (NULL != expanded_topic_name) {
-    allocator->deallocate(expanded_topic_name, allocator->state);
+  return ret;
+}
+
+rcl_ret_t
+rcl_publishers_init_bulk(
+  rcl_publisher_t * publishers,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * const * type_supports,
+  const char * const * topic_names,
+  const rcl_publisher_options_t * options,
+  size_t count)
+{
+  if (!rcl_node_is_valid(node)) {
+    return RCL_RET_NODE_INVALID;  // error already set
+  }
+  if (0u == count) {
+    return RCL_RET_OK;
   }
-  if (NULL != remapped_topic_name) {
-    allocator->deallocate(remapped_topic_name, allocator->state);
+  RCL_CHECK_ARGUMENT_FOR_NULL(publishers, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(type_supports, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(topic_names, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  // Every publisher then finds its name in the cache of the node.
+  rcl_ret_t ret = rcl_node_resolve_names(node, topic_names, count, false);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  size_t i;
+  for (i = 0u; i < count; ++i) {
+    ret = rcl_publisher_init(&publishers[i], node, type_supports[i], topic_names[i], &options[i]);
+    if (RCL_RET_OK != ret) {
+      break;
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    // Finalize the publishers initialized before the one which failed.
+    while (i-- > 0u) {
+      if (rcl_publisher_fini(&publishers[i], (rcl_node_t *)node) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          ROS_PACKAGE_NAME, "failed to fini publisher during error handling: %s",
+          rcl_get_error_string().str);
+      }
+      // Left zero initialized, so that the publishers can be initialized again.
+      publishers[i] = rcl_get_zero_initialized_publisher();
+    }
   }
   return ret;
 }
@@ -215,6 +231,8 @@ rcl_publisher_fini(rcl_publisher_t * publisher, rcl_node_t * node)
       RCL_SET_ERROR_MSG(rmw_get_error_string().str);
       result = RCL_RET_ERROR;
     }
+    rcl_intra_process_publisher_fini(&publisher->impl->intra_process);
+    rcl_loan_pool_fini(publisher->impl->loan_pool);
     allocator.deallocate(publisher->impl, allocator.state);
   }
   RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Publisher finalized");
@@ -232,6 +250,17 @@ rcl_publisher_get_default_options()
   return default_options;
 }
 
+// Return true, and set the error, if the publisher only publishes loaned messages.
+static bool
+__publisher_is_intra_process(const rcl_publisher_t * publisher)
+{
+  if (NULL == publisher->impl->intra_process.registry) {
+    return false;
+  }
+  RCL_SET_ERROR_MSG("intra process publishers only publish loaned messages");
+  return true;
+}
+
 rcl_ret_t
 rcl_publish(const rcl_publisher_t * publisher, const void * ros_message)
 {
@@ -239,13 +268,68 @@ rcl_publish(const rcl_publisher_t * publisher, const void * ros_message)
     return RCL_RET_PUBLISHER_INVALID;  // error already set
   }
   RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  if (__publisher_is_intra_process(publisher)) {
+    return RCL_RET_UNSUPPORTED;  // error already set
+  }
   if (rmw_publish(publisher->impl->rmw_handle, ros_message) != RMW_RET_OK) {
     RCL_SET_ERROR_MSG(rmw_get_error_string().str);
     return RCL_RET_ERROR;
   }
+  rcl_traffic_statistics_count_messages(&publisher->impl->traffic_statistics, 1u, 0u);
+  return RCL_RET_OK;
+}
+
+// Check the arguments of a batch publish, which are all checked before publishing any message.
+static rcl_ret_t
+__publisher_check_batch(
+  const rcl_publisher_t * publisher,
+  const void * const * messages,
+  size_t count,
+  size_t * published)
+{
+  if (!rcl_publisher_is_valid(publisher)) {
+    return RCL_RET_PUBLISHER_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(published, RCL_RET_INVALID_ARGUMENT);
+  *published = 0u;
+  if (__publisher_is_intra_process(publisher)) {
+    return RCL_RET_UNSUPPORTED;  // error already set
+  }
+  if (0u == count) {
+    return RCL_RET_OK;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(messages, RCL_RET_INVALID_ARGUMENT);
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      messages[i], "message in batch is null", return RCL_RET_INVALID_ARGUMENT);
+  }
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_publish_batch(
+  const rcl_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published)
+{
+  rcl_ret_t ret = __publisher_check_batch(publisher, ros_messages, count, published);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  rmw_publisher_t * rmw_handle = publisher->impl->rmw_handle;
+  for (; *published < count; ++*published) {
+    if (rmw_publish(rmw_handle, ros_messages[*published]) != RMW_RET_OK) {
+      RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+      ret = RCL_RET_ERROR;
+      break;
+    }
+  }
+  rcl_traffic_statistics_count_messages(&publisher->impl->traffic_statistics, *published, 0u);
+  return ret;
+}
+
 rcl_ret_t
 rcl_publish_serialized_message(
   const rcl_publisher_t * publisher, const rcl_serialized_message_t * serialized_message)
@@ -254,6 +338,9 @@ rcl_publish_serialized_message(
     return RCL_RET_PUBLISHER_INVALID;  // error already set
   }
   RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  if (__publisher_is_intra_process(publisher)) {
+    return RCL_RET_UNSUPPORTED;  // error already set
+  }
   rmw_ret_t ret = rmw_publish_serialized_message(publisher->impl->rmw_handle, serialized_message);
   if (ret != RMW_RET_OK) {
     RCL_SET_ERROR_MSG(rmw_get_error_string().str);
@@ -262,9 +349,112 @@ rcl_publish_serialized_message(
     }
     return RMW_RET_ERROR;
   }
+  rcl_traffic_statistics_count_messages(
+    &publisher->impl->traffic_statistics, 1u, serialized_message->buffer_length);
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_publish_serialized_message_batch(
+  const rcl_publisher_t * publisher,
+  const rcl_serialized_message_t * const * serialized_messages,
+  size_t count,
+  size_t * published)
+{
+  rcl_ret_t ret = __publisher_check_batch(
+    publisher, (const void * const *)serialized_messages, count, published);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  rmw_publisher_t * rmw_handle = publisher->impl->rmw_handle;
+  size_t byte_count = 0u;
+  for (; *published < count; ++*published) {
+    rmw_ret_t rmw_ret =
+      rmw_publish_serialized_message(rmw_handle, serialized_messages[*published]);
+    if (rmw_ret != RMW_RET_OK) {
+      RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+      ret = rmw_ret == RMW_RET_BAD_ALLOC ? RCL_RET_BAD_ALLOC : RCL_RET_ERROR;
+      break;
+    }
+    byte_count += serialized_messages[*published]->buffer_length;
+  }
+  rcl_traffic_statistics_count_messages(
+    &publisher->impl->traffic_statistics, *published, byte_count);
+  return ret;
+}
+
+bool
+rcl_publisher_can_loan_messages(const rcl_publisher_t * publisher)
+{
+  if (!rcl_publisher_is_valid(publisher)) {
+    return false;  // error already set
+  }
+  return rcl_loan_pool_is_enabled(publisher->impl->loan_pool);
+}
+
+rcl_ret_t
+rcl_borrow_loaned_message(const rcl_publisher_t * publisher, void ** ros_message)
+{
+  if (!rcl_publisher_is_valid(publisher)) {
+    return RCL_RET_PUBLISHER_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  return rcl_loan_pool_borrow(publisher->impl->loan_pool, ros_message);
+}
+
+rcl_ret_t
+rcl_return_loaned_message_from_publisher(
+  const rcl_publisher_t * publisher,
+  void * loaned_message)
+{
+  if (!rcl_publisher_is_valid_except_context(publisher)) {
+    return RCL_RET_PUBLISHER_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(loaned_message, RCL_RET_INVALID_ARGUMENT);
+  return rcl_loan_pool_return(publisher->impl->loan_pool, loaned_message);
+}
+
+rcl_ret_t
+rcl_publish_loaned_message(const rcl_publisher_t * publisher, void * ros_message)
+{
+  if (!rcl_publisher_is_valid(publisher)) {
+    return RCL_RET_PUBLISHER_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  // The loan keeps the message in use while publishing.
+  if (!rcl_loan_pool_is_on_loan(publisher->impl->loan_pool, ros_message)) {
+    RCL_SET_ERROR_MSG("message is not on loan");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_ret_t ret = RCL_RET_OK;
+  bool use_middleware = true;
+  if (NULL != publisher->impl->intra_process.registry) {
+    size_t delivered = 0u;
+    ret = rcl_intra_process_publish(&publisher->impl->intra_process, ros_message, &delivered);
+    // Subscriptions the message was not queued for, like those of other processes,
+    // are matched with the rmw publisher too.
+    size_t matched = 0u;
+    if (RCL_RET_OK == ret && delivered > 0u &&
+      rmw_publisher_count_matched_subscriptions(
+        publisher->impl->rmw_handle, &matched) == RMW_RET_OK)
+    {
+      use_middleware = matched > delivered;
+    }
+  }
+  if (RCL_RET_OK == ret && use_middleware &&
+    rmw_publish(publisher->impl->rmw_handle, ros_message) != RMW_RET_OK)
+  {
+    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+    ret = RCL_RET_ERROR;
+  }
+  if (RCL_RET_OK == ret) {
+    rcl_traffic_statistics_count_messages(&publisher->impl->traffic_statistics, 1u, 0u);
+  }
+  // The loan ends whether or not publishing succeeded.
+  (void)rcl_loan_pool_return(publisher->impl->loan_pool, ros_message);
+  return ret;
+}
+
 const char *
 rcl_publisher_get_topic_name(const rcl_publisher_t * publisher)
 {
@@ -349,6 +539,18 @@ rcl_publisher_get_subscription_count(
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_publisher_get_traffic_statistics(
+  const rcl_publisher_t * publisher,
+  rcl_traffic_statistics_t * statistics)
+{
+  if (!rcl_publisher_is_valid_except_context(publisher)) {
+    return RCL_RET_PUBLISHER_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  return rcl_traffic_statistics_counters_load(&publisher->impl->traffic_statistics, statistics);
+}
+
 #ifdef __cplusplus
 }
 #endif
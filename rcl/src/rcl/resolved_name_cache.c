@@ -0,0 +1,452 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "./resolved_name_cache_impl.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rcl/error_handling.h"
+#include "rcl/expand_topic_name.h"
+#include "rcutils/logging_macros.h"
+#include "rcutils/strdup.h"
+#include "rmw/error_handling.h"
+#include "rmw/validate_full_topic_name.h"
+
+#include "./arguments_impl.h"
+#include "./context_impl.h"
+
+rcl_resolved_name_cache_t
+rcl_get_zero_initialized_resolved_name_cache()
+{
+  static rcl_resolved_name_cache_t null_cache = {0};
+  return null_cache;
+}
+
+void
+rcl_resolved_name_cache_init(rcl_resolved_name_cache_t * cache, rcl_allocator_t allocator)
+{
+  *cache = rcl_get_zero_initialized_resolved_name_cache();
+  rcl_spin_lock_init(&cache->lock);
+  cache->allocator = allocator;
+}
+
+// Free a chain of names.
+static void
+__resolved_name_cache_fini_chain(rcl_resolved_name_t * entry, rcl_allocator_t allocator)
+{
+  while (NULL != entry) {
+    rcl_resolved_name_t * next = entry->next;
+    allocator.deallocate(entry->name, allocator.state);
+    allocator.deallocate(entry->resolved_name, allocator.state);
+    allocator.deallocate(entry, allocator.state);
+    entry = next;
+  }
+}
+
+void
+rcl_resolved_name_cache_fini(rcl_resolved_name_cache_t * cache)
+{
+  if (NULL == cache) {
+    return;
+  }
+  size_t i;
+  for (i = 0u; i < RCL_RESOLVED_NAME_CACHE_BUCKET_COUNT; ++i) {
+    __resolved_name_cache_fini_chain(cache->topic_names[i], cache->allocator);
+    __resolved_name_cache_fini_chain(cache->service_names[i], cache->allocator);
+    cache->topic_names[i] = NULL;
+    cache->service_names[i] = NULL;
+  }
+}
+
+// Finalize a string map, logging failures as there is nothing else to do about them.
+static void
+__resolved_name_cache_fini_map(rcutils_string_map_t * map)
+{
+  rcutils_ret_t rcutils_ret = rcutils_string_map_fini(map);
+  if (RCUTILS_RET_OK != rcutils_ret) {
+    RCUTILS_LOG_ERROR_NAMED(
+      ROS_PACKAGE_NAME,
+      "failed to fini string_map (%d) of substitutions: %s",
+      rcutils_ret,
+      rcutils_get_error_string().str);
+    rcutils_reset_error();
+  }
+}
+
+// A remap rule which may apply to the names of a node, with its match side expanded.
+typedef struct rcl_name_resolver_rule_t
+{
+  const rcl_remap_t * rule;
+  // The fully qualified match, or `NULL` if it could not be expanded.
+  char * expanded_match;
+  // The error expanding the match, which stops the rules from being applied.
+  rcl_ret_t ret;
+} rcl_name_resolver_rule_t;
+
+// What every name of a node resolves with, set up once for any number of names.
+typedef struct rcl_name_resolver_t
+{
+  const rcl_node_t * node;
+  bool is_service;
+  rcl_allocator_t allocator;
+  rcutils_string_map_t substitutions;
+  // The local rules followed by the global rules, of the right type and for this node.
+  rcl_name_resolver_rule_t * rules;
+  size_t rule_count;
+} rcl_name_resolver_t;
+
+static void
+__resolver_fini(rcl_name_resolver_t * resolver)
+{
+  rcl_allocator_t allocator = resolver->allocator;
+  for (size_t i = 0u; i < resolver->rule_count; ++i) {
+    if (NULL != resolver->rules[i].expanded_match) {
+      allocator.deallocate(resolver->rules[i].expanded_match, allocator.state);
+    }
+  }
+  if (NULL != resolver->rules) {
+    allocator.deallocate(resolver->rules, allocator.state);
+  }
+  __resolved_name_cache_fini_map(&resolver->substitutions);
+}
+
+// Expand the match side of the rules of some arguments which apply to the names to resolve.
+static void
+__resolver_add_rules(rcl_name_resolver_t * resolver, const rcl_arguments_t * arguments)
+{
+  if (NULL == arguments || NULL == arguments->impl) {
+    return;
+  }
+  const rcl_remap_type_t type = resolver->is_service ? RCL_SERVICE_REMAP : RCL_TOPIC_REMAP;
+  const char * node_name = rcl_node_get_name(resolver->node);
+  const char * node_namespace = rcl_node_get_namespace(resolver->node);
+  rcl_allocator_t allocator = resolver->allocator;
+  for (int i = 0; i < arguments->impl->num_remap_rules; ++i) {
+    const rcl_remap_t * rule = &(arguments->impl->remap_rules[i]);
+    if (!(rule->type & type)) {
+      continue;
+    }
+    if (NULL != rule->node_name && 0 != strcmp(rule->node_name, node_name)) {
+      continue;
+    }
+    rcl_name_resolver_rule_t * resolver_rule = &resolver->rules[resolver->rule_count++];
+    resolver_rule->rule = rule;
+    resolver_rule->expanded_match = NULL;
+    resolver_rule->ret = rcl_expand_topic_name(
+      rule->match, node_name, node_namespace, &resolver->substitutions, allocator,
+      &resolver_rule->expanded_match);
+    if (RCL_RET_OK != resolver_rule->ret) {
+      rcl_reset_error();
+    }
+  }
+}
+
+// Set up the substitutions and the rules once, like rcl_remap_topic_name() does for every name.
+static rcl_ret_t
+__resolver_init(
+  rcl_name_resolver_t * resolver,
+  const rcl_node_t * node,
+  bool is_service,
+  rcl_allocator_t allocator)
+{
+  resolver->node = node;
+  resolver->is_service = is_service;
+  resolver->allocator = allocator;
+  resolver->substitutions = rcutils_get_zero_initialized_string_map();
+  resolver->rules = NULL;
+  resolver->rule_count = 0u;
+  const rcl_node_options_t * node_options = rcl_node_get_options(node);
+  if (NULL == node_options) {
+    return RCL_RET_ERROR;
+  }
+  const rcl_arguments_t * local_args = &(node_options->arguments);
+  const rcl_arguments_t * global_args = NULL;
+  if (node_options->use_global_arguments) {
+    global_args = &(node->context->global_arguments);
+  }
+  if (NULL == local_args->impl && (NULL == global_args || NULL == global_args->impl)) {
+    RCL_SET_ERROR_MSG("local_arguments invalid and not using global arguments");
+    return RCL_RET_ERROR;
+  }
+
+  rcutils_ret_t rcutils_ret = rcutils_string_map_init(&resolver->substitutions, 0, allocator);
+  if (rcutils_ret != RCUTILS_RET_OK) {
+    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+    if (rcutils_ret == RCUTILS_RET_BAD_ALLOC) {
+      return RCL_RET_BAD_ALLOC;
+    }
+    return RCL_RET_ERROR;
+  }
+  rcl_ret_t ret = rcl_get_default_topic_name_substitutions(&resolver->substitutions);
+  if (ret != RCL_RET_OK) {
+    __resolver_fini(resolver);
+    return RCL_RET_BAD_ALLOC == ret ? ret : RCL_RET_ERROR;
+  }
+  size_t max_rule_count = 0u;
+  if (NULL != local_args->impl) {
+    max_rule_count += (size_t)local_args->impl->num_remap_rules;
+  }
+  if (NULL != global_args && NULL != global_args->impl) {
+    max_rule_count += (size_t)global_args->impl->num_remap_rules;
+  }
+  if (0u != max_rule_count) {
+    resolver->rules = allocator.allocate(
+      max_rule_count * sizeof(rcl_name_resolver_rule_t), allocator.state);
+    if (NULL == resolver->rules) {
+      RCL_SET_ERROR_MSG("allocating memory failed");
+      __resolver_fini(resolver);
+      return RCL_RET_BAD_ALLOC;
+    }
+  }
+  // Local rules come first, as they take precedence over global rules.
+  __resolver_add_rules(resolver, local_args);
+  __resolver_add_rules(resolver, global_args);
+  return RCL_RET_OK;
+}
+
+// Expand, remap and validate a name, with the rules of the first matching rule.
+static rcl_ret_t
+__resolver_resolve(
+  const rcl_name_resolver_t * resolver,
+  const char * input_name,
+  char ** output_name)
+{
+  const char * node_name = rcl_node_get_name(resolver->node);
+  const char * node_namespace = rcl_node_get_namespace(resolver->node);
+  rcl_allocator_t allocator = resolver->allocator;
+  char * expanded_name = NULL;
+  rcl_ret_t ret = rcl_expand_topic_name(
+    input_name, node_name, node_namespace, &resolver->substitutions, allocator, &expanded_name);
+  if (ret != RCL_RET_OK) {
+    if (ret == RCL_RET_TOPIC_NAME_INVALID || ret == RCL_RET_UNKNOWN_SUBSTITUTION) {
+      return RCL_RET_TOPIC_NAME_INVALID;
+    }
+    return RCL_RET_BAD_ALLOC == ret ? ret : RCL_RET_ERROR;
+  }
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Expanded name '%s'", expanded_name);
+
+  const rcl_remap_t * rule = NULL;
+  for (size_t i = 0u; i < resolver->rule_count && NULL == rule; ++i) {
+    const rcl_name_resolver_rule_t * resolver_rule = &resolver->rules[i];
+    if (RCL_RET_OK != resolver_rule->ret) {
+      if (
+        RCL_RET_NODE_INVALID_NAMESPACE == resolver_rule->ret ||
+        RCL_RET_NODE_INVALID_NAME == resolver_rule->ret ||
+        RCL_RET_BAD_ALLOC == resolver_rule->ret)
+      {
+        // These stop the rules from being applied, like they do in rcl_remap_topic_name().
+        allocator.deallocate(expanded_name, allocator.state);
+        return RCL_RET_BAD_ALLOC == resolver_rule->ret ? RCL_RET_BAD_ALLOC : RCL_RET_ERROR;
+      }
+      continue;
+    }
+    if (0 == strcmp(resolver_rule->expanded_match, expanded_name)) {
+      rule = resolver_rule->rule;
+    }
+  }
+  char * remapped_name = expanded_name;
+  if (NULL != rule) {
+    // The replacement needs to be expanded to a fully qualified name too.
+    remapped_name = NULL;
+    ret = rcl_expand_topic_name(
+      rule->replacement, node_name, node_namespace, &resolver->substitutions, allocator,
+      &remapped_name);
+    allocator.deallocate(expanded_name, allocator.state);
+    if (RCL_RET_OK != ret) {
+      return RCL_RET_BAD_ALLOC == ret ? ret : RCL_RET_ERROR;
+    }
+  }
+
+  // Validate the remapped name.
+  int validation_result;
+  rmw_ret_t rmw_ret = rmw_validate_full_topic_name(remapped_name, &validation_result, NULL);
+  if (rmw_ret != RMW_RET_OK) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+    ret = RCL_RET_ERROR;
+  } else if (validation_result != RMW_TOPIC_VALID) {
+    RCL_SET_ERROR_MSG(rmw_full_topic_name_validation_result_string(validation_result));
+    ret = RCL_RET_TOPIC_NAME_INVALID;
+  }
+  if (RCL_RET_OK != ret) {
+    allocator.deallocate(remapped_name, allocator.state);
+    return ret;
+  }
+  *output_name = remapped_name;
+  return RCL_RET_OK;
+}
+
+// Return the chain of a name, picked with its FNV-1a hash.
+static rcl_resolved_name_t **
+__resolved_name_cache_chain(rcl_resolved_name_cache_t * cache, bool is_service, const char * name)
+{
+  uint32_t hash = 2166136261u;
+  for (; '\0' != *name; ++name) {
+    hash = (hash ^ (uint8_t)*name) * 16777619u;
+  }
+  rcl_resolved_name_t ** chains = is_service ? cache->service_names : cache->topic_names;
+  return &chains[hash % RCL_RESOLVED_NAME_CACHE_BUCKET_COUNT];
+}
+
+// Find a name in a chain, the lock must be held.
+static const char *
+__resolved_name_cache_find(const rcl_resolved_name_t * entry, const char * name)
+{
+  for (; NULL != entry; entry = entry->next) {
+    if (0 == strcmp(entry->name, name)) {
+      return entry->resolved_name;
+    }
+  }
+  return NULL;
+}
+
+// Return the cached resolved name, or `NULL`.
+static const char *
+__resolved_name_cache_get(rcl_resolved_name_cache_t * cache, bool is_service, const char * name)
+{
+  rcl_resolved_name_t ** chain = __resolved_name_cache_chain(cache, is_service, name);
+  rcl_spin_lock_acquire(&cache->lock);
+  // Names are never removed, so they outlive the lock.
+  const char * resolved_name = __resolved_name_cache_find(*chain, name);
+  rcl_spin_lock_release(&cache->lock);
+  return resolved_name;
+}
+
+// Add a resolved name, which the cache takes, unless another thread added it meanwhile, and
+// return the cached one.
+static rcl_ret_t
+__resolved_name_cache_add(
+  rcl_resolved_name_cache_t * cache,
+  bool is_service,
+  const char * name,
+  char * resolved_name,
+  const char ** cached_name)
+{
+  rcl_allocator_t allocator = cache->allocator;
+  // The entry is allocated before taking the lock, which is only held to link it in.
+  rcl_resolved_name_t * entry = allocator.allocate(sizeof(rcl_resolved_name_t), allocator.state);
+  char * name_copy = rcutils_strdup(name, allocator);
+  if (NULL == entry || NULL == name_copy) {
+    allocator.deallocate(entry, allocator.state);
+    allocator.deallocate(name_copy, allocator.state);
+    allocator.deallocate(resolved_name, allocator.state);
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  entry->name = name_copy;
+  entry->resolved_name = resolved_name;
+  rcl_resolved_name_t ** chain = __resolved_name_cache_chain(cache, is_service, name);
+  rcl_spin_lock_acquire(&cache->lock);
+  *cached_name = __resolved_name_cache_find(*chain, name);
+  if (NULL == *cached_name) {
+    entry->next = *chain;
+    *chain = entry;
+    *cached_name = entry->resolved_name;
+    entry = NULL;
+  }
+  rcl_spin_lock_release(&cache->lock);
+  if (NULL != entry) {
+    __resolved_name_cache_fini_chain(entry, allocator);
+  }
+  return RCL_RET_OK;
+}
+
+// Resolve names which are not cached yet with a single resolver, and cache them.
+static rcl_ret_t
+__node_resolve_names(
+  const rcl_node_t * node,
+  const char * const * input_names,
+  size_t count,
+  bool is_service,
+  const char ** resolved_names)
+{
+  rcl_resolved_name_cache_t * cache = rcl_node_get_resolved_name_cache(node);
+  rcl_allocator_t allocator = rcl_node_get_options(node)->allocator;
+  rcl_name_resolver_t resolver;
+  bool resolver_initialized = false;
+  rcl_ret_t ret = RCL_RET_OK;
+  for (size_t i = 0u; i < count && RCL_RET_OK == ret; ++i) {
+    if (NULL == input_names[i]) {
+      RCL_SET_ERROR_MSG_WITH_FORMAT_STRING("name %zu is null", i);
+      ret = RCL_RET_INVALID_ARGUMENT;
+      break;
+    }
+    const char * resolved_name = __resolved_name_cache_get(cache, is_service, input_names[i]);
+    if (NULL == resolved_name) {
+      if (!resolver_initialized) {
+        ret = __resolver_init(&resolver, node, is_service, allocator);
+        if (RCL_RET_OK != ret) {
+          break;
+        }
+        resolver_initialized = true;
+      }
+      // Resolve without holding the lock, another thread may add the same name meanwhile.
+      char * output_name = NULL;
+      ret = __resolver_resolve(&resolver, input_names[i], &output_name);
+      if (RCL_RET_OK != ret) {
+        break;
+      }
+      ret = __resolved_name_cache_add(
+        cache, is_service, input_names[i], output_name, &resolved_name);
+    }
+    if (NULL != resolved_names) {
+      resolved_names[i] = resolved_name;
+    }
+  }
+  if (resolver_initialized) {
+    __resolver_fini(&resolver);
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_node_resolve_name(
+  const rcl_node_t * node,
+  const char * input_name,
+  bool is_service,
+  const char ** resolved_name)
+{
+  if (!rcl_node_is_valid(node)) {
+    return RCL_RET_NODE_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(input_name, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(resolved_name, RCL_RET_INVALID_ARGUMENT);
+  return __node_resolve_names(node, &input_name, 1u, is_service, resolved_name);
+}
+
+rcl_ret_t
+rcl_node_resolve_names(
+  const rcl_node_t * node,
+  const char * const * input_names,
+  size_t count,
+  bool is_service)
+{
+  if (!rcl_node_is_valid(node)) {
+    return RCL_RET_NODE_INVALID;  // error already set
+  }
+  if (0u == count) {
+    return RCL_RET_OK;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(input_names, RCL_RET_INVALID_ARGUMENT);
+  return __node_resolve_names(node, input_names, count, is_service, NULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
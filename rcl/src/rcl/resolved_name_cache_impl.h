@@ -0,0 +1,155 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__RESOLVED_NAME_CACHE_IMPL_H_
+#define RCL__RESOLVED_NAME_CACHE_IMPL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/node.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+#include "./spin_lock_impl.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// Number of chains names are spread over by their hash, for each kind of name.
+#define RCL_RESOLVED_NAME_CACHE_BUCKET_COUNT 64u
+
+/// \internal
+/// A name given to an entity of a node, and its resolved form.
+typedef struct rcl_resolved_name_t
+{
+  /// Next name in the same chain.
+  struct rcl_resolved_name_t * next;
+  char * name;
+  char * resolved_name;
+} rcl_resolved_name_t;
+
+/// \internal
+/// Names given to a node's entities mapped to their expanded, remapped and validated form.
+/**
+ * Everything a name resolves with, the node name and namespace, the
+ * substitutions and the remap rules, is fixed for the lifetime of the node,
+ * so resolved names are kept until the node is finalized.
+ * Topic and service names are kept apart, as they are remapped by different
+ * rules.
+ * Only names which resolved successfully are kept, so invalid names keep
+ * failing with a meaningful error.
+ * All functions but init and fini may be called concurrently.
+ */
+typedef struct rcl_resolved_name_cache_t
+{
+  /// Chains of the names of publishers and subscriptions.
+  rcl_resolved_name_t * topic_names[RCL_RESOLVED_NAME_CACHE_BUCKET_COUNT];
+  /// Chains of the names of services and clients.
+  rcl_resolved_name_t * service_names[RCL_RESOLVED_NAME_CACHE_BUCKET_COUNT];
+  /// Spin lock protecting the chains, only held to look a name up or link it in.
+  rcl_spin_lock_t lock;
+  rcl_allocator_t allocator;
+} rcl_resolved_name_cache_t;
+
+/// \internal
+/// Return a rcl_resolved_name_cache_t struct with members set to `NULL`.
+RCL_LOCAL
+rcl_resolved_name_cache_t
+rcl_get_zero_initialized_resolved_name_cache(void);
+
+/// \internal
+/// Initialize an empty resolved name cache, which cannot fail.
+/**
+ * Names are allocated with the given allocator once they are added.
+ */
+RCL_LOCAL
+void
+rcl_resolved_name_cache_init(rcl_resolved_name_cache_t * cache, rcl_allocator_t allocator);
+
+/// \internal
+/// Free every resolved name, calling it on a zero initialized cache does nothing.
+RCL_LOCAL
+void
+rcl_resolved_name_cache_fini(rcl_resolved_name_cache_t * cache);
+
+/// \internal
+/// Return the resolved name cache of a valid node.
+/**
+ * It is defined with the node, which owns the cache.
+ */
+RCL_LOCAL
+rcl_resolved_name_cache_t *
+rcl_node_get_resolved_name_cache(const rcl_node_t * node);
+
+/// \internal
+/// Resolve the name of a publisher, subscription, service or client of a node.
+/**
+ * The name is expanded with the default substitutions, remapped with the
+ * rules of the node and the global rules it uses, and then validated, unless
+ * it was already resolved for an entity of the same kind on this node.
+ *
+ * The resolved name is owned by the node and stays valid until it is
+ * finalized.
+ *
+ * \param[in] node the valid node of the entity
+ * \param[in] input_name the name given to the entity
+ * \param[in] is_service true for a service or client, false for a publisher or subscription
+ * \param[out] resolved_name the fully qualified name to create the entity with
+ * \return `RCL_RET_OK` if the name was resolved, or
+ * \return `RCL_RET_TOPIC_NAME_INVALID` if the name is invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_node_resolve_name(
+  const rcl_node_t * node,
+  const char * input_name,
+  bool is_service,
+  const char ** resolved_name);
+
+/// \internal
+/// Resolve and cache the names of many entities of a node at once.
+/**
+ * The substitutions and the remap rules are only set up once for every name
+ * not resolved yet, which rcl_node_resolve_name() then finds in the cache.
+ *
+ * \param[in] node the valid node of the entities
+ * \param[in] input_names the names given to the entities
+ * \param[in] count the number of names
+ * \param[in] is_service true for services or clients, false for publishers or subscriptions
+ * \return `RCL_RET_OK` if every name was resolved, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TOPIC_NAME_INVALID` if a name is invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_node_resolve_names(
+  const rcl_node_t * node,
+  const char * const * input_names,
+  size_t count,
+  bool is_service);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__RESOLVED_NAME_CACHE_IMPL_H_
@@ -0,0 +1,250 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "./serialized_message_pool_impl.h"
+
+#include <stdint.h>
+
+#include "rcl/error_handling.h"
+#include "rmw/serialized_message.h"
+
+rcl_serialized_message_pool_t
+rcl_get_zero_initialized_serialized_message_pool()
+{
+  static rcl_serialized_message_pool_t null_pool = {0};
+  return null_pool;
+}
+
+static size_t
+__serialized_message_pool_class_capacity(const rcl_serialized_message_pool_t * pool, size_t c)
+{
+  return pool->options.min_capacity << c;
+}
+
+// Smallest class whose buffers hold length bytes, or the largest class.
+static size_t
+__serialized_message_pool_class_for_length(
+  const rcl_serialized_message_pool_t * pool,
+  size_t length)
+{
+  size_t c = 0u;
+  while (c + 1u < pool->options.class_count &&
+    __serialized_message_pool_class_capacity(pool, c) < length)
+  {
+    ++c;
+  }
+  return c;
+}
+
+// Largest class whose buffers are not larger than capacity, or the smallest class.
+static size_t
+__serialized_message_pool_class_for_capacity(
+  const rcl_serialized_message_pool_t * pool,
+  size_t capacity)
+{
+  size_t c = 0u;
+  while (c + 1u < pool->options.class_count &&
+    __serialized_message_pool_class_capacity(pool, c + 1u) <= capacity)
+  {
+    ++c;
+  }
+  return c;
+}
+
+// Push a buffer on the free stack of its class, the lock must be held.
+static void
+__serialized_message_pool_push(rcl_serialized_message_pool_t * pool, size_t index)
+{
+  const size_t c =
+    __serialized_message_pool_class_for_capacity(pool, pool->buffers[index].buffer_capacity);
+  pool->free_indices[c * pool->buffer_count + pool->free_counts[c]++] = index;
+  pool->in_use[index] = false;
+}
+
+rcl_ret_t
+rcl_serialized_message_pool_init(
+  rcl_serialized_message_pool_t * pool,
+  const rcl_serialized_message_pool_options_t * options,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(pool, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  rcl_spin_lock_init(&pool->lock);
+  if (0u == options->buffers_per_class) {
+    return RCL_RET_OK;
+  }
+  if (0u == options->min_capacity || 0u == options->class_count ||
+    options->class_count > sizeof(size_t) * 8u ||
+    options->min_capacity > (SIZE_MAX >> (options->class_count - 1u)) ||
+    options->buffers_per_class > SIZE_MAX / options->class_count)
+  {
+    RCL_SET_ERROR_MSG("serialized message pool options need a min_capacity and class_count");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  const size_t buffer_count = options->class_count * options->buffers_per_class;
+  pool->options = *options;
+  pool->allocator = allocator;
+  pool->buffer_count = buffer_count;
+  pool->buffers =
+    allocator.zero_allocate(buffer_count, sizeof(rcl_serialized_message_t), allocator.state);
+  pool->in_use = allocator.zero_allocate(buffer_count, sizeof(bool), allocator.state);
+  pool->free_counts =
+    allocator.zero_allocate(options->class_count, sizeof(size_t), allocator.state);
+  pool->free_indices = NULL;
+  if (buffer_count <= SIZE_MAX / sizeof(size_t) / options->class_count) {
+    pool->free_indices = allocator.allocate(
+      options->class_count * buffer_count * sizeof(size_t), allocator.state);
+  }
+  if (NULL == pool->buffers || NULL == pool->in_use || NULL == pool->free_counts ||
+    NULL == pool->free_indices)
+  {
+    rcl_serialized_message_pool_fini(pool);
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  size_t i;
+  for (i = 0; i < buffer_count; ++i) {
+    const size_t c = i / options->buffers_per_class;
+    pool->buffers[i] = rmw_get_zero_initialized_serialized_message();
+    if (RCUTILS_RET_OK != rmw_serialized_message_init(
+        &pool->buffers[i], __serialized_message_pool_class_capacity(pool, c), &allocator))
+    {
+      rcl_serialized_message_pool_fini(pool);
+      RCL_SET_ERROR_MSG("allocating memory failed");
+      return RCL_RET_BAD_ALLOC;
+    }
+    __serialized_message_pool_push(pool, i);
+  }
+  return RCL_RET_OK;
+}
+
+void
+rcl_serialized_message_pool_fini(rcl_serialized_message_pool_t * pool)
+{
+  rcl_allocator_t allocator = pool->allocator;
+  if (NULL != pool->buffers) {
+    size_t i;
+    for (i = 0; i < pool->buffer_count; ++i) {
+      if (NULL != pool->buffers[i].buffer) {
+        (void)rmw_serialized_message_fini(&pool->buffers[i]);
+      }
+    }
+    allocator.deallocate(pool->buffers, allocator.state);
+  }
+  if (NULL != pool->in_use) {
+    allocator.deallocate(pool->in_use, allocator.state);
+  }
+  if (NULL != pool->free_indices) {
+    allocator.deallocate(pool->free_indices, allocator.state);
+  }
+  if (NULL != pool->free_counts) {
+    allocator.deallocate(pool->free_counts, allocator.state);
+  }
+  pool->buffers = NULL;
+  pool->in_use = NULL;
+  pool->free_indices = NULL;
+  pool->free_counts = NULL;
+  pool->buffer_count = 0u;
+}
+
+bool
+rcl_serialized_message_pool_is_enabled(const rcl_serialized_message_pool_t * pool)
+{
+  return NULL != pool->buffers;
+}
+
+rcl_ret_t
+rcl_serialized_message_pool_acquire(
+  rcl_serialized_message_pool_t * pool,
+  rcl_serialized_message_t ** serialized_message)
+{
+  if (!rcl_serialized_message_pool_is_enabled(pool)) {
+    RCL_SET_ERROR_MSG("the serialized message pool is not enabled");
+    return RCL_RET_UNSUPPORTED;
+  }
+  const size_t class_count = pool->options.class_count;
+  size_t index = SIZE_MAX;
+  rcl_spin_lock_acquire(&pool->lock);
+  size_t length = pool->window_max_length;
+  if (pool->previous_window_max_length > length) {
+    length = pool->previous_window_max_length;
+  }
+  const size_t fitting_class = __serialized_message_pool_class_for_length(pool, length);
+  // Prefer the fitting class, then larger ones, then smaller ones which the middleware may grow.
+  size_t i;
+  for (i = 0; i < class_count && SIZE_MAX == index; ++i) {
+    const size_t c = fitting_class + i < class_count ?
+      fitting_class + i : class_count - 1u - i;
+    if (pool->free_counts[c] > 0u) {
+      index = pool->free_indices[c * pool->buffer_count + --pool->free_counts[c]];
+      pool->in_use[index] = true;
+    }
+  }
+  rcl_spin_lock_release(&pool->lock);
+  if (SIZE_MAX == index) {
+    RCL_SET_ERROR_MSG("every buffer of the serialized message pool is in use");
+    return RCL_RET_BAD_ALLOC;
+  }
+  *serialized_message = &pool->buffers[index];
+  return RCL_RET_OK;
+}
+
+void
+rcl_serialized_message_pool_record_length(rcl_serialized_message_pool_t * pool, size_t length)
+{
+  rcl_spin_lock_acquire(&pool->lock);
+  if (length > pool->window_max_length) {
+    pool->window_max_length = length;
+  }
+  if (++pool->window_take_count == RCL_SERIALIZED_MESSAGE_POOL_WINDOW) {
+    pool->previous_window_max_length = pool->window_max_length;
+    pool->window_max_length = 0u;
+    pool->window_take_count = 0u;
+  }
+  rcl_spin_lock_release(&pool->lock);
+}
+
+rcl_ret_t
+rcl_serialized_message_pool_release(
+  rcl_serialized_message_pool_t * pool,
+  const rcl_serialized_message_t * serialized_message)
+{
+  bool released = false;
+  if (rcl_serialized_message_pool_is_enabled(pool) &&
+    serialized_message >= pool->buffers &&
+    serialized_message < pool->buffers + pool->buffer_count)
+  {
+    const size_t index = (size_t)(serialized_message - pool->buffers);
+    rcl_spin_lock_acquire(&pool->lock);
+    if (pool->in_use[index]) {
+      __serialized_message_pool_push(pool, index);
+      released = true;
+    }
+    rcl_spin_lock_release(&pool->lock);
+  }
+  if (!released) {
+    RCL_SET_ERROR_MSG("serialized message is not from the pool");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  return RCL_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
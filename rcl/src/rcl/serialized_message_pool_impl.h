@@ -0,0 +1,137 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__SERIALIZED_MESSAGE_POOL_IMPL_H_
+#define RCL__SERIALIZED_MESSAGE_POOL_IMPL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/subscription.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+#include "./spin_lock_impl.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// Number of takes over which the largest payload is remembered to pick a size class.
+#define RCL_SERIALIZED_MESSAGE_POOL_WINDOW 64u
+
+/// \internal
+/// Serialized messages of a subscription, in size classes of doubling capacity.
+/**
+ * Each buffer is filed in the largest class it has the capacity for, and a
+ * buffer which the middleware grew moves to a larger class when returned.
+ * Buffers are handed out from the class fitting the largest payload of the
+ * current and the previous window of takes, so that the middleware does not
+ * need to grow them once the payload sizes are known.
+ * All functions but init and fini may be called concurrently.
+ */
+typedef struct rcl_serialized_message_pool_t
+{
+  rcl_serialized_message_pool_options_t options;
+  /// `options.class_count * options.buffers_per_class` buffers, `NULL` if the pool is disabled.
+  rcl_serialized_message_t * buffers;
+  size_t buffer_count;
+  /// True for the buffers which are handed out.
+  bool * in_use;
+  /// One stack of free buffer indices per class, each with room for every buffer.
+  size_t * free_indices;
+  size_t * free_counts;
+  /// Largest payload of the current window of takes, and of the previous one.
+  size_t window_max_length;
+  size_t previous_window_max_length;
+  size_t window_take_count;
+  /// Spin lock protecting all of the above but the options.
+  rcl_spin_lock_t lock;
+  rcl_allocator_t allocator;
+} rcl_serialized_message_pool_t;
+
+/// \internal
+/// Return a rcl_serialized_message_pool_t struct which is disabled.
+RCL_LOCAL
+rcl_serialized_message_pool_t
+rcl_get_zero_initialized_serialized_message_pool(void);
+
+/// \internal
+/// Allocate the buffers of every class upfront, or leave the pool disabled.
+/**
+ * \param[inout] pool a zero initialized pool
+ * \param[in] options the pool options, the pool stays disabled without buffers_per_class
+ * \param[in] allocator allocator for the buffers
+ * \return `RCL_RET_OK` if the pool was initialized, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the options are invalid, or
+ * \return `RCL_RET_BAD_ALLOC` if allocating memory failed.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_serialized_message_pool_init(
+  rcl_serialized_message_pool_t * pool,
+  const rcl_serialized_message_pool_options_t * options,
+  rcl_allocator_t allocator);
+
+/// \internal
+/// Deallocate every buffer of the pool, including those handed out.
+RCL_LOCAL
+void
+rcl_serialized_message_pool_fini(rcl_serialized_message_pool_t * pool);
+
+/// \internal
+/// Return true if the pool hands out buffers.
+RCL_LOCAL
+bool
+rcl_serialized_message_pool_is_enabled(const rcl_serialized_message_pool_t * pool);
+
+/// \internal
+/// Hand out a free buffer, from the class fitting the recent payloads if possible.
+/**
+ * \return `RCL_RET_OK` if a buffer was handed out, or
+ * \return `RCL_RET_UNSUPPORTED` if the pool is disabled, or
+ * \return `RCL_RET_BAD_ALLOC` if every buffer is handed out.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_serialized_message_pool_acquire(
+  rcl_serialized_message_pool_t * pool,
+  rcl_serialized_message_t ** serialized_message);
+
+/// \internal
+/// Remember the length of a taken payload, to pick the class of the next buffers.
+RCL_LOCAL
+void
+rcl_serialized_message_pool_record_length(rcl_serialized_message_pool_t * pool, size_t length);
+
+/// \internal
+/// Take back a buffer, filing it by its current capacity.
+/**
+ * \return `RCL_RET_OK` if the buffer was taken back, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if the buffer is not handed out by the pool.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_serialized_message_pool_release(
+  rcl_serialized_message_pool_t * pool,
+  const rcl_serialized_message_t * serialized_message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__SERIALIZED_MESSAGE_POOL_IMPL_H_
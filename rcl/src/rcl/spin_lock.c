@@ -0,0 +1,76 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if defined(__linux__) && !defined(_POSIX_C_SOURCE)
+// For sched_yield, when compiling with strict ISO C.
+# define _POSIX_C_SOURCE 200112L
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "./spin_lock_impl.h"
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <sched.h>
+#endif
+
+// Attempts to get the lock before yielding, the critical sections are only a few loads long.
+#define RCL_SPIN_LOCK_SPIN_COUNT 64u
+
+void
+rcl_spin_lock_init(rcl_spin_lock_t * lock)
+{
+  atomic_init(&lock->locked, false);
+}
+
+void
+rcl_spin_lock_yield()
+{
+#if defined(_WIN32)
+  SwitchToThread();
+#else
+  sched_yield();
+#endif
+}
+
+void
+rcl_spin_lock_acquire(rcl_spin_lock_t * lock)
+{
+  unsigned int spin_count = 0u;
+  while (rcutils_atomic_exchange_bool(&lock->locked, true)) {
+    // Wait for the lock to look free before trying again, without writing to it meanwhile.
+    while (rcutils_atomic_load_bool(&lock->locked)) {
+      if (++spin_count < RCL_SPIN_LOCK_SPIN_COUNT) {
+        continue;
+      }
+      spin_count = 0u;
+      rcl_spin_lock_yield();
+    }
+  }
+}
+
+void
+rcl_spin_lock_release(rcl_spin_lock_t * lock)
+{
+  rcutils_atomic_store(&lock->locked, false);
+}
+
+#ifdef __cplusplus
+}
+#endif
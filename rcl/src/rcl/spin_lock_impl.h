@@ -0,0 +1,71 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__SPIN_LOCK_IMPL_H_
+#define RCL__SPIN_LOCK_IMPL_H_
+
+#include <stdbool.h>
+
+#include "rcl/visibility_control.h"
+#include "rcutils/stdatomic_helper.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// A lock for critical sections which only look entries up or move pointers.
+/**
+ * A thread waiting for the lock spins for a short while, and then yields the
+ * processor until it gets the lock, so that a thread which was preempted
+ * while holding it gets to release it.
+ *
+ * Neither the middleware nor the allocator may be called with the lock held,
+ * as other threads would wait for them without blocking.
+ */
+typedef struct rcl_spin_lock_t
+{
+  atomic_bool locked;
+} rcl_spin_lock_t;
+
+/// \internal
+/// Initialize a lock which is not held.
+RCL_LOCAL
+void
+rcl_spin_lock_init(rcl_spin_lock_t * lock);
+
+/// \internal
+/// Wait until the lock is not held, and hold it.
+RCL_LOCAL
+void
+rcl_spin_lock_acquire(rcl_spin_lock_t * lock);
+
+/// \internal
+/// Stop holding the lock.
+RCL_LOCAL
+void
+rcl_spin_lock_release(rcl_spin_lock_t * lock);
+
+/// \internal
+/// Yield the processor, to wait for a change which other threads make with the lock held.
+RCL_LOCAL
+void
+rcl_spin_lock_yield(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__SPIN_LOCK_IMPL_H_
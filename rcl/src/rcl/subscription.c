@@ -22,18 +22,41 @@ extern "C"
 #include <stdio.h>
 
 #include "./common.h"
+#include "./context_impl.h"
+#include "./intra_process_impl.h"
+#include "./loan_pool_impl.h"
+#include "./resolved_name_cache_impl.h"
+#include "./serialized_message_pool_impl.h"
+#include "./traffic_statistics_impl.h"
+#include "rcl/content_filter.h"
 #include "rcl/error_handling.h"
-#include "rcl/expand_topic_name.h"
-#include "rcl/remap.h"
 #include "rcutils/logging_macros.h"
+#include "rcutils/strdup.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
-#include "rmw/validate_full_topic_name.h"
+#include "rmw/serialized_message.h"
 
 typedef struct rcl_subscription_impl_t
 {
   rcl_subscription_options_t options;
   rmw_subscription_t * rmw_handle;
+  // Messages loaned out by rcl_take_loaned_message(), `NULL` if loaning is disabled.
+  rcl_loan_pool_t * loan_pool;
+  // Queue of the messages of intra process publishers, if the intra_process option is set.
+  rcl_intra_process_subscription_t intra_process;
+  // Buffers handed out by rcl_take_serialized_message_from_pool().
+  rcl_serialized_message_pool_t serialized_message_pool;
+  // Compiled content_filter option, zero initialized without one.
+  rcl_content_filter_t content_filter;
+  // Copy of the content_filter option, which the options point to.
+  char * content_filter_expression;
+  // Serialized message evaluated by the content filter before rcl_take() deserializes it.
+  rcl_serialized_message_t content_filter_buffer;
+  // True while a take uses the buffer, concurrent takes then use a buffer of their own.
+  atomic_bool content_filter_buffer_in_use;
+  const rosidl_message_type_support_t * type_support;
+  // Counters of the messages taken, if the traffic_statistics option is set.
+  rcl_traffic_statistics_counters_t traffic_statistics;
 } rcl_subscription_impl_t;
 
 rcl_subscription_t
@@ -43,6 +66,41 @@ rcl_get_zero_initialized_subscription()
   return null_subscription;
 }
 
+// Compile the content filter of a subscription whose impl is allocated.
+static rcl_ret_t
+__subscription_init_content_filter(rcl_subscription_impl_t * impl, const char * expression)
+{
+  rcl_allocator_t allocator = impl->options.allocator;
+  rcl_ret_t ret = rcl_content_filter_init(&impl->content_filter, expression, allocator);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  impl->content_filter_expression = rcutils_strdup(expression, allocator);
+  if (NULL == impl->content_filter_expression ||
+    rmw_serialized_message_init(&impl->content_filter_buffer, 0u, &allocator) != RMW_RET_OK)
+  {
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  impl->options.content_filter = impl->content_filter_expression;
+  return RCL_RET_OK;
+}
+
+// Release the content filter of a subscription, which may be partially initialized.
+static void
+__subscription_fini_content_filter(rcl_subscription_impl_t * impl)
+{
+  rcl_allocator_t allocator = impl->options.allocator;
+  (void)rcl_content_filter_fini(&impl->content_filter);
+  if (NULL != impl->content_filter_expression) {
+    allocator.deallocate(impl->content_filter_expression, allocator.state);
+    impl->content_filter_expression = NULL;
+  }
+  if (NULL != impl->content_filter_buffer.buffer) {
+    (void)rmw_serialized_message_fini(&impl->content_filter_buffer);
+  }
+}
+
 rcl_ret_t
 rcl_subscription_init(
   rcl_subscription_t * subscription,
@@ -57,6 +115,14 @@ rcl_subscription_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   rcl_allocator_t * allocator = (rcl_allocator_t *)&options->allocator;
   RCL_CHECK_ALLOCATOR_WITH_MSG(allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  if (options->intra_process && NULL == options->loan.create_message) {
+    RCL_SET_ERROR_MSG("intra process subscriptions need loan options");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (options->intra_process && NULL != options->content_filter) {
+    RCL_SET_ERROR_MSG("intra process messages are not serialized, so they cannot be filtered");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
   RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
   if (!rcl_node_is_valid(node)) {
     return RCL_RET_NODE_INVALID;  // error already set
@@ -69,124 +135,148 @@ rcl_subscription_init(
     RCL_SET_ERROR_MSG("subscription already initialized, or memory was uninitialized");
     return RCL_RET_ALREADY_INIT;
   }
-  // Expand the given topic name.
-  rcutils_allocator_t rcutils_allocator = *allocator;  // implicit conversion to rcutils version
-  rcutils_string_map_t substitutions_map = rcutils_get_zero_initialized_string_map();
-  rcutils_ret_t rcutils_ret = rcutils_string_map_init(&substitutions_map, 0, rcutils_allocator);
-  if (rcutils_ret != RCUTILS_RET_OK) {
-    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
-    if (RCUTILS_RET_BAD_ALLOC == rcutils_ret) {
-      return RCL_RET_BAD_ALLOC;
-    }
-    return RCL_RET_ERROR;
-  }
-  rcl_ret_t ret = rcl_get_default_topic_name_substitutions(&substitutions_map);
-  if (ret != RCL_RET_OK) {
-    rcutils_ret = rcutils_string_map_fini(&substitutions_map);
-    if (rcutils_ret != RCUTILS_RET_OK) {
-      RCUTILS_LOG_ERROR_NAMED(
-        ROS_PACKAGE_NAME,
-        "failed to fini string_map (%d) during error handling: %s",
-        rcutils_ret,
-        rcutils_get_error_string().str);
-    }
-    if (RCL_RET_BAD_ALLOC == ret) {
-      return ret;
-    }
-    return RCL_RET_ERROR;
-  }
-  char * expanded_topic_name = NULL;
-  char * remapped_topic_name = NULL;
-  ret = rcl_expand_topic_name(
-    topic_name,
-    rcl_node_get_name(node),
-    rcl_node_get_namespace(node),
-    &substitutions_map,
-    *allocator,
-    &expanded_topic_name);
-  rcutils_ret = rcutils_string_map_fini(&substitutions_map);
-  if (rcutils_ret != RCUTILS_RET_OK) {
-    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  if (ret != RCL_RET_OK) {
-    if (ret == RCL_RET_TOPIC_NAME_INVALID || ret == RCL_RET_UNKNOWN_SUBSTITUTION) {
-      ret = RCL_RET_TOPIC_NAME_INVALID;
-    } else {
-      ret = RCL_RET_ERROR;
-    }
-    goto cleanup;
-  }
-  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Expanded topic name '%s'", expanded_topic_name);
-
-  const rcl_node_options_t * node_options = rcl_node_get_options(node);
-  if (NULL == node_options) {
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  rcl_arguments_t * global_args = NULL;
-  if (node_options->use_global_arguments) {
-    global_args = &(node->context->global_arguments);
-  }
-  ret = rcl_remap_topic_name(
-    &(node_options->arguments), global_args, expanded_topic_name,
-    rcl_node_get_name(node), rcl_node_get_namespace(node), *allocator, &remapped_topic_name);
+  // Resolve the given topic name, which is only done once per name for the whole node.
+  const char * resolved_topic_name = NULL;
+  rcl_ret_t ret = rcl_node_resolve_name(node, topic_name, false, &resolved_topic_name);
   if (RCL_RET_OK != ret) {
-    goto fail;
-  } else if (NULL == remapped_topic_name) {
-    remapped_topic_name = expanded_topic_name;
-    expanded_topic_name = NULL;
-  }
-
-  // Validate the expanded topic name.
-  int validation_result;
-  rmw_ret_t rmw_ret = rmw_validate_full_topic_name(remapped_topic_name, &validation_result, NULL);
-  if (rmw_ret != RMW_RET_OK) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
-    ret = RCL_RET_ERROR;
-    goto cleanup;
-  }
-  if (validation_result != RMW_TOPIC_VALID) {
-    RCL_SET_ERROR_MSG(rmw_full_topic_name_validation_result_string(validation_result));
-    ret = RCL_RET_TOPIC_NAME_INVALID;
-    goto cleanup;
+    return ret;  // error already set
   }
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Resolved topic name '%s'", resolved_topic_name);
   // Allocate memory for the implementation struct.
   subscription->impl = (rcl_subscription_impl_t *)allocator->allocate(
     sizeof(rcl_subscription_impl_t), allocator->state);
   RCL_CHECK_FOR_NULL_WITH_MSG(
     subscription->impl, "allocating memory failed", ret = RCL_RET_BAD_ALLOC; goto cleanup);
   // Fill out the implemenation struct.
+  // options
+  subscription->impl->options = *options;
+  subscription->impl->type_support = type_support;
+  rcl_traffic_statistics_counters_init(
+    &subscription->impl->traffic_statistics, options->traffic_statistics);
+  // content filter, compiled first so that an invalid expression creates no rmw subscription
+  subscription->impl->content_filter = rcl_get_zero_initialized_content_filter();
+  subscription->impl->content_filter_expression = NULL;
+  subscription->impl->content_filter_buffer = rmw_get_zero_initialized_serialized_message();
+  atomic_init(&subscription->impl->content_filter_buffer_in_use, false);
+  if (NULL != options->content_filter) {
+    ret = __subscription_init_content_filter(subscription->impl, options->content_filter);
+    if (RCL_RET_OK != ret) {
+      fail_ret = ret;
+      goto fail;
+    }
+  }
+  rmw_qos_profile_t qos = options->qos;
+  if (options->keep_latest) {
+    // A newer message replaces the one the middleware holds, before it is ever deserialized.
+    qos.history = RMW_QOS_POLICY_HISTORY_KEEP_LAST;
+    qos.depth = 1u;
+    // The options report the QoS the subscription was actually created with.
+    subscription->impl->options.qos = qos;
+  }
   // rmw_handle
   // TODO(wjwwood): pass allocator once supported in rmw api.
   subscription->impl->rmw_handle = rmw_create_subscription(
     rcl_node_get_rmw_handle(node),
     type_support,
-    remapped_topic_name,
-    &(options->qos),
+    resolved_topic_name,
+    &qos,
     options->ignore_local_publications);
   if (!subscription->impl->rmw_handle) {
     RCL_SET_ERROR_MSG(rmw_get_error_string().str);
     goto fail;
   }
-  // options
-  subscription->impl->options = *options;
+  // loaned messages
+  subscription->impl->intra_process = rcl_get_zero_initialized_intra_process_subscription();
+  subscription->impl->serialized_message_pool = rcl_get_zero_initialized_serialized_message_pool();
+  ret = rcl_loan_pool_init(&subscription->impl->loan_pool, &options->loan, *allocator);
+  // intra process registration
+  if (RCL_RET_OK == ret && options->intra_process) {
+    ret = rcl_intra_process_subscription_init(
+      &subscription->impl->intra_process, &node->context->impl->intra_process,
+      subscription->impl->rmw_handle->topic_name, type_support, qos.depth,
+      node->context, *allocator);
+    if (RCL_RET_OK != ret) {
+      rcl_loan_pool_fini(subscription->impl->loan_pool);
+    }
+  }
+  // serialized message pool
+  if (RCL_RET_OK == ret) {
+    ret = rcl_serialized_message_pool_init(
+      &subscription->impl->serialized_message_pool, &options->serialized_message_pool,
+      *allocator);
+    if (RCL_RET_OK != ret) {
+      if (rcl_intra_process_subscription_fini(&subscription->impl->intra_process) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "%s", rcl_get_error_string().str);
+      }
+      rcl_loan_pool_fini(subscription->impl->loan_pool);
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    fail_ret = ret;
+    if (rmw_destroy_subscription(
+        rcl_node_get_rmw_handle(node), subscription->impl->rmw_handle) != RMW_RET_OK)
+    {
+      RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "%s", rmw_get_error_string().str);
+    }
+    goto fail;
+  }
   RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription initialized");
   ret = RCL_RET_OK;
   goto cleanup;
 fail:
   if (subscription->impl) {
+    __subscription_fini_content_filter(subscription->impl);
     allocator->deallocate(subscription->impl, allocator->state);
   }
   ret = fail_ret;
   // Fall through to cleanup
 cleanup:
-  if (NULL != expanded_topic_name) {
-    allocator->deallocate(expanded_topic_name, allocator->state);
+  return ret;
+}
+
+rcl_ret_t
+rcl_subscriptions_init_bulk(
+  rcl_subscription_t * subscriptions,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * const * type_supports,
+  const char * const * topic_names,
+  const rcl_subscription_options_t * options,
+  size_t count)
+{
+  if (!rcl_node_is_valid(node)) {
+    return RCL_RET_NODE_INVALID;  // error already set
+  }
+  if (0u == count) {
+    return RCL_RET_OK;
   }
-  if (NULL != remapped_topic_name) {
-    allocator->deallocate(remapped_topic_name, allocator->state);
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscriptions, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(type_supports, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(topic_names, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  // Every subscription then finds its name in the cache of the node.
+  rcl_ret_t ret = rcl_node_resolve_names(node, topic_names, count, false);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  size_t i;
+  for (i = 0u; i < count; ++i) {
+    ret = rcl_subscription_init(
+      &subscriptions[i], node, type_supports[i], topic_names[i], &options[i]);
+    if (RCL_RET_OK != ret) {
+      break;
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    // Finalize the subscriptions initialized before the one which failed.
+    while (i-- > 0u) {
+      if (rcl_subscription_fini(&subscriptions[i], (rcl_node_t *)node) != RCL_RET_OK) {
+        RCUTILS_LOG_ERROR_NAMED(
+          ROS_PACKAGE_NAME, "failed to fini subscription during error handling: %s",
+          rcl_get_error_string().str);
+      }
+      // Left zero initialized, so that the subscriptions can be initialized again.
+      subscriptions[i] = rcl_get_zero_initialized_subscription();
+    }
   }
   return ret;
 }
@@ -212,6 +302,12 @@ rcl_subscription_fini(rcl_subscription_t * subscription, rcl_node_t * node)
       RCL_SET_ERROR_MSG(rmw_get_error_string().str);
       result = RCL_RET_ERROR;
     }
+    if (rcl_intra_process_subscription_fini(&subscription->impl->intra_process) != RCL_RET_OK) {
+      result = RCL_RET_ERROR;  // error already set
+    }
+    rcl_serialized_message_pool_fini(&subscription->impl->serialized_message_pool);
+    rcl_loan_pool_fini(subscription->impl->loan_pool);
+    __subscription_fini_content_filter(subscription->impl);
     allocator.deallocate(subscription->impl, allocator.state);
   }
   RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription finalized");
@@ -231,21 +327,97 @@ rcl_subscription_get_default_options()
   return default_options;
 }
 
-rcl_ret_t
-rcl_take(
+// Return true, and set the error, if the subscription only takes loaned messages.
+static bool
+__subscription_is_intra_process(const rcl_subscription_t * subscription)
+{
+  if (NULL == subscription->impl->intra_process.registry) {
+    return false;
+  }
+  RCL_SET_ERROR_MSG("intra process subscriptions only take loaned messages");
+  return true;
+}
+
+// Take a serialized message from the middleware, the arguments are checked by the caller.
+// Messages rejected by the content filter of the subscription are skipped.
+static rcl_ret_t
+__subscription_take_serialized(
   const rcl_subscription_t * subscription,
-  void * ros_message,
+  rcl_serialized_message_t * serialized_message,
   rmw_message_info_t * message_info)
 {
-  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription taking message");
-  if (!rcl_subscription_is_valid(subscription)) {
-    return RCL_RET_SUBSCRIPTION_INVALID;  // error message already set
+  // If message_info is NULL, use a place holder which can be discarded.
+  rmw_message_info_t dummy_message_info;
+  rmw_message_info_t * message_info_local = message_info ? message_info : &dummy_message_info;
+  const rcl_content_filter_t * content_filter = &subscription->impl->content_filter;
+  bool accepted = false;
+  while (!accepted) {
+    // Call rmw_take_with_info.
+    bool taken = false;
+    rmw_ret_t ret = rmw_take_serialized_message_with_info(
+      subscription->impl->rmw_handle, serialized_message, &taken, message_info_local);
+    if (ret != RMW_RET_OK) {
+      RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+      if (RMW_RET_BAD_ALLOC == ret) {
+        return RCL_RET_BAD_ALLOC;
+      }
+      return RCL_RET_ERROR;
+    }
+    RCUTILS_LOG_DEBUG_NAMED(
+      ROS_PACKAGE_NAME, "Subscription serialized take succeeded: %s", taken ? "true" : "false");
+    if (!taken) {
+      return RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+    }
+    accepted = NULL == content_filter->impl;
+    if (!accepted &&
+      rcl_content_filter_evaluate(content_filter, serialized_message, &accepted) != RCL_RET_OK)
+    {
+      return RCL_RET_ERROR;  // error already set
+    }
   }
-  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  return RCL_RET_OK;
+}
 
+// Take a message from the middleware, the arguments are checked by the caller.
+// With a content filter, only the serialized messages it accepts are deserialized.
+static rcl_ret_t
+__subscription_take(
+  const rcl_subscription_t * subscription,
+  void * ros_message,
+  rmw_message_info_t * message_info)
+{
   // If message_info is NULL, use a place holder which can be discarded.
   rmw_message_info_t dummy_message_info;
   rmw_message_info_t * message_info_local = message_info ? message_info : &dummy_message_info;
+  if (NULL != subscription->impl->content_filter.impl) {
+    // Nothing is held across the middleware calls, a concurrent take gets a buffer of its own.
+    rcl_serialized_message_t * buffer = &subscription->impl->content_filter_buffer;
+    rcl_serialized_message_t own_buffer = rmw_get_zero_initialized_serialized_message();
+    const bool shared =
+      !rcutils_atomic_exchange_bool(&subscription->impl->content_filter_buffer_in_use, true);
+    if (!shared) {
+      rcl_allocator_t allocator = subscription->impl->options.allocator;
+      if (rmw_serialized_message_init(&own_buffer, 0u, &allocator) != RMW_RET_OK) {
+        RCL_SET_ERROR_MSG("allocating memory failed");
+        return RCL_RET_BAD_ALLOC;
+      }
+      buffer = &own_buffer;
+    }
+    rcl_ret_t rcl_ret = __subscription_take_serialized(subscription, buffer, message_info_local);
+    if (RCL_RET_OK == rcl_ret) {
+      rmw_ret_t ret = rmw_deserialize(buffer, subscription->impl->type_support, ros_message);
+      if (ret != RMW_RET_OK) {
+        RCL_SET_ERROR_MSG(rmw_get_error_string().str);
+        rcl_ret = RMW_RET_BAD_ALLOC == ret ? RCL_RET_BAD_ALLOC : RCL_RET_ERROR;
+      }
+    }
+    if (shared) {
+      rcutils_atomic_store(&subscription->impl->content_filter_buffer_in_use, false);
+    } else {
+      (void)rmw_serialized_message_fini(&own_buffer);
+    }
+    return rcl_ret;  // error already set, unless nothing was taken
+  }
   // Call rmw_take_with_info.
   bool taken = false;
   rmw_ret_t ret =
@@ -265,6 +437,176 @@ rcl_take(
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_take(
+  const rcl_subscription_t * subscription,
+  void * ros_message,
+  rmw_message_info_t * message_info)
+{
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription taking message");
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error message already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  if (__subscription_is_intra_process(subscription)) {
+    return RCL_RET_UNSUPPORTED;  // error message already set
+  }
+  rcl_ret_t ret = __subscription_take(subscription, ros_message, message_info);
+  rcl_traffic_statistics_count_take(&subscription->impl->traffic_statistics, ret, 0u);
+  return ret;
+}
+
+rcl_ret_t
+rcl_take_sequence(
+  const rcl_subscription_t * subscription,
+  size_t count,
+  rcl_message_sequence_t * message_sequence,
+  rcl_message_info_sequence_t * message_info_sequence,
+  size_t * taken)
+{
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription taking %zu messages", count);
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error message already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(message_sequence, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(taken, RCL_RET_INVALID_ARGUMENT);
+  if (__subscription_is_intra_process(subscription)) {
+    return RCL_RET_UNSUPPORTED;  // error message already set
+  }
+  if (count > message_sequence->capacity) {
+    RCL_SET_ERROR_MSG("message sequence capacity is smaller than count");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (NULL != message_info_sequence && count > message_info_sequence->capacity) {
+    RCL_SET_ERROR_MSG("message info sequence capacity is smaller than count");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      message_sequence->data[i], "message sequence entry is null",
+      return RCL_RET_INVALID_ARGUMENT);
+  }
+
+  *taken = 0u;
+  message_sequence->size = 0u;
+  if (NULL != message_info_sequence) {
+    message_info_sequence->size = 0u;
+  }
+  rcl_ret_t ret = RCL_RET_OK;
+  while (*taken < count) {
+    rmw_message_info_t * message_info_local = message_info_sequence ?
+      &message_info_sequence->data[*taken] : NULL;
+    ret = __subscription_take(subscription, message_sequence->data[*taken], message_info_local);
+    if (RCL_RET_OK != ret) {
+      break;
+    }
+    ++*taken;
+  }
+  message_sequence->size = *taken;
+  if (NULL != message_info_sequence) {
+    message_info_sequence->size = *taken;
+  }
+  rcl_traffic_statistics_count_messages(&subscription->impl->traffic_statistics, *taken, 0u);
+  if (0u == *taken) {
+    rcl_traffic_statistics_count_take(&subscription->impl->traffic_statistics, ret, 0u);
+  }
+  if (RCL_RET_OK != ret && RCL_RET_SUBSCRIPTION_TAKE_FAILED != ret) {
+    return ret;  // error already set
+  }
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription took %zu messages", *taken);
+  if (0u == *taken) {
+    return RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+  }
+  return RCL_RET_OK;
+}
+
+bool
+rcl_subscription_can_loan_messages(const rcl_subscription_t * subscription)
+{
+  if (!rcl_subscription_is_valid(subscription)) {
+    return false;  // error message already set
+  }
+  return rcl_loan_pool_is_enabled(subscription->impl->loan_pool);
+}
+
+rcl_ret_t
+rcl_take_loaned_message(
+  const rcl_subscription_t * subscription,
+  void ** loaned_message,
+  rmw_message_info_t * message_info)
+{
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription taking loaned message");
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error message already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(loaned_message, RCL_RET_INVALID_ARGUMENT);
+  rcl_intra_process_subscription_t * intra_process = &subscription->impl->intra_process;
+  rcl_traffic_statistics_counters_t * traffic_statistics = &subscription->impl->traffic_statistics;
+  bool is_intra_process = NULL != intra_process->registry;
+  rcutils_time_point_value_t publish_time;
+  if (is_intra_process && rcl_intra_process_take(
+      intra_process, loaned_message, message_info, &publish_time) == RCL_RET_OK)
+  {
+    rcl_traffic_statistics_count_take(traffic_statistics, RCL_RET_OK, 0u);
+    rcutils_time_point_value_t now;
+    if (traffic_statistics->enabled && rcutils_steady_time_now(&now) == RCUTILS_RET_OK) {
+      rcl_traffic_statistics_count_latency(traffic_statistics, now - publish_time);
+    }
+    return RCL_RET_OK;
+  }
+  void * ros_message = NULL;
+  rcl_ret_t ret = rcl_loan_pool_borrow(subscription->impl->loan_pool, &ros_message);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error message already set
+  }
+  // The message info is needed to drop the messages which were queued already.
+  rmw_message_info_t dummy_message_info;
+  rmw_message_info_t * message_info_local = message_info ? message_info : &dummy_message_info;
+  do {
+    ret = __subscription_take(subscription, ros_message, message_info_local);
+  } while (RCL_RET_OK == ret && is_intra_process &&
+    rcl_intra_process_is_local_publisher(intra_process, &message_info_local->publisher_gid));
+  rcl_traffic_statistics_count_take(traffic_statistics, ret, 0u);
+  if (RCL_RET_OK != ret) {
+    (void)rcl_loan_pool_return(subscription->impl->loan_pool, ros_message);
+    return ret;  // error message already set, unless nothing was taken
+  }
+  *loaned_message = ros_message;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_return_loaned_message_from_subscription(
+  const rcl_subscription_t * subscription,
+  void * loaned_message)
+{
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error message already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(loaned_message, RCL_RET_INVALID_ARGUMENT);
+  rcl_intra_process_subscription_t * intra_process = &subscription->impl->intra_process;
+  if (NULL == intra_process->registry ||
+    rcl_loan_pool_is_on_loan(subscription->impl->loan_pool, loaned_message))
+  {
+    return rcl_loan_pool_return(subscription->impl->loan_pool, loaned_message);
+  }
+  return rcl_intra_process_return(intra_process, loaned_message);
+}
+
+const rcl_guard_condition_t *
+rcl_subscription_get_intra_process_guard_condition(const rcl_subscription_t * subscription)
+{
+  if (!rcl_subscription_is_valid(subscription)) {
+    return NULL;  // error already set
+  }
+  if (NULL == subscription->impl->intra_process.registry) {
+    RCL_SET_ERROR_MSG("subscription is not an intra process subscription");
+    return NULL;
+  }
+  return &subscription->impl->intra_process.guard_condition;
+}
+
 rcl_ret_t
 rcl_take_serialized_message(
   const rcl_subscription_t * subscription,
@@ -276,28 +618,62 @@ rcl_take_serialized_message(
     return RCL_RET_SUBSCRIPTION_INVALID;  // error already set
   }
   RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
-  // If message_info is NULL, use a place holder which can be discarded.
-  rmw_message_info_t dummy_message_info;
-  rmw_message_info_t * message_info_local = message_info ? message_info : &dummy_message_info;
-  // Call rmw_take_with_info.
-  bool taken = false;
-  rmw_ret_t ret = rmw_take_serialized_message_with_info(
-    subscription->impl->rmw_handle, serialized_message, &taken, message_info_local);
-  if (ret != RMW_RET_OK) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string().str);
-    if (RMW_RET_BAD_ALLOC == ret) {
-      return RCL_RET_BAD_ALLOC;
-    }
-    return RCL_RET_ERROR;
+  if (__subscription_is_intra_process(subscription)) {
+    return RCL_RET_UNSUPPORTED;  // error already set
   }
-  RCUTILS_LOG_DEBUG_NAMED(
-    ROS_PACKAGE_NAME, "Subscription serialized take succeeded: %s", taken ? "true" : "false");
-  if (!taken) {
-    return RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+  rcl_ret_t ret = __subscription_take_serialized(subscription, serialized_message, message_info);
+  rcl_traffic_statistics_count_take(
+    &subscription->impl->traffic_statistics, ret,
+    RCL_RET_OK == ret ? serialized_message->buffer_length : 0u);
+  return ret;
+}
+
+rcl_ret_t
+rcl_take_serialized_message_from_pool(
+  const rcl_subscription_t * subscription,
+  rcl_serialized_message_t ** serialized_message,
+  rmw_message_info_t * message_info)
+{
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Subscription taking pooled serialized message");
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error already set
   }
+  RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  if (__subscription_is_intra_process(subscription)) {
+    return RCL_RET_UNSUPPORTED;  // error already set
+  }
+  rcl_serialized_message_pool_t * pool = &subscription->impl->serialized_message_pool;
+  rcl_serialized_message_t * buffer = NULL;
+  rcl_ret_t ret = rcl_serialized_message_pool_acquire(pool, &buffer);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  ret = __subscription_take_serialized(subscription, buffer, message_info);
+  rcl_traffic_statistics_count_take(
+    &subscription->impl->traffic_statistics, ret,
+    RCL_RET_OK == ret ? buffer->buffer_length : 0u);
+  if (RCL_RET_OK != ret) {
+    (void)rcl_serialized_message_pool_release(pool, buffer);
+    return ret;  // error already set, unless nothing was taken
+  }
+  rcl_serialized_message_pool_record_length(pool, buffer->buffer_length);
+  *serialized_message = buffer;
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_return_serialized_message_to_pool(
+  const rcl_subscription_t * subscription,
+  rcl_serialized_message_t * serialized_message)
+{
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  return rcl_serialized_message_pool_release(
+    &subscription->impl->serialized_message_pool, serialized_message);
+}
+
 const char *
 rcl_subscription_get_topic_name(const rcl_subscription_t * subscription)
 {
@@ -357,6 +733,29 @@ rcl_subscription_get_publisher_count(
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_subscription_get_traffic_statistics(
+  const rcl_subscription_t * subscription,
+  rcl_traffic_statistics_t * statistics)
+{
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error already set
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  return rcl_traffic_statistics_counters_load(
+    &subscription->impl->traffic_statistics, statistics);
+}
+
+rcl_ret_t
+rcl_subscription_add_latency_sample(const rcl_subscription_t * subscription, int64_t latency)
+{
+  if (!rcl_subscription_is_valid(subscription)) {
+    return RCL_RET_SUBSCRIPTION_INVALID;  // error already set
+  }
+  rcl_traffic_statistics_count_latency(&subscription->impl->traffic_statistics, latency);
+  return RCL_RET_OK;
+}
+
 #ifdef __cplusplus
 }
 #endif
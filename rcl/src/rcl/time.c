@@ -14,10 +14,12 @@
 
 #include "rcl/time.h"
 
+#include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
 #include "./common.h"
+#include "./time_impl.h"
 #include "rcl/allocator.h"
 #include "rcl/error_handling.h"
 #include "rcutils/stdatomic_helper.h"
@@ -55,6 +57,24 @@ rcl_init_generic_clock(rcl_clock_t * clock)
   clock->num_jump_callbacks = 0u;
   clock->get_now = NULL;
   clock->data = NULL;
+  // ensure assumption about static storage
+  static_assert(
+    sizeof(clock->schedule_epoch_storage) >= sizeof(atomic_uint_least64_t),
+    "expected rcl_clock_t's schedule epoch storage to be >= size of atomic_uint_least64_t");
+  atomic_init((atomic_uint_least64_t *)(&clock->schedule_epoch_storage), 0);
+}
+
+uint64_t
+rcl_clock_get_schedule_epoch(const rcl_clock_t * clock)
+{
+  return rcutils_atomic_load_uint64_t((atomic_uint_least64_t *)(&clock->schedule_epoch_storage));
+}
+
+void
+rcl_clock_reschedule(rcl_clock_t * clock)
+{
+  rcutils_atomic_fetch_add_uint64_t(
+    (atomic_uint_least64_t *)(&clock->schedule_epoch_storage), 1);
 }
 
 // The function used to get the current ros time.
@@ -0,0 +1,54 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TIME_IMPL_H_
+#define RCL__TIME_IMPL_H_
+
+#include <stdint.h>
+
+#include "rcl/time.h"
+#include "rcl/visibility_control.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// Return a counter which changes whenever the next call time of a timer using the clock may
+/// have moved back.
+/**
+ * The next call time of a timer only moves forward when it is called, so a
+ * schedule of the timers using a clock, ordered by next call time, stays a
+ * valid lower bound until this counter changes, e.g. because one of them was
+ * reset or the clock jumped.
+ * It may also change for timers which are not part of the schedule.
+ *
+ * \param[in] clock a valid clock
+ */
+RCL_LOCAL
+uint64_t
+rcl_clock_get_schedule_epoch(const rcl_clock_t * clock);
+
+/// \internal
+/// Change the schedule epoch of the clock, as the next call time of one of its timers moved back.
+RCL_LOCAL
+void
+rcl_clock_reschedule(rcl_clock_t * clock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TIME_IMPL_H_
@@ -26,14 +26,20 @@ extern "C"
 #include "rcutils/stdatomic_helper.h"
 #include "rcutils/time.h"
 
+#include "./time_impl.h"
+#include "./timer_fd_impl.h"
+#include "./timer_impl.h"
+
 typedef struct rcl_timer_impl_t
 {
   // The clock providing time.
   rcl_clock_t * clock;
   // The associated context.
   rcl_context_t * context;
-  // A guard condition used to wake a wait set if using ROSTime, else zero initialized.
+  // A guard condition used to wake a wait set if using ROSTime or a timerfd, else zero initialized.
   rcl_guard_condition_t guard_condition;
+  // Kernel timer triggering the guard condition, see rcl_timer_enable_timerfd().
+  rcl_timer_fd_t timer_fd;
   // The user supplied callback.
   atomic_uintptr_t callback;
   // This is a duration in nanoseconds.
@@ -42,10 +48,24 @@ typedef struct rcl_timer_impl_t
   atomic_int_least64_t last_call_time;
   // This is a time in nanoseconds since an unspecified time.
   atomic_int_least64_t next_call_time;
+  // Duration after the next call time within which the timer may be called, in nanoseconds.
+  atomic_int_least64_t slack;
+  // Dispatch priority, and deadline after the next call time in nanoseconds.
+  atomic_int_least64_t dispatch_priority;
+  atomic_int_least64_t dispatch_deadline;
   // Credit for time elapsed before ROS time is activated or deactivated.
   atomic_int_least64_t time_credit;
   // A flag which indicates if the timer is canceled.
   atomic_bool canceled;
+  // Call statistics, lateness in nanoseconds.
+  atomic_uint_least64_t call_count;
+  atomic_uint_least64_t missed_period_count;
+  atomic_uint_least64_t lateness_sum;
+  atomic_uint_least64_t min_lateness;
+  atomic_uint_least64_t max_lateness;
+  // Width of the lateness histogram buckets, 0 if the histogram is disabled.
+  atomic_uint_least64_t histogram_bucket_width;
+  atomic_uint_least64_t histogram[RCL_TIMER_LATENESS_HISTOGRAM_SIZE];
   // The user supplied allocator.
   rcl_allocator_t allocator;
 } rcl_timer_impl_t;
@@ -104,6 +124,7 @@ void _rcl_timer_time_jump(
         // set times in new epoch so timer only waits the remainder of the period
         rcutils_atomic_store(&timer->impl->next_call_time, now - time_credit + period);
         rcutils_atomic_store(&timer->impl->last_call_time, now - time_credit);
+        rcl_clock_reschedule(timer->impl->clock);
       }
     } else if (next_call_time <= now) {
       // Post Forward jump and timer is ready
@@ -116,6 +137,7 @@ void _rcl_timer_time_jump(
       // next callback should happen after 1 period
       rcutils_atomic_store(&timer->impl->next_call_time, now + period);
       rcutils_atomic_store(&timer->impl->last_call_time, now);
+      rcl_clock_reschedule(timer->impl->clock);
       return;
     }
   }
@@ -152,6 +174,7 @@ rcl_timer_init(
   impl.clock = clock;
   impl.context = context;
   impl.guard_condition = rcl_get_zero_initialized_guard_condition();
+  impl.timer_fd = rcl_get_zero_initialized_timer_fd();
   if (RCL_ROS_TIME == impl.clock->type) {
     rcl_guard_condition_options_t options = rcl_guard_condition_get_default_options();
     rcl_ret_t ret = rcl_guard_condition_init(&(impl.guard_condition), context, options);
@@ -174,10 +197,23 @@ rcl_timer_init(
   }
   atomic_init(&impl.callback, (uintptr_t)callback);
   atomic_init(&impl.period, period);
+  atomic_init(&impl.slack, 0);
+  atomic_init(&impl.dispatch_priority, 0);
+  atomic_init(&impl.dispatch_deadline, 0);
   atomic_init(&impl.time_credit, 0);
   atomic_init(&impl.last_call_time, now);
   atomic_init(&impl.next_call_time, now + period);
   atomic_init(&impl.canceled, false);
+  atomic_init(&impl.call_count, 0);
+  atomic_init(&impl.missed_period_count, 0);
+  atomic_init(&impl.lateness_sum, 0);
+  atomic_init(&impl.min_lateness, UINT64_MAX);
+  atomic_init(&impl.max_lateness, 0);
+  atomic_init(&impl.histogram_bucket_width, 0);
+  size_t i;
+  for (i = 0; i < RCL_TIMER_LATENESS_HISTOGRAM_SIZE; ++i) {
+    atomic_init(&impl.histogram[i], 0);
+  }
   impl.allocator = allocator;
   timer->impl = (rcl_timer_impl_t *)allocator.allocate(sizeof(rcl_timer_impl_t), allocator.state);
   if (NULL == timer->impl) {
@@ -206,7 +242,12 @@ rcl_timer_fini(rcl_timer_t * timer)
   // Will return either RCL_RET_OK or RCL_RET_ERROR since the timer is valid.
   rcl_ret_t result = rcl_timer_cancel(timer);
   rcl_allocator_t allocator = timer->impl->allocator;
-  rcl_ret_t fail_ret = rcl_guard_condition_fini(&(timer->impl->guard_condition));
+  // Stop the timerfd before its guard condition goes away.
+  rcl_ret_t fail_ret = rcl_timer_fd_fini(&(timer->impl->timer_fd));
+  if (RCL_RET_OK != fail_ret) {
+    RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to fini timerfd");
+  }
+  fail_ret = rcl_guard_condition_fini(&(timer->impl->guard_condition));
   if (RCL_RET_OK != fail_ret) {
     RCL_SET_ERROR_MSG("Failure to fini guard condition");
   }
@@ -233,6 +274,82 @@ rcl_timer_clock(rcl_timer_t * timer, rcl_clock_t ** clock)
   return RCL_RET_OK;
 }
 
+// Rearm the timerfd for the current next call time, if the timer is backed by one.
+// The time of the clock of the timer is given if the caller just read it, else `NULL`.
+static void
+__rcl_timer_update_timer_fd(rcl_timer_impl_t * impl, const rcl_time_point_value_t * now)
+{
+  if (impl->timer_fd.fd < 0) {
+    return;
+  }
+  rcl_ret_t ret = RCL_RET_OK;
+  if (rcutils_atomic_load_bool(&impl->canceled)) {
+    ret = rcl_timer_fd_disarm(&impl->timer_fd);
+  } else if (RCL_SYSTEM_TIME == impl->clock->type) {
+    // Armed with an absolute time, so system clock changes are followed by the kernel.
+    ret = rcl_timer_fd_arm(&impl->timer_fd, rcutils_atomic_load_int64_t(&impl->next_call_time));
+  } else {
+    // The steady clock may not be the one used by the timerfd, e.g. CLOCK_MONOTONIC_RAW, so an
+    // absolute expiry would drift from it, arm it relative to now instead.
+    rcl_time_point_value_t current_time;
+    if (NULL == now) {
+      ret = rcl_clock_get_now(impl->clock, &current_time);
+      now = &current_time;
+    }
+    if (RCL_RET_OK == ret) {
+      ret = rcl_timer_fd_arm(
+        &impl->timer_fd, rcutils_atomic_load_int64_t(&impl->next_call_time) - *now);
+    }
+  }
+  if (RCL_RET_OK != ret) {
+    // Wait sets still wake up for the timer using their timeout.
+    RCUTILS_LOG_ERROR_NAMED(
+      ROS_PACKAGE_NAME, "Failed to update timerfd: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+static void
+__rcl_timer_update_min(atomic_uint_least64_t * minimum, uint64_t value)
+{
+  uint64_t current = rcutils_atomic_load_uint64_t(minimum);
+  bool success = false;
+  while (value < current && !success) {
+    // On failure current is updated to the value stored by another thread.
+    rcutils_atomic_compare_exchange_strong(minimum, success, &current, value);
+  }
+}
+
+static void
+__rcl_timer_update_max(atomic_uint_least64_t * maximum, uint64_t value)
+{
+  uint64_t current = rcutils_atomic_load_uint64_t(maximum);
+  bool success = false;
+  while (value > current && !success) {
+    // On failure current is updated to the value stored by another thread.
+    rcutils_atomic_compare_exchange_strong(maximum, success, &current, value);
+  }
+}
+
+static void
+__rcl_timer_record_call(rcl_timer_impl_t * impl, int64_t lateness, int64_t missed_periods)
+{
+  const uint64_t late = lateness > 0 ? (uint64_t)lateness : 0u;
+  rcutils_atomic_fetch_add_uint64_t(&impl->call_count, 1);
+  rcutils_atomic_fetch_add_uint64_t(&impl->missed_period_count, (uint64_t)missed_periods);
+  rcutils_atomic_fetch_add_uint64_t(&impl->lateness_sum, late);
+  __rcl_timer_update_min(&impl->min_lateness, late);
+  __rcl_timer_update_max(&impl->max_lateness, late);
+  const uint64_t bucket_width = rcutils_atomic_load_uint64_t(&impl->histogram_bucket_width);
+  if (bucket_width > 0u) {
+    uint64_t bucket = late / bucket_width;
+    if (bucket >= RCL_TIMER_LATENESS_HISTOGRAM_SIZE) {
+      bucket = RCL_TIMER_LATENESS_HISTOGRAM_SIZE - 1;
+    }
+    rcutils_atomic_fetch_add_uint64_t(&impl->histogram[bucket], 1);
+  }
+}
+
 rcl_ret_t
 rcl_timer_call(rcl_timer_t * timer)
 {
@@ -258,6 +375,8 @@ rcl_timer_call(rcl_timer_t * timer)
 
   int64_t next_call_time = rcutils_atomic_load_int64_t(&timer->impl->next_call_time);
   int64_t period = rcutils_atomic_load_uint64_t(&timer->impl->period);
+  const int64_t lateness = now - next_call_time;
+  int64_t periods_ahead = 0;
   // always move the next call time by exactly period forward
   // don't use now as the base to avoid extending each cycle by the time
   // between the timer being ready and the callback being triggered
@@ -271,11 +390,13 @@ rcl_timer_call(rcl_timer_t * timer)
       // move the next call time forward by as many periods as necessary
       int64_t now_ahead = now - next_call_time;
       // rounding up without overflow
-      int64_t periods_ahead = 1 + (now_ahead - 1) / period;
+      periods_ahead = 1 + (now_ahead - 1) / period;
       next_call_time += periods_ahead * period;
     }
   }
   rcutils_atomic_store(&timer->impl->next_call_time, next_call_time);
+  __rcl_timer_update_timer_fd(timer->impl, &now);
+  __rcl_timer_record_call(timer->impl, lateness, periods_ahead);
 
   if (typed_callback != NULL) {
     int64_t since_last_call = now - previous_ns;
@@ -313,6 +434,16 @@ rcl_timer_get_time_until_next_call(const rcl_timer_t * timer, int64_t * time_unt
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_timer_get_next_call_time(const rcl_timer_t * timer, int64_t * next_call_time)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(next_call_time, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  *next_call_time = rcutils_atomic_load_int64_t(&timer->impl->next_call_time);
+  return RCL_RET_OK;
+}
+
 rcl_ret_t
 rcl_timer_get_time_since_last_call(
   const rcl_timer_t * timer,
@@ -351,6 +482,63 @@ rcl_timer_exchange_period(const rcl_timer_t * timer, int64_t new_period, int64_t
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_timer_get_slack(const rcl_timer_t * timer, int64_t * slack)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(slack, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  *slack = rcutils_atomic_load_int64_t(&timer->impl->slack);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_exchange_slack(const rcl_timer_t * timer, int64_t new_slack, int64_t * old_slack)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(old_slack, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  if (new_slack < 0) {
+    RCL_SET_ERROR_MSG("timer slack must be non-negative");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  *old_slack = rcutils_atomic_exchange_int64_t(&timer->impl->slack, new_slack);
+  RCUTILS_LOG_DEBUG_NAMED(
+    ROS_PACKAGE_NAME, "Updated timer slack from '%" PRId64 "ns' to '%" PRId64 "ns'",
+    *old_slack, new_slack);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_get_dispatch_attributes(
+  const rcl_timer_t * timer,
+  rcl_dispatch_attributes_t * attributes)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(attributes, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  attributes->priority = (int32_t)rcutils_atomic_load_int64_t(&timer->impl->dispatch_priority);
+  attributes->deadline = rcutils_atomic_load_int64_t(&timer->impl->dispatch_deadline);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_set_dispatch_attributes(
+  const rcl_timer_t * timer,
+  const rcl_dispatch_attributes_t * attributes)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(attributes, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  if (attributes->deadline < 0) {
+    RCL_SET_ERROR_MSG("timer dispatch deadline must be non-negative");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcutils_atomic_store(&timer->impl->dispatch_priority, (int64_t)attributes->priority);
+  rcutils_atomic_store(&timer->impl->dispatch_deadline, attributes->deadline);
+  return RCL_RET_OK;
+}
+
 rcl_timer_callback_t
 rcl_timer_get_callback(const rcl_timer_t * timer)
 {
@@ -375,6 +563,7 @@ rcl_timer_cancel(rcl_timer_t * timer)
   RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
   rcutils_atomic_store(&timer->impl->canceled, true);
+  __rcl_timer_update_timer_fd(timer->impl, NULL);
   RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Timer canceled");
   return RCL_RET_OK;
 }
@@ -401,10 +590,77 @@ rcl_timer_reset(rcl_timer_t * timer)
   int64_t period = rcutils_atomic_load_uint64_t(&timer->impl->period);
   rcutils_atomic_store(&timer->impl->next_call_time, now + period);
   rcutils_atomic_store(&timer->impl->canceled, false);
+  rcl_clock_reschedule(timer->impl->clock);
+  __rcl_timer_update_timer_fd(timer->impl, &now);
   RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Timer successfully reset");
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_timer_get_statistics(const rcl_timer_t * timer, rcl_timer_statistics_t * statistics)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  rcl_timer_impl_t * impl = timer->impl;
+  statistics->call_count = rcutils_atomic_load_uint64_t(&impl->call_count);
+  statistics->missed_period_count = rcutils_atomic_load_uint64_t(&impl->missed_period_count);
+  if (statistics->call_count > 0u) {
+    statistics->min_lateness = (int64_t)rcutils_atomic_load_uint64_t(&impl->min_lateness);
+    statistics->max_lateness = (int64_t)rcutils_atomic_load_uint64_t(&impl->max_lateness);
+    statistics->mean_lateness =
+      (int64_t)(rcutils_atomic_load_uint64_t(&impl->lateness_sum) / statistics->call_count);
+  } else {
+    statistics->min_lateness = 0;
+    statistics->max_lateness = 0;
+    statistics->mean_lateness = 0;
+  }
+  statistics->histogram_bucket_width =
+    (int64_t)rcutils_atomic_load_uint64_t(&impl->histogram_bucket_width);
+  size_t i;
+  for (i = 0; i < RCL_TIMER_LATENESS_HISTOGRAM_SIZE; ++i) {
+    statistics->histogram[i] = rcutils_atomic_load_uint64_t(&impl->histogram[i]);
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_reset_statistics(const rcl_timer_t * timer)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  rcl_timer_impl_t * impl = timer->impl;
+  rcutils_atomic_store(&impl->call_count, 0);
+  rcutils_atomic_store(&impl->missed_period_count, 0);
+  rcutils_atomic_store(&impl->lateness_sum, 0);
+  rcutils_atomic_store(&impl->min_lateness, UINT64_MAX);
+  rcutils_atomic_store(&impl->max_lateness, 0);
+  size_t i;
+  for (i = 0; i < RCL_TIMER_LATENESS_HISTOGRAM_SIZE; ++i) {
+    rcutils_atomic_store(&impl->histogram[i], 0);
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_set_lateness_histogram(const rcl_timer_t * timer, int64_t bucket_width)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  if (bucket_width < 0) {
+    RCL_SET_ERROR_MSG("histogram bucket width must be non-negative");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_timer_impl_t * impl = timer->impl;
+  rcutils_atomic_store(&impl->histogram_bucket_width, 0);
+  size_t i;
+  for (i = 0; i < RCL_TIMER_LATENESS_HISTOGRAM_SIZE; ++i) {
+    rcutils_atomic_store(&impl->histogram[i], 0);
+  }
+  rcutils_atomic_store(&impl->histogram_bucket_width, (uint64_t)bucket_width);
+  return RCL_RET_OK;
+}
+
 const rcl_allocator_t *
 rcl_timer_get_allocator(const rcl_timer_t * timer)
 {
@@ -413,6 +669,41 @@ rcl_timer_get_allocator(const rcl_timer_t * timer)
   return &timer->impl->allocator;
 }
 
+rcl_ret_t
+rcl_timer_enable_timerfd(rcl_timer_t * timer)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  rcl_timer_impl_t * impl = timer->impl;
+  if (RCL_ROS_TIME == impl->clock->type) {
+    RCL_SET_ERROR_MSG("ROS time timers cannot be backed by a timerfd");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (impl->timer_fd.fd >= 0) {
+    RCL_SET_ERROR_MSG("timer is already backed by a timerfd");
+    return RCL_RET_ALREADY_INIT;
+  }
+  rcl_guard_condition_options_t options = rcl_guard_condition_get_default_options();
+  options.allocator = impl->allocator;
+  rcl_ret_t ret = rcl_guard_condition_init(&impl->guard_condition, impl->context, options);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  ret = rcl_timer_fd_init(
+    &impl->timer_fd, &impl->guard_condition, RCL_SYSTEM_TIME == impl->clock->type);
+  if (RCL_RET_OK != ret) {
+    if (RCL_RET_OK != rcl_guard_condition_fini(&impl->guard_condition)) {
+      // Should be impossible
+      RCUTILS_LOG_ERROR_NAMED(
+        ROS_PACKAGE_NAME, "Failed to fini guard condition after failing to create timerfd");
+    }
+    return ret;  // rcl error state should already be set.
+  }
+  __rcl_timer_update_timer_fd(impl, NULL);
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Timer backed by a timerfd");
+  return RCL_RET_OK;
+}
+
 rcl_guard_condition_t *
 rcl_timer_get_guard_condition(const rcl_timer_t * timer)
 {
@@ -422,6 +713,20 @@ rcl_timer_get_guard_condition(const rcl_timer_t * timer)
   return &timer->impl->guard_condition;
 }
 
+rcl_ret_t
+rcl_timer_set_next_call_time(rcl_timer_t * timer, int64_t next_call_time)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
+  int64_t previous_next_call_time =
+    rcutils_atomic_exchange_int64_t(&timer->impl->next_call_time, next_call_time);
+  if (next_call_time < previous_next_call_time) {
+    rcl_clock_reschedule(timer->impl->clock);
+  }
+  __rcl_timer_update_timer_fd(timer->impl, NULL);
+  return RCL_RET_OK;
+}
+
 #ifdef __cplusplus
 }
 #endif
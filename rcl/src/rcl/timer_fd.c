@@ -0,0 +1,289 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if defined(__linux__) && !defined(_POSIX_C_SOURCE)
+// For pthreads and clock_gettime(), when compiling with strict ISO C.
+# define _POSIX_C_SOURCE 200112L
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "./timer_fd_impl.h"
+
+#include "rcl/error_handling.h"
+#include "rcutils/logging_macros.h"
+
+#if defined(__linux__)
+# include <errno.h>
+# include <pthread.h>
+# include <string.h>
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# include <sys/timerfd.h>
+# include <time.h>
+# include <unistd.h>
+
+# define RCL_TIMER_FD_MAX_EVENTS 16
+
+// Serializes starting and stopping the thread.
+static pthread_mutex_t __rcl_timer_fd_lifecycle_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Protects the list of watched timerfds, held while triggering guard conditions.
+static pthread_mutex_t __rcl_timer_fd_mutex = PTHREAD_MUTEX_INITIALIZER;
+static rcl_timer_fd_t * __rcl_timer_fd_list = NULL;
+static size_t __rcl_timer_fd_count = 0u;
+static int __rcl_timer_fd_epoll = -1;
+// An eventfd which is written to stop the thread.
+static int __rcl_timer_fd_stop = -1;
+static pthread_t __rcl_timer_fd_thread;
+
+static void
+__rcl_timer_fd_expired(int fd)
+{
+  pthread_mutex_lock(&__rcl_timer_fd_mutex);
+  // The timerfd may have been finalized since epoll_wait() returned.
+  rcl_timer_fd_t * timer_fd = __rcl_timer_fd_list;
+  while (NULL != timer_fd && timer_fd->fd != fd) {
+    timer_fd = timer_fd->next;
+  }
+  uint64_t expirations = 0u;
+  if (
+    NULL != timer_fd &&
+    sizeof(expirations) == read(fd, &expirations, sizeof(expirations)) && expirations > 0u)
+  {
+    if (RCL_RET_OK != rcl_trigger_guard_condition(timer_fd->guard_condition)) {
+      RCUTILS_LOG_ERROR_NAMED(
+        ROS_PACKAGE_NAME, "Failed to trigger timer guard condition: %s",
+        rcl_get_error_string().str);
+      rcl_reset_error();
+    }
+  }
+  pthread_mutex_unlock(&__rcl_timer_fd_mutex);
+}
+
+static void *
+__rcl_timer_fd_run(void * arg)
+{
+  (void)arg;
+  struct epoll_event events[RCL_TIMER_FD_MAX_EVENTS];
+  for (;;) {
+    int count = epoll_wait(__rcl_timer_fd_epoll, events, RCL_TIMER_FD_MAX_EVENTS, -1);
+    if (count < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      RCUTILS_LOG_ERROR_NAMED(
+        ROS_PACKAGE_NAME, "Failed to wait for timerfds: %s", strerror(errno));
+      return NULL;
+    }
+    int i;
+    for (i = 0; i < count; ++i) {
+      if (events[i].data.fd == __rcl_timer_fd_stop) {
+        return NULL;
+      }
+      __rcl_timer_fd_expired(events[i].data.fd);
+    }
+  }
+}
+
+// Called with the lifecycle mutex held.
+static rcl_ret_t
+__rcl_timer_fd_start(void)
+{
+  __rcl_timer_fd_epoll = epoll_create1(EPOLL_CLOEXEC);
+  __rcl_timer_fd_stop = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (__rcl_timer_fd_epoll >= 0 && __rcl_timer_fd_stop >= 0) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = __rcl_timer_fd_stop;
+    if (
+      0 == epoll_ctl(__rcl_timer_fd_epoll, EPOLL_CTL_ADD, __rcl_timer_fd_stop, &event) &&
+      0 == pthread_create(&__rcl_timer_fd_thread, NULL, __rcl_timer_fd_run, NULL))
+    {
+      return RCL_RET_OK;
+    }
+  }
+  RCL_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to start timerfd thread: %s", strerror(errno));
+  if (__rcl_timer_fd_stop >= 0) {
+    close(__rcl_timer_fd_stop);
+    __rcl_timer_fd_stop = -1;
+  }
+  if (__rcl_timer_fd_epoll >= 0) {
+    close(__rcl_timer_fd_epoll);
+    __rcl_timer_fd_epoll = -1;
+  }
+  return RCL_RET_ERROR;
+}
+
+// Called with the lifecycle mutex held.
+static void
+__rcl_timer_fd_stop_thread(void)
+{
+  const uint64_t one = 1u;
+  if (sizeof(one) != write(__rcl_timer_fd_stop, &one, sizeof(one))) {
+    RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to stop timerfd thread");
+    return;
+  }
+  pthread_join(__rcl_timer_fd_thread, NULL);
+  close(__rcl_timer_fd_stop);
+  __rcl_timer_fd_stop = -1;
+  close(__rcl_timer_fd_epoll);
+  __rcl_timer_fd_epoll = -1;
+}
+#endif
+
+rcl_timer_fd_t
+rcl_get_zero_initialized_timer_fd(void)
+{
+  static rcl_timer_fd_t null_timer_fd = {-1, false, NULL, NULL};
+  return null_timer_fd;
+}
+
+rcl_ret_t
+rcl_timer_fd_init(
+  rcl_timer_fd_t * timer_fd,
+  rcl_guard_condition_t * guard_condition,
+  bool system_time)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer_fd, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(guard_condition, RCL_RET_INVALID_ARGUMENT);
+  if (timer_fd->fd >= 0) {
+    RCL_SET_ERROR_MSG("timerfd already initialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+#if defined(__linux__)
+  const int fd =
+    timerfd_create(system_time ? CLOCK_REALTIME : CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (fd < 0) {
+    RCL_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to create timerfd: %s", strerror(errno));
+    return RCL_RET_ERROR;
+  }
+  pthread_mutex_lock(&__rcl_timer_fd_lifecycle_mutex);
+  rcl_ret_t ret = RCL_RET_OK;
+  if (0u == __rcl_timer_fd_count) {
+    ret = __rcl_timer_fd_start();
+  }
+  if (RCL_RET_OK == ret) {
+    timer_fd->fd = fd;
+    timer_fd->system_time = system_time;
+    timer_fd->guard_condition = guard_condition;
+    pthread_mutex_lock(&__rcl_timer_fd_mutex);
+    timer_fd->next = __rcl_timer_fd_list;
+    __rcl_timer_fd_list = timer_fd;
+    pthread_mutex_unlock(&__rcl_timer_fd_mutex);
+    ++__rcl_timer_fd_count;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (0 != epoll_ctl(__rcl_timer_fd_epoll, EPOLL_CTL_ADD, fd, &event)) {
+      RCL_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to watch timerfd: %s", strerror(errno));
+      pthread_mutex_unlock(&__rcl_timer_fd_lifecycle_mutex);
+      // Unlinks the timerfd, closes it and stops the thread if it is the only one.
+      (void)rcl_timer_fd_fini(timer_fd);
+      return RCL_RET_ERROR;
+    }
+  } else {
+    close(fd);
+  }
+  pthread_mutex_unlock(&__rcl_timer_fd_lifecycle_mutex);
+  return ret;
+#else
+  (void)system_time;
+  RCL_SET_ERROR_MSG("timerfds are not supported on this platform");
+  return RCL_RET_ERROR;
+#endif
+}
+
+rcl_ret_t
+rcl_timer_fd_fini(rcl_timer_fd_t * timer_fd)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer_fd, RCL_RET_INVALID_ARGUMENT);
+  if (timer_fd->fd < 0) {
+    return RCL_RET_OK;
+  }
+#if defined(__linux__)
+  pthread_mutex_lock(&__rcl_timer_fd_lifecycle_mutex);
+  pthread_mutex_lock(&__rcl_timer_fd_mutex);
+  // Fails harmlessly if the timerfd was never added.
+  (void)epoll_ctl(__rcl_timer_fd_epoll, EPOLL_CTL_DEL, timer_fd->fd, NULL);
+  rcl_timer_fd_t ** link = &__rcl_timer_fd_list;
+  while (NULL != *link && *link != timer_fd) {
+    link = &(*link)->next;
+  }
+  if (NULL != *link) {
+    *link = timer_fd->next;
+  }
+  close(timer_fd->fd);
+  pthread_mutex_unlock(&__rcl_timer_fd_mutex);
+  if (0u == --__rcl_timer_fd_count) {
+    __rcl_timer_fd_stop_thread();
+  }
+  pthread_mutex_unlock(&__rcl_timer_fd_lifecycle_mutex);
+#endif
+  *timer_fd = rcl_get_zero_initialized_timer_fd();
+  return RCL_RET_OK;
+}
+
+#if defined(__linux__)
+static rcl_ret_t
+__rcl_timer_fd_settime(const rcl_timer_fd_t * timer_fd, int flags, int64_t expiry)
+{
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = (time_t)(expiry / 1000000000);
+  spec.it_value.tv_nsec = (long)(expiry % 1000000000);
+  if (0 != timerfd_settime(timer_fd->fd, flags, &spec, NULL)) {
+    RCL_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to set timerfd: %s", strerror(errno));
+    return RCL_RET_ERROR;
+  }
+  return RCL_RET_OK;
+}
+#endif
+
+rcl_ret_t
+rcl_timer_fd_arm(const rcl_timer_fd_t * timer_fd, int64_t expiry)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer_fd, RCL_RET_INVALID_ARGUMENT);
+#if defined(__linux__)
+  // An all zero expiry would disarm the timerfd, expire as soon as possible instead.
+  if (expiry <= 0) {
+    expiry = 1;
+  }
+  return __rcl_timer_fd_settime(timer_fd, timer_fd->system_time ? TFD_TIMER_ABSTIME : 0, expiry);
+#else
+  (void)expiry;
+  RCL_SET_ERROR_MSG("timerfds are not supported on this platform");
+  return RCL_RET_ERROR;
+#endif
+}
+
+rcl_ret_t
+rcl_timer_fd_disarm(const rcl_timer_fd_t * timer_fd)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(timer_fd, RCL_RET_INVALID_ARGUMENT);
+#if defined(__linux__)
+  return __rcl_timer_fd_settime(timer_fd, 0, 0);
+#else
+  RCL_SET_ERROR_MSG("timerfds are not supported on this platform");
+  return RCL_RET_ERROR;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,101 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TIMER_FD_IMPL_H_
+#define RCL__TIMER_FD_IMPL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rcl/guard_condition.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// A kernel timer which triggers a guard condition when it expires.
+/**
+ * All timerfds are watched by a single thread, which is started when the
+ * first one is initialized and stopped when the last one is finalized.
+ */
+typedef struct rcl_timer_fd_t
+{
+  /// The timerfd, -1 if not initialized.
+  int fd;
+  /// True if the timerfd follows the system clock and is armed with absolute times.
+  bool system_time;
+  /// Guard condition triggered when the timerfd expires.
+  rcl_guard_condition_t * guard_condition;
+  /// Next timerfd watched by the thread.
+  struct rcl_timer_fd_t * next;
+} rcl_timer_fd_t;
+
+/// \internal
+/// Return a rcl_timer_fd_t struct with members set to `NULL` or -1.
+RCL_LOCAL
+rcl_timer_fd_t
+rcl_get_zero_initialized_timer_fd(void);
+
+/// \internal
+/// Create a disarmed timerfd and start watching it.
+/**
+ * \param[inout] timer_fd a zero initialized timerfd
+ * \param[in] guard_condition guard condition to trigger, must outlive the timerfd
+ * \param[in] system_time true to follow the system clock, else the steady clock
+ * \return `RCL_RET_OK` if the timerfd is watched, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_ALREADY_INIT` if the timerfd is already initialized, or
+ * \return `RCL_RET_ERROR` if timerfds are not supported or an unspecified error occurs.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_timer_fd_init(
+  rcl_timer_fd_t * timer_fd,
+  rcl_guard_condition_t * guard_condition,
+  bool system_time);
+
+/// \internal
+/// Stop watching the timerfd and close it, does nothing if it is not initialized.
+RCL_LOCAL
+rcl_ret_t
+rcl_timer_fd_fini(rcl_timer_fd_t * timer_fd);
+
+/// \internal
+/// Arm the timerfd, replacing any previous expiry.
+/**
+ * \param[in] timer_fd an initialized timerfd
+ * \param[in] expiry for a system time timerfd the absolute expiry time,
+ *   otherwise the duration until expiry, in nanoseconds
+ * \return `RCL_RET_OK` if the timerfd was armed, or
+ * \return `RCL_RET_ERROR` if an unspecified error occurs.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_timer_fd_arm(const rcl_timer_fd_t * timer_fd, int64_t expiry);
+
+/// \internal
+/// Disarm the timerfd, so it does not expire until armed again.
+RCL_LOCAL
+rcl_ret_t
+rcl_timer_fd_disarm(const rcl_timer_fd_t * timer_fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TIMER_FD_IMPL_H_
@@ -0,0 +1,49 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TIMER_IMPL_H_
+#define RCL__TIMER_IMPL_H_
+
+#include <stdint.h>
+
+#include "rcl/timer.h"
+#include "rcl/visibility_control.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// Set the next call time of a timer to an absolute time point.
+/**
+ * Used by facilities which own a timer and schedule it themselves, such as
+ * the timer wheel.
+ * The schedule epoch of its clock is changed if the next call time moves back.
+ *
+ * \param[inout] timer the timer whose next call time is set
+ * \param[in] next_call_time the new next call time, in nanoseconds on the timer's clock
+ * \return `RCL_RET_OK` if the next call time was set, or
+ * \return `RCL_RET_INVALID_ARGUMENT` if any arguments are invalid, or
+ * \return `RCL_RET_TIMER_INVALID` if the timer is invalid.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_timer_set_next_call_time(rcl_timer_t * timer, int64_t next_call_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TIMER_IMPL_H_
@@ -0,0 +1,569 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/timer_wheel.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/error_handling.h"
+#include "rcutils/logging_macros.h"
+
+#include "./timer_impl.h"
+
+#define RCL_TIMER_WHEEL_LEVEL_BITS 6
+#define RCL_TIMER_WHEEL_SLOTS (1u << RCL_TIMER_WHEEL_LEVEL_BITS)
+#define RCL_TIMER_WHEEL_SLOT_MASK (RCL_TIMER_WHEEL_SLOTS - 1u)
+#define RCL_TIMER_WHEEL_LEVELS 4u
+// Entries further out than this many ticks wait in the last level until they get closer.
+#define RCL_TIMER_WHEEL_MAX_DELTA \
+  ((uint64_t)1 << (RCL_TIMER_WHEEL_LEVEL_BITS * RCL_TIMER_WHEEL_LEVELS))
+#define RCL_TIMER_WHEEL_BUCKETS (RCL_TIMER_WHEEL_LEVELS * RCL_TIMER_WHEEL_SLOTS)
+// Pseudo buckets, for the entries being expired and the unused entries.
+#define RCL_TIMER_WHEEL_EXPIRING_BUCKET RCL_TIMER_WHEEL_BUCKETS
+#define RCL_TIMER_WHEEL_FREE_BUCKET (RCL_TIMER_WHEEL_BUCKETS + 1u)
+#define RCL_TIMER_WHEEL_NIL SIZE_MAX
+
+typedef struct rcl_timer_wheel_entry_impl_t
+{
+  // Deadline in nanoseconds on the clock of the wheel.
+  int64_t deadline;
+  // Period in nanoseconds, 0 for one shot entries.
+  int64_t period;
+  // Tick at which the entry expires, the first tick at or after the deadline.
+  uint64_t expires;
+  rcl_timer_wheel_callback_t callback;
+  void * user_data;
+  // Links of the bucket list, or of the free list.
+  size_t prev;
+  size_t next;
+  // Incremented whenever the entry is released, so stale handles are detected.
+  uint32_t generation;
+  // Bucket which holds the entry.
+  uint32_t bucket;
+} rcl_timer_wheel_entry_impl_t;
+
+typedef struct rcl_timer_wheel_impl_t
+{
+  // The timer representing the wheel in wait sets.
+  rcl_timer_t timer;
+  // The wheel, needed to call the callbacks of entries from the timer callback.
+  rcl_timer_wheel_t * wheel;
+  rcl_clock_t * clock;
+  // Time of tick 0, in nanoseconds.
+  int64_t start_time;
+  // Duration of a tick, in nanoseconds.
+  int64_t resolution;
+  // Last tick which was processed.
+  uint64_t current_tick;
+  // Tick at which the timer is scheduled, UINT64_MAX if it is not scheduled.
+  uint64_t scheduled_tick;
+  // First entry of each bucket.
+  size_t heads[RCL_TIMER_WHEEL_BUCKETS + 1u];
+  // One bit per non empty bucket, one word per level.
+  uint64_t occupied[RCL_TIMER_WHEEL_LEVELS];
+  rcl_timer_wheel_entry_impl_t * entries;
+  size_t capacity;
+  size_t free_head;
+  size_t entry_count;
+  // True while the entries are being expired.
+  bool calling;
+  rcl_allocator_t allocator;
+} rcl_timer_wheel_impl_t;
+
+rcl_timer_wheel_t
+rcl_get_zero_initialized_timer_wheel()
+{
+  static rcl_timer_wheel_t null_timer_wheel = {0};
+  return null_timer_wheel;
+}
+
+static unsigned
+__count_trailing_zeros(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned)__builtin_ctzll(value);
+#else
+  unsigned count = 0u;
+  while (!(value & 1u)) {
+    value >>= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+
+static uint64_t
+__timer_wheel_tick_at(const rcl_timer_wheel_impl_t * impl, rcl_time_point_value_t time)
+{
+  if (time <= impl->start_time) {
+    return 0u;
+  }
+  return (uint64_t)(time - impl->start_time) / (uint64_t)impl->resolution;
+}
+
+// First tick which starts at or after the deadline, so that entries never expire early.
+static uint64_t
+__timer_wheel_tick_after(const rcl_timer_wheel_impl_t * impl, int64_t deadline)
+{
+  if (deadline <= impl->start_time) {
+    return 0u;
+  }
+  return ((uint64_t)(deadline - impl->start_time) - 1u) / (uint64_t)impl->resolution + 1u;
+}
+
+static int64_t
+__timer_wheel_time_of(const rcl_timer_wheel_impl_t * impl, uint64_t tick)
+{
+  if (tick > (uint64_t)(INT64_MAX - impl->start_time) / (uint64_t)impl->resolution) {
+    return INT64_MAX;
+  }
+  return impl->start_time + (int64_t)tick * impl->resolution;
+}
+
+static void
+__timer_wheel_link(rcl_timer_wheel_impl_t * impl, size_t index, uint32_t bucket)
+{
+  rcl_timer_wheel_entry_impl_t * entry = &impl->entries[index];
+  entry->bucket = bucket;
+  entry->prev = RCL_TIMER_WHEEL_NIL;
+  entry->next = impl->heads[bucket];
+  if (RCL_TIMER_WHEEL_NIL != entry->next) {
+    impl->entries[entry->next].prev = index;
+  }
+  impl->heads[bucket] = index;
+  if (bucket < RCL_TIMER_WHEEL_BUCKETS) {
+    impl->occupied[bucket / RCL_TIMER_WHEEL_SLOTS] |=
+      (uint64_t)1 << (bucket % RCL_TIMER_WHEEL_SLOTS);
+  }
+}
+
+static void
+__timer_wheel_unlink(rcl_timer_wheel_impl_t * impl, size_t index)
+{
+  rcl_timer_wheel_entry_impl_t * entry = &impl->entries[index];
+  if (RCL_TIMER_WHEEL_NIL != entry->prev) {
+    impl->entries[entry->prev].next = entry->next;
+  } else {
+    impl->heads[entry->bucket] = entry->next;
+    if (RCL_TIMER_WHEEL_NIL == entry->next && entry->bucket < RCL_TIMER_WHEEL_BUCKETS) {
+      impl->occupied[entry->bucket / RCL_TIMER_WHEEL_SLOTS] &=
+        ~((uint64_t)1 << (entry->bucket % RCL_TIMER_WHEEL_SLOTS));
+    }
+  }
+  if (RCL_TIMER_WHEEL_NIL != entry->next) {
+    impl->entries[entry->next].prev = entry->prev;
+  }
+}
+
+// Move a whole bucket into another one, clearing the source bucket.
+static size_t
+__timer_wheel_detach(rcl_timer_wheel_impl_t * impl, uint32_t bucket)
+{
+  size_t head = impl->heads[bucket];
+  impl->heads[bucket] = RCL_TIMER_WHEEL_NIL;
+  impl->occupied[bucket / RCL_TIMER_WHEEL_SLOTS] &=
+    ~((uint64_t)1 << (bucket % RCL_TIMER_WHEEL_SLOTS));
+  return head;
+}
+
+// Hash an entry into the bucket of its expiration tick, relative to the current tick.
+static void
+__timer_wheel_insert(rcl_timer_wheel_impl_t * impl, size_t index)
+{
+  uint64_t expires = impl->entries[index].expires;
+  if (expires < impl->current_tick) {
+    expires = impl->current_tick;
+  }
+  uint64_t delta = expires - impl->current_tick;
+  if (delta >= RCL_TIMER_WHEEL_MAX_DELTA) {
+    // Parked in the last level, it is hashed again once it gets closer.
+    delta = RCL_TIMER_WHEEL_MAX_DELTA - 1u;
+    expires = impl->current_tick + delta;
+  }
+  uint32_t level = 0u;
+  while (delta >= ((uint64_t)1 << (RCL_TIMER_WHEEL_LEVEL_BITS * (level + 1u)))) {
+    ++level;
+  }
+  uint32_t slot =
+    (uint32_t)(expires >> (RCL_TIMER_WHEEL_LEVEL_BITS * level)) & RCL_TIMER_WHEEL_SLOT_MASK;
+  __timer_wheel_link(impl, index, level * RCL_TIMER_WHEEL_SLOTS + slot);
+}
+
+// Earliest tick after the current one at which a non empty bucket has to be processed.
+static uint64_t
+__timer_wheel_next_tick(const rcl_timer_wheel_impl_t * impl)
+{
+  uint64_t next_tick = UINT64_MAX;
+  uint32_t level;
+  for (level = 0u; level < RCL_TIMER_WHEEL_LEVELS; ++level) {
+    uint64_t occupied = impl->occupied[level];
+    if (!occupied) {
+      continue;
+    }
+    const unsigned shift = RCL_TIMER_WHEEL_LEVEL_BITS * level;
+    const uint64_t position = impl->current_tick >> shift;
+    const unsigned rotation = (unsigned)(position & RCL_TIMER_WHEEL_SLOT_MASK) + 1u;
+    // Rotate so that the bit of the slot following the current one comes first.
+    if (rotation < RCL_TIMER_WHEEL_SLOTS) {
+      occupied = (occupied >> rotation) | (occupied << (RCL_TIMER_WHEEL_SLOTS - rotation));
+    }
+    const uint64_t distance = __count_trailing_zeros(occupied) + 1u;
+    const uint64_t tick = (position + distance) << shift;
+    if (tick < next_tick) {
+      next_tick = tick;
+    }
+  }
+  return next_tick;
+}
+
+// Move the entries of the outer buckets which start at the given tick inward.
+static void
+__timer_wheel_cascade(rcl_timer_wheel_impl_t * impl, uint64_t tick)
+{
+  uint32_t level;
+  for (level = 1u; level < RCL_TIMER_WHEEL_LEVELS; ++level) {
+    const unsigned shift = RCL_TIMER_WHEEL_LEVEL_BITS * level;
+    if (tick & (((uint64_t)1 << shift) - 1u)) {
+      return;
+    }
+    const uint32_t slot = (uint32_t)(tick >> shift) & RCL_TIMER_WHEEL_SLOT_MASK;
+    size_t index = __timer_wheel_detach(impl, level * RCL_TIMER_WHEEL_SLOTS + slot);
+    while (RCL_TIMER_WHEEL_NIL != index) {
+      size_t next = impl->entries[index].next;
+      __timer_wheel_insert(impl, index);
+      index = next;
+    }
+  }
+}
+
+static rcl_timer_wheel_entry_t
+__timer_wheel_handle(const rcl_timer_wheel_impl_t * impl, size_t index)
+{
+  return ((uint64_t)impl->entries[index].generation << 32) | (uint64_t)index;
+}
+
+static void
+__timer_wheel_release(rcl_timer_wheel_impl_t * impl, size_t index)
+{
+  rcl_timer_wheel_entry_impl_t * entry = &impl->entries[index];
+  ++entry->generation;
+  entry->bucket = RCL_TIMER_WHEEL_FREE_BUCKET;
+  entry->next = impl->free_head;
+  impl->free_head = index;
+  --impl->entry_count;
+}
+
+static rcl_ret_t
+__timer_wheel_grow(rcl_timer_wheel_impl_t * impl, size_t capacity)
+{
+  if (capacity <= impl->capacity) {
+    return RCL_RET_OK;
+  }
+  if (capacity > UINT32_MAX) {
+    RCL_SET_ERROR_MSG("too many timer wheel entries");
+    return RCL_RET_ERROR;
+  }
+  rcl_allocator_t allocator = impl->allocator;
+  rcl_timer_wheel_entry_impl_t * entries = allocator.reallocate(
+    impl->entries, sizeof(rcl_timer_wheel_entry_impl_t) * capacity, allocator.state);
+  if (NULL == entries) {
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  impl->entries = entries;
+  size_t index = capacity;
+  while (index-- > impl->capacity) {
+    entries[index].generation = 1u;
+    entries[index].bucket = RCL_TIMER_WHEEL_FREE_BUCKET;
+    entries[index].next = impl->free_head;
+    impl->free_head = index;
+  }
+  impl->capacity = capacity;
+  return RCL_RET_OK;
+}
+
+static rcl_ret_t
+__timer_wheel_schedule(rcl_timer_wheel_impl_t * impl, uint64_t tick)
+{
+  impl->scheduled_tick = tick;
+  int64_t next_call_time = UINT64_MAX == tick ? INT64_MAX : __timer_wheel_time_of(impl, tick);
+  return rcl_timer_set_next_call_time(&impl->timer, next_call_time);
+}
+
+// Call the callbacks of the entries of the level 0 bucket of the current tick.
+static void
+__timer_wheel_expire(rcl_timer_wheel_impl_t * impl, rcl_time_point_value_t now)
+{
+  const uint32_t slot = (uint32_t)impl->current_tick & RCL_TIMER_WHEEL_SLOT_MASK;
+  size_t index = __timer_wheel_detach(impl, slot);
+  // Keep the entries in a list of their own, so callbacks can cancel them.
+  while (RCL_TIMER_WHEEL_NIL != index) {
+    size_t next = impl->entries[index].next;
+    __timer_wheel_link(impl, index, RCL_TIMER_WHEEL_EXPIRING_BUCKET);
+    index = next;
+  }
+  while (RCL_TIMER_WHEEL_NIL != impl->heads[RCL_TIMER_WHEEL_EXPIRING_BUCKET]) {
+    index = impl->heads[RCL_TIMER_WHEEL_EXPIRING_BUCKET];
+    __timer_wheel_unlink(impl, index);
+    rcl_timer_wheel_entry_impl_t * entry = &impl->entries[index];
+    rcl_timer_wheel_entry_t handle = __timer_wheel_handle(impl, index);
+    rcl_timer_wheel_callback_t callback = entry->callback;
+    void * user_data = entry->user_data;
+    if (entry->period > 0) {
+      // Like rcl_timer_call(), move by whole periods and skip the deadlines already missed.
+      entry->deadline += entry->period;
+      if (entry->deadline <= now) {
+        entry->deadline += ((now - entry->deadline) / entry->period + 1) * entry->period;
+      }
+      entry->expires = __timer_wheel_tick_after(impl, entry->deadline);
+      __timer_wheel_insert(impl, index);
+    } else {
+      __timer_wheel_release(impl, index);
+    }
+    // The entries may be reallocated by the callback, so do not use entry after this.
+    callback(impl->wheel, handle, user_data);
+  }
+}
+
+static rcl_ret_t
+__timer_wheel_call(rcl_timer_wheel_impl_t * impl)
+{
+  if (impl->calling) {
+    RCL_SET_ERROR_MSG("timer wheel is already being called");
+    return RCL_RET_ERROR;
+  }
+  rcl_time_point_value_t now;
+  rcl_ret_t ret = rcl_clock_get_now(impl->clock, &now);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  const uint64_t target_tick = __timer_wheel_tick_at(impl, now);
+  impl->calling = true;
+  // Only the ticks with a non empty bucket are visited.
+  uint64_t tick;
+  while ((tick = __timer_wheel_next_tick(impl)) <= target_tick) {
+    impl->current_tick = tick;
+    __timer_wheel_cascade(impl, tick);
+    __timer_wheel_expire(impl, now);
+  }
+  if (target_tick > impl->current_tick) {
+    impl->current_tick = target_tick;
+  }
+  impl->calling = false;
+  return __timer_wheel_schedule(impl, __timer_wheel_next_tick(impl));
+}
+
+static void
+__timer_wheel_timer_callback(rcl_timer_t * timer, int64_t last_call_time)
+{
+  (void)last_call_time;
+  rcl_timer_wheel_impl_t * impl = (rcl_timer_wheel_impl_t *)(
+    (char *)timer - offsetof(rcl_timer_wheel_impl_t, timer));
+  if (RCL_RET_OK != __timer_wheel_call(impl)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      ROS_PACKAGE_NAME, "Failed to call timer wheel: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+rcl_ret_t
+rcl_timer_wheel_init(
+  rcl_timer_wheel_t * wheel,
+  rcl_clock_t * clock,
+  rcl_context_t * context,
+  int64_t resolution,
+  size_t capacity,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(wheel, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(clock, RCL_RET_INVALID_ARGUMENT);
+  if (resolution <= 0) {
+    RCL_SET_ERROR_MSG("timer wheel resolution must be positive");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (wheel->impl) {
+    RCL_SET_ERROR_MSG("timer wheel already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  rcl_timer_wheel_impl_t * impl = (rcl_timer_wheel_impl_t *)allocator.zero_allocate(
+    1, sizeof(rcl_timer_wheel_impl_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->wheel = wheel;
+  impl->clock = clock;
+  impl->resolution = resolution;
+  impl->allocator = allocator;
+  impl->free_head = RCL_TIMER_WHEEL_NIL;
+  size_t i;
+  for (i = 0; i < RCL_TIMER_WHEEL_BUCKETS + 1u; ++i) {
+    impl->heads[i] = RCL_TIMER_WHEEL_NIL;
+  }
+  rcl_ret_t ret = __timer_wheel_grow(impl, capacity);
+  if (RCL_RET_OK != ret) {
+    allocator.deallocate(impl, allocator.state);
+    return ret;
+  }
+  impl->timer = rcl_get_zero_initialized_timer();
+  ret = rcl_timer_init(
+    &impl->timer, clock, context, resolution, __timer_wheel_timer_callback, allocator);
+  if (RCL_RET_OK != ret) {
+    allocator.deallocate(impl->entries, allocator.state);
+    allocator.deallocate(impl, allocator.state);
+    return ret;  // rcl error state should already be set.
+  }
+  ret = rcl_clock_get_now(clock, &impl->start_time);
+  if (RCL_RET_OK == ret) {
+    // No entry is armed yet.
+    ret = __timer_wheel_schedule(impl, UINT64_MAX);
+  }
+  if (RCL_RET_OK != ret) {
+    if (RCL_RET_OK != rcl_timer_fini(&impl->timer)) {
+      RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to fini timer after failed init");
+    }
+    allocator.deallocate(impl->entries, allocator.state);
+    allocator.deallocate(impl, allocator.state);
+    return ret;  // rcl error state should already be set.
+  }
+  wheel->impl = impl;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_wheel_fini(rcl_timer_wheel_t * wheel)
+{
+  if (!wheel || !wheel->impl) {
+    return RCL_RET_OK;
+  }
+  rcl_timer_wheel_impl_t * impl = wheel->impl;
+  rcl_allocator_t allocator = impl->allocator;
+  rcl_ret_t result = rcl_timer_fini(&impl->timer);
+  allocator.deallocate(impl->entries, allocator.state);
+  allocator.deallocate(impl, allocator.state);
+  wheel->impl = NULL;
+  return result;
+}
+
+rcl_ret_t
+rcl_timer_wheel_arm(
+  rcl_timer_wheel_t * wheel,
+  int64_t delay,
+  int64_t period,
+  rcl_timer_wheel_callback_t callback,
+  void * user_data,
+  rcl_timer_wheel_entry_t * entry)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wheel, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    wheel->impl, "timer wheel is invalid", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(callback, RCL_RET_INVALID_ARGUMENT);
+  if (delay < 0 || period < 0) {
+    RCL_SET_ERROR_MSG("timer wheel delay and period must be non-negative");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_timer_wheel_impl_t * impl = wheel->impl;
+  rcl_time_point_value_t now;
+  rcl_ret_t ret = rcl_clock_get_now(impl->clock, &now);
+  if (RCL_RET_OK != ret) {
+    return ret;  // rcl error state should already be set.
+  }
+  if (RCL_TIMER_WHEEL_NIL == impl->free_head) {
+    ret = __timer_wheel_grow(impl, impl->capacity ? 2 * impl->capacity : 16u);
+    if (RCL_RET_OK != ret) {
+      return ret;  // rcl error state should already be set.
+    }
+  }
+  size_t index = impl->free_head;
+  rcl_timer_wheel_entry_impl_t * new_entry = &impl->entries[index];
+  impl->free_head = new_entry->next;
+  ++impl->entry_count;
+  new_entry->deadline = delay > INT64_MAX - now ? INT64_MAX : now + delay;
+  new_entry->period = period;
+  new_entry->callback = callback;
+  new_entry->user_data = user_data;
+  new_entry->expires = __timer_wheel_tick_after(impl, new_entry->deadline);
+  // The current tick was already processed, or is being processed.
+  if (new_entry->expires <= impl->current_tick) {
+    new_entry->expires = impl->current_tick + 1u;
+  }
+  __timer_wheel_insert(impl, index);
+  if (NULL != entry) {
+    *entry = __timer_wheel_handle(impl, index);
+  }
+  // While calling, the timer is scheduled once all entries have been expired.
+  if (!impl->calling && impl->entries[index].expires < impl->scheduled_tick) {
+    return __timer_wheel_schedule(impl, impl->entries[index].expires);
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_wheel_cancel(rcl_timer_wheel_t * wheel, rcl_timer_wheel_entry_t entry)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wheel, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    wheel->impl, "timer wheel is invalid", return RCL_RET_INVALID_ARGUMENT);
+  rcl_timer_wheel_impl_t * impl = wheel->impl;
+  const size_t index = (size_t)(entry & UINT32_MAX);
+  if (
+    index >= impl->capacity ||
+    impl->entries[index].generation != (uint32_t)(entry >> 32) ||
+    RCL_TIMER_WHEEL_FREE_BUCKET == impl->entries[index].bucket)
+  {
+    RCL_SET_ERROR_MSG("timer wheel entry is invalid");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  __timer_wheel_unlink(impl, index);
+  __timer_wheel_release(impl, index);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_timer_wheel_call(rcl_timer_wheel_t * wheel)
+{
+  RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Calling timer wheel");
+  RCL_CHECK_ARGUMENT_FOR_NULL(wheel, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    wheel->impl, "timer wheel is invalid", return RCL_RET_INVALID_ARGUMENT);
+  return __timer_wheel_call(wheel->impl);
+}
+
+rcl_ret_t
+rcl_timer_wheel_get_entry_count(const rcl_timer_wheel_t * wheel, size_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wheel, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    wheel->impl, "timer wheel is invalid", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  *count = wheel->impl->entry_count;
+  return RCL_RET_OK;
+}
+
+rcl_timer_t *
+rcl_timer_wheel_get_timer(rcl_timer_wheel_t * wheel)
+{
+  if (NULL == wheel || NULL == wheel->impl) {
+    return NULL;
+  }
+  return &wheel->impl->timer;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,348 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/traffic_statistics_publisher.h"
+
+#include <stddef.h>
+
+#include "./traffic_statistics_impl.h"
+#include "rcl/error_handling.h"
+#include "rcutils/logging_macros.h"
+
+void
+rcl_traffic_statistics_counters_init(rcl_traffic_statistics_counters_t * counters, bool enabled)
+{
+  counters->enabled = enabled;
+  atomic_init(&counters->message_count, 0u);
+  atomic_init(&counters->byte_count, 0u);
+  atomic_init(&counters->failed_take_count, 0u);
+  size_t i;
+  for (i = 0; i < RCL_TRAFFIC_STATISTICS_LATENCY_BUCKETS; ++i) {
+    atomic_init(&counters->latency_histogram[i], 0u);
+  }
+}
+
+void
+rcl_traffic_statistics_count_messages(
+  rcl_traffic_statistics_counters_t * counters,
+  size_t message_count,
+  size_t byte_count)
+{
+  if (!counters->enabled || 0u == message_count) {
+    return;
+  }
+  (void)rcutils_atomic_fetch_add_uint64_t(&counters->message_count, message_count);
+  if (0u != byte_count) {
+    (void)rcutils_atomic_fetch_add_uint64_t(&counters->byte_count, byte_count);
+  }
+}
+
+void
+rcl_traffic_statistics_count_take(
+  rcl_traffic_statistics_counters_t * counters,
+  rcl_ret_t ret,
+  size_t byte_count)
+{
+  if (!counters->enabled) {
+    return;
+  }
+  if (RCL_RET_OK == ret) {
+    rcl_traffic_statistics_count_messages(counters, 1u, byte_count);
+  } else if (RCL_RET_SUBSCRIPTION_TAKE_FAILED == ret) {
+    (void)rcutils_atomic_fetch_add_uint64_t(&counters->failed_take_count, 1u);
+  }
+}
+
+void
+rcl_traffic_statistics_count_latency(rcl_traffic_statistics_counters_t * counters, int64_t latency)
+{
+  if (!counters->enabled) {
+    return;
+  }
+  // Bucket i counts latencies below 2^i microseconds, and not in a smaller bucket.
+  size_t bucket = 0u;
+  if (latency >= 1000) {
+    uint64_t microseconds = (uint64_t)latency / 1000u;
+    while (0u != microseconds && bucket + 1u < RCL_TRAFFIC_STATISTICS_LATENCY_BUCKETS) {
+      microseconds >>= 1u;
+      ++bucket;
+    }
+  }
+  (void)rcutils_atomic_fetch_add_uint64_t(&counters->latency_histogram[bucket], 1u);
+}
+
+rcl_ret_t
+rcl_traffic_statistics_counters_load(
+  rcl_traffic_statistics_counters_t * counters,
+  rcl_traffic_statistics_t * statistics)
+{
+  if (!counters->enabled) {
+    RCL_SET_ERROR_MSG("traffic statistics are not enabled");
+    return RCL_RET_UNSUPPORTED;
+  }
+  statistics->message_count = rcutils_atomic_load_uint64_t(&counters->message_count);
+  statistics->byte_count = rcutils_atomic_load_uint64_t(&counters->byte_count);
+  statistics->failed_take_count = rcutils_atomic_load_uint64_t(&counters->failed_take_count);
+  size_t i;
+  for (i = 0; i < RCL_TRAFFIC_STATISTICS_LATENCY_BUCKETS; ++i) {
+    statistics->latency_histogram[i] =
+      rcutils_atomic_load_uint64_t(&counters->latency_histogram[i]);
+  }
+  return RCL_RET_OK;
+}
+
+typedef struct rcl_traffic_statistics_entity_t
+{
+  // A rcl_subscription_t if is_subscription is true, a rcl_publisher_t otherwise.
+  const void * entity;
+  bool is_subscription;
+} rcl_traffic_statistics_entity_t;
+
+typedef struct rcl_traffic_statistics_publisher_impl_t
+{
+  // The timer publishing the statistics.
+  rcl_timer_t timer;
+  rcl_publisher_t publisher;
+  void * ros_message;
+  rcl_traffic_statistics_fill_t fill;
+  void * user_data;
+  rcl_traffic_statistics_entity_t * entities;
+  size_t entity_count;
+  size_t entity_capacity;
+  rcl_allocator_t allocator;
+} rcl_traffic_statistics_publisher_impl_t;
+
+rcl_traffic_statistics_publisher_t
+rcl_get_zero_initialized_traffic_statistics_publisher()
+{
+  static rcl_traffic_statistics_publisher_t null_statistics_publisher = {0};
+  return null_statistics_publisher;
+}
+
+static void
+__traffic_statistics_timer_callback(rcl_timer_t * timer, int64_t last_call_time)
+{
+  (void)last_call_time;
+  rcl_traffic_statistics_publisher_impl_t * impl = (rcl_traffic_statistics_publisher_impl_t *)(
+    (char *)timer - offsetof(rcl_traffic_statistics_publisher_impl_t, timer));
+  rcl_traffic_statistics_publisher_t statistics_publisher = {impl};
+  if (RCL_RET_OK != rcl_traffic_statistics_publisher_publish(&statistics_publisher)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      ROS_PACKAGE_NAME, "Failed to publish traffic statistics: %s", rcl_get_error_string().str);
+    rcl_reset_error();
+  }
+}
+
+rcl_ret_t
+rcl_traffic_statistics_publisher_init(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const rcl_node_t * node,
+  const rosidl_message_type_support_t * type_support,
+  const char * topic_name,
+  const rcl_publisher_options_t * options,
+  void * ros_message,
+  rcl_traffic_statistics_fill_t fill,
+  void * user_data,
+  rcl_clock_t * clock,
+  int64_t period)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
+  rcl_allocator_t allocator = options->allocator;
+  RCL_CHECK_ALLOCATOR_WITH_MSG(&allocator, "invalid allocator", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics_publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(fill, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(clock, RCL_RET_INVALID_ARGUMENT);
+  if (period <= 0) {
+    RCL_SET_ERROR_MSG("traffic statistics period must be positive");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (statistics_publisher->impl) {
+    RCL_SET_ERROR_MSG("statistics publisher already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  if (!rcl_node_is_valid(node)) {
+    return RCL_RET_NODE_INVALID;  // error already set
+  }
+  rcl_traffic_statistics_publisher_impl_t * impl =
+    (rcl_traffic_statistics_publisher_impl_t *)allocator.zero_allocate(
+    1, sizeof(rcl_traffic_statistics_publisher_impl_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  impl->ros_message = ros_message;
+  impl->fill = fill;
+  impl->user_data = user_data;
+  impl->allocator = allocator;
+  impl->publisher = rcl_get_zero_initialized_publisher();
+  rcl_ret_t ret =
+    rcl_publisher_init(&impl->publisher, node, type_support, topic_name, options);
+  if (RCL_RET_OK != ret) {
+    allocator.deallocate(impl, allocator.state);
+    return ret;  // error already set
+  }
+  impl->timer = rcl_get_zero_initialized_timer();
+  ret = rcl_timer_init(
+    &impl->timer, clock, node->context, period, __traffic_statistics_timer_callback, allocator);
+  if (RCL_RET_OK != ret) {
+    if (rcl_publisher_fini(&impl->publisher, (rcl_node_t *)node) != RCL_RET_OK) {
+      RCUTILS_LOG_ERROR_NAMED(
+        ROS_PACKAGE_NAME, "Failed to fini publisher after failed init: %s",
+        rcl_get_error_string().str);
+    }
+    allocator.deallocate(impl, allocator.state);
+    return ret;  // error already set
+  }
+  statistics_publisher->impl = impl;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_traffic_statistics_publisher_fini(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  rcl_node_t * node)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics_publisher, RCL_RET_INVALID_ARGUMENT);
+  rcl_traffic_statistics_publisher_impl_t * impl = statistics_publisher->impl;
+  if (NULL == impl) {
+    return RCL_RET_OK;
+  }
+  rcl_ret_t result = rcl_timer_fini(&impl->timer);
+  rcl_ret_t ret = rcl_publisher_fini(&impl->publisher, node);
+  if (RCL_RET_OK != ret) {
+    result = ret;  // error already set
+  }
+  rcl_allocator_t allocator = impl->allocator;
+  if (NULL != impl->entities) {
+    allocator.deallocate(impl->entities, allocator.state);
+  }
+  allocator.deallocate(impl, allocator.state);
+  statistics_publisher->impl = NULL;
+  return result;
+}
+
+static rcl_ret_t
+__traffic_statistics_publisher_add(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const void * entity,
+  bool is_subscription)
+{
+  rcl_traffic_statistics_publisher_impl_t * impl = statistics_publisher->impl;
+  if (impl->entity_count == impl->entity_capacity) {
+    const size_t capacity = impl->entity_capacity ? impl->entity_capacity * 2u : 8u;
+    rcl_traffic_statistics_entity_t * entities =
+      (rcl_traffic_statistics_entity_t *)impl->allocator.reallocate(
+      impl->entities, capacity * sizeof(rcl_traffic_statistics_entity_t),
+      impl->allocator.state);
+    RCL_CHECK_FOR_NULL_WITH_MSG(entities, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+    impl->entities = entities;
+    impl->entity_capacity = capacity;
+  }
+  impl->entities[impl->entity_count].entity = entity;
+  impl->entities[impl->entity_count].is_subscription = is_subscription;
+  ++impl->entity_count;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_traffic_statistics_publisher_add_publisher(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const rcl_publisher_t * publisher)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics_publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    statistics_publisher->impl, "statistics publisher is not initialized",
+    return RCL_RET_INVALID_ARGUMENT);
+  rcl_traffic_statistics_t statistics;
+  rcl_ret_t ret = rcl_publisher_get_traffic_statistics(publisher, &statistics);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  return __traffic_statistics_publisher_add(statistics_publisher, publisher, false);
+}
+
+rcl_ret_t
+rcl_traffic_statistics_publisher_add_subscription(
+  rcl_traffic_statistics_publisher_t * statistics_publisher,
+  const rcl_subscription_t * subscription)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics_publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    statistics_publisher->impl, "statistics publisher is not initialized",
+    return RCL_RET_INVALID_ARGUMENT);
+  rcl_traffic_statistics_t statistics;
+  rcl_ret_t ret = rcl_subscription_get_traffic_statistics(subscription, &statistics);
+  if (RCL_RET_OK != ret) {
+    return ret;  // error already set
+  }
+  return __traffic_statistics_publisher_add(statistics_publisher, subscription, true);
+}
+
+rcl_ret_t
+rcl_traffic_statistics_publisher_publish(
+  const rcl_traffic_statistics_publisher_t * statistics_publisher)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics_publisher, RCL_RET_INVALID_ARGUMENT);
+  const rcl_traffic_statistics_publisher_impl_t * impl = statistics_publisher->impl;
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    impl, "statistics publisher is not initialized", return RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t result = RCL_RET_OK;
+  size_t i;
+  for (i = 0; i < impl->entity_count; ++i) {
+    const rcl_traffic_statistics_entity_t * entry = &impl->entities[i];
+    rcl_traffic_statistics_t statistics;
+    const char * topic_name = NULL;
+    rcl_ret_t ret = RCL_RET_OK;
+    if (entry->is_subscription) {
+      const rcl_subscription_t * subscription = (const rcl_subscription_t *)entry->entity;
+      topic_name = rcl_subscription_get_topic_name(subscription);
+      ret = rcl_subscription_get_traffic_statistics(subscription, &statistics);
+    } else {
+      const rcl_publisher_t * publisher = (const rcl_publisher_t *)entry->entity;
+      topic_name = rcl_publisher_get_topic_name(publisher);
+      ret = rcl_publisher_get_traffic_statistics(publisher, &statistics);
+    }
+    if (RCL_RET_OK == ret) {
+      ret = impl->fill(
+        topic_name, entry->is_subscription, &statistics, impl->ros_message, impl->user_data);
+      if (RCL_RET_OK != ret && !rcl_error_is_set()) {
+        RCL_SET_ERROR_MSG("filling the traffic statistics message failed");
+      }
+    }
+    if (RCL_RET_OK == ret) {
+      ret = rcl_publish(&impl->publisher, impl->ros_message);
+    }
+    if (RCL_RET_OK != ret && RCL_RET_OK == result) {
+      result = RCL_RET_ERROR;  // error already set
+    }
+  }
+  return result;
+}
+
+rcl_timer_t *
+rcl_traffic_statistics_publisher_get_timer(
+  rcl_traffic_statistics_publisher_t * statistics_publisher)
+{
+  if (NULL == statistics_publisher || NULL == statistics_publisher->impl) {
+    return NULL;
+  }
+  return &statistics_publisher->impl->timer;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,91 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__TRAFFIC_STATISTICS_IMPL_H_
+#define RCL__TRAFFIC_STATISTICS_IMPL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/traffic_statistics.h"
+#include "rcl/visibility_control.h"
+#include "rcutils/stdatomic_helper.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// \internal
+/// Counters of a publisher or subscription, which are updated concurrently.
+/**
+ * Every function but init does nothing for disabled counters.
+ */
+typedef struct rcl_traffic_statistics_counters_t
+{
+  bool enabled;
+  atomic_uint_least64_t message_count;
+  atomic_uint_least64_t byte_count;
+  atomic_uint_least64_t failed_take_count;
+  atomic_uint_least64_t latency_histogram[RCL_TRAFFIC_STATISTICS_LATENCY_BUCKETS];
+} rcl_traffic_statistics_counters_t;
+
+/// \internal
+/// Set every counter to 0, and enable or disable them.
+RCL_LOCAL
+void
+rcl_traffic_statistics_counters_init(rcl_traffic_statistics_counters_t * counters, bool enabled);
+
+/// \internal
+/// Count messages, and the bytes of those whose serialized size is known.
+RCL_LOCAL
+void
+rcl_traffic_statistics_count_messages(
+  rcl_traffic_statistics_counters_t * counters,
+  size_t message_count,
+  size_t byte_count);
+
+/// \internal
+/// Count the result of a take, a take failed if no message was available.
+RCL_LOCAL
+void
+rcl_traffic_statistics_count_take(
+  rcl_traffic_statistics_counters_t * counters,
+  rcl_ret_t ret,
+  size_t byte_count);
+
+/// \internal
+/// Add a latency sample, in nanoseconds, to the histogram.
+RCL_LOCAL
+void
+rcl_traffic_statistics_count_latency(rcl_traffic_statistics_counters_t * counters, int64_t latency);
+
+/// \internal
+/// Copy the counters.
+/**
+ * \return `RCL_RET_OK` if the counters were copied, or
+ * \return `RCL_RET_UNSUPPORTED` if they are disabled.
+ */
+RCL_LOCAL
+rcl_ret_t
+rcl_traffic_statistics_counters_load(
+  rcl_traffic_statistics_counters_t * counters,
+  rcl_traffic_statistics_t * statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RCL__TRAFFIC_STATISTICS_IMPL_H_
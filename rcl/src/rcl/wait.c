@@ -12,6 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#if defined(__linux__) && !defined(_POSIX_C_SOURCE)
+// For clock_nanosleep(), when compiling with strict ISO C.
+# define _POSIX_C_SOURCE 200112L
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -22,14 +27,54 @@ extern "C"
 #include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "rcl/error_handling.h"
 #include "rcl/time.h"
 #include "rcutils/logging_macros.h"
+#include "rcutils/stdatomic_helper.h"
+#include "rcutils/time.h"
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
+#if defined(__linux__)
+# include <errno.h>
+# include <time.h>
+#endif
+
+#include "./time_impl.h"
+
+typedef struct rcl_wait_set_timer_node_t
+{
+  // next call time of the timer when it was last looked at, never later than the actual one
+  int64_t next_call_time;
+  // index of the timer in the timers storage
+  size_t index;
+  const rcl_timer_t * timer;
+} rcl_wait_set_timer_node_t;
+
+// Min-heap of the timers which share a clock, ordered by next call time.
+typedef struct rcl_wait_set_timer_queue_t
+{
+  rcl_clock_t * clock;
+  // schedule epoch of the clock when the queue was built
+  uint64_t schedule_epoch;
+  rcl_wait_set_timer_node_t * nodes;
+  size_t count;
+} rcl_wait_set_timer_queue_t;
+
+// Sort key of a ready entity, see rcl_wait_set_sort_ready_entities().
+typedef struct rcl_wait_set_dispatch_key_t
+{
+  rcl_wait_set_ready_entity_t entity;
+  // time left until the deadline in nanoseconds, INT64_MAX if there is none
+  int64_t time_left;
+  int32_t priority;
+  // position in the ready list before sorting, so that the sort is stable
+  size_t position;
+} rcl_wait_set_dispatch_key_t;
+
 typedef struct rcl_wait_set_impl_t
 {
   // number of subscriptions that have been added to the wait set
@@ -48,8 +93,85 @@ typedef struct rcl_wait_set_impl_t
   // number of timers that have been added to the wait set
   size_t timer_index;
   rcl_allocator_t allocator;
+  // single block all the arrays below and those of the wait set are carved out of
+  void * storage;
+  size_t storage_capacity;
+  // if true, entities stay in the wait set across calls to rcl_wait()
+  bool persistent;
+  // membership storage used in persistent mode, rcl_wait() restores from these
+  const rcl_subscription_t ** subscription_members;
+  const rcl_guard_condition_t ** guard_condition_members;
+  const rcl_timer_t ** timer_members;
+  const rcl_client_t ** client_members;
+  const rcl_service_t ** service_members;
+  void ** rmw_subscription_members;
+  // guard conditions followed by the guard conditions of timers, like the rmw storage
+  void ** rmw_guard_condition_members;
+  void ** rmw_client_members;
+  void ** rmw_service_members;
+  // compact list of the entities found ready by the last call to rcl_wait()
+  rcl_wait_set_ready_entity_t * ready_entities;
+  size_t ready_entity_count;
+  // scratch space to sort the ready list
+  rcl_wait_set_dispatch_key_t * dispatch_keys;
+  // one queue per clock, the nodes of all queues are carved out of timer_nodes
+  rcl_wait_set_timer_queue_t * timer_queues;
+  size_t timer_queue_count;
+  rcl_wait_set_timer_node_t * timer_nodes;
+  // indices of the timers which have a guard condition, in ascending order
+  size_t * timer_guard_condition_indices;
+  size_t timer_guard_condition_count;
+  // true if timers were added or removed since the queues were built
+  bool timer_queues_dirty;
+  // Triggered when the deadline of rcl_wait_until() passes on a clock with ROS time active.
+  rcl_guard_condition_t deadline_guard_condition;
+  rcl_clock_t * deadline_clock;
+  rcl_time_point_value_t deadline;
+  // Duration to busy poll the middleware before blocking, 0 to always block.
+  int64_t spin_budget;
+  // copy of the rmw storage, restored after each poll which found nothing ready
+  void ** spin_storage;
+  rcl_wait_set_spin_statistics_t spin_statistics;
+  // Wake up instrumentation, atomic so that another thread may read it during a wait.
+  bool statistics_enabled;
+  // Time spent in the middleware or sleeping during the current wait, in nanoseconds.
+  int64_t blocked_time;
+  atomic_uint_least64_t wait_count;
+  atomic_uint_least64_t timeout_count;
+  atomic_uint_least64_t empty_wake_count;
+  atomic_uint_least64_t total_blocked_time;
+  atomic_uint_least64_t total_bookkeeping_time;
+  atomic_uint_least64_t ready_histogram[RCL_WAIT_SET_ENTITY_TYPE_COUNT][
+    RCL_WAIT_SET_READY_HISTOGRAM_SIZE];
 } rcl_wait_set_impl_t;
 
+// Set all the wake up statistics to zero.
+static void
+__wait_set_statistics_reset(rcl_wait_set_impl_t * impl)
+{
+  rcutils_atomic_store(&impl->wait_count, 0);
+  rcutils_atomic_store(&impl->timeout_count, 0);
+  rcutils_atomic_store(&impl->empty_wake_count, 0);
+  rcutils_atomic_store(&impl->total_blocked_time, 0);
+  rcutils_atomic_store(&impl->total_bookkeeping_time, 0);
+  size_t type;
+  size_t bucket;
+  for (type = 0; type < RCL_WAIT_SET_ENTITY_TYPE_COUNT; ++type) {
+    for (bucket = 0; bucket < RCL_WAIT_SET_READY_HISTOGRAM_SIZE; ++bucket) {
+      rcutils_atomic_store(&impl->ready_histogram[type][bucket], 0);
+    }
+  }
+}
+
+// Absolute deadline of a wait, see rcl_wait_until().
+typedef struct rcl_wait_deadline_t
+{
+  rcl_clock_t * clock;
+  rcl_time_point_value_t time;
+  // True if the deadline guard condition wakes the wait up, instead of a timeout.
+  bool use_guard_condition;
+} rcl_wait_deadline_t;
+
 rcl_wait_set_t
 rcl_get_zero_initialized_wait_set()
 {
@@ -75,13 +197,137 @@ __wait_set_is_valid(const rcl_wait_set_t * wait_set)
   return wait_set && wait_set->impl;
 }
 
+// Alignment of the arrays carved out of the storage block, enough for pointers and 64 bit times.
+#define RCL_WAIT_SET_STORAGE_ALIGNMENT 8u
+
+#define SET_CARVE(Pointer, Type, Count) \
+  do { \
+    const size_t count = (Count); \
+    if (assign) { \
+      Pointer = (NULL == base || 0u == count) ? NULL : (Type *)(void *)(base + size); \
+    } \
+    size += \
+      (sizeof(Type) * count + RCL_WAIT_SET_STORAGE_ALIGNMENT - 1u) & \
+      ~(size_t)(RCL_WAIT_SET_STORAGE_ALIGNMENT - 1u); \
+  } while (false)
+
+// Lay out every array of the wait set in its storage block, for the current set sizes.
+// If assign is true the arrays are pointed into the block, returns the size of the block.
+// The membership storage always has room, but is only assigned in persistent mode.
+static size_t
+__wait_set_storage_layout(rcl_wait_set_t * wait_set, bool assign)
+{
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  char * base = (char *)impl->storage;
+  size_t size = 0u;
+  const size_t subscriptions = wait_set->size_of_subscriptions;
+  const size_t guard_conditions = wait_set->size_of_guard_conditions;
+  const size_t timers = wait_set->size_of_timers;
+  const size_t clients = wait_set->size_of_clients;
+  const size_t services = wait_set->size_of_services;
+  // Guard condition rmw size needs to be guard conditions + timers,
+  // plus one for the deadline guard condition of rcl_wait_until().
+  const size_t rmw_guard_conditions = guard_conditions + timers + 1u;
+  const size_t entities = subscriptions + guard_conditions + timers + clients + services;
+  // The arrays used by every wait come first, next to each other.
+  SET_CARVE(wait_set->subscriptions, const rcl_subscription_t *, subscriptions);
+  SET_CARVE(wait_set->guard_conditions, const rcl_guard_condition_t *, guard_conditions);
+  SET_CARVE(wait_set->timers, const rcl_timer_t *, timers);
+  SET_CARVE(wait_set->clients, const rcl_client_t *, clients);
+  SET_CARVE(wait_set->services, const rcl_service_t *, services);
+  SET_CARVE(impl->rmw_subscriptions.subscribers, void *, subscriptions);
+  SET_CARVE(impl->rmw_guard_conditions.guard_conditions, void *, rmw_guard_conditions);
+  SET_CARVE(impl->rmw_clients.clients, void *, clients);
+  SET_CARVE(impl->rmw_services.services, void *, services);
+  SET_CARVE(impl->ready_entities, rcl_wait_set_ready_entity_t, entities);
+  SET_CARVE(impl->dispatch_keys, rcl_wait_set_dispatch_key_t, entities);
+  SET_CARVE(impl->timer_queues, rcl_wait_set_timer_queue_t, timers);
+  SET_CARVE(impl->timer_nodes, rcl_wait_set_timer_node_t, timers);
+  SET_CARVE(impl->timer_guard_condition_indices, size_t, timers);
+  SET_CARVE(
+    impl->spin_storage, void *, subscriptions + rmw_guard_conditions + clients + services);
+  // Base is only used for assignments, so the membership storage is not assigned unless persistent.
+  if (!impl->persistent) {
+    base = NULL;
+  }
+  SET_CARVE(impl->subscription_members, const rcl_subscription_t *, subscriptions);
+  SET_CARVE(impl->guard_condition_members, const rcl_guard_condition_t *, guard_conditions);
+  SET_CARVE(impl->timer_members, const rcl_timer_t *, timers);
+  SET_CARVE(impl->client_members, const rcl_client_t *, clients);
+  SET_CARVE(impl->service_members, const rcl_service_t *, services);
+  SET_CARVE(impl->rmw_subscription_members, void *, subscriptions);
+  // guard conditions followed by the guard conditions of timers, like the rmw storage
+  SET_CARVE(impl->rmw_guard_condition_members, void *, guard_conditions + timers);
+  SET_CARVE(impl->rmw_client_members, void *, clients);
+  SET_CARVE(impl->rmw_service_members, void *, services);
+  return size;
+}
+
+// Set all the membership storage to NULL, it is assigned in persistent mode only.
+static void
+__wait_set_members_clear(rcl_wait_set_t * wait_set)
+{
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  if (!impl->persistent || NULL == impl->storage) {
+    return;
+  }
+  // The membership storage is contiguous, from the first to the last non empty array.
+  char * begin = NULL;
+  char * end = NULL;
+  void * arrays[9] = {
+    (void *)impl->subscription_members, (void *)impl->guard_condition_members,
+    (void *)impl->timer_members, (void *)impl->client_members, (void *)impl->service_members,
+    (void *)impl->rmw_subscription_members, (void *)impl->rmw_guard_condition_members,
+    (void *)impl->rmw_client_members, (void *)impl->rmw_service_members,
+  };
+  const size_t counts[9] = {
+    wait_set->size_of_subscriptions, wait_set->size_of_guard_conditions,
+    wait_set->size_of_timers, wait_set->size_of_clients, wait_set->size_of_services,
+    wait_set->size_of_subscriptions,
+    wait_set->size_of_guard_conditions + wait_set->size_of_timers,
+    wait_set->size_of_clients, wait_set->size_of_services,
+  };
+  size_t i;
+  for (i = 0; i < 9; ++i) {
+    if (NULL != arrays[i]) {
+      if (NULL == begin) {
+        begin = (char *)arrays[i];
+      }
+      end = (char *)arrays[i] + sizeof(void *) * counts[i];
+    }
+  }
+  if (NULL != begin) {
+    memset(begin, 0, (size_t)(end - begin));
+  }
+}
+
 static void
 __wait_set_clean_up(rcl_wait_set_t * wait_set, rcl_allocator_t allocator)
 {
-  if (wait_set->subscriptions) {
-    rcl_ret_t ret = rcl_wait_set_resize(wait_set, 0, 0, 0, 0, 0);
+  if (wait_set->impl) {
+    rcl_wait_set_impl_t * impl = wait_set->impl;
+    // Resizing to 0 would still lay out the deadline guard condition, so free the block directly.
+    allocator.deallocate(impl->storage, allocator.state);
+    impl->storage = NULL;
+    impl->storage_capacity = 0u;
+    impl->persistent = false;
+    wait_set->size_of_subscriptions = 0;
+    wait_set->size_of_guard_conditions = 0;
+    wait_set->size_of_timers = 0;
+    wait_set->size_of_clients = 0;
+    wait_set->size_of_services = 0;
+    impl->rmw_subscriptions.subscriber_count = 0;
+    impl->rmw_guard_conditions.guard_condition_count = 0;
+    impl->rmw_clients.client_count = 0;
+    impl->rmw_services.service_count = 0;
+    impl->ready_entity_count = 0;
+    impl->timer_queue_count = 0;
+    impl->timer_guard_condition_count = 0;
+    // Without a storage block every array is set to NULL.
+    __wait_set_storage_layout(wait_set, true);
+    rcl_ret_t ret = rcl_guard_condition_fini(&impl->deadline_guard_condition);
     (void)ret;  // NO LINT
-    assert(RCL_RET_OK == ret);  // Defensive, shouldn't fail with size 0.
+    assert(RCL_RET_OK == ret);
   }
   if (wait_set->impl) {
     allocator.deallocate(wait_set->impl, allocator.state);
@@ -118,6 +364,8 @@ rcl_wait_set_init(
   RCL_CHECK_FOR_NULL_WITH_MSG(
     wait_set->impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
   memset(wait_set->impl, 0, sizeof(rcl_wait_set_impl_t));
+  __wait_set_statistics_reset(wait_set->impl);
+  wait_set->impl->deadline_guard_condition = rcl_get_zero_initialized_guard_condition();
   wait_set->impl->rmw_subscriptions.subscribers = NULL;
   wait_set->impl->rmw_subscriptions.subscriber_count = 0;
   wait_set->impl->rmw_guard_conditions.guard_conditions = NULL;
@@ -136,7 +384,7 @@ rcl_wait_set_init(
 
   // Set allocator.
   wait_set->impl->allocator = allocator;
-  // Initialize subscription space.
+  // Initialize the storage of all entities.
   rcl_ret_t ret = rcl_wait_set_resize(
     wait_set, number_of_subscriptions, number_of_guard_conditions, number_of_timers,
     number_of_clients, number_of_services);
@@ -186,6 +434,23 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
   return RCL_RET_OK;
 }
 
+// Find a slot freed by a remove call, only persistent wait sets have members.
+static bool
+__wait_set_find_free_member(const void ** members, size_t count, size_t * index)
+{
+  size_t i;
+  if (NULL == members) {
+    return false;
+  }
+  for (i = 0; i < count; ++i) {
+    if (NULL == members[i]) {
+      *index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
 #define SET_ADD(Type) \
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT); \
   if (!__wait_set_is_valid(wait_set)) { \
@@ -193,24 +458,65 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
     return RCL_RET_WAIT_SET_INVALID; \
   } \
   RCL_CHECK_ARGUMENT_FOR_NULL(Type, RCL_RET_INVALID_ARGUMENT); \
-  if (!(wait_set->impl->Type ## _index < wait_set->size_of_ ## Type ## s)) { \
+  size_t current_index = wait_set->impl->Type ## _index; \
+  if (current_index < wait_set->size_of_ ## Type ## s) { \
+    wait_set->impl->Type ## _index++; \
+  } else if (!__wait_set_find_free_member( \
+      (const void **)wait_set->impl->Type ## _members, current_index, &current_index)) \
+  { \
     RCL_SET_ERROR_MSG(#Type "s set is full"); \
     return RCL_RET_WAIT_SET_FULL; \
   } \
-  size_t current_index = wait_set->impl->Type ## _index++; \
   wait_set->Type ## s[current_index] = Type; \
+  if (wait_set->impl->persistent) { \
+    wait_set->impl->Type ## _members[current_index] = Type; \
+  } \
   /* Set optional output argument */ \
   if (NULL != index) { \
     *index = current_index; \
   }
 
-#define SET_ADD_RMW(Type, RMWStorage, RMWCount) \
-  /* Also place into rmw storage. */ \
+#define SET_ADD_RMW(Type, RMWStorage, RMWCount, RMWMembers) \
+  /* Also place into rmw storage, or the rmw membership storage if persistent. */ \
   rmw_ ## Type ## _t * rmw_handle = rcl_ ## Type ## _get_rmw_handle(Type); \
   RCL_CHECK_FOR_NULL_WITH_MSG( \
     rmw_handle, rcl_get_error_string().str, return RCL_RET_ERROR); \
-  wait_set->impl->RMWStorage[current_index] = rmw_handle->data; \
-  wait_set->impl->RMWCount++;
+  if (wait_set->impl->persistent) { \
+    wait_set->impl->RMWMembers[current_index] = rmw_handle->data; \
+  } else { \
+    wait_set->impl->RMWStorage[current_index] = rmw_handle->data; \
+    wait_set->impl->RMWCount++; \
+  }
+
+#define SET_REMOVE(Type) \
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT); \
+  if (!__wait_set_is_valid(wait_set)) { \
+    RCL_SET_ERROR_MSG("wait set is invalid"); \
+    return RCL_RET_WAIT_SET_INVALID; \
+  } \
+  if (!wait_set->impl->persistent) { \
+    RCL_SET_ERROR_MSG("wait set is not persistent"); \
+    return RCL_RET_ERROR; \
+  } \
+  if (!(index < wait_set->impl->Type ## _index)) { \
+    RCL_SET_ERROR_MSG(#Type " index is out of range"); \
+    return RCL_RET_INVALID_ARGUMENT; \
+  } \
+  wait_set->Type ## s[index] = NULL; \
+  wait_set->impl->Type ## _members[index] = NULL;
+
+#define SET_RESTORE(Type, RMWStorage, RMWCount, RMWMembers) \
+  do { \
+    /* Refill the rcl storage and pack the members into the rmw storage. */ \
+    size_t i; \
+    wait_set->impl->RMWCount = 0; \
+    for (i = 0; i < wait_set->impl->Type ## _index; ++i) { \
+      wait_set->Type ## s[i] = wait_set->impl->Type ## _members[i]; \
+      if (NULL != wait_set->impl->RMWMembers[i]) { \
+        wait_set->impl->RMWStorage[wait_set->impl->RMWCount++] = wait_set->impl->RMWMembers[i]; \
+      } \
+    } \
+  } while (false)
 
 #define SET_CLEAR(Type) \
   do { \
@@ -221,6 +527,12 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
         sizeof(rcl_ ## Type ## _t *) * wait_set->size_of_ ## Type ## s); \
       wait_set->impl->Type ## _index = 0; \
     } \
+    if (NULL != wait_set->impl->Type ## _members) { \
+      memset( \
+        (void *)wait_set->impl->Type ## _members, \
+        0, \
+        sizeof(rcl_ ## Type ## _t *) * wait_set->size_of_ ## Type ## s); \
+    } \
   } while (false)
 
 #define SET_CLEAR_RMW(Type, RMWStorage, RMWCount) \
@@ -235,50 +547,6 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
     } \
   } while (false)
 
-#define SET_RESIZE(Type, ExtraDealloc, ExtraRealloc) \
-  do { \
-    rcl_allocator_t allocator = wait_set->impl->allocator; \
-    wait_set->size_of_ ## Type ## s = 0; \
-    wait_set->impl->Type ## _index = 0; \
-    if (0 == Type ## s_size) { \
-      if (wait_set->Type ## s) { \
-        allocator.deallocate((void *)wait_set->Type ## s, allocator.state); \
-        wait_set->Type ## s = NULL; \
-      } \
-      ExtraDealloc \
-    } else { \
-      wait_set->Type ## s = (const rcl_ ## Type ## _t **)allocator.reallocate( \
-        (void *)wait_set->Type ## s, sizeof(rcl_ ## Type ## _t *) * Type ## s_size, \
-        allocator.state); \
-      RCL_CHECK_FOR_NULL_WITH_MSG( \
-        wait_set->Type ## s, "allocating memory failed", return RCL_RET_BAD_ALLOC); \
-      memset((void *)wait_set->Type ## s, 0, sizeof(rcl_ ## Type ## _t *) * Type ## s_size); \
-      wait_set->size_of_ ## Type ## s = Type ## s_size; \
-      ExtraRealloc \
-    } \
-  } while (false)
-
-#define SET_RESIZE_RMW_DEALLOC(RMWStorage, RMWCount) \
-  /* Also deallocate the rmw storage. */ \
-  if (wait_set->impl->RMWStorage) { \
-    allocator.deallocate((void *)wait_set->impl->RMWStorage, allocator.state); \
-    wait_set->impl->RMWStorage = NULL; \
-    wait_set->impl->RMWCount = 0; \
-  }
-
-#define SET_RESIZE_RMW_REALLOC(Type, RMWStorage, RMWCount) \
-  /* Also resize the rmw storage. */ \
-  wait_set->impl->RMWCount = 0; \
-  wait_set->impl->RMWStorage = (void **)allocator.reallocate( \
-    wait_set->impl->RMWStorage, sizeof(void *) * Type ## s_size, allocator.state); \
-  if (!wait_set->impl->RMWStorage) { \
-    allocator.deallocate((void *)wait_set->Type ## s, allocator.state); \
-    wait_set->size_of_ ## Type ## s = 0; \
-    RCL_SET_ERROR_MSG("allocating memory failed"); \
-    return RCL_RET_BAD_ALLOC; \
-  } \
-  memset(wait_set->impl->RMWStorage, 0, sizeof(void *) * Type ## s_size);
-
 /* Implementation-specific notes:
  *
  * Add the rmw representation to the underlying rmw array and increment
@@ -291,7 +559,8 @@ rcl_wait_set_add_subscription(
   size_t * index)
 {
   SET_ADD(subscription)
-  SET_ADD_RMW(subscription, rmw_subscriptions.subscribers, rmw_subscriptions.subscriber_count)
+  SET_ADD_RMW(subscription, rmw_subscriptions.subscribers, rmw_subscriptions.subscriber_count,
+    rmw_subscription_members)
   return RCL_RET_OK;
 }
 
@@ -329,12 +598,20 @@ rcl_wait_set_clear(rcl_wait_set_t * wait_set)
     rmw_services.services,
     rmw_services.service_count);
 
+  wait_set->impl->ready_entity_count = 0u;
+  wait_set->impl->timer_queues_dirty = true;
+
+  // Also forget the rmw members, keeping their storage.
+  __wait_set_members_clear(wait_set);
+
   return RCL_RET_OK;
 }
 
 /* Implementation-specific notes:
  *
- * Similarly, the underlying rmw representation is reallocated and reset:
+ * All of the rcl and rmw storage is carved out of one block, which only
+ * grows, geometrically, when the new sizes do not fit.
+ * Similarly, the underlying rmw representation is reset:
  * all entries are set to null and the count is set to zero.
  */
 rcl_ret_t
@@ -348,59 +625,53 @@ rcl_wait_set_resize(
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set->impl, RCL_RET_WAIT_SET_INVALID);
-  SET_RESIZE(
-    subscription,
-    SET_RESIZE_RMW_DEALLOC(
-      rmw_subscriptions.subscribers, rmw_subscriptions.subscriber_count),
-    SET_RESIZE_RMW_REALLOC(
-      subscription, rmw_subscriptions.subscribers, rmw_subscriptions.subscriber_count)
-  );
-  // Guard condition RCL size is the resize amount given
-  SET_RESIZE(guard_condition,;,;);  // NOLINT
-
-  // Guard condition RMW size needs to be guard conditions + timers
-  rmw_guard_conditions_t * rmw_gcs = &(wait_set->impl->rmw_guard_conditions);
-  const size_t num_rmw_gc = guard_conditions_size + timers_size;
-  // Clear added guard conditions
-  rmw_gcs->guard_condition_count = 0u;
-  if (0u == num_rmw_gc) {
-    if (rmw_gcs->guard_conditions) {
-      wait_set->impl->allocator.deallocate(
-        (void *)rmw_gcs->guard_conditions, wait_set->impl->allocator.state);
-      rmw_gcs->guard_conditions = NULL;
-    }
-  } else {
-    rmw_gcs->guard_conditions = (void **)wait_set->impl->allocator.reallocate(
-      rmw_gcs->guard_conditions, sizeof(void *) * num_rmw_gc, wait_set->impl->allocator.state);
-    if (!rmw_gcs->guard_conditions) {
-      // Deallocate rcl arrays to match unallocated rmw guard conditions
-      wait_set->impl->allocator.deallocate(
-        (void *)wait_set->guard_conditions, wait_set->impl->allocator.state);
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  wait_set->size_of_subscriptions = subscriptions_size;
+  wait_set->size_of_guard_conditions = guard_conditions_size;
+  wait_set->size_of_timers = timers_size;
+  wait_set->size_of_clients = clients_size;
+  wait_set->size_of_services = services_size;
+  const size_t size = __wait_set_storage_layout(wait_set, false);
+  if (size > impl->storage_capacity) {
+    rcl_allocator_t allocator = impl->allocator;
+    size_t capacity = 2u * impl->storage_capacity;
+    if (capacity < size) {
+      capacity = size;
+    }
+    // The contents are reset anyway, so there is nothing to copy.
+    allocator.deallocate(impl->storage, allocator.state);
+    impl->storage = allocator.allocate(capacity, allocator.state);
+    impl->storage_capacity = NULL == impl->storage ? 0u : capacity;
+    if (NULL == impl->storage) {
+      wait_set->size_of_subscriptions = 0u;
       wait_set->size_of_guard_conditions = 0u;
-      wait_set->guard_conditions = NULL;
-      wait_set->impl->allocator.deallocate(
-        (void *)wait_set->timers, wait_set->impl->allocator.state);
       wait_set->size_of_timers = 0u;
-      wait_set->timers = NULL;
-      RCL_SET_ERROR_MSG("allocating memory failed");
-      return RCL_RET_BAD_ALLOC;
-    }
-    memset(rmw_gcs->guard_conditions, 0, sizeof(void *) * num_rmw_gc);
-  }
-
-  SET_RESIZE(timer,;,;);  // NOLINT
-  SET_RESIZE(client,
-    SET_RESIZE_RMW_DEALLOC(
-      rmw_clients.clients, rmw_clients.client_count),
-    SET_RESIZE_RMW_REALLOC(
-      client, rmw_clients.clients, rmw_clients.client_count)
-  );
-  SET_RESIZE(service,
-    SET_RESIZE_RMW_DEALLOC(
-      rmw_services.services, rmw_services.service_count),
-    SET_RESIZE_RMW_REALLOC(
-      service, rmw_services.services, rmw_services.service_count)
-  );
+      wait_set->size_of_clients = 0u;
+      wait_set->size_of_services = 0u;
+    }
+  }
+  __wait_set_storage_layout(wait_set, true);
+  impl->subscription_index = 0u;
+  impl->guard_condition_index = 0u;
+  impl->timer_index = 0u;
+  impl->client_index = 0u;
+  impl->service_index = 0u;
+  impl->rmw_subscriptions.subscriber_count = 0u;
+  impl->rmw_guard_conditions.guard_condition_count = 0u;
+  impl->rmw_clients.client_count = 0u;
+  impl->rmw_services.service_count = 0u;
+  impl->ready_entity_count = 0u;
+  impl->timer_queue_count = 0u;
+  impl->timer_guard_condition_count = 0u;
+  impl->timer_queues_dirty = true;
+  if (NULL == impl->storage) {
+    if (0u == size) {
+      return RCL_RET_OK;
+    }
+    RCL_SET_ERROR_MSG("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  memset(impl->storage, 0, size);
   return RCL_RET_OK;
 }
 
@@ -412,7 +683,7 @@ rcl_wait_set_add_guard_condition(
 {
   SET_ADD(guard_condition)
   SET_ADD_RMW(guard_condition, rmw_guard_conditions.guard_conditions,
-    rmw_guard_conditions.guard_condition_count)
+    rmw_guard_conditions.guard_condition_count, rmw_guard_condition_members)
 
   return RCL_RET_OK;
 }
@@ -424,15 +695,20 @@ rcl_wait_set_add_timer(
   size_t * index)
 {
   SET_ADD(timer)
+  wait_set->impl->timer_queues_dirty = true;
   // Add timer guard conditions to end of rmw guard condtion set.
   rcl_guard_condition_t * guard_condition = rcl_timer_get_guard_condition(timer);
   if (NULL != guard_condition) {
     // rcl_wait() will take care of moving these backwards and setting guard_condition_count.
-    const size_t index = wait_set->size_of_guard_conditions + (wait_set->impl->timer_index - 1);
+    const size_t index = wait_set->size_of_guard_conditions + current_index;
     rmw_guard_condition_t * rmw_handle = rcl_guard_condition_get_rmw_handle(guard_condition);
     RCL_CHECK_FOR_NULL_WITH_MSG(
       rmw_handle, rcl_get_error_string().str, return RCL_RET_ERROR);
-    wait_set->impl->rmw_guard_conditions.guard_conditions[index] = rmw_handle->data;
+    if (wait_set->impl->persistent) {
+      wait_set->impl->rmw_guard_condition_members[index] = rmw_handle->data;
+    } else {
+      wait_set->impl->rmw_guard_conditions.guard_conditions[index] = rmw_handle->data;
+    }
   }
   return RCL_RET_OK;
 }
@@ -444,7 +720,7 @@ rcl_wait_set_add_client(
   size_t * index)
 {
   SET_ADD(client)
-  SET_ADD_RMW(client, rmw_clients.clients, rmw_clients.client_count)
+  SET_ADD_RMW(client, rmw_clients.clients, rmw_clients.client_count, rmw_client_members)
   return RCL_RET_OK;
 }
 
@@ -455,12 +731,824 @@ rcl_wait_set_add_service(
   size_t * index)
 {
   SET_ADD(service)
-  SET_ADD_RMW(service, rmw_services.services, rmw_services.service_count)
+  SET_ADD_RMW(service, rmw_services.services, rmw_services.service_count, rmw_service_members)
+  return RCL_RET_OK;
+}
+
+// Refill the rcl and rmw storage from the members of a persistent wait set.
+static void
+__wait_set_restore_members(rcl_wait_set_t * wait_set)
+{
+  SET_RESTORE(
+    subscription, rmw_subscriptions.subscribers, rmw_subscriptions.subscriber_count,
+    rmw_subscription_members);
+  SET_RESTORE(
+    guard_condition, rmw_guard_conditions.guard_conditions,
+    rmw_guard_conditions.guard_condition_count, rmw_guard_condition_members);
+  SET_RESTORE(client, rmw_clients.clients, rmw_clients.client_count, rmw_client_members);
+  SET_RESTORE(service, rmw_services.services, rmw_services.service_count, rmw_service_members);
+  // Timers are not given to rmw, only their guard conditions which rcl_wait() packs itself.
+  size_t i;
+  for (i = 0; i < wait_set->impl->timer_index; ++i) {
+    const size_t gc_idx = wait_set->size_of_guard_conditions + i;
+    wait_set->timers[i] = wait_set->impl->timer_members[i];
+    wait_set->impl->rmw_guard_conditions.guard_conditions[gc_idx] =
+      wait_set->impl->rmw_guard_condition_members[gc_idx];
+  }
+}
+
+rcl_ret_t
+rcl_wait_set_set_persistent(rcl_wait_set_t * wait_set, bool persistent)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  if (persistent == impl->persistent) {
+    return RCL_RET_OK;
+  }
+  impl->persistent = persistent;
+  // The membership storage is always reserved, it only needs to be pointed into.
+  __wait_set_storage_layout(wait_set, true);
+  if (!persistent) {
+    // Leaving persistent mode empties the wait set, as rcl_wait_set_clear() would.
+    return rcl_wait_set_clear(wait_set);
+  }
+  __wait_set_members_clear(wait_set);
+  impl->timer_queues_dirty = true;
+  // Entities added before switching become members, this is the last time their rmw storage
+  // is used directly.
+  size_t i;
+  for (i = 0; i < impl->subscription_index; ++i) {
+    impl->subscription_members[i] = wait_set->subscriptions[i];
+    impl->rmw_subscription_members[i] = impl->rmw_subscriptions.subscribers[i];
+  }
+  for (i = 0; i < impl->guard_condition_index; ++i) {
+    impl->guard_condition_members[i] = wait_set->guard_conditions[i];
+    impl->rmw_guard_condition_members[i] = impl->rmw_guard_conditions.guard_conditions[i];
+  }
+  for (i = 0; i < impl->timer_index; ++i) {
+    const size_t gc_idx = wait_set->size_of_guard_conditions + i;
+    impl->timer_members[i] = wait_set->timers[i];
+    impl->rmw_guard_condition_members[gc_idx] = impl->rmw_guard_conditions.guard_conditions[gc_idx];
+  }
+  for (i = 0; i < impl->client_index; ++i) {
+    impl->client_members[i] = wait_set->clients[i];
+    impl->rmw_client_members[i] = impl->rmw_clients.clients[i];
+  }
+  for (i = 0; i < impl->service_index; ++i) {
+    impl->service_members[i] = wait_set->services[i];
+    impl->rmw_service_members[i] = impl->rmw_services.services[i];
+  }
   return RCL_RET_OK;
 }
 
 rcl_ret_t
-rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
+rcl_wait_set_is_persistent(const rcl_wait_set_t * wait_set, bool * persistent)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(persistent, RCL_RET_INVALID_ARGUMENT);
+  *persistent = wait_set->impl->persistent;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_set_spin_budget(rcl_wait_set_t * wait_set, int64_t spin_budget)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  if (spin_budget < 0) {
+    RCL_SET_ERROR_MSG("spin budget must be non-negative");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  wait_set->impl->spin_budget = spin_budget;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_get_spin_budget(const rcl_wait_set_t * wait_set, int64_t * spin_budget)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(spin_budget, RCL_RET_INVALID_ARGUMENT);
+  *spin_budget = wait_set->impl->spin_budget;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_get_spin_statistics(
+  const rcl_wait_set_t * wait_set,
+  rcl_wait_set_spin_statistics_t * statistics)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  *statistics = wait_set->impl->spin_statistics;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_reset_spin_statistics(rcl_wait_set_t * wait_set)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  memset(&wait_set->impl->spin_statistics, 0, sizeof(rcl_wait_set_spin_statistics_t));
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_enable_statistics(rcl_wait_set_t * wait_set, bool enabled)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  wait_set->impl->statistics_enabled = enabled;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_get_statistics(
+  const rcl_wait_set_t * wait_set,
+  rcl_wait_set_statistics_t * statistics)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  statistics->wait_count = rcutils_atomic_load_uint64_t(&impl->wait_count);
+  statistics->timeout_count = rcutils_atomic_load_uint64_t(&impl->timeout_count);
+  statistics->empty_wake_count = rcutils_atomic_load_uint64_t(&impl->empty_wake_count);
+  statistics->blocked_time = (int64_t)rcutils_atomic_load_uint64_t(&impl->total_blocked_time);
+  statistics->bookkeeping_time =
+    (int64_t)rcutils_atomic_load_uint64_t(&impl->total_bookkeeping_time);
+  size_t type;
+  size_t bucket;
+  for (type = 0; type < RCL_WAIT_SET_ENTITY_TYPE_COUNT; ++type) {
+    for (bucket = 0; bucket < RCL_WAIT_SET_READY_HISTOGRAM_SIZE; ++bucket) {
+      statistics->ready_histogram[type][bucket] =
+        rcutils_atomic_load_uint64_t(&impl->ready_histogram[type][bucket]);
+    }
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_reset_statistics(rcl_wait_set_t * wait_set)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  __wait_set_statistics_reset(wait_set->impl);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_remove_subscription(rcl_wait_set_t * wait_set, size_t index)
+{
+  SET_REMOVE(subscription)
+  wait_set->impl->rmw_subscription_members[index] = NULL;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_remove_guard_condition(rcl_wait_set_t * wait_set, size_t index)
+{
+  SET_REMOVE(guard_condition)
+  wait_set->impl->rmw_guard_condition_members[index] = NULL;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_remove_timer(rcl_wait_set_t * wait_set, size_t index)
+{
+  SET_REMOVE(timer)
+  wait_set->impl->rmw_guard_condition_members[wait_set->size_of_guard_conditions + index] = NULL;
+  wait_set->impl->timer_queues_dirty = true;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_remove_client(rcl_wait_set_t * wait_set, size_t index)
+{
+  SET_REMOVE(client)
+  wait_set->impl->rmw_client_members[index] = NULL;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_remove_service(rcl_wait_set_t * wait_set, size_t index)
+{
+  SET_REMOVE(service)
+  wait_set->impl->rmw_service_members[index] = NULL;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_wait_set_get_ready_entities(
+  const rcl_wait_set_t * wait_set,
+  const rcl_wait_set_ready_entity_t ** ready_entities,
+  size_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(ready_entities, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  *ready_entities = wait_set->impl->ready_entities;
+  *count = wait_set->impl->ready_entity_count;
+  return RCL_RET_OK;
+}
+
+// Rank of the entity types in the order filled by rcl_wait().
+static int
+__dispatch_key_type_rank(rcl_wait_set_entity_type_t type)
+{
+  return RCL_WAIT_SET_TIMER == type ? -1 : (int)type;
+}
+
+static int
+__dispatch_key_compare_position(
+  const rcl_wait_set_dispatch_key_t * a,
+  const rcl_wait_set_dispatch_key_t * b)
+{
+  return (a->position > b->position) - (a->position < b->position);
+}
+
+static int
+__dispatch_key_compare_wait_set(const void * lhs, const void * rhs)
+{
+  const rcl_wait_set_dispatch_key_t * a = lhs;
+  const rcl_wait_set_dispatch_key_t * b = rhs;
+  int a_rank = __dispatch_key_type_rank(a->entity.type);
+  int b_rank = __dispatch_key_type_rank(b->entity.type);
+  if (a_rank != b_rank) {
+    return a_rank < b_rank ? -1 : 1;
+  }
+  return (a->entity.index > b->entity.index) - (a->entity.index < b->entity.index);
+}
+
+static int
+__dispatch_key_compare_deadline(const void * lhs, const void * rhs)
+{
+  const rcl_wait_set_dispatch_key_t * a = lhs;
+  const rcl_wait_set_dispatch_key_t * b = rhs;
+  if (a->time_left != b->time_left) {
+    return a->time_left < b->time_left ? -1 : 1;
+  }
+  if (a->priority != b->priority) {
+    return a->priority > b->priority ? -1 : 1;
+  }
+  return __dispatch_key_compare_position(a, b);
+}
+
+static int
+__dispatch_key_compare_priority(const void * lhs, const void * rhs)
+{
+  const rcl_wait_set_dispatch_key_t * a = lhs;
+  const rcl_wait_set_dispatch_key_t * b = rhs;
+  if (a->priority != b->priority) {
+    return a->priority > b->priority ? -1 : 1;
+  }
+  if (a->time_left != b->time_left) {
+    return a->time_left < b->time_left ? -1 : 1;
+  }
+  return __dispatch_key_compare_position(a, b);
+}
+
+// Fill the priority and time left until the deadline of a ready entity.
+static void
+__wait_set_dispatch_key_init(
+  const rcl_wait_set_t * wait_set,
+  rcl_wait_set_dispatch_key_t * key)
+{
+  rcl_dispatch_attributes_t attributes = {0};
+  int64_t time_until_next_call = 0;
+  const size_t index = key->entity.index;
+  switch (key->entity.type) {
+    case RCL_WAIT_SET_SUBSCRIPTION:
+      {
+        const rcl_subscription_options_t * options =
+          rcl_subscription_get_options(wait_set->subscriptions[index]);
+        if (NULL != options) {
+          attributes = options->dispatch;
+        }
+      }
+      break;
+    case RCL_WAIT_SET_TIMER:
+      // A canceled timer is treated as having no deadline.
+      if (
+        RCL_RET_OK != rcl_timer_get_dispatch_attributes(wait_set->timers[index], &attributes) ||
+        RCL_RET_OK != rcl_timer_get_time_until_next_call(
+          wait_set->timers[index], &time_until_next_call))
+      {
+        rcl_reset_error();
+        attributes.deadline = 0;
+      }
+      break;
+    case RCL_WAIT_SET_CLIENT:
+      {
+        const rcl_client_options_t * options = rcl_client_get_options(wait_set->clients[index]);
+        if (NULL != options) {
+          attributes = options->dispatch;
+        }
+      }
+      break;
+    case RCL_WAIT_SET_SERVICE:
+      {
+        const rcl_service_options_t * options = rcl_service_get_options(wait_set->services[index]);
+        if (NULL != options) {
+          attributes = options->dispatch;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  key->priority = attributes.priority;
+  key->time_left = INT64_MAX;
+  if (attributes.deadline > 0) {
+    // Saturate below INT64_MAX, which stands for no deadline.
+    if (time_until_next_call > 0 && attributes.deadline >= INT64_MAX - time_until_next_call) {
+      key->time_left = INT64_MAX - 1;
+    } else {
+      key->time_left = attributes.deadline + time_until_next_call;
+    }
+  }
+}
+
+rcl_ret_t
+rcl_wait_set_sort_ready_entities(rcl_wait_set_t * wait_set, rcl_dispatch_order_t order)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  int (* compare)(const void *, const void *) = NULL;
+  switch (order) {
+    case RCL_DISPATCH_ORDER_WAIT_SET:
+      compare = __dispatch_key_compare_wait_set;
+      break;
+    case RCL_DISPATCH_ORDER_PRIORITY:
+      compare = __dispatch_key_compare_priority;
+      break;
+    case RCL_DISPATCH_ORDER_EARLIEST_DEADLINE:
+      compare = __dispatch_key_compare_deadline;
+      break;
+    default:
+      RCL_SET_ERROR_MSG("unknown dispatch order");
+      return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  const size_t count = impl->ready_entity_count;
+  if (count < 2u) {
+    return RCL_RET_OK;
+  }
+  rcl_wait_set_dispatch_key_t * keys = impl->dispatch_keys;
+  for (size_t i = 0u; i < count; ++i) {
+    keys[i].entity = impl->ready_entities[i];
+    keys[i].position = i;
+    if (RCL_DISPATCH_ORDER_WAIT_SET != order) {
+      __wait_set_dispatch_key_init(wait_set, &keys[i]);
+    }
+  }
+  qsort(keys, count, sizeof(rcl_wait_set_dispatch_key_t), compare);
+  for (size_t i = 0u; i < count; ++i) {
+    impl->ready_entities[i] = keys[i].entity;
+  }
+  return RCL_RET_OK;
+}
+
+static void
+__timer_queue_sift_down(rcl_wait_set_timer_queue_t * queue, size_t index)
+{
+  rcl_wait_set_timer_node_t * nodes = queue->nodes;
+  while (true) {
+    size_t smallest = index;
+    const size_t left = 2 * index + 1;
+    const size_t right = left + 1;
+    if (left < queue->count && nodes[left].next_call_time < nodes[smallest].next_call_time) {
+      smallest = left;
+    }
+    if (right < queue->count && nodes[right].next_call_time < nodes[smallest].next_call_time) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      return;
+    }
+    rcl_wait_set_timer_node_t tmp = nodes[index];
+    nodes[index] = nodes[smallest];
+    nodes[smallest] = tmp;
+    index = smallest;
+  }
+}
+
+// Group the timers which are not canceled by clock, and order each group by next call time.
+static rcl_ret_t
+__wait_set_build_timer_queues(rcl_wait_set_t * wait_set)
+{
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  impl->timer_queue_count = 0u;
+  impl->timer_guard_condition_count = 0u;
+  size_t node_count = 0u;
+  size_t i;
+  for (i = 0; i < impl->timer_index; ++i) {
+    const rcl_timer_t * timer = wait_set->timers[i];
+    if (NULL == timer) {
+      continue;
+    }
+    // Canceled timers keep their guard condition, they may be reset during the wait.
+    if (NULL != rcl_timer_get_guard_condition(timer)) {
+      impl->timer_guard_condition_indices[impl->timer_guard_condition_count++] = i;
+    }
+    rcl_clock_t * clock = NULL;
+    rcl_ret_t ret = rcl_timer_clock((rcl_timer_t *)timer, &clock);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+    // Canceled timers get a queue for their clock too, so that a reset is noticed.
+    size_t q;
+    for (q = 0; q < impl->timer_queue_count && impl->timer_queues[q].clock != clock; ++q) {
+    }
+    if (q == impl->timer_queue_count) {
+      impl->timer_queues[q].clock = clock;
+      // Read the epoch first, so a reset racing with this build causes another build.
+      impl->timer_queues[q].schedule_epoch = rcl_clock_get_schedule_epoch(clock);
+      impl->timer_queue_count++;
+    }
+    bool is_canceled = false;
+    ret = rcl_timer_is_canceled(timer, &is_canceled);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+    if (is_canceled) {
+      continue;
+    }
+    rcl_wait_set_timer_node_t * node = &impl->timer_nodes[node_count++];
+    node->index = i;
+    node->timer = timer;
+    ret = rcl_timer_get_next_call_time(timer, &node->next_call_time);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+  }
+  // Partition the nodes by clock, there are rarely more than a few clocks.
+  size_t begin = 0u;
+  size_t q;
+  for (q = 0; q < impl->timer_queue_count; ++q) {
+    rcl_wait_set_timer_queue_t * queue = &impl->timer_queues[q];
+    queue->nodes = &impl->timer_nodes[begin];
+    for (i = begin; i < node_count; ++i) {
+      rcl_clock_t * clock = NULL;
+      rcl_ret_t ret = rcl_timer_clock((rcl_timer_t *)impl->timer_nodes[i].timer, &clock);
+      if (RCL_RET_OK != ret) {
+        return ret;  // The rcl error state should already be set.
+      }
+      if (clock == queue->clock) {
+        rcl_wait_set_timer_node_t tmp = impl->timer_nodes[begin];
+        impl->timer_nodes[begin++] = impl->timer_nodes[i];
+        impl->timer_nodes[i] = tmp;
+      }
+    }
+    queue->count = (size_t)(&impl->timer_nodes[begin] - queue->nodes);
+    for (i = queue->count / 2; i-- > 0; ) {
+      __timer_queue_sift_down(queue, i);
+    }
+  }
+  impl->timer_queues_dirty = false;
+  return RCL_RET_OK;
+}
+
+// Return true if the next call time of a timer may have moved back since the queues were built,
+// so that they no longer bound the next call times, looking at one epoch per clock.
+static bool
+__wait_set_timers_rescheduled(const rcl_wait_set_t * wait_set)
+{
+  const rcl_wait_set_impl_t * impl = wait_set->impl;
+  size_t q;
+  for (q = 0; q < impl->timer_queue_count; ++q) {
+    const rcl_wait_set_timer_queue_t * queue = &impl->timer_queues[q];
+    if (queue->schedule_epoch != rcl_clock_get_schedule_epoch(queue->clock)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Make the head of the queue exact: drop canceled timers and refresh a stale next call time.
+static rcl_ret_t
+__timer_queue_update_head(rcl_wait_set_timer_queue_t * queue)
+{
+  while (queue->count > 0u) {
+    rcl_wait_set_timer_node_t * head = &queue->nodes[0];
+    bool is_canceled = false;
+    rcl_ret_t ret = rcl_timer_is_canceled(head->timer, &is_canceled);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+    if (is_canceled) {
+      // It comes back when the queues are rebuilt after the timer is reset.
+      *head = queue->nodes[--queue->count];
+      __timer_queue_sift_down(queue, 0u);
+      continue;
+    }
+    int64_t next_call_time = 0;
+    ret = rcl_timer_get_next_call_time(head->timer, &next_call_time);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+    if (next_call_time == head->next_call_time) {
+      break;
+    }
+    head->next_call_time = next_call_time;
+    __timer_queue_sift_down(queue, 0u);
+  }
+  return RCL_RET_OK;
+}
+
+// Lower the wake up time to the end of the slack window of the timers which may be due before it.
+static rcl_ret_t
+__timer_queue_get_wake_up_time(
+  const rcl_wait_set_timer_queue_t * queue,
+  size_t index,
+  int64_t * wake_up_time)
+{
+  // Next call times in a subtree are at least the one of its root, so it can be skipped.
+  if (index >= queue->count || queue->nodes[index].next_call_time >= *wake_up_time) {
+    return RCL_RET_OK;
+  }
+  const rcl_timer_t * timer = queue->nodes[index].timer;
+  bool is_canceled = false;
+  rcl_ret_t ret = rcl_timer_is_canceled(timer, &is_canceled);
+  if (RCL_RET_OK != ret) {
+    return ret;  // The rcl error state should already be set.
+  }
+  if (!is_canceled) {
+    int64_t next_call_time = 0;
+    ret = rcl_timer_get_next_call_time(timer, &next_call_time);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+    int64_t slack = 0;
+    ret = rcl_timer_get_slack(timer, &slack);
+    if (RCL_RET_OK != ret) {
+      return ret;  // The rcl error state should already be set.
+    }
+    int64_t latest_call_time =
+      next_call_time > INT64_MAX - slack ? INT64_MAX : next_call_time + slack;
+    if (latest_call_time < *wake_up_time) {
+      *wake_up_time = latest_call_time;
+    }
+  }
+  ret = __timer_queue_get_wake_up_time(queue, 2 * index + 1, wake_up_time);
+  if (RCL_RET_OK != ret) {
+    return ret;
+  }
+  return __timer_queue_get_wake_up_time(queue, 2 * index + 2, wake_up_time);
+}
+
+#define SET_READY(EntityType, Index) \
+  do { \
+    rcl_wait_set_ready_entity_t * ready_entity = \
+      &wait_set->impl->ready_entities[wait_set->impl->ready_entity_count++]; \
+    ready_entity->type = EntityType; \
+    ready_entity->index = Index; \
+  } while (false)
+
+// Visit the nodes due at now, a node which is not due bounds its whole subtree.
+static rcl_ret_t
+__wait_set_collect_ready_timers(
+  rcl_wait_set_t * wait_set,
+  const rcl_wait_set_timer_queue_t * queue,
+  size_t index,
+  rcl_time_point_value_t now)
+{
+  if (index >= queue->count || queue->nodes[index].next_call_time > now) {
+    return RCL_RET_OK;
+  }
+  const rcl_wait_set_timer_node_t * node = &queue->nodes[index];
+  int64_t next_call_time = 0;
+  rcl_ret_t ret = rcl_timer_get_next_call_time(node->timer, &next_call_time);
+  if (RCL_RET_OK != ret) {
+    return ret;  // The rcl error state should already be set.
+  }
+  bool is_canceled = false;
+  ret = rcl_timer_is_canceled(node->timer, &is_canceled);
+  if (RCL_RET_OK != ret) {
+    return ret;  // The rcl error state should already be set.
+  }
+  if (!is_canceled && next_call_time <= now) {
+    RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Timer in wait set is ready");
+    wait_set->timers[node->index] = node->timer;
+    SET_READY(RCL_WAIT_SET_TIMER, node->index);
+  }
+  ret = __wait_set_collect_ready_timers(wait_set, queue, 2 * index + 1, now);
+  if (RCL_RET_OK != ret) {
+    return ret;
+  }
+  return __wait_set_collect_ready_timers(wait_set, queue, 2 * index + 2, now);
+}
+
+#define SET_RMW_INDEX(Type) \
+  if (!wait_set->impl->persistent) { \
+    rmw_index = i; \
+  } else if (NULL == wait_set->impl->Type ## _members[i]) { \
+    continue; \
+  } else { \
+    rmw_index = packed_index++; \
+  }
+
+// True if nothing needs to be passed to the middleware, e.g. only steady time timers were added.
+static bool
+__wait_set_has_no_rmw_entities(const rcl_wait_set_t * wait_set)
+{
+  return
+    0u == wait_set->impl->rmw_subscriptions.subscriber_count &&
+    0u == wait_set->impl->rmw_guard_conditions.guard_condition_count &&
+    0u == wait_set->impl->rmw_clients.client_count &&
+    0u == wait_set->impl->rmw_services.service_count;
+}
+
+// Sleep for the given duration without going through the middleware, if supported.
+static bool
+__wait_set_sleep(const rmw_time_t * duration)
+{
+#if defined(__linux__)
+  // Sleep until an absolute time, so being interrupted by signals does not add up.
+  struct timespec wake_up_time;
+  if (0 != clock_gettime(CLOCK_MONOTONIC, &wake_up_time)) {
+    return false;
+  }
+  wake_up_time.tv_sec += (time_t)duration->sec;
+  wake_up_time.tv_nsec += (long)duration->nsec;
+  if (wake_up_time.tv_nsec >= 1000000000L) {
+    wake_up_time.tv_sec += 1;
+    wake_up_time.tv_nsec -= 1000000000L;
+  }
+  int result;
+  do {
+    result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_up_time, NULL);
+  } while (EINTR == result);
+  return 0 == result;
+#else
+  (void)duration;
+  return false;
+#endif
+}
+
+#define SPIN_STORAGE_COPY(Dst, Src, Count) \
+  memcpy((void *)(Dst), (const void *)(Src), sizeof(void *) * (Count))
+
+// Save or restore the rmw storage, the counts are not changed by rmw_wait().
+static void
+__wait_set_spin_storage_copy(rcl_wait_set_t * wait_set, bool restore)
+{
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  void ** storage = impl->spin_storage;
+  void ** arrays[4] = {
+    impl->rmw_subscriptions.subscribers,
+    impl->rmw_guard_conditions.guard_conditions,
+    impl->rmw_clients.clients,
+    impl->rmw_services.services,
+  };
+  const size_t counts[4] = {
+    impl->rmw_subscriptions.subscriber_count,
+    impl->rmw_guard_conditions.guard_condition_count,
+    impl->rmw_clients.client_count,
+    impl->rmw_services.service_count,
+  };
+  size_t i;
+  for (i = 0; i < 4; ++i) {
+    if (0u == counts[i]) {
+      continue;
+    }
+    if (restore) {
+      SPIN_STORAGE_COPY(arrays[i], storage, counts[i]);
+    } else {
+      SPIN_STORAGE_COPY(storage, arrays[i], counts[i]);
+    }
+    storage += counts[i];
+  }
+}
+
+// Poll the middleware without blocking until something is ready or the spin budget is spent.
+// If the wait is not resolved, the timeout is reduced by the time spent spinning.
+static rcl_ret_t
+__wait_set_spin(
+  rcl_wait_set_t * wait_set,
+  rmw_time_t * timeout_argument,
+  rmw_ret_t * rmw_ret,
+  bool * resolved)
+{
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  int64_t timeout = INT64_MAX;
+  if (NULL != timeout_argument) {
+    timeout = (int64_t)RCL_S_TO_NS(timeout_argument->sec) + (int64_t)timeout_argument->nsec;
+  }
+  const int64_t budget = impl->spin_budget < timeout ? impl->spin_budget : timeout;
+  __wait_set_spin_storage_copy(wait_set, false);
+  ++impl->spin_statistics.spin_count;
+  rmw_time_t zero_timeout = {0, 0};
+  rcutils_time_point_value_t start;
+  rcutils_time_point_value_t now;
+  if (RCUTILS_RET_OK != rcutils_steady_time_now(&start)) {
+    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+    return RCL_RET_ERROR;
+  }
+  for (;;) {
+    *rmw_ret = rmw_wait(
+      &impl->rmw_subscriptions,
+      &impl->rmw_guard_conditions,
+      &impl->rmw_services,
+      &impl->rmw_clients,
+      impl->rmw_wait_set,
+      &zero_timeout);
+    if (RMW_RET_TIMEOUT != *rmw_ret) {
+      // Something is ready, or an error which is reported by the caller.
+      if (RMW_RET_OK == *rmw_ret) {
+        ++impl->spin_statistics.spin_wake_count;
+      }
+      *resolved = true;
+      return RCL_RET_OK;
+    }
+    if (RCUTILS_RET_OK != rcutils_steady_time_now(&now)) {
+      RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+      return RCL_RET_ERROR;
+    }
+    if (now - start >= budget) {
+      break;
+    }
+    __wait_set_spin_storage_copy(wait_set, true);
+  }
+  if (now - start >= timeout) {
+    // Keep the result of the last poll, in which nothing was ready.
+    ++impl->spin_statistics.timeout_count;
+    *resolved = true;
+    return RCL_RET_OK;
+  }
+  __wait_set_spin_storage_copy(wait_set, true);
+  if (NULL != timeout_argument) {
+    const int64_t remaining = timeout - (now - start);
+    timeout_argument->sec = RCL_NS_TO_S(remaining);
+    timeout_argument->nsec = remaining % 1000000000;
+  }
+  *resolved = false;
+  return RCL_RET_OK;
+}
+
+static void
+__wait_set_deadline_jump(
+  const struct rcl_time_jump_t * time_jump,
+  bool before_jump,
+  void * user_data)
+{
+  (void)time_jump;
+  if (before_jump) {
+    return;
+  }
+  rcl_wait_set_impl_t * impl = (rcl_wait_set_impl_t *)user_data;
+  rcl_time_point_value_t now;
+  if (RCL_RET_OK != rcl_clock_get_now(impl->deadline_clock, &now)) {
+    RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to get current time in jump callback");
+    return;
+  }
+  if (now >= impl->deadline) {
+    if (RCL_RET_OK != rcl_trigger_guard_condition(&impl->deadline_guard_condition)) {
+      RCUTILS_LOG_ERROR_NAMED(
+        ROS_PACKAGE_NAME, "Failed to trigger deadline guard condition in jump callback");
+    }
+  }
+}
+
+static rcl_ret_t
+__wait_impl(rcl_wait_set_t * wait_set, int64_t timeout, const rcl_wait_deadline_t * deadline)
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
   if (!__wait_set_is_valid(wait_set)) {
@@ -477,6 +1565,10 @@ rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
     RCL_SET_ERROR_MSG("wait set is empty");
     return RCL_RET_WAIT_SET_EMPTY;
   }
+  wait_set->impl->ready_entity_count = 0u;
+  if (wait_set->impl->persistent) {
+    __wait_set_restore_members(wait_set);
+  }
   // Calculate the timeout argument.
   // By default, set the timer to block indefinitely if none of the below conditions are met.
   rmw_time_t * timeout_argument = NULL;
@@ -484,53 +1576,94 @@ rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
 
   bool is_timer_timeout = false;
   int64_t min_timeout = timeout > 0 ? timeout : INT64_MAX;
+  // Rebuild the timer queues only if the timers changed, otherwise only the head of each
+  // queue is looked at and each clock is read once.
+  // Without persistent membership the timers change on every wait, so they are always rebuilt.
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  if (impl->timer_queues_dirty || __wait_set_timers_rescheduled(wait_set)) {
+    rcl_ret_t ret = __wait_set_build_timer_queues(wait_set);
+    if (ret != RCL_RET_OK) {
+      return ret;  // The rcl error state should already be set.
+    }
+  }
   // calculate the number of valid (non-NULL and non-canceled) timers
-  size_t number_of_valid_timers = wait_set->size_of_timers;
-  {  // scope to prevent i from colliding below
-    uint64_t i = 0;
-    for (i = 0; i < wait_set->impl->timer_index; ++i) {
-      if (!wait_set->timers[i]) {
-        number_of_valid_timers--;
-        continue;  // Skip NULL timers.
-      }
-      bool is_canceled = false;
-      rcl_ret_t ret = rcl_timer_is_canceled(wait_set->timers[i], &is_canceled);
+  size_t number_of_valid_timers = 0u;
+  {  // scope to prevent q from colliding below
+    size_t q;
+    for (q = 0; q < impl->timer_queue_count; ++q) {
+      rcl_wait_set_timer_queue_t * queue = &impl->timer_queues[q];
+      rcl_ret_t ret = __timer_queue_update_head(queue);
       if (ret != RCL_RET_OK) {
         return ret;  // The rcl error state should already be set.
       }
-      if (is_canceled) {
-        number_of_valid_timers--;
-        wait_set->timers[i] = NULL;
+      number_of_valid_timers += queue->count;
+      // Timers with ROS time use their guard condition instead to wake the wait set.
+      if (0u == queue->count || RCL_ROS_TIME == queue->clock->type) {
         continue;
       }
-      rmw_guard_conditions_t * rmw_gcs = &(wait_set->impl->rmw_guard_conditions);
-      size_t gc_idx = wait_set->size_of_guard_conditions + i;
+      rcl_time_point_value_t now;
+      ret = rcl_clock_get_now(queue->clock, &now);
+      if (ret != RCL_RET_OK) {
+        return ret;  // The rcl error state should already be set.
+      }
+      // Wake up once for all the timers whose slack window overlaps the earliest one.
+      int64_t wake_up_time = INT64_MAX;
+      ret = __timer_queue_get_wake_up_time(queue, 0u, &wake_up_time);
+      if (ret != RCL_RET_OK) {
+        return ret;  // The rcl error state should already be set.
+      }
+      int64_t timer_timeout = wake_up_time - now;
+      if (timer_timeout < min_timeout) {
+        is_timer_timeout = true;
+        min_timeout = timer_timeout;
+      }
+    }
+    // Move the guard conditions of timers backwards to make a legal wait set.
+    rmw_guard_conditions_t * rmw_gcs = &(impl->rmw_guard_conditions);
+    size_t k;
+    for (k = 0; k < impl->timer_guard_condition_count; ++k) {
+      size_t gc_idx = wait_set->size_of_guard_conditions + impl->timer_guard_condition_indices[k];
       if (NULL != rmw_gcs->guard_conditions[gc_idx]) {
-        // This timer has a guard condition, so move it to make a legal wait set.
         rmw_gcs->guard_conditions[rmw_gcs->guard_condition_count] =
           rmw_gcs->guard_conditions[gc_idx];
         ++(rmw_gcs->guard_condition_count);
-      } else {
-        // No guard condition, instead use to set the rmw_wait timeout
-        int64_t timer_timeout = INT64_MAX;
-        rcl_ret_t ret = rcl_timer_get_time_until_next_call(wait_set->timers[i], &timer_timeout);
-        if (ret != RCL_RET_OK) {
-          return ret;  // The rcl error state should already be set.
-        }
-        if (timer_timeout < min_timeout) {
-          is_timer_timeout = true;
-          min_timeout = timer_timeout;
-        }
       }
     }
   }
+  // The deadline guard condition goes last, after those of the timers.
+  size_t deadline_gc_index = SIZE_MAX;
+  if (NULL != deadline && deadline->use_guard_condition) {
+    rmw_guard_conditions_t * rmw_gcs = &(impl->rmw_guard_conditions);
+    rmw_guard_condition_t * rmw_handle =
+      rcl_guard_condition_get_rmw_handle(&impl->deadline_guard_condition);
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      rmw_handle, rcl_get_error_string().str, return RCL_RET_ERROR);
+    deadline_gc_index = rmw_gcs->guard_condition_count;
+    rmw_gcs->guard_conditions[rmw_gcs->guard_condition_count++] = rmw_handle->data;
+  }
+
+  bool is_deadline_timeout = false;
+  if (NULL != deadline && !deadline->use_guard_condition) {
+    // Convert the deadline as late as possible, so that the time spent above is accounted for.
+    rcl_time_point_value_t now;
+    rcl_ret_t ret = rcl_clock_get_now(deadline->clock, &now);
+    if (ret != RCL_RET_OK) {
+      return ret;  // The rcl error state should already be set.
+    }
+    int64_t deadline_timeout = deadline->time - now;
+    if (deadline_timeout < min_timeout) {
+      is_timer_timeout = false;
+      min_timeout = deadline_timeout;
+    }
+    is_deadline_timeout = true;
+  }
 
   if (timeout == 0) {
     // Then it is non-blocking, so set the temporary storage to 0, 0 and pass it.
     temporary_timeout_storage.sec = 0;
     temporary_timeout_storage.nsec = 0;
     timeout_argument = &temporary_timeout_storage;
-  } else if (timeout > 0 || number_of_valid_timers > 0) {
+  } else if (timeout > 0 || number_of_valid_timers > 0 || is_deadline_timeout) {
     // If min_timeout was negative, we need to wake up immediately.
     if (min_timeout < 0) {
       min_timeout = 0;
@@ -550,32 +1683,81 @@ rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
     is_timer_timeout ? "true" : "false");
 
   // Wait.
-  rmw_ret_t ret = rmw_wait(
-    &wait_set->impl->rmw_subscriptions,
-    &wait_set->impl->rmw_guard_conditions,
-    &wait_set->impl->rmw_services,
-    &wait_set->impl->rmw_clients,
-    wait_set->impl->rmw_wait_set,
-    timeout_argument);
+  rcutils_time_point_value_t blocked_start = 0;
+  if (impl->statistics_enabled && RCUTILS_RET_OK != rcutils_steady_time_now(&blocked_start)) {
+    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+    return RCL_RET_ERROR;
+  }
+  rmw_ret_t ret = RMW_RET_TIMEOUT;
+  bool resolved = false;
+  const bool has_rmw_entities = !__wait_set_has_no_rmw_entities(wait_set);
+  const bool spin =
+    impl->spin_budget > 0 && has_rmw_entities && (
+    NULL == timeout_argument || timeout_argument->sec > 0 || timeout_argument->nsec > 0);
+  if (NULL != timeout_argument && !has_rmw_entities && __wait_set_sleep(timeout_argument)) {
+    // Only timers which do not need a guard condition, so nothing else can wake the wait up.
+    RCUTILS_LOG_DEBUG_NAMED(ROS_PACKAGE_NAME, "Slept without calling rmw_wait");
+    resolved = true;
+  } else if (spin) {
+    rcl_ret_t spin_ret = __wait_set_spin(wait_set, timeout_argument, &ret, &resolved);
+    if (spin_ret != RCL_RET_OK) {
+      return spin_ret;  // The rcl error state should already be set.
+    }
+  }
+  if (!resolved) {
+    ret = rmw_wait(
+      &wait_set->impl->rmw_subscriptions,
+      &wait_set->impl->rmw_guard_conditions,
+      &wait_set->impl->rmw_services,
+      &wait_set->impl->rmw_clients,
+      wait_set->impl->rmw_wait_set,
+      timeout_argument);
+    if (spin && RMW_RET_OK == ret) {
+      ++impl->spin_statistics.block_wake_count;
+    } else if (spin && RMW_RET_TIMEOUT == ret) {
+      ++impl->spin_statistics.timeout_count;
+    }
+  }
+  if (impl->statistics_enabled) {
+    rcutils_time_point_value_t blocked_end;
+    if (RCUTILS_RET_OK != rcutils_steady_time_now(&blocked_end)) {
+      RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+      return RCL_RET_ERROR;
+    }
+    impl->blocked_time = blocked_end - blocked_start;
+  }
 
   // Items that are not ready will have been set to NULL by rmw_wait.
   // We now update our handles accordingly.
 
   // Check for ready timers
   // and set not ready timers (which includes canceled timers) to NULL.
+  if (__wait_set_timers_rescheduled(wait_set)) {
+    // A timer was reset while waiting, so the queues may no longer bound the next call times.
+    rcl_ret_t ret = __wait_set_build_timer_queues(wait_set);
+    if (ret != RCL_RET_OK) {
+      return ret;  // The rcl error state should already be set.
+    }
+  }
   size_t i;
-  for (i = 0; i < wait_set->impl->timer_index; ++i) {
-    if (!wait_set->timers[i]) {
+  if (NULL != wait_set->timers) {
+    memset((void *)wait_set->timers, 0, sizeof(rcl_timer_t *) * impl->timer_index);
+  }
+  // Without persistent membership the next wait only looks at the timers left in the storage.
+  impl->timer_queues_dirty = !impl->persistent;
+  for (i = 0; i < impl->timer_queue_count; ++i) {
+    const rcl_wait_set_timer_queue_t * queue = &impl->timer_queues[i];
+    if (0u == queue->count) {
       continue;
     }
-    bool is_ready = false;
-    rcl_ret_t ret = rcl_timer_is_ready(wait_set->timers[i], &is_ready);
+    rcl_time_point_value_t now;
+    rcl_ret_t ret = rcl_clock_get_now(queue->clock, &now);
     if (ret != RCL_RET_OK) {
       return ret;  // The rcl error state should already be set.
     }
-    RCUTILS_LOG_DEBUG_EXPRESSION_NAMED(is_ready, ROS_PACKAGE_NAME, "Timer in wait set is ready");
-    if (!is_ready) {
-      wait_set->timers[i] = NULL;
+    ret = __wait_set_collect_ready_timers(wait_set, queue, 0u, now);
+    if (ret != RCL_RET_OK) {
+      return ret;  // The rcl error state should already be set.
     }
   }
   // Check for timeout, return RCL_RET_TIMEOUT only if it wasn't a timer.
@@ -584,46 +1766,194 @@ rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
     return RCL_RET_ERROR;
   }
   // Set corresponding rcl subscription handles NULL.
+  // Persistent wait sets packed their members into the rmw storage, so skip the holes.
+  size_t rmw_index = 0;
+  size_t packed_index = 0;
   for (i = 0; i < wait_set->size_of_subscriptions; ++i) {
-    bool is_ready = wait_set->impl->rmw_subscriptions.subscribers[i] != NULL;
+    SET_RMW_INDEX(subscription);
+    bool is_ready = wait_set->impl->rmw_subscriptions.subscribers[rmw_index] != NULL;
     RCUTILS_LOG_DEBUG_EXPRESSION_NAMED(
       is_ready, ROS_PACKAGE_NAME, "Subscription in wait set is ready");
     if (!is_ready) {
       wait_set->subscriptions[i] = NULL;
+    } else if (NULL != wait_set->subscriptions[i]) {
+      SET_READY(RCL_WAIT_SET_SUBSCRIPTION, i);
     }
   }
   // Set corresponding rcl guard_condition handles NULL.
+  packed_index = 0;
   for (i = 0; i < wait_set->size_of_guard_conditions; ++i) {
-    bool is_ready = wait_set->impl->rmw_guard_conditions.guard_conditions[i] != NULL;
+    SET_RMW_INDEX(guard_condition);
+    bool is_ready = wait_set->impl->rmw_guard_conditions.guard_conditions[rmw_index] != NULL;
     RCUTILS_LOG_DEBUG_EXPRESSION_NAMED(
       is_ready, ROS_PACKAGE_NAME, "Guard condition in wait set is ready");
     if (!is_ready) {
       wait_set->guard_conditions[i] = NULL;
+    } else if (NULL != wait_set->guard_conditions[i]) {
+      SET_READY(RCL_WAIT_SET_GUARD_CONDITION, i);
     }
   }
   // Set corresponding rcl client handles NULL.
+  packed_index = 0;
   for (i = 0; i < wait_set->size_of_clients; ++i) {
-    bool is_ready = wait_set->impl->rmw_clients.clients[i] != NULL;
+    SET_RMW_INDEX(client);
+    bool is_ready = wait_set->impl->rmw_clients.clients[rmw_index] != NULL;
     RCUTILS_LOG_DEBUG_EXPRESSION_NAMED(is_ready, ROS_PACKAGE_NAME, "Client in wait set is ready");
     if (!is_ready) {
       wait_set->clients[i] = NULL;
+    } else if (NULL != wait_set->clients[i]) {
+      SET_READY(RCL_WAIT_SET_CLIENT, i);
     }
   }
   // Set corresponding rcl service handles NULL.
+  packed_index = 0;
   for (i = 0; i < wait_set->size_of_services; ++i) {
-    bool is_ready = wait_set->impl->rmw_services.services[i] != NULL;
+    SET_RMW_INDEX(service);
+    bool is_ready = wait_set->impl->rmw_services.services[rmw_index] != NULL;
     RCUTILS_LOG_DEBUG_EXPRESSION_NAMED(is_ready, ROS_PACKAGE_NAME, "Service in wait set is ready");
     if (!is_ready) {
       wait_set->services[i] = NULL;
+    } else if (NULL != wait_set->services[i]) {
+      SET_READY(RCL_WAIT_SET_SERVICE, i);
     }
   }
 
   if (RMW_RET_TIMEOUT == ret && !is_timer_timeout) {
     return RCL_RET_TIMEOUT;
   }
+  // Only the deadline guard condition woke up the wait, nothing the caller waits on is ready.
+  // Its trigger may also be left over from a jump late in a previous wait, which is treated
+  // the same, as a wait never returns RCL_RET_OK with nothing ready.
+  if (
+    SIZE_MAX != deadline_gc_index && 0u == impl->ready_entity_count &&
+    NULL != impl->rmw_guard_conditions.guard_conditions[deadline_gc_index])
+  {
+    return RCL_RET_TIMEOUT;
+  }
   return RCL_RET_OK;
 }
 
+// Wait and record the wake up statistics, if enabled.
+static rcl_ret_t
+__wait(rcl_wait_set_t * wait_set, int64_t timeout, const rcl_wait_deadline_t * deadline)
+{
+  if (!__wait_set_is_valid(wait_set) || !wait_set->impl->statistics_enabled) {
+    return __wait_impl(wait_set, timeout, deadline);
+  }
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  rcutils_time_point_value_t start;
+  rcutils_time_point_value_t end;
+  if (RCUTILS_RET_OK != rcutils_steady_time_now(&start)) {
+    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+    return RCL_RET_ERROR;
+  }
+  impl->blocked_time = 0;
+  rcl_ret_t ret = __wait_impl(wait_set, timeout, deadline);
+  if (RCL_RET_OK != ret && RCL_RET_TIMEOUT != ret) {
+    return ret;  // The rcl error state should already be set.
+  }
+  if (RCUTILS_RET_OK != rcutils_steady_time_now(&end)) {
+    RCL_SET_ERROR_MSG(rcutils_get_error_string().str);
+    return RCL_RET_ERROR;
+  }
+  rcutils_atomic_fetch_add_uint64_t(&impl->wait_count, 1);
+  rcutils_atomic_fetch_add_uint64_t(&impl->total_blocked_time, (uint64_t)impl->blocked_time);
+  rcutils_atomic_fetch_add_uint64_t(
+    &impl->total_bookkeeping_time, (uint64_t)(end - start - impl->blocked_time));
+  if (RCL_RET_TIMEOUT == ret) {
+    rcutils_atomic_fetch_add_uint64_t(&impl->timeout_count, 1);
+  } else if (0u == impl->ready_entity_count) {
+    rcutils_atomic_fetch_add_uint64_t(&impl->empty_wake_count, 1);
+  }
+  size_t ready_counts[RCL_WAIT_SET_ENTITY_TYPE_COUNT] = {0u};
+  size_t i;
+  for (i = 0; i < impl->ready_entity_count; ++i) {
+    ++ready_counts[impl->ready_entities[i].type];
+  }
+  for (i = 0; i < RCL_WAIT_SET_ENTITY_TYPE_COUNT; ++i) {
+    size_t bucket = ready_counts[i];
+    if (bucket >= RCL_WAIT_SET_READY_HISTOGRAM_SIZE) {
+      bucket = RCL_WAIT_SET_READY_HISTOGRAM_SIZE - 1;
+    }
+    rcutils_atomic_fetch_add_uint64_t(&impl->ready_histogram[i][bucket], 1);
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
+{
+  return __wait(wait_set, timeout, NULL);
+}
+
+rcl_ret_t
+rcl_wait_until(
+  rcl_wait_set_t * wait_set,
+  rcl_clock_t * clock,
+  const rcl_time_point_t * deadline,
+  rcl_context_t * context)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
+  if (!__wait_set_is_valid(wait_set)) {
+    RCL_SET_ERROR_MSG("wait set is invalid");
+    return RCL_RET_WAIT_SET_INVALID;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(clock, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(deadline, RCL_RET_INVALID_ARGUMENT);
+  if (deadline->clock_type != clock->type) {
+    RCL_SET_ERROR_MSG("deadline and clock have different types");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_wait_deadline_t wait_deadline;
+  wait_deadline.clock = clock;
+  wait_deadline.time = deadline->nanoseconds;
+  wait_deadline.use_guard_condition = false;
+  bool is_ros_time_active = false;
+  if (RCL_ROS_TIME == clock->type) {
+    rcl_ret_t ret = rcl_is_enabled_ros_time_override(clock, &is_ros_time_active);
+    if (ret != RCL_RET_OK) {
+      return ret;  // The rcl error state should already be set.
+    }
+  }
+  if (!is_ros_time_active) {
+    return __wait(wait_set, -1, &wait_deadline);
+  }
+  // ROS time does not advance with the system clock, so a timeout can not be used.
+  // Instead, like ROS time timers, the wait set is woken up by a guard condition
+  // triggered from a jump callback once the clock passed the deadline.
+  rcl_wait_set_impl_t * impl = wait_set->impl;
+  if (NULL == impl->deadline_guard_condition.impl) {
+    RCL_CHECK_ARGUMENT_FOR_NULL(context, RCL_RET_INVALID_ARGUMENT);
+    rcl_ret_t ret = rcl_guard_condition_init(
+      &impl->deadline_guard_condition, context, rcl_guard_condition_get_default_options());
+    if (ret != RCL_RET_OK) {
+      return ret;  // The rcl error state should already be set.
+    }
+  }
+  impl->deadline_clock = clock;
+  impl->deadline = deadline->nanoseconds;
+  rcl_jump_threshold_t threshold;
+  threshold.on_clock_change = true;
+  threshold.min_forward.nanoseconds = 1;
+  threshold.min_backward.nanoseconds = -1;
+  rcl_ret_t ret = rcl_clock_add_jump_callback(
+    clock, threshold, __wait_set_deadline_jump, impl);
+  if (ret != RCL_RET_OK) {
+    return ret;  // The rcl error state should already be set.
+  }
+  // Check after adding the callback, so that a jump in between is not missed.
+  rcl_time_point_value_t now;
+  ret = rcl_clock_get_now(clock, &now);
+  if (RCL_RET_OK == ret) {
+    wait_deadline.use_guard_condition = true;
+    ret = __wait(wait_set, now >= deadline->nanoseconds ? 0 : -1, &wait_deadline);
+  }
+  if (RCL_RET_OK != rcl_clock_remove_jump_callback(clock, __wait_set_deadline_jump, impl)) {
+    RCUTILS_LOG_ERROR_NAMED(ROS_PACKAGE_NAME, "Failed to remove deadline jump callback");
+  }
+  return ret;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -199,3 +199,37 @@ TEST_F(TestClientFixture, test_client_init_fini) {
   EXPECT_EQ(RCL_RET_BAD_ALLOC, ret) << rcl_get_error_string().str;
   rcl_reset_error();
 }
+
+/* Test initializing several clients at once.
+ */
+TEST_F(TestClientFixture, test_clients_init_bulk) {
+  rcl_ret_t ret;
+  const size_t kNumClients = 2u;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_SRV_TYPE_SUPPORT(
+    test_msgs, srv, Primitives);
+  const rosidl_service_type_support_t * type_supports[kNumClients] = {ts, ts};
+  const char * service_names[kNumClients] = {"add_two_ints", "{bad}"};
+  rcl_client_options_t options[kNumClients];
+  rcl_client_t clients[kNumClients];
+  for (size_t i = 0u; i < kNumClients; ++i) {
+    options[i] = rcl_client_get_default_options();
+    clients[i] = rcl_get_zero_initialized_client();
+  }
+  ret = rcl_clients_init_bulk(
+    clients, this->node_ptr, type_supports, service_names, options, kNumClients);
+  EXPECT_EQ(RCL_RET_SERVICE_NAME_INVALID, ret);
+  rcl_reset_error();
+
+  service_names[1] = "multiply_two_ints";
+  ret = rcl_clients_init_bulk(
+    clients, this->node_ptr, type_supports, service_names, options, kNumClients);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumClients; ++i) {
+      rcl_ret_t ret = rcl_client_fini(&clients[i], this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    }
+  });
+  EXPECT_STREQ("/add_two_ints", rcl_client_get_service_name(&clients[0]));
+  EXPECT_STREQ("/multiply_two_ints", rcl_client_get_service_name(&clients[1]));
+}
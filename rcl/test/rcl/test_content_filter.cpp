@@ -0,0 +1,139 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rcl/content_filter.h"
+
+#include "rcl/error_handling.h"
+
+class TestContentFilterFixture : public ::testing::Test
+{
+public:
+  // Little endian payload of an int32 at 0, a uint32 at 4, a string at 8 and a float64 at 24.
+  std::vector<uint8_t> payload;
+
+  void SetUp()
+  {
+    this->payload.assign(4 + 32, 0);
+    this->payload[1] = 1;  // CDR_LE
+    uint8_t * data = &this->payload[4];
+    const int32_t int32_value = -5;
+    const uint32_t uint32_value = 200;
+    const uint32_t string_length = 10;
+    const double float64_value = 1.5;
+    memcpy(data, &int32_value, sizeof(int32_value));
+    memcpy(data + 4, &uint32_value, sizeof(uint32_value));
+    memcpy(data + 8, &string_length, sizeof(string_length));
+    memcpy(data + 12, "base_link", string_length);
+    memcpy(data + 24, &float64_value, sizeof(float64_value));
+  }
+
+  void TearDown()
+  {
+  }
+
+  // Return 1 if the expression accepts the payload, 0 if it rejects it, -1 if it is invalid.
+  int evaluate(const char * expression)
+  {
+    rcl_content_filter_t filter = rcl_get_zero_initialized_content_filter();
+    rcl_ret_t ret = rcl_content_filter_init(&filter, expression, rcl_get_default_allocator());
+    if (RCL_RET_OK != ret) {
+      EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+      rcl_reset_error();
+      return -1;
+    }
+    rcl_serialized_message_t serialized_message;
+    memset(&serialized_message, 0, sizeof(serialized_message));
+    serialized_message.buffer = reinterpret_cast<char *>(this->payload.data());
+    serialized_message.buffer_length = this->payload.size();
+    serialized_message.buffer_capacity = this->payload.size();
+    bool accepted = false;
+    ret = rcl_content_filter_evaluate(&filter, &serialized_message, &accepted);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_content_filter_fini(&filter);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    return accepted ? 1 : 0;
+  }
+};
+
+/* Test the comparisons of each kind of field.
+ */
+TEST_F(TestContentFilterFixture, test_content_filter_comparisons) {
+  EXPECT_EQ(1, this->evaluate("int32@0 == -5"));
+  EXPECT_EQ(1, this->evaluate("int32@0 < 0"));
+  EXPECT_EQ(0, this->evaluate("int32@0 >= 0"));
+  EXPECT_EQ(1, this->evaluate("uint32@4 == 0xC8"));
+  EXPECT_EQ(0, this->evaluate("uint32@4 > 200"));
+  EXPECT_EQ(1, this->evaluate("string@8 == \"base_link\""));
+  EXPECT_EQ(0, this->evaluate("string@8 == \"base\""));
+  EXPECT_EQ(1, this->evaluate("string@8 > \"base\""));
+  EXPECT_EQ(1, this->evaluate("float64@24 > 1.25"));
+  EXPECT_EQ(0, this->evaluate("float64@24 != 1.5"));
+  // Fields which do not fit in the payload compare false.
+  EXPECT_EQ(0, this->evaluate("uint64@32 == 0"));
+  EXPECT_EQ(0, this->evaluate("uint64@32 != 0"));
+  // Big endian payloads.
+  this->payload[1] = 0;
+  EXPECT_EQ(1, this->evaluate("uint32@4 == 0xC8000000"));
+}
+
+/* Test the logical operators and their precedence.
+ */
+TEST_F(TestContentFilterFixture, test_content_filter_operators) {
+  EXPECT_EQ(1, this->evaluate("int32@0 < 0 && uint32@4 > 100"));
+  EXPECT_EQ(0, this->evaluate("int32@0 > 0 && uint32@4 > 100"));
+  EXPECT_EQ(1, this->evaluate("int32@0 > 0 || uint32@4 > 100"));
+  EXPECT_EQ(1, this->evaluate("int32@0 > 0 && uint32@4 > 1000 || uint32@4 == 200"));
+  EXPECT_EQ(0, this->evaluate("int32@0 > 0 && (uint32@4 > 1000 || uint32@4 == 200)"));
+  EXPECT_EQ(0, this->evaluate("!int32@0 == -5"));
+  EXPECT_EQ(1, this->evaluate("!!(int32@0 == -5)"));
+}
+
+/* Test the expressions which do not follow the grammar.
+ */
+TEST_F(TestContentFilterFixture, test_content_filter_invalid) {
+  EXPECT_EQ(-1, this->evaluate(""));
+  EXPECT_EQ(-1, this->evaluate("int24@0 == 1"));
+  EXPECT_EQ(-1, this->evaluate("int8 == 1"));
+  EXPECT_EQ(-1, this->evaluate("int8@0 = 1"));
+  EXPECT_EQ(-1, this->evaluate("int8@0 == 128"));
+  EXPECT_EQ(-1, this->evaluate("uint8@0 == -1"));
+  EXPECT_EQ(-1, this->evaluate("bool@0 == 1"));
+  EXPECT_EQ(-1, this->evaluate("string@8 == base_link"));
+  EXPECT_EQ(-1, this->evaluate("string@8 == \"base_link"));
+  EXPECT_EQ(-1, this->evaluate("(int8@0 == 1"));
+  EXPECT_EQ(-1, this->evaluate("int8@0 == 1 int8@1 == 1"));
+  std::string nested = std::string(RCL_CONTENT_FILTER_MAX_DEPTH + 1, '(') + "int8@0 == 1" +
+    std::string(RCL_CONTENT_FILTER_MAX_DEPTH + 1, ')');
+  EXPECT_EQ(-1, this->evaluate(nested.c_str()));
+
+  rcl_content_filter_t filter = rcl_get_zero_initialized_content_filter();
+  rcl_ret_t ret = rcl_content_filter_init(&filter, nullptr, rcl_get_default_allocator());
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  rcl_serialized_message_t serialized_message;
+  memset(&serialized_message, 0, sizeof(serialized_message));
+  bool accepted = false;
+  ret = rcl_content_filter_evaluate(&filter, &serialized_message, &accepted);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ret = rcl_content_filter_fini(&filter);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+}
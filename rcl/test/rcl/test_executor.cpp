@@ -0,0 +1,195 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "rcl/executor.h"
+
+#include "rcl/rcl.h"
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+#include "rcl/error_handling.h"
+
+class TestExecutorFixture : public ::testing::Test
+{
+public:
+  rcl_context_t * context_ptr;
+  void SetUp()
+  {
+    rcl_init_options_t init_options = rcl_get_zero_initialized_init_options();
+    rcl_ret_t ret = rcl_init_options_init(&init_options, rcl_get_default_allocator());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+      EXPECT_EQ(RCL_RET_OK, rcl_init_options_fini(&init_options)) << rcl_get_error_string().str;
+    });
+    this->context_ptr = new rcl_context_t;
+    *this->context_ptr = rcl_get_zero_initialized_context();
+    ret = rcl_init(0, nullptr, &init_options, this->context_ptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+
+  void TearDown()
+  {
+    rcl_ret_t ret = rcl_shutdown(this->context_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_context_fini(this->context_ptr);
+    delete this->context_ptr;
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+};
+
+static std::atomic<int> timer_calls;
+
+static void
+timer_callback(rcl_timer_t * timer, int64_t last_call_time)
+{
+  (void)timer;
+  (void)last_call_time;
+  ++timer_calls;
+}
+
+TEST_F(TestExecutorFixture, test_spin_some) {
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_ret_t ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  rcl_timer_t timer = rcl_get_zero_initialized_timer();
+  ret = rcl_timer_init(
+    &timer, &clock, this->context_ptr, RCL_MS_TO_NS(10), timer_callback, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timer)) << rcl_get_error_string().str;
+  });
+
+  rcl_executor_t executor = rcl_get_zero_initialized_executor();
+  rcl_executor_options_t options = rcl_executor_get_default_options();
+  options.thread_count = 0;
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, rcl_executor_init(&executor, this->context_ptr, &options));
+  rcl_reset_error();
+  options.thread_count = 1;
+  ret = rcl_executor_init(&executor, this->context_ptr, &options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_executor_fini(&executor)) << rcl_get_error_string().str;
+  });
+  EXPECT_EQ(RCL_RET_ALREADY_INIT, rcl_executor_init(&executor, this->context_ptr, &options));
+  rcl_reset_error();
+
+  // Nothing is added yet.
+  ret = rcl_executor_spin_some(&executor, RCL_MS_TO_NS(10));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+
+  ret = rcl_executor_add_timer(&executor, &timer);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  timer_calls = 0;
+  for (int i = 1; i <= 3; ++i) {
+    ret = rcl_executor_spin_some(&executor, RCL_S_TO_NS(1));
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_EQ(i, timer_calls);
+  }
+}
+
+struct counting_state
+{
+  rcl_executor_t * executor;
+  rcl_guard_condition_t * guard_condition;
+  std::atomic<int> * calls;
+  std::atomic<int> * concurrent;
+  std::atomic<int> * max_concurrent;
+  int limit;
+};
+
+// Count the call, and trigger the guard condition again until the limit is reached.
+static void
+counting_callback(void * user_data)
+{
+  counting_state * state = static_cast<counting_state *>(user_data);
+  int concurrent = ++*state->concurrent;
+  int max_concurrent = state->max_concurrent->load();
+  while (concurrent > max_concurrent &&
+    !state->max_concurrent->compare_exchange_weak(max_concurrent, concurrent))
+  {
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  --*state->concurrent;
+  if (++*state->calls >= state->limit) {
+    EXPECT_EQ(RCL_RET_OK, rcl_executor_cancel(state->executor));
+    return;
+  }
+  EXPECT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(state->guard_condition));
+}
+
+// Spin on guard conditions which trigger themselves again, until enough callbacks were called.
+static void
+spin_until_canceled(rcl_context_t * context, size_t thread_count)
+{
+  rcl_executor_t executor = rcl_get_zero_initialized_executor();
+  rcl_executor_options_t options = rcl_executor_get_default_options();
+  options.thread_count = thread_count;
+  rcl_ret_t ret = rcl_executor_init(&executor, context, &options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_executor_fini(&executor)) << rcl_get_error_string().str;
+  });
+
+  const size_t kNumGuardConditions = 8u;
+  rcl_guard_condition_t guard_conds[kNumGuardConditions];
+  counting_state states[kNumGuardConditions];
+  std::atomic<int> calls(0);
+  std::atomic<int> concurrent(0);
+  std::atomic<int> max_concurrent(0);
+  for (size_t i = 0u; i < kNumGuardConditions; ++i) {
+    guard_conds[i] = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_conds[i], context, rcl_guard_condition_get_default_options());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    states[i] = {&executor, &guard_conds[i], &calls, &concurrent, &max_concurrent, 100};
+    ret = rcl_executor_add_guard_condition(
+      &executor, &guard_conds[i], counting_callback, &states[i]);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (rcl_guard_condition_t & guard_cond : guard_conds) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+    }
+  });
+
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_cond));
+  }
+  ret = rcl_executor_spin(&executor);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  // The work found ready before canceling is finished.
+  EXPECT_GE(calls, 100);
+  EXPECT_LT(calls, 100 + static_cast<int>(kNumGuardConditions));
+  EXPECT_LE(max_concurrent, static_cast<int>(thread_count));
+  if (1u == thread_count) {
+    EXPECT_EQ(1, max_concurrent);
+  }
+}
+
+TEST_F(TestExecutorFixture, test_spin_single_threaded) {
+  spin_until_canceled(this->context_ptr, 1u);
+}
+
+TEST_F(TestExecutorFixture, test_spin_multi_threaded) {
+  spin_until_canceled(this->context_ptr, 4u);
+}
@@ -0,0 +1,188 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "rcl/partitioned_wait_set.h"
+
+#include "rcl/rcl.h"
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+#include "rcl/error_handling.h"
+
+class TestPartitionedWaitSetFixture : public ::testing::Test
+{
+public:
+  rcl_context_t * context_ptr;
+  void SetUp()
+  {
+    rcl_init_options_t init_options = rcl_get_zero_initialized_init_options();
+    rcl_ret_t ret = rcl_init_options_init(&init_options, rcl_get_default_allocator());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+      EXPECT_EQ(RCL_RET_OK, rcl_init_options_fini(&init_options)) << rcl_get_error_string().str;
+    });
+    this->context_ptr = new rcl_context_t;
+    *this->context_ptr = rcl_get_zero_initialized_context();
+    ret = rcl_init(0, nullptr, &init_options, this->context_ptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+
+  void TearDown()
+  {
+    rcl_ret_t ret = rcl_shutdown(this->context_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_context_fini(this->context_ptr);
+    delete this->context_ptr;
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+};
+
+TEST_F(TestPartitionedWaitSetFixture, test_add_remove_rebalance) {
+  rcl_partitioned_wait_set_t partitioned = rcl_get_zero_initialized_partitioned_wait_set();
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_ret_t ret = rcl_partitioned_wait_set_init(&partitioned, 0, this->context_ptr, allocator);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ret = rcl_partitioned_wait_set_init(&partitioned, 3, this->context_ptr, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_partitioned_wait_set_fini(&partitioned)) <<
+      rcl_get_error_string().str;
+  });
+  size_t shard_count = 0u;
+  EXPECT_EQ(RCL_RET_OK, rcl_partitioned_wait_set_get_shard_count(&partitioned, &shard_count));
+  EXPECT_EQ(3u, shard_count);
+
+  const size_t kNumGuardConditions = 9u;
+  std::vector<rcl_guard_condition_t> guard_conds(kNumGuardConditions);
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    guard_cond = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_cond, this->context_ptr, rcl_guard_condition_get_default_options());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (rcl_guard_condition_t & guard_cond : guard_conds) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+    }
+  });
+
+  // Entities are spread round robin while the shards are even.
+  for (size_t i = 0u; i < kNumGuardConditions; ++i) {
+    size_t shard_index = SIZE_MAX;
+    ret = rcl_partitioned_wait_set_add_guard_condition(&partitioned, &guard_conds[i], &shard_index);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_EQ(i % 3u, shard_index);
+  }
+  ret = rcl_partitioned_wait_set_add_guard_condition(&partitioned, &guard_conds[0], NULL);
+  EXPECT_EQ(RCL_RET_ERROR, ret);
+  rcl_reset_error();
+
+  // Empty the first shard, then rebalance.
+  for (size_t i = 0u; i < kNumGuardConditions; i += 3u) {
+    ret = rcl_partitioned_wait_set_remove(&partitioned, &guard_conds[i]);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  EXPECT_EQ(RCL_RET_ERROR, rcl_partitioned_wait_set_remove(&partitioned, &guard_conds[0]));
+  rcl_reset_error();
+  size_t entity_count = SIZE_MAX;
+  EXPECT_EQ(RCL_RET_OK, rcl_partitioned_wait_set_get_entity_count(&partitioned, 0, &entity_count));
+  EXPECT_EQ(0u, entity_count);
+  ret = rcl_partitioned_wait_set_rebalance(&partitioned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  for (size_t i = 0u; i < 3u; ++i) {
+    ret = rcl_partitioned_wait_set_get_entity_count(&partitioned, i, &entity_count);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_EQ(2u, entity_count);
+  }
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, rcl_partitioned_wait_set_get_entity_count(
+      &partitioned, 3, &entity_count));
+  rcl_reset_error();
+}
+
+TEST_F(TestPartitionedWaitSetFixture, test_wait_on_shards) {
+  rcl_partitioned_wait_set_t partitioned = rcl_get_zero_initialized_partitioned_wait_set();
+  rcl_ret_t ret = rcl_partitioned_wait_set_init(
+    &partitioned, 2, this->context_ptr, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_partitioned_wait_set_fini(&partitioned)) <<
+      rcl_get_error_string().str;
+  });
+  rcl_guard_condition_t guard_conds[2];
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    guard_cond = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_cond, this->context_ptr, rcl_guard_condition_get_default_options());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (rcl_guard_condition_t & guard_cond : guard_conds) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+    }
+  });
+
+  // An empty shard times out.
+  rcl_wait_set_t * wait_set = nullptr;
+  ret = rcl_partitioned_wait_set_wait(&partitioned, 0, RCL_MS_TO_NS(10), &wait_set);
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+
+  // A thread waiting on an empty shard picks up the entity added to it.
+  std::future<rcl_ret_t> waiter = std::async(std::launch::async, [&partitioned]() {
+      rcl_wait_set_t * shard_wait_set = nullptr;
+      rcl_ret_t wait_ret = rcl_partitioned_wait_set_wait(
+        &partitioned, 0, RCL_S_TO_NS(1), &shard_wait_set);
+      EXPECT_NE(nullptr, shard_wait_set);
+      EXPECT_EQ(nullptr, shard_wait_set->guard_conditions[0]);
+      return wait_ret;
+    });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  size_t shard_index = SIZE_MAX;
+  ret = rcl_partitioned_wait_set_add_guard_condition(&partitioned, &guard_conds[0], &shard_index);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, shard_index);
+  ret = rcl_partitioned_wait_set_add_guard_condition(&partitioned, &guard_conds[1], &shard_index);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(1u, shard_index);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(std::future_status::timeout, waiter.wait_for(std::chrono::milliseconds(0)));
+  ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_conds[0]));
+  EXPECT_EQ(RCL_RET_OK, waiter.get());
+
+  // Both shards are waited on concurrently, each only sees its own entity.
+  std::future<rcl_ret_t> waiters[2];
+  for (size_t i = 0u; i < 2u; ++i) {
+    waiters[i] = std::async(std::launch::async, [&partitioned, &guard_conds, i]() {
+        rcl_wait_set_t * shard_wait_set = nullptr;
+        rcl_ret_t wait_ret = rcl_partitioned_wait_set_wait(
+          &partitioned, i, RCL_S_TO_NS(1), &shard_wait_set);
+        EXPECT_EQ(2u, shard_wait_set->size_of_guard_conditions);
+        EXPECT_EQ(&guard_conds[i], shard_wait_set->guard_conditions[1]);
+        return wait_ret;
+      });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_cond));
+  }
+  for (std::future<rcl_ret_t> & shard_waiter : waiters) {
+    EXPECT_EQ(RCL_RET_OK, shard_waiter.get());
+  }
+}
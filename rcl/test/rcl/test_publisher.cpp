@@ -17,6 +17,7 @@
 #include "rcl/publisher.h"
 
 #include "rcl/rcl.h"
+#include "rcl/traffic_statistics_publisher.h"
 #include "test_msgs/msg/primitives.h"
 #include "rosidl_generator_c/string_functions.h"
 
@@ -97,6 +98,278 @@ TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_nomin
   ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
 }
 
+/* Test publishing several messages at once.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_batch) {
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const char * topic_name = "chatter";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  const size_t kNumMessages = 3u;
+  test_msgs__msg__Primitives msgs[kNumMessages];
+  const void * batch[kNumMessages];
+  for (size_t i = 0u; i < kNumMessages; ++i) {
+    test_msgs__msg__Primitives__init(&msgs[i]);
+    msgs[i].int64_value = static_cast<int64_t>(i);
+    batch[i] = &msgs[i];
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumMessages; ++i) {
+      test_msgs__msg__Primitives__fini(&msgs[i]);
+    }
+  });
+  size_t published = 42u;
+  ret = rcl_publish_batch(&publisher, batch, kNumMessages, &published);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(kNumMessages, published);
+  ret = rcl_publish_batch(&publisher, nullptr, 0u, &published);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, published);
+
+  // A null message fails the whole batch before anything is published.
+  batch[1] = nullptr;
+  published = 42u;
+  ret = rcl_publish_batch(&publisher, batch, kNumMessages, &published);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  EXPECT_EQ(0u, published);
+  rcl_reset_error();
+  const rcl_serialized_message_t * serialized_batch[] = {nullptr};
+  ret = rcl_publish_serialized_message_batch(&publisher, serialized_batch, 1u, &published);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  rcl_publisher_t invalid_publisher = rcl_get_zero_initialized_publisher();
+  ret = rcl_publish_batch(&invalid_publisher, batch, kNumMessages, &published);
+  EXPECT_EQ(RCL_RET_PUBLISHER_INVALID, ret);
+  rcl_reset_error();
+}
+
+static void *
+create_primitives(void * state)
+{
+  (void)state;
+  return test_msgs__msg__Primitives__create();
+}
+
+static void
+destroy_primitives(void * message, void * state)
+{
+  (void)state;
+  test_msgs__msg__Primitives__destroy(static_cast<test_msgs__msg__Primitives *>(message));
+}
+
+/* Test publishing messages loaned from the publisher.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_loaned_message) {
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const char * topic_name = "chatter";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+
+  // Loaning is disabled by default.
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_FALSE(rcl_publisher_can_loan_messages(&publisher));
+  void * loaned_message = nullptr;
+  EXPECT_EQ(RCL_RET_UNSUPPORTED, rcl_borrow_loaned_message(&publisher, &loaned_message));
+  rcl_reset_error();
+  ret = rcl_publisher_fini(&publisher, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  publisher_options.loan.create_message = create_primitives;
+  publisher_options.loan.destroy_message = destroy_primitives;
+  publisher_options.loan.capacity = 2u;
+  publisher = rcl_get_zero_initialized_publisher();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  EXPECT_TRUE(rcl_publisher_can_loan_messages(&publisher));
+
+  // Only capacity messages can be on loan at the same time.
+  void * first = nullptr;
+  void * second = nullptr;
+  ASSERT_EQ(RCL_RET_OK, rcl_borrow_loaned_message(&publisher, &first));
+  ASSERT_EQ(RCL_RET_OK, rcl_borrow_loaned_message(&publisher, &second));
+  EXPECT_NE(first, second);
+  EXPECT_EQ(RCL_RET_BAD_ALLOC, rcl_borrow_loaned_message(&publisher, &loaned_message));
+  rcl_reset_error();
+
+  static_cast<test_msgs__msg__Primitives *>(first)->int64_value = 42;
+  ret = rcl_publish_loaned_message(&publisher, first);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_return_loaned_message_from_publisher(&publisher, second);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  // The loans ended, so the messages are loaned again.
+  ret = rcl_publish_loaned_message(&publisher, first);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ASSERT_EQ(RCL_RET_OK, rcl_borrow_loaned_message(&publisher, &loaned_message));
+  EXPECT_TRUE(loaned_message == first || loaned_message == second);
+  ret = rcl_return_loaned_message_from_publisher(&publisher, loaned_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+}
+
+static rcl_ret_t
+fill_primitives(
+  const char * topic_name, bool is_subscription, const rcl_traffic_statistics_t * statistics,
+  void * ros_message, void * user_data)
+{
+  (void)topic_name;
+  (void)is_subscription;
+  auto msg = static_cast<test_msgs__msg__Primitives *>(ros_message);
+  msg->uint64_value = statistics->message_count;
+  ++*static_cast<size_t *>(user_data);
+  return RCL_RET_OK;
+}
+
+/* Test the traffic statistics of a publisher, and publishing them.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_traffic_statistics) {
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const char * topic_name = "chatter";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  rcl_traffic_statistics_t statistics;
+
+  // Statistics are disabled by default.
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(RCL_RET_UNSUPPORTED, rcl_publisher_get_traffic_statistics(&publisher, &statistics));
+  rcl_reset_error();
+  ret = rcl_publisher_fini(&publisher, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  publisher_options.traffic_statistics = true;
+  publisher = rcl_get_zero_initialized_publisher();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  test_msgs__msg__Primitives msg;
+  test_msgs__msg__Primitives__init(&msg);
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    test_msgs__msg__Primitives__fini(&msg);
+  });
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  const void * batch[] = {&msg, &msg};
+  size_t published = 0u;
+  ret = rcl_publish_batch(&publisher, batch, 2u, &published);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_publisher_get_traffic_statistics(&publisher, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(3u, statistics.message_count);
+  // The size of messages which are not serialized by rcl is unknown.
+  EXPECT_EQ(0u, statistics.byte_count);
+  EXPECT_EQ(0u, statistics.failed_take_count);
+
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_clock_t clock;
+  ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  test_msgs__msg__Primitives statistics_msg;
+  test_msgs__msg__Primitives__init(&statistics_msg);
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    test_msgs__msg__Primitives__fini(&statistics_msg);
+  });
+  size_t filled = 0u;
+  rcl_traffic_statistics_publisher_t statistics_publisher =
+    rcl_get_zero_initialized_traffic_statistics_publisher();
+  rcl_publisher_options_t statistics_options = rcl_publisher_get_default_options();
+  ret = rcl_traffic_statistics_publisher_init(
+    &statistics_publisher, this->node_ptr, ts, "statistics", &statistics_options,
+    &statistics_msg, fill_primitives, &filled, &clock, RCL_S_TO_NS(1));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_traffic_statistics_publisher_fini(&statistics_publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  EXPECT_NE(nullptr, rcl_traffic_statistics_publisher_get_timer(&statistics_publisher));
+  ret = rcl_traffic_statistics_publisher_add_publisher(&statistics_publisher, &publisher);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_traffic_statistics_publisher_publish(&statistics_publisher);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(1u, filled);
+  EXPECT_EQ(3u, statistics_msg.uint64_value);
+}
+
+/* Test initializing several publishers at once.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publishers_init_bulk) {
+  rcl_ret_t ret;
+  const size_t kNumPublishers = 3u;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const rosidl_message_type_support_t * type_supports[kNumPublishers] = {ts, ts, ts};
+  const char * topic_names[kNumPublishers] = {"chatter", "/chatter", "~/chatter"};
+  rcl_publisher_options_t options[kNumPublishers];
+  rcl_publisher_t publishers[kNumPublishers];
+  for (size_t i = 0u; i < kNumPublishers; ++i) {
+    options[i] = rcl_publisher_get_default_options();
+    publishers[i] = rcl_get_zero_initialized_publisher();
+  }
+
+  // An invalid name fails every publisher.
+  topic_names[2] = "chatter//";
+  ret = rcl_publishers_init_bulk(
+    publishers, this->node_ptr, type_supports, topic_names, options, kNumPublishers);
+  EXPECT_EQ(RCL_RET_TOPIC_NAME_INVALID, ret);
+  rcl_reset_error();
+  for (size_t i = 0u; i < kNumPublishers; ++i) {
+    EXPECT_FALSE(rcl_publisher_is_valid(&publishers[i]));
+    rcl_reset_error();
+  }
+
+  topic_names[2] = "~/chatter";
+  ret = rcl_publishers_init_bulk(
+    publishers, this->node_ptr, type_supports, topic_names, options, kNumPublishers);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumPublishers; ++i) {
+      rcl_ret_t ret = rcl_publisher_fini(&publishers[i], this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    }
+  });
+  EXPECT_STREQ("/chatter", rcl_publisher_get_topic_name(&publishers[0]));
+  EXPECT_STREQ("/chatter", rcl_publisher_get_topic_name(&publishers[1]));
+  EXPECT_STREQ("/test_publisher_node/chatter", rcl_publisher_get_topic_name(&publishers[2]));
+  test_msgs__msg__Primitives msg;
+  test_msgs__msg__Primitives__init(&msg);
+  ret = rcl_publish(&publishers[2], &msg);
+  test_msgs__msg__Primitives__fini(&msg);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  // Initialized publishers are not initialized again.
+  ret = rcl_publishers_init_bulk(
+    publishers, this->node_ptr, type_supports, topic_names, options, kNumPublishers);
+  EXPECT_EQ(RCL_RET_ALREADY_INIT, ret);
+  rcl_reset_error();
+  EXPECT_TRUE(rcl_publisher_is_valid(&publishers[0]));
+  ret = rcl_publishers_init_bulk(
+    publishers, this->node_ptr, type_supports, nullptr, options, kNumPublishers);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+}
+
 /* Basic nominal test of a publisher with a string.
  */
 TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_nominal_string) {
@@ -314,3 +314,53 @@ TEST_F(CLASSNAME(TestRemapIntegrationFixture, RMW_IMPLEMENTATION), remap_using_n
   }
   EXPECT_EQ(RCL_RET_OK, rcl_node_fini(&node));
 }
+
+TEST_F(CLASSNAME(TestRemapIntegrationFixture, RMW_IMPLEMENTATION), remap_repeated_names) {
+  int argc;
+  char ** argv;
+  SCOPE_GLOBAL_ARGS(argc, argv, "process_name", "rostopic://foo:=bar");
+
+  rcl_node_t node = rcl_get_zero_initialized_node();
+  rcl_node_options_t default_options = rcl_node_get_default_options();
+  ASSERT_EQ(RCL_RET_OK, rcl_node_init(&node, "original_name", "/ns", &context, &default_options));
+
+  {  // Names resolved before resolve the same way again
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+    rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+    rcl_publisher_t first = rcl_get_zero_initialized_publisher();
+    rcl_ret_t ret = rcl_publisher_init(&first, &node, ts, "foo", &publisher_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    rcl_publisher_t second = rcl_get_zero_initialized_publisher();
+    ret = rcl_publisher_init(&second, &node, ts, "foo", &publisher_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_STREQ("/ns/bar", rcl_publisher_get_topic_name(&first));
+    EXPECT_STREQ("/ns/bar", rcl_publisher_get_topic_name(&second));
+    EXPECT_EQ(RCL_RET_OK, rcl_publisher_fini(&first, &node));
+    EXPECT_EQ(RCL_RET_OK, rcl_publisher_fini(&second, &node));
+  }
+  {  // Services do not reuse the names of topics, as they follow other rules
+    const rosidl_service_type_support_t * ts = ROSIDL_GET_SRV_TYPE_SUPPORT(
+      test_msgs, srv, Primitives);
+    rcl_service_options_t service_options = rcl_service_get_default_options();
+    rcl_service_t service = rcl_get_zero_initialized_service();
+    rcl_ret_t ret = rcl_service_init(&service, &node, ts, "foo", &service_options);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_STREQ("/ns/foo", rcl_service_get_service_name(&service));
+    EXPECT_EQ(RCL_RET_OK, rcl_service_fini(&service, &node));
+  }
+  {  // Invalid names are reported every time
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+    rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+    for (int i = 0; i < 2; ++i) {
+      rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+      rcl_ret_t ret = rcl_subscription_init(
+        &subscription, &node, ts, "foo//bar", &subscription_options);
+      EXPECT_EQ(RCL_RET_TOPIC_NAME_INVALID, ret);
+      rcl_reset_error();
+    }
+  }
+
+  EXPECT_EQ(RCL_RET_OK, rcl_node_fini(&node));
+}
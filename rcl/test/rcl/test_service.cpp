@@ -213,3 +213,59 @@ TEST_F(CLASSNAME(TestServiceFixture, RMW_IMPLEMENTATION), test_service_nominal)
   EXPECT_EQ(client_response.uint64_value, 3ULL);
   EXPECT_EQ(header.sequence_number, 1);
 }
+
+/* Test initializing several services at once, and the rollback when one of them fails.
+ */
+TEST_F(CLASSNAME(TestServiceFixture, RMW_IMPLEMENTATION), test_services_init_bulk) {
+  rcl_ret_t ret;
+  const size_t kNumServices = 3u;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_SRV_TYPE_SUPPORT(
+    test_msgs, srv, Primitives);
+  const rosidl_service_type_support_t * type_supports[kNumServices] = {ts, ts, nullptr};
+  const char * service_names[kNumServices] = {"primitives", "/other_primitives", "~/primitives"};
+  rcl_service_options_t options[kNumServices];
+  rcl_service_t services[kNumServices];
+  for (size_t i = 0u; i < kNumServices; ++i) {
+    options[i] = rcl_service_get_default_options();
+    services[i] = rcl_get_zero_initialized_service();
+  }
+
+  // The last service fails, after the others were initialized, which are finalized again.
+  ret = rcl_services_init_bulk(
+    services, this->node_ptr, type_supports, service_names, options, kNumServices);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  for (size_t i = 0u; i < kNumServices; ++i) {
+    EXPECT_FALSE(rcl_service_is_valid(&services[i]));
+    rcl_reset_error();
+  }
+
+  type_supports[2] = ts;
+  ret = rcl_services_init_bulk(
+    services, this->node_ptr, type_supports, service_names, options, kNumServices);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumServices; ++i) {
+      rcl_ret_t ret = rcl_service_fini(&services[i], this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    }
+  });
+  EXPECT_STREQ("/primitives", rcl_service_get_service_name(&services[0]));
+  EXPECT_STREQ("/other_primitives", rcl_service_get_service_name(&services[1]));
+  EXPECT_STREQ("/test_service_node/primitives", rcl_service_get_service_name(&services[2]));
+
+  // An invalid name fails before any service is initialized.
+  rcl_service_t others[kNumServices];
+  for (size_t i = 0u; i < kNumServices; ++i) {
+    others[i] = rcl_get_zero_initialized_service();
+  }
+  service_names[1] = "{bad}";
+  ret = rcl_services_init_bulk(
+    others, this->node_ptr, type_supports, service_names, options, kNumServices);
+  EXPECT_EQ(RCL_RET_SERVICE_NAME_INVALID, ret);
+  rcl_reset_error();
+  for (size_t i = 0u; i < kNumServices; ++i) {
+    EXPECT_FALSE(rcl_service_is_valid(&others[i]));
+    rcl_reset_error();
+  }
+}
@@ -34,14 +34,54 @@
 # define CLASSNAME(NAME, SUFFIX) NAME
 #endif
 
+void
+wait_for_subscription_to_be_ready(
+  rcl_subscription_t * subscription,
+  size_t max_tries,
+  int64_t period_ms,
+  bool & success)
+{
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 1, 0, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_wait_set_fini(&wait_set);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  size_t iteration = 0;
+  do {
+    ++iteration;
+    ret = rcl_wait_set_clear(&wait_set);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_subscription(&wait_set, subscription, NULL);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait(&wait_set, RCL_MS_TO_NS(period_ms));
+    if (ret == RCL_RET_TIMEOUT) {
+      continue;
+    }
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    for (size_t i = 0; i < wait_set.size_of_subscriptions; ++i) {
+      if (wait_set.subscriptions[i] && wait_set.subscriptions[i] == subscription) {
+        success = true;
+        return;
+      }
+    }
+  } while (iteration < max_tries);
+  success = false;
+}
+
 class CLASSNAME (TestSubscriptionFixture, RMW_IMPLEMENTATION) : public ::testing::Test
 {
 public:
   rcl_context_t * context_ptr;
   rcl_node_t * node_ptr;
+  rcl_publisher_t * publisher_ptr;
+  rcl_subscription_t * subscription_ptr;
   void SetUp()
   {
     rcl_ret_t ret;
+    this->publisher_ptr = nullptr;
+    this->subscription_ptr = nullptr;
     {
       rcl_init_options_t init_options = rcl_get_zero_initialized_init_options();
       ret = rcl_init_options_init(&init_options, rcl_get_default_allocator());
@@ -64,7 +104,18 @@ public:
 
   void TearDown()
   {
-    rcl_ret_t ret = rcl_node_fini(this->node_ptr);
+    rcl_ret_t ret;
+    if (this->subscription_ptr) {
+      ret = rcl_subscription_fini(this->subscription_ptr, this->node_ptr);
+      delete this->subscription_ptr;
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    }
+    if (this->publisher_ptr) {
+      ret = rcl_publisher_fini(this->publisher_ptr, this->node_ptr);
+      delete this->publisher_ptr;
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    }
+    ret = rcl_node_fini(this->node_ptr);
     delete this->node_ptr;
     EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
     ret = rcl_shutdown(this->context_ptr);
@@ -73,43 +124,50 @@ public:
     delete this->context_ptr;
     EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
   }
-};
 
-void
-wait_for_subscription_to_be_ready(
-  rcl_subscription_t * subscription,
-  size_t max_tries,
-  int64_t period_ms,
-  bool & success)
-{
-  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
-  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 1, 0, 0, 0, 0, rcl_get_default_allocator());
-  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
-  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
-    rcl_ret_t ret = rcl_wait_set_fini(&wait_set);
-    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
-  });
-  size_t iteration = 0;
-  do {
-    ++iteration;
-    ret = rcl_wait_set_clear(&wait_set);
+  // Initialize a publisher and a subscription on the topic, which are finalized on tear down,
+  // and wait until they are matched.
+  void init_publisher_and_subscription(
+    const char * topic, const rcl_subscription_options_t & subscription_options)
+  {
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+    this->publisher_ptr = new rcl_publisher_t;
+    *this->publisher_ptr = rcl_get_zero_initialized_publisher();
+    rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+    rcl_ret_t ret = rcl_publisher_init(
+      this->publisher_ptr, this->node_ptr, ts, topic, &publisher_options);
     ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
-    ret = rcl_wait_set_add_subscription(&wait_set, subscription, NULL);
+    this->subscription_ptr = new rcl_subscription_t;
+    *this->subscription_ptr = rcl_get_zero_initialized_subscription();
+    ret = rcl_subscription_init(
+      this->subscription_ptr, this->node_ptr, ts, topic, &subscription_options);
     ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
-    ret = rcl_wait(&wait_set, RCL_MS_TO_NS(period_ms));
-    if (ret == RCL_RET_TIMEOUT) {
-      continue;
-    }
-    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
-    for (size_t i = 0; i < wait_set.size_of_subscriptions; ++i) {
-      if (wait_set.subscriptions[i] && wait_set.subscriptions[i] == subscription) {
-        success = true;
+    for (size_t i = 0u; i < 100u; ++i) {
+      size_t subscription_count = 0u;
+      size_t publisher_count = 0u;
+      ret = rcl_publisher_get_subscription_count(this->publisher_ptr, &subscription_count);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+      ret = rcl_subscription_get_publisher_count(this->subscription_ptr, &publisher_count);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+      if (subscription_count > 0u && publisher_count > 0u) {
         return;
       }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
-  } while (iteration < max_tries);
-  success = false;
-}
+    FAIL() << "publisher and subscription were not matched";
+  }
+
+  // Wait until the messages published so far reached the subscription.
+  void wait_for_messages()
+  {
+    bool success;
+    wait_for_subscription_to_be_ready(this->subscription_ptr, 10, 100, success);
+    ASSERT_TRUE(success);
+    // Give the messages published after the first one time to arrive.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+};
 
 /* Basic nominal test of a subscription.
  */
@@ -230,3 +288,479 @@ TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription
     ASSERT_EQ(std::string(test_string), std::string(msg.string_value.data, msg.string_value.size));
   }
 }
+
+/* Test taking several messages at once.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_take_sequence) {
+  rcl_ret_t ret;
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.qos.depth = 10;
+  ASSERT_NO_FATAL_FAILURE(
+    this->init_publisher_and_subscription("rcl_test_take_sequence", subscription_options));
+
+  const size_t kCapacity = 5u;
+  test_msgs__msg__Primitives msgs[kCapacity];
+  rcl_message_sequence_t message_sequence = rcl_get_zero_initialized_message_sequence();
+  ret = rcl_message_sequence_init(&message_sequence, kCapacity, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_message_info_sequence_t message_info_sequence =
+    rcl_get_zero_initialized_message_info_sequence();
+  ret = rcl_message_info_sequence_init(
+    &message_info_sequence, kCapacity, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  for (size_t i = 0u; i < kCapacity; ++i) {
+    test_msgs__msg__Primitives__init(&msgs[i]);
+    message_sequence.data[i] = &msgs[i];
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kCapacity; ++i) {
+      test_msgs__msg__Primitives__fini(&msgs[i]);
+    }
+    EXPECT_EQ(RCL_RET_OK, rcl_message_sequence_fini(&message_sequence));
+    EXPECT_EQ(RCL_RET_OK, rcl_message_info_sequence_fini(&message_info_sequence));
+  });
+
+  size_t taken = 42u;
+  ret = rcl_take_sequence(
+    this->subscription_ptr, kCapacity + 1u, &message_sequence, &message_info_sequence, &taken);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ret = rcl_take_sequence(
+    this->subscription_ptr, kCapacity, &message_sequence, &message_info_sequence, &taken);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, taken);
+
+  const int64_t kNumMessages = 3;
+  for (int64_t i = 0; i < kNumMessages; ++i) {
+    test_msgs__msg__Primitives msg;
+    test_msgs__msg__Primitives__init(&msg);
+    msg.int64_value = i;
+    ret = rcl_publish(this->publisher_ptr, &msg);
+    test_msgs__msg__Primitives__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  ASSERT_NO_FATAL_FAILURE(this->wait_for_messages());
+  ret = rcl_take_sequence(
+    this->subscription_ptr, kCapacity, &message_sequence, &message_info_sequence, &taken);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(static_cast<size_t>(kNumMessages), taken);
+  EXPECT_EQ(taken, message_sequence.size);
+  EXPECT_EQ(taken, message_info_sequence.size);
+  for (size_t i = 0u; i < taken; ++i) {
+    EXPECT_EQ(static_cast<int64_t>(i), msgs[i].int64_value);
+  }
+}
+
+static void *
+create_primitives(void * state)
+{
+  (void)state;
+  return test_msgs__msg__Primitives__create();
+}
+
+static void
+destroy_primitives(void * message, void * state)
+{
+  (void)state;
+  test_msgs__msg__Primitives__destroy(static_cast<test_msgs__msg__Primitives *>(message));
+}
+
+/* Test taking messages loaned from the subscription.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_loaned_message) {
+  rcl_ret_t ret;
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.loan.create_message = create_primitives;
+  subscription_options.loan.destroy_message = destroy_primitives;
+  subscription_options.loan.capacity = 1u;
+  ASSERT_NO_FATAL_FAILURE(
+    this->init_publisher_and_subscription("rcl_test_loaned_message", subscription_options));
+  EXPECT_TRUE(rcl_subscription_can_loan_messages(this->subscription_ptr));
+
+  // Nothing taken, nothing loaned.
+  void * loaned_message = nullptr;
+  ret = rcl_take_loaned_message(this->subscription_ptr, &loaned_message, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, loaned_message);
+
+  {
+    test_msgs__msg__Primitives msg;
+    test_msgs__msg__Primitives__init(&msg);
+    msg.int64_value = 42;
+    ret = rcl_publish(this->publisher_ptr, &msg);
+    test_msgs__msg__Primitives__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  ASSERT_NO_FATAL_FAILURE(this->wait_for_messages());
+  ret = rcl_take_loaned_message(this->subscription_ptr, &loaned_message, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(42, static_cast<test_msgs__msg__Primitives *>(loaned_message)->int64_value);
+  ret = rcl_return_loaned_message_from_subscription(this->subscription_ptr, loaned_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_return_loaned_message_from_subscription(this->subscription_ptr, loaned_message);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+}
+
+/* Test that loaned messages of an intra process publisher are queued without the middleware.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_intra_process) {
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const char * topic = "rcl_test_intra_process";
+  rcl_loan_options_t loan_options = rcl_loan_options_t();
+  loan_options.create_message = create_primitives;
+  loan_options.destroy_message = destroy_primitives;
+  loan_options.capacity = 2u;
+
+  // Intra process requires loaning.
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.intra_process = true;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  publisher_options.loan = loan_options;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.intra_process = true;
+  subscription_options.loan = loan_options;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  const rcl_guard_condition_t * guard_condition =
+    rcl_subscription_get_intra_process_guard_condition(&subscription);
+  ASSERT_NE(nullptr, guard_condition) << rcl_get_error_string().str;
+
+  // Only loaned messages are exchanged.
+  {
+    test_msgs__msg__Primitives msg;
+    test_msgs__msg__Primitives__init(&msg);
+    EXPECT_EQ(RCL_RET_UNSUPPORTED, rcl_publish(&publisher, &msg));
+    rcl_reset_error();
+    EXPECT_EQ(RCL_RET_UNSUPPORTED, rcl_take(&subscription, &msg, nullptr));
+    rcl_reset_error();
+    test_msgs__msg__Primitives__fini(&msg);
+  }
+
+  void * published_message = nullptr;
+  ASSERT_EQ(RCL_RET_OK, rcl_borrow_loaned_message(&publisher, &published_message));
+  static_cast<test_msgs__msg__Primitives *>(published_message)->int64_value = 42;
+  ret = rcl_publish_loaned_message(&publisher, published_message);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  // The guard condition wakes the wait up.
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 1, 1, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_wait_set_fini(&wait_set);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  ret = rcl_wait_set_add_subscription(&wait_set, &subscription, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_add_guard_condition(&wait_set, guard_condition, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1000));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(guard_condition, wait_set.guard_conditions[0]);
+
+  // The subscription gets the very message which was published.
+  void * taken_message = nullptr;
+  rmw_message_info_t message_info;
+  ret = rcl_take_loaned_message(&subscription, &taken_message, &message_info);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(published_message, taken_message);
+  EXPECT_TRUE(message_info.from_intra_process);
+  EXPECT_EQ(42, static_cast<test_msgs__msg__Primitives *>(taken_message)->int64_value);
+  ret = rcl_take_loaned_message(&subscription, &taken_message, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+  rcl_reset_error();
+  ret = rcl_return_loaned_message_from_subscription(&subscription, published_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+}
+
+/* Test that taken intra process messages stay on loan until returned, even after a fini.
+ */
+TEST_F(
+  CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_intra_process_fini)
+{
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const char * topic = "rcl_test_intra_process_fini";
+  rcl_loan_options_t loan_options = rcl_loan_options_t();
+  loan_options.create_message = create_primitives;
+  loan_options.destroy_message = destroy_primitives;
+  loan_options.capacity = 1u;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.intra_process = true;
+  publisher_options.loan = loan_options;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.intra_process = true;
+  subscription_options.loan = loan_options;
+
+  // Finalizing a subscription returns the message it took, so it can be loaned again.
+  void * published_message = nullptr;
+  {
+    rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+    ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ASSERT_EQ(RCL_RET_OK, rcl_borrow_loaned_message(&publisher, &published_message));
+    ret = rcl_publish_loaned_message(&publisher, published_message);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    void * taken_message = nullptr;
+    ret = rcl_take_loaned_message(&subscription, &taken_message, nullptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_EQ(published_message, taken_message);
+    ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+
+  // A message taken from a publisher which is finalized meanwhile can still be used and returned.
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  });
+  ret = rcl_borrow_loaned_message(&publisher, &published_message);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  static_cast<test_msgs__msg__Primitives *>(published_message)->int64_value = 42;
+  ret = rcl_publish_loaned_message(&publisher, published_message);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  void * taken_message = nullptr;
+  ret = rcl_take_loaned_message(&subscription, &taken_message, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_publisher_fini(&publisher, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(42, static_cast<test_msgs__msg__Primitives *>(taken_message)->int64_value);
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken_message);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+}
+
+/* Test taking serialized messages into the buffers of the subscription's pool.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_serialized_pool) {
+  rcl_ret_t ret;
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.serialized_message_pool.buffers_per_class = 1u;
+  subscription_options.serialized_message_pool.min_capacity = 16u;
+  subscription_options.serialized_message_pool.class_count = 4u;
+  ASSERT_NO_FATAL_FAILURE(
+    this->init_publisher_and_subscription(
+      "rcl_test_subscription_serialized_pool", subscription_options));
+  const std::string test_string(200, 'x');
+  {
+    test_msgs__msg__Primitives msg;
+    test_msgs__msg__Primitives__init(&msg);
+    ASSERT_TRUE(rosidl_generator_c__String__assign(&msg.string_value, test_string.c_str()));
+    ret = rcl_publish(this->publisher_ptr, &msg);
+    test_msgs__msg__Primitives__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  ASSERT_NO_FATAL_FAILURE(this->wait_for_messages());
+  rcl_serialized_message_t * serialized_message = nullptr;
+  ret = rcl_take_serialized_message_from_pool(
+    this->subscription_ptr, &serialized_message, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_NE(nullptr, serialized_message);
+  EXPECT_GT(serialized_message->buffer_length, test_string.size());
+  ret = rcl_return_serialized_message_to_pool(this->subscription_ptr, serialized_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_return_serialized_message_to_pool(this->subscription_ptr, serialized_message);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  // Nothing taken, nothing handed out.
+  serialized_message = nullptr;
+  ret = rcl_take_serialized_message_from_pool(
+    this->subscription_ptr, &serialized_message, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, serialized_message);
+}
+
+/* Test that a keep latest subscription only takes the most recent message.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_keep_latest) {
+  rcl_ret_t ret;
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.keep_latest = true;
+  ASSERT_NO_FATAL_FAILURE(
+    this->init_publisher_and_subscription(
+      "rcl_test_subscription_keep_latest", subscription_options));
+  // The options hold the QoS the subscription was created with.
+  const rcl_subscription_options_t * options = rcl_subscription_get_options(this->subscription_ptr);
+  ASSERT_NE(nullptr, options) << rcl_get_error_string().str;
+  EXPECT_EQ(RMW_QOS_POLICY_HISTORY_KEEP_LAST, options->qos.history);
+  EXPECT_EQ(1u, options->qos.depth);
+  for (int64_t i = 1; i <= 3; ++i) {
+    test_msgs__msg__Primitives msg;
+    test_msgs__msg__Primitives__init(&msg);
+    msg.int64_value = i;
+    ret = rcl_publish(this->publisher_ptr, &msg);
+    test_msgs__msg__Primitives__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  ASSERT_NO_FATAL_FAILURE(this->wait_for_messages());
+  test_msgs__msg__Primitives msg;
+  test_msgs__msg__Primitives__init(&msg);
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    test_msgs__msg__Primitives__fini(&msg);
+  });
+  ret = rcl_take(this->subscription_ptr, &msg, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(3, msg.int64_value);
+  ret = rcl_take(this->subscription_ptr, &msg, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+}
+
+/* Test that a subscription with a content filter only takes the matching messages.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_content_filter) {
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.content_filter = "bool@0 = true";
+  ret = rcl_subscription_init(
+    &subscription, this->node_ptr, ts, "rcl_test_subscription_content_filter",
+    &subscription_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  // bool_value is the first field of the message.
+  subscription_options.content_filter = "bool@0 == true";
+  ASSERT_NO_FATAL_FAILURE(
+    this->init_publisher_and_subscription(
+      "rcl_test_subscription_content_filter", subscription_options));
+  for (int64_t i = 1; i <= 3; ++i) {
+    test_msgs__msg__Primitives msg;
+    test_msgs__msg__Primitives__init(&msg);
+    msg.bool_value = 2 == i;
+    msg.int64_value = i;
+    ret = rcl_publish(this->publisher_ptr, &msg);
+    test_msgs__msg__Primitives__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  ASSERT_NO_FATAL_FAILURE(this->wait_for_messages());
+  test_msgs__msg__Primitives msg;
+  test_msgs__msg__Primitives__init(&msg);
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    test_msgs__msg__Primitives__fini(&msg);
+  });
+  ret = rcl_take(this->subscription_ptr, &msg, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_TRUE(msg.bool_value);
+  EXPECT_EQ(2, msg.int64_value);
+  ret = rcl_take(this->subscription_ptr, &msg, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+}
+
+/* Test the traffic statistics of a subscription.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_statistics) {
+  rcl_ret_t ret;
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.traffic_statistics = true;
+  ASSERT_NO_FATAL_FAILURE(
+    this->init_publisher_and_subscription(
+      "rcl_test_subscription_traffic_statistics", subscription_options));
+  test_msgs__msg__Primitives msg;
+  test_msgs__msg__Primitives__init(&msg);
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    test_msgs__msg__Primitives__fini(&msg);
+  });
+  ret = rcl_take(this->subscription_ptr, &msg, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string().str;
+  msg.int64_value = 42;
+  ret = rcl_publish(this->publisher_ptr, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_NO_FATAL_FAILURE(this->wait_for_messages());
+  ret = rcl_take(this->subscription_ptr, &msg, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(42, msg.int64_value);
+  // 1.5 microseconds fall in the bucket from 1 up to 2 microseconds.
+  ret = rcl_subscription_add_latency_sample(this->subscription_ptr, 1500);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_traffic_statistics_t statistics;
+  ret = rcl_subscription_get_traffic_statistics(this->subscription_ptr, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(1u, statistics.message_count);
+  EXPECT_EQ(1u, statistics.failed_take_count);
+  EXPECT_EQ(0u, statistics.latency_histogram[0]);
+  EXPECT_EQ(1u, statistics.latency_histogram[1]);
+}
+
+/* Test initializing several subscriptions at once, and the rollback when one of them fails.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscriptions_init_bulk) {
+  rcl_ret_t ret;
+  const size_t kNumSubscriptions = 3u;
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Primitives);
+  const rosidl_message_type_support_t * type_supports[kNumSubscriptions] = {ts, ts, nullptr};
+  const char * topic_names[kNumSubscriptions] = {"chatter", "/chatter", "~/chatter"};
+  rcl_subscription_options_t options[kNumSubscriptions];
+  rcl_subscription_t subscriptions[kNumSubscriptions];
+  for (size_t i = 0u; i < kNumSubscriptions; ++i) {
+    options[i] = rcl_subscription_get_default_options();
+    subscriptions[i] = rcl_get_zero_initialized_subscription();
+  }
+
+  // The last subscription fails, after the others were initialized, which are finalized again.
+  ret = rcl_subscriptions_init_bulk(
+    subscriptions, this->node_ptr, type_supports, topic_names, options, kNumSubscriptions);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  for (size_t i = 0u; i < kNumSubscriptions; ++i) {
+    EXPECT_FALSE(rcl_subscription_is_valid(&subscriptions[i]));
+    rcl_reset_error();
+  }
+
+  type_supports[2] = ts;
+  ret = rcl_subscriptions_init_bulk(
+    subscriptions, this->node_ptr, type_supports, topic_names, options, kNumSubscriptions);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumSubscriptions; ++i) {
+      rcl_ret_t ret = rcl_subscription_fini(&subscriptions[i], this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    }
+  });
+  EXPECT_STREQ("/chatter", rcl_subscription_get_topic_name(&subscriptions[0]));
+  EXPECT_STREQ("/chatter", rcl_subscription_get_topic_name(&subscriptions[1]));
+  EXPECT_STREQ(
+    "/test_subscription_node/chatter", rcl_subscription_get_topic_name(&subscriptions[2]));
+
+  // An invalid name fails before any subscription is initialized.
+  rcl_subscription_t others[kNumSubscriptions];
+  for (size_t i = 0u; i < kNumSubscriptions; ++i) {
+    others[i] = rcl_get_zero_initialized_subscription();
+  }
+  topic_names[1] = "chatter//";
+  ret = rcl_subscriptions_init_bulk(
+    others, this->node_ptr, type_supports, topic_names, options, kNumSubscriptions);
+  EXPECT_EQ(RCL_RET_TOPIC_NAME_INVALID, ret);
+  rcl_reset_error();
+  for (size_t i = 0u; i < kNumSubscriptions; ++i) {
+    EXPECT_FALSE(rcl_subscription_is_valid(&others[i]));
+    rcl_reset_error();
+  }
+}
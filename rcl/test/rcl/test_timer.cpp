@@ -269,6 +269,60 @@ TEST_F(TestTimerFixture, test_canceled_timer) {
   EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
 }
 
+TEST_F(TestTimerFixture, test_timer_slack_coalesces_wake_ups) {
+  rcl_ret_t ret;
+
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+
+  rcl_timer_t timer = rcl_get_zero_initialized_timer();
+  rcl_timer_t timer2 = rcl_get_zero_initialized_timer();
+  ret = rcl_timer_init(
+    &timer, &clock, this->context_ptr, RCL_MS_TO_NS(10), nullptr, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_timer_init(
+    &timer2, &clock, this->context_ptr, RCL_MS_TO_NS(40), nullptr, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timer)) << rcl_get_error_string().str;
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timer2)) << rcl_get_error_string().str;
+  });
+
+  int64_t old_slack = -1;
+  ret = rcl_timer_exchange_slack(&timer, RCL_MS_TO_NS(50), &old_slack);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0, old_slack);
+  int64_t slack = 0;
+  ret = rcl_timer_get_slack(&timer, &slack);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(RCL_MS_TO_NS(50), slack);
+  ret = rcl_timer_exchange_slack(&timer, -1, &old_slack);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 0, 2, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+  ret = rcl_wait_set_add_timer(&wait_set, &timer, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_add_timer(&wait_set, &timer2, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  // The first timer tolerates waiting for the second one, so both are ready on one wake up.
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(&timer, wait_set.timers[0]);
+  EXPECT_EQ(&timer2, wait_set.timers[1]);
+}
+
 TEST_F(TestTimerFixture, test_rostime_time_until_next_call) {
   rcl_ret_t ret;
   const int64_t sec_5 = RCL_S_TO_NS(5);
@@ -493,3 +547,124 @@ TEST_F(TestTimerFixture, test_ros_time_wakes_wait) {
   EXPECT_TRUE(timer_was_ready);
   EXPECT_LT(finish - start, std::chrono::milliseconds(100));
 }
+
+TEST_F(TestTimerFixture, test_timerfd_wakes_wait) {
+  rcl_ret_t ret;
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  ASSERT_EQ(RCL_RET_OK, rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator)) <<
+    rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+
+  rcl_timer_t timer = rcl_get_zero_initialized_timer();
+  ret = rcl_timer_init(
+    &timer, &clock, this->context_ptr, RCL_MS_TO_NS(20), nullptr, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timer)) << rcl_get_error_string().str;
+  });
+  EXPECT_EQ(nullptr, rcl_timer_get_guard_condition(&timer));
+  ret = rcl_timer_enable_timerfd(&timer);
+#if !defined(__linux__)
+  EXPECT_EQ(RCL_RET_ERROR, ret);
+  rcl_reset_error();
+  return;
+#endif
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_NE(nullptr, rcl_timer_get_guard_condition(&timer));
+  EXPECT_EQ(RCL_RET_ALREADY_INIT, rcl_timer_enable_timerfd(&timer));
+  rcl_reset_error();
+
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 0, 1, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+
+  // A canceled timer does not shorten the timeout, the timerfd wakes the wait once it is reset.
+  ASSERT_EQ(RCL_RET_OK, rcl_timer_cancel(&timer)) << rcl_get_error_string().str;
+  std::thread reset_thr([&timer]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      EXPECT_EQ(RCL_RET_OK, rcl_timer_reset(&timer)) << rcl_get_error_string().str;
+    });
+  auto start = std::chrono::steady_clock::now();
+  bool timer_was_ready = false;
+  // The wait may end just before the timer is ready, the clocks are not the same.
+  for (int i = 0; i < 10 && !timer_was_ready; ++i) {
+    ASSERT_EQ(RCL_RET_OK, rcl_wait_set_clear(&wait_set)) << rcl_get_error_string().str;
+    ASSERT_EQ(RCL_RET_OK, rcl_wait_set_add_timer(&wait_set, &timer, NULL)) <<
+      rcl_get_error_string().str;
+    ret = rcl_wait(&wait_set, RCL_S_TO_NS(5));
+    ASSERT_NE(RCL_RET_ERROR, ret) << rcl_get_error_string().str;
+    timer_was_ready = nullptr != wait_set.timers[0];
+  }
+  auto finish = std::chrono::steady_clock::now();
+  reset_thr.join();
+  EXPECT_TRUE(timer_was_ready);
+  EXPECT_LT(finish - start, std::chrono::milliseconds(1000));
+}
+
+TEST_F(TestTimerFixture, test_timer_statistics) {
+  rcl_ret_t ret;
+  const int64_t sec_1 = RCL_S_TO_NS(1);
+
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  ret = rcl_clock_init(RCL_ROS_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  ASSERT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&clock, sec_1)) << rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_enable_ros_time_override(&clock)) << rcl_get_error_string().str;
+
+  rcl_timer_t timer = rcl_get_zero_initialized_timer();
+  ret = rcl_timer_init(
+    &timer, &clock, this->context_ptr, sec_1, nullptr, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timer)) << rcl_get_error_string().str;
+  });
+  ret = rcl_timer_set_lateness_histogram(&timer, RCL_MS_TO_NS(100));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  rcl_timer_statistics_t statistics;
+  ret = rcl_timer_get_statistics(&timer, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, statistics.call_count);
+  EXPECT_EQ(0, statistics.min_lateness);
+
+  // Scheduled at 2s, called at 3.5s, so the call at 3s is skipped.
+  ASSERT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&clock, sec_1 * 3 + RCL_MS_TO_NS(500))) <<
+    rcl_get_error_string().str;
+  ret = rcl_timer_call(&timer);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  // Scheduled at 4s, called at 4.2s.
+  ASSERT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&clock, sec_1 * 4 + RCL_MS_TO_NS(200))) <<
+    rcl_get_error_string().str;
+  ret = rcl_timer_call(&timer);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  ret = rcl_timer_get_statistics(&timer, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(2u, statistics.call_count);
+  EXPECT_EQ(1u, statistics.missed_period_count);
+  EXPECT_EQ(RCL_MS_TO_NS(200), statistics.min_lateness);
+  EXPECT_EQ(RCL_MS_TO_NS(1500), statistics.max_lateness);
+  EXPECT_EQ(RCL_MS_TO_NS(850), statistics.mean_lateness);
+  EXPECT_EQ(RCL_MS_TO_NS(100), statistics.histogram_bucket_width);
+  for (size_t i = 0; i < RCL_TIMER_LATENESS_HISTOGRAM_SIZE; ++i) {
+    EXPECT_EQ((i == 2 || i == 15) ? 1u : 0u, statistics.histogram[i]) << "bucket " << i;
+  }
+
+  ret = rcl_timer_reset_statistics(&timer);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_timer_get_statistics(&timer, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, statistics.call_count);
+  EXPECT_EQ(0u, statistics.missed_period_count);
+  EXPECT_EQ(0u, statistics.histogram[2]);
+}
@@ -0,0 +1,197 @@
+// Copyright 2018 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "rcl/timer_wheel.h"
+
+#include "rcl/rcl.h"
+
+#include "osrf_testing_tools_cpp/scope_exit.hpp"
+#include "rcl/error_handling.h"
+
+class TestTimerWheelFixture : public ::testing::Test
+{
+public:
+  rcl_context_t * context_ptr;
+  void SetUp()
+  {
+    rcl_init_options_t init_options = rcl_get_zero_initialized_init_options();
+    rcl_ret_t ret = rcl_init_options_init(&init_options, rcl_get_default_allocator());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+      EXPECT_EQ(RCL_RET_OK, rcl_init_options_fini(&init_options)) << rcl_get_error_string().str;
+    });
+    this->context_ptr = new rcl_context_t;
+    *this->context_ptr = rcl_get_zero_initialized_context();
+    ret = rcl_init(0, nullptr, &init_options, this->context_ptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+
+  void TearDown()
+  {
+    rcl_ret_t ret = rcl_shutdown(this->context_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_context_fini(this->context_ptr);
+    delete this->context_ptr;
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+};
+
+static void
+count_callback(rcl_timer_wheel_t * wheel, rcl_timer_wheel_entry_t entry, void * user_data)
+{
+  (void)wheel;
+  (void)entry;
+  ++*static_cast<int *>(user_data);
+}
+
+TEST_F(TestTimerWheelFixture, test_expire_in_order) {
+  const int64_t sec_1 = RCL_S_TO_NS(1);
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_ret_t ret = rcl_clock_init(RCL_ROS_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  ASSERT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&clock, sec_1)) << rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_enable_ros_time_override(&clock)) << rcl_get_error_string().str;
+
+  rcl_timer_wheel_t wheel = rcl_get_zero_initialized_timer_wheel();
+  // Start small, so the storage has to grow.
+  ret = rcl_timer_wheel_init(&wheel, &clock, this->context_ptr, RCL_MS_TO_NS(1), 4, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_fini(&wheel)) << rcl_get_error_string().str;
+  });
+  EXPECT_EQ(RCL_RET_ALREADY_INIT, rcl_timer_wheel_init(
+      &wheel, &clock, this->context_ptr, RCL_MS_TO_NS(1), 4, allocator));
+  rcl_reset_error();
+
+  // One shot entries spread over more than the first two levels of the wheel.
+  const size_t kNumEntries = 1000u;
+  const int64_t kStep = RCL_MS_TO_NS(7);
+  std::vector<int> fired(kNumEntries, 0);
+  std::vector<rcl_timer_wheel_entry_t> entries(kNumEntries);
+  for (size_t i = 0u; i < kNumEntries; ++i) {
+    ret = rcl_timer_wheel_arm(
+      &wheel, static_cast<int64_t>(i + 1) * kStep, 0, count_callback, &fired[i], &entries[i]);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  int periodic_fired = 0;
+  ret = rcl_timer_wheel_arm(
+    &wheel, RCL_MS_TO_NS(100), RCL_MS_TO_NS(100), count_callback, &periodic_fired, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  size_t count = 0u;
+  EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_get_entry_count(&wheel, &count));
+  EXPECT_EQ(kNumEntries + 1u, count);
+
+  // The timer of the wheel is ready when the first entry expires.
+  rcl_timer_t * timer = rcl_timer_wheel_get_timer(&wheel);
+  ASSERT_NE(nullptr, timer);
+  int64_t time_until = 0;
+  ASSERT_EQ(RCL_RET_OK, rcl_timer_get_time_until_next_call(timer, &time_until)) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(kStep, time_until);
+
+  const size_t kCanceled = 500u;
+  EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_cancel(&wheel, entries[kCanceled])) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, rcl_timer_wheel_cancel(&wheel, entries[kCanceled]));
+  rcl_reset_error();
+
+  const int64_t end = static_cast<int64_t>(kNumEntries + 1) * kStep;
+  for (int64_t elapsed = 0; elapsed <= end; elapsed += RCL_MS_TO_NS(50)) {
+    ASSERT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&clock, sec_1 + elapsed)) <<
+      rcl_get_error_string().str;
+    ASSERT_EQ(RCL_RET_OK, rcl_timer_wheel_call(&wheel)) << rcl_get_error_string().str;
+    for (size_t i = 0u; i < kNumEntries; ++i) {
+      const bool expired = i != kCanceled && static_cast<int64_t>(i + 1) * kStep <= elapsed;
+      ASSERT_EQ(expired ? 1 : 0, fired[i]) << "entry " << i << " at " << elapsed << "ns";
+    }
+    EXPECT_EQ(elapsed / RCL_MS_TO_NS(100), periodic_fired);
+  }
+  // Only the periodic entry is left.
+  EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_get_entry_count(&wheel, &count));
+  EXPECT_EQ(1u, count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, rcl_timer_wheel_cancel(&wheel, entries[0]));
+  rcl_reset_error();
+}
+
+struct rearm_state
+{
+  int fired;
+  rcl_timer_wheel_entry_t entry;
+};
+
+static void
+rearm_callback(rcl_timer_wheel_t * wheel, rcl_timer_wheel_entry_t entry, void * user_data)
+{
+  (void)entry;
+  rearm_state * state = static_cast<rearm_state *>(user_data);
+  ++state->fired;
+  EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_arm(
+      wheel, RCL_MS_TO_NS(10), 0, rearm_callback, state, &state->entry));
+}
+
+TEST_F(TestTimerWheelFixture, test_wait_and_call_timer) {
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_ret_t ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  rcl_timer_wheel_t wheel = rcl_get_zero_initialized_timer_wheel();
+  ret = rcl_timer_wheel_init(&wheel, &clock, this->context_ptr, RCL_MS_TO_NS(1), 0, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_fini(&wheel)) << rcl_get_error_string().str;
+  });
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 0, 1, 0, 0, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+
+  // Nothing is armed, so the wheel does not wake the wait set.
+  ret = rcl_wait_set_add_timer(&wait_set, rcl_timer_wheel_get_timer(&wheel), NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(20));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+
+  // An entry which rearms itself from its callback.
+  rearm_state state = {0, 0};
+  ret = rcl_timer_wheel_arm(&wheel, RCL_MS_TO_NS(10), 0, rearm_callback, &state, &state.entry);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  for (int i = 1; i <= 3; ++i) {
+    ret = rcl_wait_set_clear(&wait_set);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_timer(&wait_set, rcl_timer_wheel_get_timer(&wheel), NULL);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ASSERT_NE(nullptr, wait_set.timers[0]);
+    // Calling the timer expires the entries of the wheel.
+    ret = rcl_timer_call(rcl_timer_wheel_get_timer(&wheel));
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    EXPECT_EQ(i, state.fired);
+  }
+  EXPECT_EQ(RCL_RET_OK, rcl_timer_wheel_cancel(&wheel, state.entry)) <<
+    rcl_get_error_string().str;
+}
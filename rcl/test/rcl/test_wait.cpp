@@ -477,3 +477,636 @@ TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), add_with_index) {
     EXPECT_EQ(&guard_conditions[i], wait_set.guard_conditions[i]);
   }
 }
+
+// Check that a persistent wait set keeps its members across calls to rcl_wait
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), persistent_membership) {
+  const size_t kNumEntities = 3u;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(
+    &wait_set, 0, kNumEntities, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_remove_guard_condition(&wait_set, 0u);
+  EXPECT_EQ(RCL_RET_ERROR, ret);
+  rcl_reset_error();
+  ret = rcl_wait_set_set_persistent(&wait_set, true);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  bool persistent = false;
+  ret = rcl_wait_set_is_persistent(&wait_set, &persistent);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_TRUE(persistent);
+
+  rcl_guard_condition_t guard_conditions[kNumEntities];
+  for (size_t i = 0u; i < kNumEntities; ++i) {
+    guard_conditions[i] = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_conditions[i], this->context_ptr, rcl_guard_condition_get_default_options());
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_conditions[i], NULL);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumEntities; ++i) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_conditions[i])) <<
+        rcl_get_error_string().str;
+    }
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+
+  // Each wait sees every member without clearing and adding again.
+  for (size_t i = 0u; i < kNumEntities; ++i) {
+    ret = rcl_trigger_guard_condition(&guard_conditions[i]);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait(&wait_set, RCL_MS_TO_NS(100));
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    for (size_t j = 0u; j < kNumEntities; ++j) {
+      if (i == j) {
+        EXPECT_EQ(&guard_conditions[j], wait_set.guard_conditions[j]);
+      } else {
+        EXPECT_EQ(nullptr, wait_set.guard_conditions[j]);
+      }
+    }
+  }
+
+  // A removed member is no longer waited on and its slot is reused by the next add.
+  ret = rcl_wait_set_remove_guard_condition(&wait_set, 1u);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_trigger_guard_condition(&guard_conditions[1]);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, 0);
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  size_t index = 42u;
+  ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_conditions[1], &index);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(1u, index);
+  ret = rcl_trigger_guard_condition(&guard_conditions[2]);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(100));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, wait_set.guard_conditions[0]);
+  EXPECT_EQ(&guard_conditions[2], wait_set.guard_conditions[2]);
+}
+
+// Check that rcl_wait lists exactly the ready entities
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), ready_entities) {
+  const size_t kNumEntities = 4u;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(
+    &wait_set, 0, kNumEntities, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_guard_condition_t guard_conditions[kNumEntities];
+  for (size_t i = 0u; i < kNumEntities; ++i) {
+    guard_conditions[i] = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_conditions[i], this->context_ptr, rcl_guard_condition_get_default_options());
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_conditions[i], NULL);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumEntities; ++i) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_conditions[i])) <<
+        rcl_get_error_string().str;
+    }
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+
+  const rcl_wait_set_ready_entity_t * ready_entities = nullptr;
+  size_t count = 42u;
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, count);
+
+  ret = rcl_trigger_guard_condition(&guard_conditions[1]);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_trigger_guard_condition(&guard_conditions[3]);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(100));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(2u, count);
+  EXPECT_EQ(RCL_WAIT_SET_GUARD_CONDITION, ready_entities[0].type);
+  EXPECT_EQ(1u, ready_entities[0].index);
+  EXPECT_EQ(RCL_WAIT_SET_GUARD_CONDITION, ready_entities[1].type);
+  EXPECT_EQ(3u, ready_entities[1].index);
+
+  ret = rcl_wait_set_clear(&wait_set);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, count);
+}
+
+// Check that the ready list is sorted by the dispatch attributes of the entities.
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), sort_ready_entities) {
+  const size_t kNumTimers = 3u;
+  const size_t kNumGuardConditions = 2u;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_clock_t clock;
+  rcl_ret_t ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, kNumGuardConditions, kNumTimers, 0, 0, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_guard_condition_t guard_conditions[kNumGuardConditions];
+  for (size_t i = 0u; i < kNumGuardConditions; ++i) {
+    guard_conditions[i] = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_conditions[i], this->context_ptr, rcl_guard_condition_get_default_options());
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_conditions[i], NULL);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_trigger_guard_condition(&guard_conditions[i]);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  // The first timer has no attributes, the second a high priority, the third a deadline.
+  const rcl_dispatch_attributes_t attributes[kNumTimers] = {{0, 0}, {5, 0}, {0, RCL_S_TO_NS(1)}};
+  rcl_timer_t timers[kNumTimers];
+  for (size_t i = 0u; i < kNumTimers; ++i) {
+    timers[i] = rcl_get_zero_initialized_timer();
+    ret = rcl_timer_init(
+      &timers[i], &clock, this->context_ptr, RCL_MS_TO_NS(1), nullptr, allocator);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_timer_set_dispatch_attributes(&timers[i], &attributes[i]);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_timer(&wait_set, &timers[i], NULL);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumTimers; ++i) {
+      EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timers[i])) << rcl_get_error_string().str;
+    }
+    for (size_t i = 0u; i < kNumGuardConditions; ++i) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_conditions[i])) <<
+        rcl_get_error_string().str;
+    }
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  rcl_dispatch_attributes_t timer_attributes = {0, 0};
+  ret = rcl_timer_get_dispatch_attributes(&timers[2], &timer_attributes);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(RCL_S_TO_NS(1), timer_attributes.deadline);
+  timer_attributes.deadline = -1;
+  ret = rcl_timer_set_dispatch_attributes(&timers[2], &timer_attributes);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(100));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  const rcl_wait_set_ready_entity_t * ready_entities = nullptr;
+  size_t count = 0u;
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(kNumTimers + kNumGuardConditions, count);
+
+  // Entities without priority or deadline keep the order of the wait, timers first.
+  const rcl_wait_set_ready_entity_t by_priority[] = {
+    {RCL_WAIT_SET_TIMER, 1u}, {RCL_WAIT_SET_TIMER, 2u}, {RCL_WAIT_SET_TIMER, 0u},
+    {RCL_WAIT_SET_GUARD_CONDITION, 0u}, {RCL_WAIT_SET_GUARD_CONDITION, 1u}};
+  const rcl_wait_set_ready_entity_t by_deadline[] = {
+    {RCL_WAIT_SET_TIMER, 2u}, {RCL_WAIT_SET_TIMER, 1u}, {RCL_WAIT_SET_TIMER, 0u},
+    {RCL_WAIT_SET_GUARD_CONDITION, 0u}, {RCL_WAIT_SET_GUARD_CONDITION, 1u}};
+  const rcl_wait_set_ready_entity_t by_wait_set[] = {
+    {RCL_WAIT_SET_TIMER, 0u}, {RCL_WAIT_SET_TIMER, 1u}, {RCL_WAIT_SET_TIMER, 2u},
+    {RCL_WAIT_SET_GUARD_CONDITION, 0u}, {RCL_WAIT_SET_GUARD_CONDITION, 1u}};
+  const struct
+  {
+    rcl_dispatch_order_t order;
+    const rcl_wait_set_ready_entity_t * expected;
+  } cases[] = {
+    {RCL_DISPATCH_ORDER_PRIORITY, by_priority},
+    {RCL_DISPATCH_ORDER_EARLIEST_DEADLINE, by_deadline},
+    {RCL_DISPATCH_ORDER_WAIT_SET, by_wait_set},
+  };
+  for (const auto & sort_case : cases) {
+    ret = rcl_wait_set_sort_ready_entities(&wait_set, sort_case.order);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    for (size_t i = 0u; i < count; ++i) {
+      EXPECT_EQ(sort_case.expected[i].type, ready_entities[i].type) << i;
+      EXPECT_EQ(sort_case.expected[i].index, ready_entities[i].index) << i;
+    }
+  }
+}
+
+// Check that only the earliest timer decides the timeout and only due timers are ready.
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), timer_queue) {
+  const size_t kNumTimers = 4u;
+  const int64_t periods[kNumTimers] = {
+    RCL_S_TO_NS(2), RCL_MS_TO_NS(50), RCL_S_TO_NS(3), RCL_S_TO_NS(1)};
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_clock_t clock;
+  rcl_ret_t ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 0, kNumTimers, 0, 0, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_set_persistent(&wait_set, true);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_timer_t timers[kNumTimers];
+  for (size_t i = 0u; i < kNumTimers; ++i) {
+    timers[i] = rcl_get_zero_initialized_timer();
+    ret = rcl_timer_init(
+      &timers[i], &clock, this->context_ptr, periods[i], nullptr, allocator);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+    ret = rcl_wait_set_add_timer(&wait_set, &timers[i], NULL);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (size_t i = 0u; i < kNumTimers; ++i) {
+      EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timers[i])) << rcl_get_error_string().str;
+    }
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+
+  const rcl_wait_set_ready_entity_t * ready_entities = nullptr;
+  size_t count = 0u;
+  std::chrono::steady_clock::time_point before_sc = std::chrono::steady_clock::now();
+  ret = rcl_wait(&wait_set, -1);
+  std::chrono::steady_clock::time_point after_sc = std::chrono::steady_clock::now();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  int64_t diff = std::chrono::duration_cast<std::chrono::nanoseconds>(after_sc - before_sc).count();
+  EXPECT_LE(diff, RCL_MS_TO_NS(50) + TOLERANCE);
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(1u, count);
+  EXPECT_EQ(RCL_WAIT_SET_TIMER, ready_entities[0].type);
+  EXPECT_EQ(1u, ready_entities[0].index);
+  for (size_t i = 0u; i < kNumTimers; ++i) {
+    EXPECT_EQ(i == 1u ? &timers[i] : nullptr, wait_set.timers[i]);
+  }
+  ret = rcl_timer_call(&timers[1]);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  // A canceled timer no longer bounds the timeout.
+  ret = rcl_timer_cancel(&timers[1]);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(100));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(0u, count);
+
+  // Resetting it brings it back.
+  ret = rcl_timer_reset(&timers[1]);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(500));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_get_ready_entities(&wait_set, &ready_entities, &count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(1u, count);
+  EXPECT_EQ(1u, ready_entities[0].index);
+}
+
+// Test rcl_wait_until with a deadline on a steady clock and on a clock with ROS time active.
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), wait_until) {
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 0, 1, 0, 0, 0, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_guard_condition_t guard_cond = rcl_get_zero_initialized_guard_condition();
+  ret = rcl_guard_condition_init(
+    &guard_cond, this->context_ptr, rcl_guard_condition_get_default_options());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+
+  rcl_clock_t steady_clock;
+  ret = rcl_clock_init(RCL_STEADY_TIME, &steady_clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  rcl_clock_t ros_clock;
+  ret = rcl_clock_init(RCL_ROS_TIME, &ros_clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&steady_clock)) << rcl_get_error_string().str;
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&ros_clock)) << rcl_get_error_string().str;
+  });
+
+  rcl_time_point_t deadline;
+  deadline.clock_type = RCL_STEADY_TIME;
+  ret = rcl_clock_get_now(&steady_clock, &deadline.nanoseconds);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  deadline.nanoseconds += RCL_MS_TO_NS(20);
+  ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_cond, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_until(&wait_set, &ros_clock, &deadline, this->context_ptr);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ret = rcl_wait_until(&wait_set, &steady_clock, &deadline, this->context_ptr);
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  rcl_time_point_value_t now;
+  ret = rcl_clock_get_now(&steady_clock, &now);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_GE(now, deadline.nanoseconds);
+  EXPECT_LE(now, deadline.nanoseconds + TOLERANCE);
+
+  // ROS time only advances when it is set, the wait ends once it passes the deadline.
+  ASSERT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&ros_clock, RCL_S_TO_NS(1))) <<
+    rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_enable_ros_time_override(&ros_clock)) << rcl_get_error_string().str;
+  deadline.clock_type = RCL_ROS_TIME;
+  deadline.nanoseconds = RCL_S_TO_NS(2);
+  std::future<void> f = std::async(std::launch::async, [&ros_clock]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      // Not yet at the deadline.
+      EXPECT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&ros_clock, RCL_MS_TO_NS(1500)));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      EXPECT_EQ(RCL_RET_OK, rcl_set_ros_time_override(&ros_clock, RCL_S_TO_NS(2)));
+    });
+  ret = rcl_wait_set_clear(&wait_set);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_cond, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  std::chrono::steady_clock::time_point before_sc = std::chrono::steady_clock::now();
+  ret = rcl_wait_until(&wait_set, &ros_clock, &deadline, this->context_ptr);
+  std::chrono::steady_clock::time_point after_sc = std::chrono::steady_clock::now();
+  f.get();
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, wait_set.guard_conditions[0]);
+  int64_t diff = std::chrono::duration_cast<std::chrono::nanoseconds>(after_sc - before_sc).count();
+  EXPECT_LE(diff, RCL_S_TO_NS(1));
+}
+
+// Check that a wait set with only steady time timers wakes up for the earliest one.
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), timers_only) {
+  rcl_clock_t clock;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_ret_t ret = rcl_clock_init(RCL_STEADY_TIME, &clock, &allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_clock_fini(&clock)) << rcl_get_error_string().str;
+  });
+  rcl_timer_t timers[2] = {rcl_get_zero_initialized_timer(), rcl_get_zero_initialized_timer()};
+  const int64_t periods[2] = {RCL_MS_TO_NS(30), RCL_MS_TO_NS(10)};
+  for (size_t i = 0u; i < 2u; ++i) {
+    ret = rcl_timer_init(&timers[i], &clock, this->context_ptr, periods[i], nullptr, allocator);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timers[0])) << rcl_get_error_string().str;
+    EXPECT_EQ(RCL_RET_OK, rcl_timer_fini(&timers[1])) << rcl_get_error_string().str;
+  });
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 0, 2, 0, 0, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+  for (size_t i = 0u; i < 2u; ++i) {
+    ret = rcl_wait_set_add_timer(&wait_set, &timers[i], NULL);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+
+  // The timeout is shorter than both periods.
+  std::chrono::steady_clock::time_point before_sc = std::chrono::steady_clock::now();
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(5));
+  std::chrono::steady_clock::time_point after_sc = std::chrono::steady_clock::now();
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  int64_t diff = std::chrono::duration_cast<std::chrono::nanoseconds>(after_sc - before_sc).count();
+  EXPECT_GE(diff, RCL_MS_TO_NS(5));
+  EXPECT_LE(diff, RCL_MS_TO_NS(5) + TOLERANCE);
+
+  ret = rcl_wait_set_clear(&wait_set);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  for (size_t i = 0u; i < 2u; ++i) {
+    ret = rcl_wait_set_add_timer(&wait_set, &timers[i], NULL);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  after_sc = std::chrono::steady_clock::now();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, wait_set.timers[0]);
+  EXPECT_EQ(&timers[1], wait_set.timers[1]);
+  diff = std::chrono::duration_cast<std::chrono::nanoseconds>(after_sc - before_sc).count();
+  // The timers started before the first wait.
+  EXPECT_LE(diff, periods[1] + TOLERANCE);
+}
+
+// Check that waits spin before blocking and are counted by how they were resolved.
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), spin_budget) {
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 0, 1, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+  rcl_guard_condition_t guard_cond = rcl_get_zero_initialized_guard_condition();
+  ret = rcl_guard_condition_init(
+    &guard_cond, this->context_ptr, rcl_guard_condition_get_default_options());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+  });
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_set_persistent(&wait_set, true)) <<
+    rcl_get_error_string().str;
+  ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_cond, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, rcl_wait_set_set_spin_budget(&wait_set, -1));
+  rcl_reset_error();
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_set_spin_budget(&wait_set, RCL_MS_TO_NS(2))) <<
+    rcl_get_error_string().str;
+  int64_t spin_budget = 0;
+  EXPECT_EQ(RCL_RET_OK, rcl_wait_set_get_spin_budget(&wait_set, &spin_budget));
+  EXPECT_EQ(RCL_MS_TO_NS(2), spin_budget);
+
+  // Ready while spinning.
+  ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_cond)) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(&guard_cond, wait_set.guard_conditions[0]);
+
+  // Nothing ready, the timeout expires after the spin budget.
+  std::chrono::steady_clock::time_point before_sc = std::chrono::steady_clock::now();
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(10));
+  std::chrono::steady_clock::time_point after_sc = std::chrono::steady_clock::now();
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  int64_t diff = std::chrono::duration_cast<std::chrono::nanoseconds>(after_sc - before_sc).count();
+  EXPECT_LE(diff, RCL_MS_TO_NS(10) + TOLERANCE);
+  EXPECT_EQ(nullptr, wait_set.guard_conditions[0]);
+
+  // Ready after blocking.
+  std::future<void> f = std::async(std::launch::async, [&guard_cond]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      EXPECT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_cond));
+    });
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  f.get();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(&guard_cond, wait_set.guard_conditions[0]);
+
+  rcl_wait_set_spin_statistics_t statistics;
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_get_spin_statistics(&wait_set, &statistics)) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(3u, statistics.spin_count);
+  EXPECT_EQ(1u, statistics.spin_wake_count);
+  EXPECT_EQ(1u, statistics.block_wake_count);
+  EXPECT_EQ(1u, statistics.timeout_count);
+
+  // The timeout expires while spinning, nothing is reported ready.
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, wait_set.guard_conditions[0]);
+
+  // Without a budget nothing is counted.
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_reset_spin_statistics(&wait_set));
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_set_spin_budget(&wait_set, 0));
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_get_spin_statistics(&wait_set, &statistics));
+  EXPECT_EQ(0u, statistics.spin_count);
+  EXPECT_EQ(0u, statistics.timeout_count);
+}
+
+static void *
+counting_allocate(size_t size, void * state)
+{
+  ++*static_cast<size_t *>(state);
+  return rcutils_get_default_allocator().allocate(size, nullptr);
+}
+
+static void
+counting_deallocate(void * pointer, void * state)
+{
+  (void)state;
+  rcutils_get_default_allocator().deallocate(pointer, nullptr);
+}
+
+static void *
+counting_reallocate(void * pointer, size_t size, void * state)
+{
+  ++*static_cast<size_t *>(state);
+  return rcutils_get_default_allocator().reallocate(pointer, size, nullptr);
+}
+
+static void *
+counting_zero_allocate(size_t count, size_t size, void * state)
+{
+  ++*static_cast<size_t *>(state);
+  return rcutils_get_default_allocator().zero_allocate(count, size, nullptr);
+}
+
+// Check that the wait set storage is one block which only grows.
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), resize_reuses_storage) {
+  size_t allocations = 0u;
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  allocator.allocate = counting_allocate;
+  allocator.deallocate = counting_deallocate;
+  allocator.reallocate = counting_reallocate;
+  allocator.zero_allocate = counting_zero_allocate;
+  allocator.state = &allocations;
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 4, 4, 4, 4, 4, allocator);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+
+  // Shrinking and growing back does not allocate, neither does switching to persistent.
+  allocations = 0u;
+  ret = rcl_wait_set_resize(&wait_set, 1, 1, 0, 0, 0);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(nullptr, wait_set.timers);
+  ret = rcl_wait_set_resize(&wait_set, 4, 4, 4, 4, 4);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_set_persistent(&wait_set, true)) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(0u, allocations);
+
+  // Growing allocates a single block.
+  ret = rcl_wait_set_resize(&wait_set, 40, 4, 4, 4, 4);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(1u, allocations);
+  EXPECT_EQ(40u, wait_set.size_of_subscriptions);
+
+  // The wait set still works.
+  rcl_guard_condition_t guard_cond = rcl_get_zero_initialized_guard_condition();
+  ret = rcl_guard_condition_init(
+    &guard_cond, this->context_ptr, rcl_guard_condition_get_default_options());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+  });
+  ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_cond, NULL);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_cond)) << rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  EXPECT_EQ(&guard_cond, wait_set.guard_conditions[0]);
+}
+
+TEST_F(CLASSNAME(WaitSetTestFixture, RMW_IMPLEMENTATION), statistics) {
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  rcl_ret_t ret = rcl_wait_set_init(&wait_set, 0, 2, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    EXPECT_EQ(RCL_RET_OK, rcl_wait_set_fini(&wait_set)) << rcl_get_error_string().str;
+  });
+  rcl_guard_condition_t guard_conds[2];
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    guard_cond = rcl_get_zero_initialized_guard_condition();
+    ret = rcl_guard_condition_init(
+      &guard_cond, this->context_ptr, rcl_guard_condition_get_default_options());
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT({
+    for (rcl_guard_condition_t & guard_cond : guard_conds) {
+      EXPECT_EQ(RCL_RET_OK, rcl_guard_condition_fini(&guard_cond)) << rcl_get_error_string().str;
+    }
+  });
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_set_persistent(&wait_set, true)) <<
+    rcl_get_error_string().str;
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    ret = rcl_wait_set_add_guard_condition(&wait_set, &guard_cond, NULL);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  }
+
+  // Nothing is counted until the statistics are enabled.
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(1));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  rcl_wait_set_statistics_t statistics;
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_get_statistics(&wait_set, &statistics)) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(0u, statistics.wait_count);
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_enable_statistics(&wait_set, true)) <<
+    rcl_get_error_string().str;
+
+  ret = rcl_wait(&wait_set, RCL_MS_TO_NS(10));
+  EXPECT_EQ(RCL_RET_TIMEOUT, ret) << rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_conds[0])) <<
+    rcl_get_error_string().str;
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+  for (rcl_guard_condition_t & guard_cond : guard_conds) {
+    ASSERT_EQ(RCL_RET_OK, rcl_trigger_guard_condition(&guard_cond)) <<
+      rcl_get_error_string().str;
+  }
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string().str;
+
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_get_statistics(&wait_set, &statistics)) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(3u, statistics.wait_count);
+  EXPECT_EQ(1u, statistics.timeout_count);
+  EXPECT_EQ(0u, statistics.empty_wake_count);
+  EXPECT_GE(statistics.blocked_time, RCL_MS_TO_NS(10));
+  EXPECT_GE(statistics.bookkeeping_time, 0);
+  const uint64_t * guard_condition_histogram =
+    statistics.ready_histogram[RCL_WAIT_SET_GUARD_CONDITION];
+  EXPECT_EQ(1u, guard_condition_histogram[0]);
+  EXPECT_EQ(1u, guard_condition_histogram[1]);
+  EXPECT_EQ(1u, guard_condition_histogram[2]);
+  EXPECT_EQ(3u, statistics.ready_histogram[RCL_WAIT_SET_SUBSCRIPTION][0]);
+
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_reset_statistics(&wait_set)) <<
+    rcl_get_error_string().str;
+  ASSERT_EQ(RCL_RET_OK, rcl_wait_set_get_statistics(&wait_set, &statistics)) <<
+    rcl_get_error_string().str;
+  EXPECT_EQ(0u, statistics.wait_count);
+  EXPECT_EQ(0, statistics.blocked_time);
+  EXPECT_EQ(0u, statistics.ready_histogram[RCL_WAIT_SET_GUARD_CONDITION][1]);
+}